@@ -14,6 +14,7 @@
 #define _HEADER_FILE_RBTree_20211208190717_
 
 #include <stdint.h>
+#include <stddef.h>
 
 /**
  * Internal RBT tree node, carrying a key and a data reference,
@@ -22,6 +23,7 @@
  * Coloring is determinted by the most significate bit of the key with
  * a set bit marking the node as red, and a cleared bit marking the node as black.
  * On 64 bit systems this gives a 2^63 number of unique keys.
+ * Trees using the WAVL balancing policy keep the parity of the node rank in the same bit.
  */
 struct RBT_Node {
     uintmax_t key;
@@ -31,15 +33,109 @@ struct RBT_Node {
     struct RBT_Node *parent;
 };
 
+/**
+ * Description of a monoid used to augment a RBT tree with subtree aggregates.
+ *
+ * Every node keeps the aggregate of its whole subtree, stored right after the node
+ * in the same allocation. "lift" turns a single key and value into an aggregate,
+ * while "combine" joins the aggregates of two adjacent key ranges, left range first.
+ * "combine" must be associative, and "identity" must be its neutral element.
+ * The output pointers handed to "lift" and "combine" never alias their inputs.
+ */
+struct RBT_Augment {
+    size_t size;
+    const void *identity;
+    void (*lift)(void *out, uintmax_t key, void *data, void *context);
+    void (*combine)(void *out, const void *left, const void *right, void *context);
+    void *context;
+};
+
+struct RBT_Hash_Index;
+struct RBT_Capacity;
+struct RBT_Filter;
+struct RBT_Trace;
+struct RBT_Extension;
+
+/*
+ * number of elements a tree with inline entries keeps in an array, see RBT_set_inline_entries.
+ */
+#ifndef RBT_INLINE_CAPACITY
+#define RBT_INLINE_CAPACITY 4
+#endif
+
+/**
+ * Policies for choosing the element evicted from a tree at its capacity, see RBT_set_capacity.
+ */
+enum RBT_Eviction {
+    RBT_EVICT_MINIMUM,
+    RBT_EVICT_MAXIMUM,
+    RBT_EVICT_LEAST_RECENT
+};
+
+/**
+ * Balancing policies of a RBT tree, see RBT_set_balance.
+ */
+enum RBT_Balance {
+    RBT_BALANCE_RED_BLACK,
+    RBT_BALANCE_WAVL
+};
+
+/**
+ * Engines storing the elements of a RBT tree, see RBT_set_engine.
+ */
+enum RBT_Engine {
+    RBT_ENGINE_RED_BLACK,
+    RBT_ENGINE_BPLUS
+};
+
 /**
  * Front facade for the RBT tree carrying the root node,
  * as well as some meta data.
+ * With lazy deletion enabled, node_count only counts the live elements, while
+ * dead_count counts the deleted nodes still linked into the tree.
+ * The generation is advanced whenever nodes are freed, invalidating fingers into the tree.
+ * Every node of a tree is node_size bytes, fixed by the options enabled while it was empty.
+ * The options most trees never set, such as the hash index, the lookup filter, the capacity bound,
+ * the trace, the memory budget, the reserve, the inline entries and the B+-tree of a tree using
+ * the RBT_ENGINE_BPLUS engine, live in "extension", which is
+ * allocated along with the first of them and freed by RBT_deinit_tree, so the facade of every tree
+ * fits in a single cache line.
  */
 struct RBT_Tree {
     struct RBT_Node *root;
     uintmax_t node_count;
+    const struct RBT_Augment *augment;
+    uintmax_t dead_count;
+    uintmax_t generation;
+    size_t node_size;
+    struct RBT_Extension *extension;
+    unsigned purge_percent;
+    enum RBT_Balance balance;
+};
+
+/**
+ * Bytes of memory held by a tree, or by every RBT tree together. "nodes" counts the bytes requested
+ * for the nodes, and "slack" the bytes the allocator handed out beyond those requests, as far as
+ * RBT_USABLE_SIZE can tell. "auxiliary" counts the bytes of the hash index, the lookup filter and the
+ * capacity bound.
+ */
+struct RBT_Memory_Usage {
+    uintmax_t nodes;
+    uintmax_t slack;
+    uintmax_t auxiliary;
+};
+
+/**
+ * Position of the last lookup of a caller in a tree, so lookups of nearby keys can start
+ * from there. Fingers are owned by the caller, and must be initialized with RBT_FINGER_INIT.
+ */
+struct RBT_Finger {
+    struct RBT_Node *node;
+    uintmax_t generation;
 };
 
+#define RBT_FINGER_INIT { NULL, 0 }
+
 /**
  *  RBT tree initialization.
  *  The memory allocation of the RBT_Tree is owned by the caller.
@@ -89,11 +185,268 @@ int RBT_get_maximum(struct RBT_Tree *tree, uintmax_t *key, void **value);
  */
 int RBT_get_minimum(struct RBT_Tree *tree, uintmax_t *key, void **value);
 
+/**
+ * Visits every element of the tree in ascending key order. The iteration stops early
+ * when "visit" returns zero. The tree must not be modified while it is being visited.
+ * @returns a non-zero value if every element was visited, zero otherwise.
+ */
+int RBT_for_each(struct RBT_Tree *tree, int (*visit)(uintmax_t key, void *data, void *context), void *context);
+
+/**
+ * Enables subtree aggregates on an empty RBT tree. The augment description is not copied,
+ * so it has to outlive the tree. With augmentation enabled every node allocation is
+ * augment->size bytes larger than sizeof(struct RBT_Node).
+ * @returns a non-zero value on success, zero if the tree is not empty or the aggregate
+ * size exceeds RBT_AGGREGATE_MAX_SIZE.
+ */
+int RBT_set_augment(struct RBT_Tree *tree, const struct RBT_Augment *augment);
+
+/**
+ * Computes the aggregate of every element with a key in the closed range [lo; hi] in O(log n).
+ * "out" must point to at least augment->size bytes, and receives the identity for an empty range.
+ * @returns a non-zero value on success, zero if the tree is not augmented.
+ */
+int RBT_range_aggregate(struct RBT_Tree *tree, uintmax_t lo, uintmax_t hi, void *out);
+
+/**
+ * Recomputes the aggregates on the path from the node with the given key to the root.
+ * This has to be called after the data referenced by an element is changed in place.
+ * @returns a non-zero value if a node with the key was found, zero otherwise.
+ */
+int RBT_refresh_aggregate(struct RBT_Tree *tree, uintmax_t key);
+
+/**
+ * Enables lazy deletion, where RBT_delete only marks the node as dead instead of unlinking and
+ * rebalancing. Dead nodes are skipped by every lookup, and a later RBT_add of the same key
+ * revives a dead node in place. Once at least "purge_percent" percent of the nodes are dead
+ * the tree is purged; a value above 100 leaves purging to explicit RBT_purge calls.
+ * A "purge_percent" of zero purges the tree and restores eager deletion.
+ * @returns a non-zero value on success, zero otherwise.
+ */
+int RBT_set_lazy_delete(struct RBT_Tree *tree, unsigned purge_percent);
+
+/**
+ * Frees every dead node of a tree using lazy deletion, and rebuilds the remaining nodes
+ * into a balanced tree in linear time.
+ * @returns the number of dead nodes that were freed.
+ */
+uintmax_t RBT_purge(struct RBT_Tree *tree);
+
+/**
+ * Enables, or disables, a hash index from keys to nodes kept next to the tree. With the index,
+ * RBT_find and RBT_delete locate their node in expected constant time instead of descending
+ * the tree, while ordered operations still use the tree. The index costs 32 to 64 bytes per
+ * distinct key, and is dropped again if it cannot grow while adding to the tree.
+ * @returns a non-zero value on success, zero if the index could not be allocated.
+ */
+int RBT_set_hash_index(struct RBT_Tree *tree, int enabled);
+
+/**
+ * Enables, or disables, a blocked Bloom filter over the keys of the tree, consulted by RBT_find,
+ * RBT_finger_find and RBT_delete before descending the tree. A key that is not in the tree is
+ * then turned away after touching a single cache line in all but a fraction of a percent of the
+ * lookups, at a cost of 2 to 4 bytes per key. The filter is rebuilt from the live keys as the tree
+ * grows, and once enough of its keys have been deleted, which keeps the amortized cost of every
+ * update constant. The filter does not apply to sequences.
+ * @returns a non-zero value on success, zero if the filter could not be allocated.
+ */
+int RBT_set_lookup_filter(struct RBT_Tree *tree, int enabled);
+
+/**
+ * Finds a value in the RBT tree given a key, searching from the position of the last lookup
+ * through the same finger. The search climbs from the finger only until the key is within reach,
+ * so a key d elements away from the previous one is found in O(log d). The finger falls back to
+ * the root after nodes have been removed from the tree.
+ * @returns the found value, if any, NULL otherwise.
+ */
+void *RBT_finger_find(struct RBT_Tree *tree, struct RBT_Finger *finger, uintmax_t key);
+
+/**
+ * Bounds the tree to at most "capacity" elements. Once the tree is full, RBT_add evicts an element
+ * before adding a new one: the one with the minimum or maximum key, or the least recently added or
+ * found one, as chosen by "policy". The eviction happens within the RBT_add call, so no other
+ * operation can come in between. "evicted" is called, if provided, with the key and value of every
+ * evicted element after it has left the tree, and must not modify the tree. If the new element is
+ * the one that would be evicted, as when its key is below every key under RBT_EVICT_MINIMUM, it is
+ * handed to "evicted" right away instead of being added, and RBT_add returns NULL.
+ *
+ * RBT_EVICT_LEAST_RECENT keeps a recency list threaded through the nodes, making every node two
+ * pointers larger, and can only be enabled on an empty tree. RBT_find and RBT_finger_find move
+ * the element they find to the front of the list, so they modify the tree under that policy.
+ * Lowering the capacity of a non-empty tree evicts down to the new capacity right away.
+ * A "capacity" of zero removes the bound.
+ * @returns a non-zero value on success, zero otherwise.
+ */
+int RBT_set_capacity(struct RBT_Tree *tree, uintmax_t capacity, enum RBT_Eviction policy,
+        void (*evicted)(uintmax_t key, void *data, void *context), void *context);
+
+/**
+ * Enables, or disables, inline entries. A tree with inline entries keeps up to RBT_INLINE_CAPACITY
+ * elements in a sorted array in the extension of the tree, allocating no nodes at all, and moves
+ * them into nodes once it outgrows the array. Deletions move the elements back once at most half
+ * of the array would be used, so a tree hovering around the capacity does not move them every time.
+ * Only RBT_add, RBT_find, RBT_delete, RBT_get_minimum, RBT_get_maximum, RBT_for_each and
+ * RBT_finger_find use the array; the other operations move the elements into nodes first.
+ * Inline entries are turned off by enabling augmentation, lazy deletion, the hash index, the lookup
+ * filter or a capacity bound, none of which they can be combined with.
+ * @returns a non-zero value on success, zero if another of these options is on, or allocation failed.
+ */
+int RBT_set_inline_entries(struct RBT_Tree *tree, int enabled);
+
+/**
+ * Selects the balancing policy of an empty tree. Trees are red-black by default, which keeps
+ * updates cheap with at most three rotations per deletion. RBT_BALANCE_WAVL keeps the tree
+ * weak AVL balanced instead, storing the parity of a rank in the bit that otherwise holds the
+ * color. Built by insertions alone, a WAVL tree is an AVL tree, at most 1.44 log n high against
+ * 2 log n for red-black, so lookups visit fewer nodes in read-heavy trees, while deletions still
+ * take at most two rotations. The policy changes nothing about the interface, but RBT_delete_range
+ * on a WAVL tree unlinks the elements one by one in O(k log n), and sequences are always red-black.
+ * @returns a non-zero value on success, zero if the tree is not empty or is a sequence.
+ */
+int RBT_set_balance(struct RBT_Tree *tree, enum RBT_Balance balance);
+
+/**
+ * Selects the engine of an empty tree. Trees keep their elements in binary nodes by default.
+ * RBT_ENGINE_BPLUS keeps them in a B+-tree instead, see RBTreeBPlus.h, whose wide nodes make
+ * a lookup in a large tree touch a few cache lines per level rather than a node per binary level.
+ * RBT_add, RBT_find, RBT_finger_find, RBT_delete, RBT_get_minimum, RBT_get_maximum, RBT_for_each,
+ * RBT_deinit_tree, RBT_get_memory_usage and traces behave the same on either engine, and RBT_NODE_COUNT
+ * keeps working.
+ * Every other operation and option needs the binary nodes, so they fail on a B+-tree, and the
+ * engine can only be selected for a tree without any of them set.
+ * @returns a non-zero value on success, zero if the tree is not empty, has another option set,
+ * or allocation failed.
+ */
+int RBT_set_engine(struct RBT_Tree *tree, enum RBT_Engine engine);
+
+/**
+ * Reports the memory held by a tree. Nodes detached by RBT_delete_range are no longer counted.
+ * @returns a non-zero value on success, zero otherwise.
+ */
+int RBT_get_memory_usage(struct RBT_Tree *tree, struct RBT_Memory_Usage *usage);
+
+/**
+ * Reports the memory held by every RBT tree of the process together. The counters are updated with
+ * relaxed atomic operations where the compiler provides them, so trees may be used from any thread.
+ */
+void RBT_get_global_memory_usage(struct RBT_Memory_Usage *usage);
+
+/**
+ * Bounds the memory held by a tree to "budget" bytes, as reported by RBT_get_memory_usage.
+ * RBT_add and RBT_sequence_insert_at return NULL, leaving the tree as it was, rather than allocate
+ * a node taking the tree past its budget. The auxiliary structures count towards the budget, but
+ * are not refused room to grow. A budget below the current usage only stops the tree from growing.
+ * A "budget" of zero removes the bound.
+ * @returns a non-zero value on success, zero otherwise.
+ */
+int RBT_set_memory_budget(struct RBT_Tree *tree, uintmax_t budget);
+
+/**
+ * Sets aside nodes for the next "count" elements added, so that neither RBT_add nor
+ * RBT_sequence_insert_at allocate until they are used up. The nodes are allocated, and their pages
+ * faulted in, right away, all of them or none. Reserved nodes count as auxiliary memory, and the
+ * reserve is dropped by options changing the node size, so it is best made once the tree is set up.
+ * @returns a non-zero value if at least "count" nodes are reserved, zero if allocation failed or the
+ * reserve would take the tree past its memory budget.
+ */
+int RBT_reserve(struct RBT_Tree *tree, uintmax_t count);
+
+/**
+ * Frees the nodes left in the reserve of a tree.
+ * @returns the number of nodes freed.
+ */
+uintmax_t RBT_shrink_to_fit(struct RBT_Tree *tree);
+
+/**
+ * Deletes every element with a key in the closed range [lo; hi]. The range is cut out of the tree
+ * by splitting and joining it in O(log n), without rebalancing for each element. The detached
+ * elements are only visited once more, to count them and drop them from the hash index if any.
+ * If "detached" is not NULL it receives the cut out subtree, whose nodes are then owned by the
+ * caller and released with RBT_free_detached, possibly later or from another thread. Otherwise
+ * the nodes are freed right away, without freeing the values, as with RBT_delete.
+ * @returns the number of elements deleted.
+ */
+uintmax_t RBT_delete_range(struct RBT_Tree *tree, uintmax_t lo, uintmax_t hi, struct RBT_Node **detached);
+
+/**
+ * Deletes every element with a key below the given key, as RBT_delete_range.
+ * @returns the number of elements deleted.
+ */
+uintmax_t RBT_delete_below(struct RBT_Tree *tree, uintmax_t key, struct RBT_Node **detached);
+
+/**
+ * Frees a subtree detached by RBT_delete_range, calling freedata on every value if provided.
+ * The subtree shares nothing with the tree it came from, so it can be freed concurrently with
+ * operations on that tree.
+ */
+void RBT_free_detached(struct RBT_Node *detached, void (*freedata)(void *));
+
+/**
+ * Initializes a tree in sequence mode, where the elements are ordered by position instead of by key.
+ * Every node keeps the size of its subtree as the aggregate of a built-in augmentation, so positions
+ * are found by counting while descending, and inserting or erasing in the middle never renumbers
+ * anything. Keys of sequence elements are all zero: RBT_for_each and RBT_deinit_tree work as usual,
+ * while the functions looking up keys, and augmentation, lazy deletion, the hash index and the
+ * capacity bound do not apply, and fail on a sequence. The memory allocation of the RBT_Tree is owned by the caller.
+ * @returns a non-zero value on success, and zero on failure.
+ */
+int RBT_sequence_init(struct RBT_Tree *tree);
+
+/**
+ * Inserts a value at a position of a sequence in O(log n), moving the elements from that
+ * position on one position up. The position may be the length of the sequence to append.
+ * @returns the inserted value, or NULL if the position is out of range or allocation failed.
+ */
+void *RBT_sequence_insert_at(struct RBT_Tree *tree, uintmax_t position, void *data);
+
+/**
+ * Erases the element at a position of a sequence in O(log n), moving the elements after it
+ * one position down.
+ * @returns a non-zero value on success, zero if the position is out of range.
+ */
+int RBT_sequence_erase_at(struct RBT_Tree *tree, uintmax_t position);
+
+/**
+ * Finds the value at a position of a sequence in O(log n).
+ * @returns the value at the position, or NULL if the position is out of range.
+ */
+void *RBT_sequence_get(struct RBT_Tree *tree, uintmax_t position);
+
+/**
+ * Splits a sequence in O(log n), moving the elements from the position on into "rest",
+ * which must be an initialized, empty tree other than "tree", and is turned into a sequence.
+ * @returns a non-zero value on success, zero if the position is out of range or "rest" is not empty.
+ */
+int RBT_sequence_split(struct RBT_Tree *tree, uintmax_t position, struct RBT_Tree *rest);
+
+/**
+ * Appends every element of another sequence to a sequence in O(log n), leaving the other one empty.
+ * @returns a non-zero value on success, zero otherwise.
+ */
+int RBT_sequence_concat(struct RBT_Tree *tree, struct RBT_Tree *other);
+
 /**
  * Convience macro for getting the node count of a RBT tree
  */
 #define RBT_NODE_COUNT(tree_ptr) ((tree_ptr)->node_count)
 
+/**
+ * The largest key a RBT tree can store, as the most significant bit holds the node color.
+ */
+#define RBT_KEY_MAX (UINTMAX_MAX >> 1)
+
+/*
+ * usable size of a block of "size" bytes from RBT_MALLOC, which may exceed the requested size.
+ * It is only known for the default allocator on glibc, and taken to be the requested size otherwise.
+ */
+#ifndef RBT_USABLE_SIZE
+#if defined(__GLIBC__) && !defined(RBT_MALLOC)
+#define RBT_USABLE_SIZE(pointer, size) malloc_usable_size(pointer)
+#else
+#define RBT_USABLE_SIZE(pointer, size) (size)
+#endif
+#endif
+
 /*
  * memory allocation function. This function is given a size_t of RBT_Node as the
  * first argument to allocate a tree node of sizeof(RBT_Node)
@@ -110,4 +463,12 @@ int RBT_get_minimum(struct RBT_Tree *tree, uintmax_t *key, void **value);
 #define RBT_FREE free
 #endif
 
+/*
+ * upper bound on the size of a single aggregate of an augmented tree. Aggregates
+ * are combined in stack buffers of this size.
+ */
+#ifndef RBT_AGGREGATE_MAX_SIZE
+#define RBT_AGGREGATE_MAX_SIZE 64
+#endif
+
 #endif
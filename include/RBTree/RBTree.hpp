@@ -0,0 +1,912 @@
+/**
+ * Header-only C++ red-black tree container
+ * rbt::map<K, V, Compare, Alloc> is an ordered map with unique keys following the interface
+ * of std::map, built on the same Cormen red-black tree as the C library. Every element is
+ * stored inline in its node, so an element costs a single allocation from "Alloc" and a
+ * lookup touches no memory beyond the nodes on its path.
+ *
+ * Elements are constructed in place by emplace and try_emplace, and moved rather than copied
+ * wherever the interface allows it. Nodes can be taken out of a map with extract and linked
+ * into another map with insert(node_type &&) without reallocating or moving the element, as
+ * long as the allocators of the maps compare equal.
+ *
+ * Iterators and references stay valid until their element is erased, also across extract and
+ * insert of the node. Unlike std::map, the end iterator refers to the map object, and is
+ * invalidated when the map is moved or swapped.
+ *
+ * Requires C++11.
+ **/
+#ifndef _HEADER_FILE_RBTreeHpp_20261019181530_
+#define _HEADER_FILE_RBTreeHpp_20261019181530_
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace rbt {
+
+template <class K, class V, class Compare = std::less<K>, class Alloc = std::allocator<std::pair<const K, V>>>
+class map;
+
+namespace detail {
+
+/**
+ * Links and color of a node, independent of the element type.
+ */
+struct node_base {
+    node_base *left;
+    node_base *right;
+    node_base *parent;
+    bool red;
+};
+
+/**
+ * Root and element count of a tree, with the rebalancing shared by every instantiation.
+ */
+struct tree_base {
+    node_base *root = nullptr;
+    std::size_t node_count = 0;
+};
+
+inline bool is_red(const node_base *node) {
+    return node != nullptr && node->red;
+}
+
+inline node_base *minimum(node_base *node) {
+    while ( node->left != nullptr ) {
+        node = node->left;
+    }
+    return node;
+}
+
+inline node_base *maximum(node_base *node) {
+    while ( node->right != nullptr ) {
+        node = node->right;
+    }
+    return node;
+}
+
+inline node_base *successor(node_base *node) {
+    if ( node->right != nullptr ) {
+        return minimum(node->right);
+    }
+    node_base *parent = node->parent;
+    while ( parent != nullptr && node == parent->right ) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+inline node_base *predecessor(node_base *node) {
+    if ( node->left != nullptr ) {
+        return maximum(node->left);
+    }
+    node_base *parent = node->parent;
+    while ( parent != nullptr && node == parent->left ) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+inline void replace_child(tree_base &tree, node_base *old, node_base *replacement) {
+    if ( old->parent == nullptr ) {
+        tree.root = replacement;
+    } else if ( old == old->parent->left ) {
+        old->parent->left = replacement;
+    } else {
+        old->parent->right = replacement;
+    }
+    if ( replacement != nullptr ) {
+        replacement->parent = old->parent;
+    }
+}
+
+inline void left_rotate(tree_base &tree, node_base *node) {
+    node_base *right_node = node->right;
+    node->right = right_node->left;
+    if ( right_node->left != nullptr ) {
+        right_node->left->parent = node;
+    }
+    replace_child(tree, node, right_node);
+    right_node->left = node;
+    node->parent = right_node;
+}
+
+inline void right_rotate(tree_base &tree, node_base *node) {
+    node_base *left_node = node->left;
+    node->left = left_node->right;
+    if ( left_node->right != nullptr ) {
+        left_node->right->parent = node;
+    }
+    replace_child(tree, node, left_node);
+    left_node->right = node;
+    node->parent = left_node;
+}
+
+inline void insert_fixup(tree_base &tree, node_base *node) {
+    while ( is_red(node->parent) ) {
+        node_base *parent = node->parent;
+        node_base *grandparent = parent->parent;
+        if ( parent == grandparent->left ) {
+            node_base *uncle = grandparent->right;
+            if ( is_red(uncle) ) {
+                parent->red = false;
+                uncle->red = false;
+                grandparent->red = true;
+                node = grandparent;
+                continue;
+            }
+            if ( node == parent->right ) {
+                node = parent;
+                left_rotate(tree, node);
+                parent = node->parent;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            right_rotate(tree, grandparent);
+        } else {
+            node_base *uncle = grandparent->left;
+            if ( is_red(uncle) ) {
+                parent->red = false;
+                uncle->red = false;
+                grandparent->red = true;
+                node = grandparent;
+                continue;
+            }
+            if ( node == parent->left ) {
+                node = parent;
+                right_rotate(tree, node);
+                parent = node->parent;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            left_rotate(tree, grandparent);
+        }
+    }
+    tree.root->red = false;
+}
+
+/**
+ * Links a detached node in as the left or right child of "parent", or as the root.
+ */
+inline void link(tree_base &tree, node_base *parent, bool smaller, node_base *node) {
+    node->left = nullptr;
+    node->right = nullptr;
+    node->parent = parent;
+    node->red = true;
+    if ( parent == nullptr ) {
+        tree.root = node;
+    } else if ( smaller ) {
+        parent->left = node;
+    } else {
+        parent->right = node;
+    }
+    tree.node_count++;
+    insert_fixup(tree, node);
+}
+
+inline void remove_fixup(tree_base &tree, node_base *node, node_base *parent) {
+    while ( node != tree.root && !is_red(node) ) {
+        if ( node == parent->left ) {
+            node_base *sibling = parent->right;
+            if ( sibling->red ) {
+                sibling->red = false;
+                parent->red = true;
+                left_rotate(tree, parent);
+                sibling = parent->right;
+            }
+            if ( !is_red(sibling->left) && !is_red(sibling->right) ) {
+                sibling->red = true;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+            if ( !is_red(sibling->right) ) {
+                sibling->left->red = false;
+                sibling->red = true;
+                right_rotate(tree, sibling);
+                sibling = parent->right;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            sibling->right->red = false;
+            left_rotate(tree, parent);
+            node = tree.root;
+        } else {
+            node_base *sibling = parent->left;
+            if ( sibling->red ) {
+                sibling->red = false;
+                parent->red = true;
+                right_rotate(tree, parent);
+                sibling = parent->left;
+            }
+            if ( !is_red(sibling->left) && !is_red(sibling->right) ) {
+                sibling->red = true;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+            if ( !is_red(sibling->left) ) {
+                sibling->right->red = false;
+                sibling->red = true;
+                left_rotate(tree, sibling);
+                sibling = parent->left;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            sibling->left->red = false;
+            right_rotate(tree, parent);
+            node = tree.root;
+        }
+    }
+    if ( node != nullptr ) {
+        node->red = false;
+    }
+}
+
+/**
+ * Unlinks a node from the tree and rebalances, leaving the node itself untouched for reuse.
+ */
+inline void unlink(tree_base &tree, node_base *node) {
+    node_base *point;
+    node_base *point_parent;
+    bool removed_red = node->red;
+    if ( node->left == nullptr ) {
+        point = node->right;
+        point_parent = node->parent;
+        replace_child(tree, node, node->right);
+    } else if ( node->right == nullptr ) {
+        point = node->left;
+        point_parent = node->parent;
+        replace_child(tree, node, node->left);
+    } else {
+        node_base *next = minimum(node->right);
+        removed_red = next->red;
+        point = next->right;
+        if ( next->parent == node ) {
+            point_parent = next;
+        } else {
+            point_parent = next->parent;
+            replace_child(tree, next, next->right);
+            next->right = node->right;
+            next->right->parent = next;
+        }
+        replace_child(tree, node, next);
+        next->left = node->left;
+        next->left->parent = next;
+        next->red = node->red;
+    }
+    if ( !removed_red ) {
+        remove_fixup(tree, point, point_parent);
+    }
+    tree.node_count--;
+}
+
+/**
+ * Bidirectional iterator over the nodes of a tree. A null node is the end iterator,
+ * which is decremented by finding the maximum of the tree.
+ */
+template <class Value, bool Const>
+class tree_iterator {
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = Value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = typename std::conditional<Const, const Value *, Value *>::type;
+    using reference = typename std::conditional<Const, const Value &, Value &>::type;
+
+    tree_iterator() = default;
+
+    tree_iterator(node_base *node, const tree_base *tree) : node_(node), tree_(tree) {}
+
+    // a mutable iterator converts to a const iterator, but not the other way around
+    template <bool OtherConst, class = typename std::enable_if<Const && !OtherConst>::type>
+    tree_iterator(const tree_iterator<Value, OtherConst> &other) : node_(other.node_), tree_(other.tree_) {}
+
+    reference operator*() const {
+        return *operator->();
+    }
+
+    pointer operator->() const;
+
+    tree_iterator &operator++() {
+        node_ = successor(node_);
+        return *this;
+    }
+
+    tree_iterator operator++(int) {
+        tree_iterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    tree_iterator &operator--() {
+        node_ = node_ == nullptr ? maximum(tree_->root) : predecessor(node_);
+        return *this;
+    }
+
+    tree_iterator operator--(int) {
+        tree_iterator previous = *this;
+        --*this;
+        return previous;
+    }
+
+    friend bool operator==(const tree_iterator &a, const tree_iterator &b) {
+        return a.node_ == b.node_;
+    }
+
+    friend bool operator!=(const tree_iterator &a, const tree_iterator &b) {
+        return a.node_ != b.node_;
+    }
+
+private:
+    template <class, bool> friend class tree_iterator;
+    template <class, class, class, class> friend class ::rbt::map;
+
+    node_base *node_ = nullptr;
+    const tree_base *tree_ = nullptr;
+};
+
+/**
+ * Node carrying an element inline after its links. The element is constructed and destroyed
+ * separately from the node, so nodes can be allocated as raw storage.
+ */
+template <class Value>
+struct node : node_base {
+    alignas(Value) unsigned char storage[sizeof(Value)];
+
+    Value *value() {
+        return reinterpret_cast<Value *>(storage);
+    }
+};
+
+template <class Value, bool Const>
+typename tree_iterator<Value, Const>::pointer tree_iterator<Value, Const>::operator->() const {
+    return static_cast<node<Value> *>(node_)->value();
+}
+
+} // namespace detail
+
+/**
+ * Ordered map with unique keys and elements stored inline in the tree nodes.
+ */
+template <class K, class V, class Compare, class Alloc>
+class map {
+    using node = detail::node<std::pair<const K, V>>;
+    using node_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_allocator>;
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare = Compare;
+    using allocator_type = Alloc;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using pointer = typename std::allocator_traits<Alloc>::pointer;
+    using const_pointer = typename std::allocator_traits<Alloc>::const_pointer;
+    using iterator = detail::tree_iterator<value_type, false>;
+    using const_iterator = detail::tree_iterator<value_type, true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    /**
+     * Owner of a node extracted from a map. Destroys the element and frees the node unless
+     * it is inserted into a map again.
+     */
+    class node_type {
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using allocator_type = Alloc;
+
+        node_type() = default;
+
+        node_type(node_type &&other) noexcept : node_(other.node_), allocator_(std::move(other.allocator_)) {
+            other.node_ = nullptr;
+        }
+
+        node_type &operator=(node_type &&other) noexcept {
+            if ( this != &other ) {
+                reset();
+                node_ = other.node_;
+                allocator_ = std::move(other.allocator_);
+                other.node_ = nullptr;
+            }
+            return *this;
+        }
+
+        ~node_type() {
+            reset();
+        }
+
+        bool empty() const noexcept {
+            return node_ == nullptr;
+        }
+
+        explicit operator bool() const noexcept {
+            return node_ != nullptr;
+        }
+
+        allocator_type get_allocator() const {
+            return allocator_type(allocator_);
+        }
+
+        /**
+         * The key of the element may be changed while the node is outside of any map.
+         */
+        key_type &key() const {
+            return const_cast<key_type &>(node_->value()->first);
+        }
+
+        mapped_type &mapped() const {
+            return node_->value()->second;
+        }
+
+        void swap(node_type &other) noexcept {
+            using std::swap;
+            swap(node_, other.node_);
+            swap(allocator_, other.allocator_);
+        }
+
+        friend void swap(node_type &a, node_type &b) noexcept {
+            a.swap(b);
+        }
+
+    private:
+        friend class map;
+
+        node_type(node *extracted, const node_allocator &allocator) : node_(extracted), allocator_(allocator) {}
+
+        void reset() {
+            if ( node_ != nullptr ) {
+                node_traits::destroy(allocator_, node_->value());
+                node_traits::deallocate(allocator_, node_, 1);
+                node_ = nullptr;
+            }
+        }
+
+        node *node_ = nullptr;
+        node_allocator allocator_;
+    };
+
+    /**
+     * Result of inserting a node: on failure "node" still owns the node that was passed in.
+     */
+    struct insert_return_type {
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
+
+    map() = default;
+
+    explicit map(const Compare &compare, const Alloc &allocator = Alloc())
+        : compare_(compare), allocator_(allocator) {}
+
+    explicit map(const Alloc &allocator) : allocator_(allocator) {}
+
+    map(std::initializer_list<value_type> elements, const Compare &compare = Compare(), const Alloc &allocator = Alloc())
+        : compare_(compare), allocator_(allocator) {
+        for ( const value_type &element : elements ) {
+            emplace(element);
+        }
+    }
+
+    map(const map &other)
+        : compare_(other.compare_),
+          allocator_(node_traits::select_on_container_copy_construction(other.allocator_)) {
+        if ( other.tree_.root != nullptr ) {
+            tree_.root = clone(static_cast<node *>(other.tree_.root), nullptr);
+            tree_.node_count = other.tree_.node_count;
+        }
+    }
+
+    map(map &&other) noexcept : tree_(other.tree_), compare_(std::move(other.compare_)), allocator_(std::move(other.allocator_)) {
+        other.tree_ = detail::tree_base();
+    }
+
+    ~map() {
+        destroy(tree_.root);
+    }
+
+    map &operator=(const map &other) {
+        if ( this != &other ) {
+            map copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    map &operator=(map &&other) noexcept {
+        if ( this != &other ) {
+            clear();
+            std::swap(tree_, other.tree_);
+            compare_ = std::move(other.compare_);
+            allocator_ = std::move(other.allocator_);
+        }
+        return *this;
+    }
+
+    allocator_type get_allocator() const {
+        return allocator_type(allocator_);
+    }
+
+    key_compare key_comp() const {
+        return compare_;
+    }
+
+    iterator begin() noexcept {
+        return make_iterator(tree_.root == nullptr ? nullptr : detail::minimum(tree_.root));
+    }
+
+    const_iterator begin() const noexcept {
+        return make_const_iterator(tree_.root == nullptr ? nullptr : detail::minimum(tree_.root));
+    }
+
+    const_iterator cbegin() const noexcept {
+        return begin();
+    }
+
+    iterator end() noexcept {
+        return make_iterator(nullptr);
+    }
+
+    const_iterator end() const noexcept {
+        return make_const_iterator(nullptr);
+    }
+
+    const_iterator cend() const noexcept {
+        return end();
+    }
+
+    reverse_iterator rbegin() noexcept {
+        return reverse_iterator(end());
+    }
+
+    const_reverse_iterator rbegin() const noexcept {
+        return const_reverse_iterator(end());
+    }
+
+    reverse_iterator rend() noexcept {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rend() const noexcept {
+        return const_reverse_iterator(begin());
+    }
+
+    bool empty() const noexcept {
+        return tree_.node_count == 0;
+    }
+
+    size_type size() const noexcept {
+        return tree_.node_count;
+    }
+
+    void clear() noexcept {
+        destroy(tree_.root);
+        tree_ = detail::tree_base();
+    }
+
+    /**
+     * Constructs an element from the arguments, and links it in unless the key is present.
+     * The element is constructed before the key can be looked up, see try_emplace.
+     */
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args &&... args) {
+        node *created = create(std::forward<Args>(args)...);
+        detail::node_base *parent;
+        bool smaller;
+        detail::node_base *found = find_slot(created->value()->first, parent, smaller);
+        if ( found != nullptr ) {
+            release(created);
+            return std::pair<iterator, bool>(make_iterator(found), false);
+        }
+        detail::link(tree_, parent, smaller, created);
+        return std::pair<iterator, bool>(make_iterator(created), true);
+    }
+
+    /**
+     * Constructs the mapped value from the arguments only if the key is not present,
+     * leaving the arguments untouched otherwise.
+     */
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const key_type &key, Args &&... args) {
+        return try_emplace_key(key, std::forward<Args>(args)...);
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(key_type &&key, Args &&... args) {
+        return try_emplace_key(std::move(key), std::forward<Args>(args)...);
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const key_type &key, M &&value) {
+        std::pair<iterator, bool> result = try_emplace(key, std::forward<M>(value));
+        if ( !result.second ) {
+            result.first->second = std::forward<M>(value);
+        }
+        return result;
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(key_type &&key, M &&value) {
+        std::pair<iterator, bool> result = try_emplace(std::move(key), std::forward<M>(value));
+        if ( !result.second ) {
+            result.first->second = std::forward<M>(value);
+        }
+        return result;
+    }
+
+    std::pair<iterator, bool> insert(const value_type &value) {
+        return try_emplace(value.first, value.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type &&value) {
+        return try_emplace(value.first, std::move(value.second));
+    }
+
+    /**
+     * Links a node extracted from a map with an equal allocator in, unless its key is present.
+     */
+    insert_return_type insert(node_type &&handle) {
+        if ( handle.empty() ) {
+            return insert_return_type{ end(), false, node_type() };
+        }
+        detail::node_base *parent;
+        bool smaller;
+        detail::node_base *found = find_slot(handle.key(), parent, smaller);
+        if ( found != nullptr ) {
+            return insert_return_type{ make_iterator(found), false, std::move(handle) };
+        }
+        node *linked = handle.node_;
+        handle.node_ = nullptr;
+        detail::link(tree_, parent, smaller, linked);
+        return insert_return_type{ make_iterator(linked), true, node_type() };
+    }
+
+    /**
+     * Unlinks the node of an element from the map, handing it over to the caller.
+     */
+    node_type extract(const_iterator position) {
+        node *extracted = static_cast<node *>(position.node_);
+        detail::unlink(tree_, extracted);
+        return node_type(extracted, allocator_);
+    }
+
+    node_type extract(const key_type &key) {
+        const_iterator position = find(key);
+        return position == end() ? node_type() : extract(position);
+    }
+
+    iterator erase(const_iterator position) {
+        detail::node_base *next = detail::successor(position.node_);
+        detail::unlink(tree_, position.node_);
+        release(static_cast<node *>(position.node_));
+        return make_iterator(next);
+    }
+
+    iterator erase(iterator position) {
+        return erase(const_iterator(position));
+    }
+
+    size_type erase(const key_type &key) {
+        const_iterator position = find(key);
+        if ( position == end() ) {
+            return 0;
+        }
+        erase(position);
+        return 1;
+    }
+
+    void swap(map &other) noexcept {
+        using std::swap;
+        swap(tree_, other.tree_);
+        swap(compare_, other.compare_);
+        swap(allocator_, other.allocator_);
+    }
+
+    friend void swap(map &a, map &b) noexcept {
+        a.swap(b);
+    }
+
+    mapped_type &operator[](const key_type &key) {
+        return try_emplace(key).first->second;
+    }
+
+    mapped_type &operator[](key_type &&key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    mapped_type &at(const key_type &key) {
+        iterator position = find(key);
+        if ( position == end() ) {
+            throw std::out_of_range("rbt::map::at");
+        }
+        return position->second;
+    }
+
+    const mapped_type &at(const key_type &key) const {
+        const_iterator position = find(key);
+        if ( position == end() ) {
+            throw std::out_of_range("rbt::map::at");
+        }
+        return position->second;
+    }
+
+    iterator find(const key_type &key) {
+        detail::node_base *parent;
+        bool smaller;
+        return make_iterator(find_slot(key, parent, smaller));
+    }
+
+    const_iterator find(const key_type &key) const {
+        detail::node_base *parent;
+        bool smaller;
+        return make_const_iterator(find_slot(key, parent, smaller));
+    }
+
+    size_type count(const key_type &key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    bool contains(const key_type &key) const {
+        return find(key) != end();
+    }
+
+    iterator lower_bound(const key_type &key) {
+        return make_iterator(bound(key, false));
+    }
+
+    const_iterator lower_bound(const key_type &key) const {
+        return make_const_iterator(bound(key, false));
+    }
+
+    iterator upper_bound(const key_type &key) {
+        return make_iterator(bound(key, true));
+    }
+
+    const_iterator upper_bound(const key_type &key) const {
+        return make_const_iterator(bound(key, true));
+    }
+
+private:
+    iterator make_iterator(detail::node_base *position) const {
+        return iterator(position, &tree_);
+    }
+
+    const_iterator make_const_iterator(detail::node_base *position) const {
+        return const_iterator(position, &tree_);
+    }
+
+    static const key_type &key_of(detail::node_base *position) {
+        return static_cast<node *>(position)->value()->first;
+    }
+
+    /**
+     * Finds the node with the key using a single comparison per level. When the key is not
+     * present, "parent" and "smaller" receive the place a node with the key is linked in at.
+     */
+    detail::node_base *find_slot(const key_type &key, detail::node_base *&parent, bool &smaller) const {
+        detail::node_base *iterator = tree_.root;
+        detail::node_base *candidate = nullptr;
+        parent = nullptr;
+        smaller = false;
+        while ( iterator != nullptr ) {
+            parent = iterator;
+            smaller = compare_(key, key_of(iterator));
+            if ( smaller ) {
+                iterator = iterator->left;
+            } else {
+                candidate = iterator;
+                iterator = iterator->right;
+            }
+        }
+        // the candidate is the largest node not above the key, which is equal unless below it
+        if ( candidate != nullptr && !compare_(key_of(candidate), key) ) {
+            return candidate;
+        }
+        return nullptr;
+    }
+
+    // first node above the key when "strict" is set, otherwise first node not below the key
+    detail::node_base *bound(const key_type &key, bool strict) const {
+        detail::node_base *iterator = tree_.root;
+        detail::node_base *result = nullptr;
+        while ( iterator != nullptr ) {
+            bool after = strict ? compare_(key, key_of(iterator)) : !compare_(key_of(iterator), key);
+            if ( after ) {
+                result = iterator;
+                iterator = iterator->left;
+            } else {
+                iterator = iterator->right;
+            }
+        }
+        return result;
+    }
+
+    template <class Key, class... Args>
+    std::pair<iterator, bool> try_emplace_key(Key &&key, Args &&... args) {
+        detail::node_base *parent;
+        bool smaller;
+        detail::node_base *found = find_slot(key, parent, smaller);
+        if ( found != nullptr ) {
+            return std::pair<iterator, bool>(make_iterator(found), false);
+        }
+        node *created = create(std::piecewise_construct,
+                               std::forward_as_tuple(std::forward<Key>(key)),
+                               std::forward_as_tuple(std::forward<Args>(args)...));
+        detail::link(tree_, parent, smaller, created);
+        return std::pair<iterator, bool>(make_iterator(created), true);
+    }
+
+    template <class... Args>
+    node *create(Args &&... args) {
+        node *created = node_traits::allocate(allocator_, 1);
+        try {
+            node_traits::construct(allocator_, created->value(), std::forward<Args>(args)...);
+        } catch ( ... ) {
+            node_traits::deallocate(allocator_, created, 1);
+            throw;
+        }
+        created->left = nullptr;
+        created->right = nullptr;
+        created->parent = nullptr;
+        created->red = true;
+        return created;
+    }
+
+    void release(node *released) {
+        node_traits::destroy(allocator_, released->value());
+        node_traits::deallocate(allocator_, released, 1);
+    }
+
+    void destroy(detail::node_base *position) {
+        while ( position != nullptr ) {
+            detail::node_base *right = position->right;
+            destroy(position->left);
+            release(static_cast<node *>(position));
+            position = right;
+        }
+    }
+
+    // copies a subtree node by node, keeping its shape and colors
+    node *clone(node *source, detail::node_base *parent) {
+        node *copy = create(*source->value());
+        copy->red = source->red;
+        copy->parent = parent;
+        try {
+            if ( source->left != nullptr ) {
+                copy->left = clone(static_cast<node *>(source->left), copy);
+            }
+            if ( source->right != nullptr ) {
+                copy->right = clone(static_cast<node *>(source->right), copy);
+            }
+        } catch ( ... ) {
+            destroy(copy);
+            throw;
+        }
+        return copy;
+    }
+
+    detail::tree_base tree_;
+    Compare compare_;
+    node_allocator allocator_;
+};
+
+} // namespace rbt
+
+#endif
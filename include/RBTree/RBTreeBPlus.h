@@ -0,0 +1,116 @@
+/**
+ * Cache-conscious B+-tree
+ * An alternative engine for large trees storing up to RBT_BP_ORDER keys contiguously
+ * per node, so a lookup touches a few wide nodes instead of one node per binary level.
+ * Values are only stored in the leaves, which are linked in key order for scans.
+ *
+ * The interface mirrors the one of the RBT tree, with a RBT_BP_ prefix, including
+ * duplicate keys and the largest storable key RBT_KEY_MAX. RBT_set_engine puts a RBT tree
+ * on top of this engine instead, keeping the RBT interface.
+ **/
+#ifndef _HEADER_FILE_RBTBPlus_20261019164912_
+#define _HEADER_FILE_RBTBPlus_20261019164912_
+
+#include "RBTree.h"
+
+/*
+ * maximum number of keys per node. Nodes are searched over the full key array,
+ * which compilers vectorize, so this should be a multiple of the SIMD width.
+ */
+#ifndef RBT_BP_ORDER
+#define RBT_BP_ORDER 32
+#endif
+
+/**
+ * Node header shared by leaves and inner nodes. Key slots past "count" hold UINTMAX_MAX,
+ * which is larger than any stored key.
+ */
+struct RBT_BP_Node {
+    uintmax_t keys[RBT_BP_ORDER];
+    unsigned count;
+    unsigned char leaf;
+};
+
+/**
+ * Leaf node carrying a value per key, and a link to the next leaf in key order.
+ */
+struct RBT_BP_Leaf {
+    struct RBT_BP_Node node;
+    void *data[RBT_BP_ORDER];
+    struct RBT_BP_Leaf *next;
+};
+
+/**
+ * Inner node where the keys separate the children, so that every key in children[i]
+ * lies between keys[i - 1] and keys[i], both inclusive.
+ */
+struct RBT_BP_Inner {
+    struct RBT_BP_Node node;
+    struct RBT_BP_Node *children[RBT_BP_ORDER + 1];
+};
+
+/**
+ * Front facade for the B+-tree carrying the root node, as well as some meta data.
+ * RBT_NODE_COUNT works on this facade as well. "bytes" and "slack" count the memory of the
+ * nodes like RBT_Memory_Usage does, and the nodes count towards RBT_get_global_memory_usage.
+ */
+struct RBT_BP_Tree {
+    struct RBT_BP_Node *root;
+    uintmax_t node_count;
+    uintmax_t bytes;
+    uintmax_t slack;
+    unsigned height;
+};
+
+/**
+ * B+-tree initialization. The memory allocation of the RBT_BP_Tree is owned by the caller.
+ * @returns a non-zero value on success, and zero on failure.
+ */
+int RBT_BP_init_tree(struct RBT_BP_Tree *tree);
+
+/**
+ * B+-tree de-initialization. Deallocates every node, calling the data_deallocator,
+ * if provided, for every value stored in the tree.
+ */
+void RBT_BP_deinit_tree(struct RBT_BP_Tree *tree, void (*data_deallocator)(void *));
+
+/**
+ * Adds a new element to the tree with the given key and value.
+ * @returns The added value, if any, NULL otherwise.
+ */
+void *RBT_BP_add(struct RBT_BP_Tree *tree, uintmax_t key, void *data);
+
+/**
+ * Delete an element with the given key from the tree.
+ * @returns a non-zero value on successful deletion, zero otherwise.
+ */
+int RBT_BP_delete(struct RBT_BP_Tree *tree, uintmax_t key);
+
+/**
+ * Finds a value in the tree given a key.
+ * @returns the found value, if any, NULL otherwise.
+ */
+void *RBT_BP_find(struct RBT_BP_Tree *tree, uintmax_t key);
+
+/**
+ * Finds the key and value of the element with the trees' maximum key value.
+ * "key" and "value" are both optional output variables.
+ * @returns a non-zero value if any element was found, zero otherwise.
+ */
+int RBT_BP_get_maximum(struct RBT_BP_Tree *tree, uintmax_t *key, void **value);
+
+/**
+ * Finds the key and value of the element with the trees' minimum key value.
+ * "key" and "value" are both optional output variables.
+ * @returns a non-zero value if any element was found, zero otherwise.
+ */
+int RBT_BP_get_minimum(struct RBT_BP_Tree *tree, uintmax_t *key, void **value);
+
+/**
+ * Visits every element in ascending key order by following the leaf links, stopping early
+ * when "visit" returns zero.
+ * @returns a non-zero value if every element was visited, zero otherwise.
+ */
+int RBT_BP_for_each(struct RBT_BP_Tree *tree, int (*visit)(uintmax_t key, void *data, void *context), void *context);
+
+#endif
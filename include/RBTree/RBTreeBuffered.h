@@ -0,0 +1,94 @@
+/**
+ * Write buffered RBT tree
+ * Additions and deletions first land in a small sorted buffer in front of the tree. Once the
+ * buffer is full it is merged into the tree in a single ascending pass, where every insertion
+ * continues the search from the previously inserted node instead of descending from the root.
+ * Bursts of random writes are in this way turned into short, mostly cache-resident descents.
+ *
+ * Options set on the inner tree are honored, though merging into a tree with a memory budget,
+ * a reserve, a capacity, the hash index, the lookup filter, a trace, dead nodes, inline entries
+ * or the B+-tree engine falls back to a RBT_add per buffered addition.
+ *
+ * Lookups consult the buffer before the tree. Deleting a key with a buffered addition cancels
+ * the addition without touching the tree, while other deletions are applied at merge time,
+ * before any buffered addition of the same key.
+ **/
+#ifndef _HEADER_FILE_RBTBuffered_20261019171408_
+#define _HEADER_FILE_RBTBuffered_20261019171408_
+
+#include "RBTree.h"
+
+/**
+ * Pending operation in the write buffer.
+ */
+struct RBT_Buffered_Op {
+    uintmax_t key;
+    void *data;
+    int deletion;
+};
+
+/**
+ * Buffered tree facade. node_count includes the pending operations, so RBT_NODE_COUNT works
+ * on this facade as well.
+ */
+struct RBT_Buffered_Tree {
+    struct RBT_Tree tree;
+    uintmax_t node_count;
+    struct RBT_Buffered_Op *ops;
+    size_t op_count;
+    size_t capacity;
+};
+
+/**
+ * Buffered tree initialization with room for "capacity" pending operations.
+ * The memory allocation of the RBT_Buffered_Tree is owned by the caller.
+ * @returns a non-zero value on success, and zero on failure.
+ */
+int RBT_buffered_init_tree(struct RBT_Buffered_Tree *tree, size_t capacity);
+
+/**
+ * Buffered tree de-initialization. The data_deallocator, if provided, is called for every value
+ * stored in the tree or pending in the buffer.
+ */
+void RBT_buffered_deinit_tree(struct RBT_Buffered_Tree *tree, void (*data_deallocator)(void *));
+
+/**
+ * Adds a new element with the given key and value, merging the buffer if it is full.
+ * @returns The added value, if any, NULL otherwise.
+ */
+void *RBT_buffered_add(struct RBT_Buffered_Tree *tree, uintmax_t key, void *data);
+
+/**
+ * Delete an element with the given key.
+ * @returns a non-zero value on successful deletion, zero otherwise.
+ */
+int RBT_buffered_delete(struct RBT_Buffered_Tree *tree, uintmax_t key);
+
+/**
+ * Finds a value given a key, in the buffer or the tree.
+ * @returns the found value, if any, NULL otherwise.
+ */
+void *RBT_buffered_find(struct RBT_Buffered_Tree *tree, uintmax_t key);
+
+/**
+ * Merges every pending operation into the tree.
+ * @returns a non-zero value on success, zero if a node could not be allocated, in which case
+ * the operations not yet merged stay in the buffer.
+ */
+int RBT_buffered_flush(struct RBT_Buffered_Tree *tree);
+
+/**
+ * Merges the buffer and finds the key and value of the element with the maximum key value.
+ * "key" and "value" are both optional output variables.
+ * @returns a non-zero value if any element was found, zero otherwise.
+ */
+int RBT_buffered_get_maximum(struct RBT_Buffered_Tree *tree, uintmax_t *key, void **value);
+
+/**
+ * Merges the buffer and finds the key and value of the element with the minimum key value.
+ * "key" and "value" are both optional output variables.
+ * @returns a non-zero value if any element was found, zero otherwise.
+ */
+int RBT_buffered_get_minimum(struct RBT_Buffered_Tree *tree, uintmax_t *key, void **value);
+
+#endif
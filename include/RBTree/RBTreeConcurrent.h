@@ -0,0 +1,104 @@
+/**
+ * Concurrently written red-black tree
+ * A tree taking additions and deletions from many threads at once. Writers only lock the node
+ * they link a new leaf below, so updates on different parts of the tree proceed in parallel.
+ *
+ * Balancing is relaxed: new nodes are linked in red without any recoloring or rotation, and
+ * are queued for a rebalancing pass that repairs the red-red violations they leave later on,
+ * either from the adding thread once enough nodes are queued, or from a maintenance thread.
+ * Deleted elements are marked dead in place, and removed when a rebalancing pass finds that
+ * at least half of the nodes are dead.
+ *
+ * Keys are unique. The tree relies on the __atomic builtins of GCC and Clang.
+ **/
+#ifndef _HEADER_FILE_RBTConcurrent_20261019185214_
+#define _HEADER_FILE_RBTConcurrent_20261019185214_
+
+#include "RBTree.h"
+#include <pthread.h>
+
+/**
+ * Concurrent tree node. Coloring is determined by the most significant bit of the key, as for
+ * struct RBT_Node. "pending" links the nodes waiting for the next rebalancing pass, and "lock"
+ * guards the child pointers of the node while a leaf is linked below it.
+ */
+struct RBT_Concurrent_Node {
+    uintmax_t key;
+    void *data;
+    struct RBT_Concurrent_Node *left;
+    struct RBT_Concurrent_Node *right;
+    struct RBT_Concurrent_Node *parent;
+    struct RBT_Concurrent_Node *pending;
+    unsigned lock;
+};
+
+/**
+ * Front facade for the concurrent tree. The structure lock is taken shared by every addition,
+ * deletion and lookup, and exclusively by the rebalancing passes, which are the only ones to
+ * recolor, rotate or free nodes.
+ */
+struct RBT_Concurrent_Tree {
+    struct RBT_Concurrent_Node *root;
+    struct RBT_Concurrent_Node *pending;
+    uintmax_t node_count;
+    uintmax_t dead_count;
+    uintmax_t pending_count;
+    uintmax_t rebalance_threshold;
+    unsigned root_lock;
+    unsigned rebalancing;
+    pthread_rwlock_t structure_lock;
+};
+
+/**
+ * Concurrent tree initialization. An addition leaving "rebalance_threshold" or more nodes waiting
+ * for rebalancing runs a rebalancing pass itself. A threshold of zero leaves every pass to
+ * RBT_concurrent_rebalance, so the tree only stays balanced if it is called regularly.
+ * The memory allocation of the RBT_Concurrent_Tree is owned by the caller.
+ * @returns a non-zero value on success, and zero on failure.
+ */
+int RBT_concurrent_init_tree(struct RBT_Concurrent_Tree *tree, uintmax_t rebalance_threshold);
+
+/**
+ * Concurrent tree de-initialization. Must not run concurrently with any other operation.
+ * Deallocates every node, calling "freedata", if any, for every value stored in the tree.
+ */
+void RBT_concurrent_deinit_tree(struct RBT_Concurrent_Tree *tree, void (*freedata)(void *));
+
+/**
+ * Adds an element to the tree, unless the key is already present. Safe to call concurrently.
+ * @returns the added value, or NULL if the key was present or allocation failed.
+ */
+void *RBT_concurrent_add(struct RBT_Concurrent_Tree *tree, uintmax_t key, void *data);
+
+/**
+ * Deletes the element with the given key. Safe to call concurrently.
+ * @returns a non-zero value on successful deletion, zero otherwise.
+ */
+int RBT_concurrent_delete(struct RBT_Concurrent_Tree *tree, uintmax_t key);
+
+/**
+ * Finds a value given a key. Safe to call concurrently.
+ * @returns the found value, if any, NULL otherwise.
+ */
+void *RBT_concurrent_find(struct RBT_Concurrent_Tree *tree, uintmax_t key);
+
+/**
+ * Repairs the balance of every node added since the last pass, and removes the dead nodes once
+ * they make up half of the tree. Safe to call concurrently, e.g. from a maintenance thread,
+ * but blocks every other operation while it runs.
+ */
+void RBT_concurrent_rebalance(struct RBT_Concurrent_Tree *tree);
+
+/**
+ * Visits every element in ascending key order, stopping early when "visit" returns zero.
+ * Other operations are blocked during the visit, so "visit" must not use the tree at all.
+ * @returns a non-zero value if every element was visited, zero otherwise.
+ */
+int RBT_concurrent_for_each(struct RBT_Concurrent_Tree *tree, int (*visit)(uintmax_t key, void *data, void *context), void *context);
+
+/**
+ * @returns the number of elements in the tree.
+ */
+uintmax_t RBT_concurrent_node_count(struct RBT_Concurrent_Tree *tree);
+
+#endif
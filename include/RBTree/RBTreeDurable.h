@@ -0,0 +1,86 @@
+/**
+ * Durable RBT tree
+ * Every mutation is appended to a write-ahead log next to the tree, and the log is
+ * flushed to disk with a single fdatasync per group of mutations. Once the log grows
+ * past a threshold the whole tree is written to a checkpoint and the log is restarted.
+ * Opening a durable tree loads the last checkpoint and replays the log on top of it.
+ *
+ * Values are copied into the tree, as only their bytes can survive a restart.
+ * Mutations that have not been synced yet, at most "group_size" of them, are lost
+ * if the process dies.
+ **/
+#ifndef _HEADER_FILE_RBTDurable_20261019162733_
+#define _HEADER_FILE_RBTDurable_20261019162733_
+
+#include "RBTree.h"
+
+/**
+ * Durable tree facade, wrapping a RBT tree with the log and checkpoint state.
+ * The log file is "<path>.log" and the checkpoint file is "<path>.checkpoint".
+ * "failed" is set once a torn write could not be cut off the log, after which no mutation is taken.
+ */
+struct RBT_Durable_Tree {
+    struct RBT_Tree tree;
+    int log_fd;
+    char *log_path;
+    char *checkpoint_path;
+    uintmax_t generation;
+    unsigned char *batch;
+    size_t batch_size;
+    size_t batch_capacity;
+    size_t batch_count;
+    size_t group_size;
+    uintmax_t log_size;
+    uintmax_t checkpoint_size;
+    int failed;
+};
+
+/**
+ * Opens, or creates, the durable tree stored at the given path, recovering its contents from the
+ * checkpoint and log files. The log is synced every "group_size" mutations, and a checkpoint is
+ * written whenever the log grows beyond "checkpoint_size" bytes, zero disabling automatic checkpoints.
+ * The memory allocation of the RBT_Durable_Tree is owned by the caller.
+ * @returns a non-zero value on success, and zero on failure.
+ */
+int RBT_durable_open(struct RBT_Durable_Tree *tree, const char *path, size_t group_size, uintmax_t checkpoint_size);
+
+/**
+ * Syncs any pending mutations and releases the tree, leaving its files on disk.
+ * @returns a non-zero value if the pending mutations were synced, zero otherwise.
+ */
+int RBT_durable_close(struct RBT_Durable_Tree *tree);
+
+/**
+ * Adds a copy of the "size" bytes at "value" under the given key, and logs the mutation.
+ * A mutation whose group failed to sync stays pending, and is written again by the next sync.
+ * An element the tree turns away, as at its memory budget or capacity, is not logged either.
+ * @returns a non-zero value on success, zero on failure.
+ */
+int RBT_durable_add(struct RBT_Durable_Tree *tree, uintmax_t key, const void *value, size_t size);
+
+/**
+ * Deletes a node with the given key, and logs the mutation.
+ * @returns a non-zero value on successful deletion, zero otherwise.
+ */
+int RBT_durable_delete(struct RBT_Durable_Tree *tree, uintmax_t key);
+
+/**
+ * Finds the value stored under the given key. "size" is an optional output variable
+ * receiving the size of the value.
+ * @returns the found value, owned by the tree, if any, NULL otherwise.
+ */
+const void *RBT_durable_find(struct RBT_Durable_Tree *tree, uintmax_t key, size_t *size);
+
+/**
+ * Writes any pending mutations to the log and syncs it to disk.
+ * @returns a non-zero value on success, zero on failure.
+ */
+int RBT_durable_sync(struct RBT_Durable_Tree *tree);
+
+/**
+ * Writes the whole tree to a new checkpoint and restarts the log.
+ * @returns a non-zero value on success, zero on failure.
+ */
+int RBT_durable_checkpoint(struct RBT_Durable_Tree *tree);
+
+#endif
@@ -0,0 +1,349 @@
+/**
+ * Header-only, type specialized red-black tree
+ * RBT_GENERATE(name, key_type, value_type, compare) expands to a red-black tree named "name"
+ * with keys of key_type and values of value_type stored inline in the nodes, and with every
+ * operation defined static inline, so lookups can be inlined into the calling code.
+ *
+ * "compare" is a function or function-like macro taking two keys, returning a negative
+ * value, zero or a positive value when the first key is smaller, equal or larger.
+ *
+ * The generated operations mirror the RBT tree interface:
+ *
+ *   struct name;                              tree facade with root and node_count
+ *   void name_init(struct name *);
+ *   void name_deinit(struct name *, void (*)(value_type *));
+ *   value_type *name_add(struct name *, key_type, value_type);
+ *   value_type *name_find(struct name *, key_type);
+ *   int name_delete(struct name *, key_type);
+ *   int name_get_minimum(struct name *, key_type *, value_type *);
+ *   int name_get_maximum(struct name *, key_type *, value_type *);
+ *
+ * Nodes are allocated with RBT_MALLOC and freed with RBT_FREE.
+ **/
+#ifndef _HEADER_FILE_RBTGenerate_20261019160215_
+#define _HEADER_FILE_RBTGenerate_20261019160215_
+
+#include "RBTree.h"
+#include <stdlib.h>
+
+#define RBT_GENERATE(name, key_type, value_type, compare) \
+    RBT_GENERATE_TYPES(name, key_type, value_type) \
+    RBT_GENERATE_ROTATIONS(name) \
+    RBT_GENERATE_INSERT(name, key_type, value_type, compare) \
+    RBT_GENERATE_REMOVE(name, key_type, compare) \
+    RBT_GENERATE_LOOKUP(name, key_type, value_type, compare)
+
+#define RBT_GENERATE_TYPES(name, key_type, value_type) \
+    struct name##_node { \
+        key_type key; \
+        value_type value; \
+        struct name##_node *left; \
+        struct name##_node *right; \
+        struct name##_node *parent; \
+        unsigned char red; \
+    }; \
+    \
+    struct name { \
+        struct name##_node *root; \
+        uintmax_t node_count; \
+    }; \
+    \
+    static inline void name##_init(struct name *tree) { \
+        tree->root = NULL; \
+        tree->node_count = 0; \
+    } \
+    \
+    static inline void name##_destroy_subtree(struct name##_node *node, void (*freevalue)(value_type *)) { \
+        while ( node != NULL ) { \
+            struct name##_node *right = node->right; \
+            name##_destroy_subtree(node->left, freevalue); \
+            if ( freevalue ) { \
+                freevalue(&node->value); \
+            } \
+            RBT_FREE(node); \
+            node = right; \
+        } \
+    } \
+    \
+    static inline void name##_deinit(struct name *tree, void (*freevalue)(value_type *)) { \
+        name##_destroy_subtree(tree->root, freevalue); \
+        tree->root = NULL; \
+        tree->node_count = 0; \
+    }
+
+#define RBT_GENERATE_ROTATIONS(name) \
+    static inline int name##_is_red(struct name##_node *node) { \
+        return node != NULL && node->red; \
+    } \
+    \
+    static inline void name##_replace_child(struct name *tree, struct name##_node *old, struct name##_node *replacement) { \
+        if ( old->parent == NULL ) { \
+            tree->root = replacement; \
+        } else if ( old == old->parent->left ) { \
+            old->parent->left = replacement; \
+        } else { \
+            old->parent->right = replacement; \
+        } \
+        if ( replacement != NULL ) { \
+            replacement->parent = old->parent; \
+        } \
+    } \
+    \
+    static inline void name##_left_rotate(struct name *tree, struct name##_node *node) { \
+        struct name##_node *right_node = node->right; \
+        node->right = right_node->left; \
+        if ( right_node->left != NULL ) { \
+            right_node->left->parent = node; \
+        } \
+        name##_replace_child(tree, node, right_node); \
+        right_node->left = node; \
+        node->parent = right_node; \
+    } \
+    \
+    static inline void name##_right_rotate(struct name *tree, struct name##_node *node) { \
+        struct name##_node *left_node = node->left; \
+        node->left = left_node->right; \
+        if ( left_node->right != NULL ) { \
+            left_node->right->parent = node; \
+        } \
+        name##_replace_child(tree, node, left_node); \
+        left_node->right = node; \
+        node->parent = left_node; \
+    }
+
+#define RBT_GENERATE_INSERT(name, key_type, value_type, compare) \
+    static inline void name##_insert_fixup(struct name *tree, struct name##_node *node) { \
+        while ( name##_is_red(node->parent) ) { \
+            struct name##_node *parent = node->parent; \
+            struct name##_node *grandparent = parent->parent; \
+            if ( parent == grandparent->left ) { \
+                struct name##_node *uncle = grandparent->right; \
+                if ( name##_is_red(uncle) ) { \
+                    parent->red = 0; \
+                    uncle->red = 0; \
+                    grandparent->red = 1; \
+                    node = grandparent; \
+                    continue; \
+                } \
+                if ( node == parent->right ) { \
+                    node = parent; \
+                    name##_left_rotate(tree, node); \
+                    parent = node->parent; \
+                } \
+                parent->red = 0; \
+                grandparent->red = 1; \
+                name##_right_rotate(tree, grandparent); \
+            } else { \
+                struct name##_node *uncle = grandparent->left; \
+                if ( name##_is_red(uncle) ) { \
+                    parent->red = 0; \
+                    uncle->red = 0; \
+                    grandparent->red = 1; \
+                    node = grandparent; \
+                    continue; \
+                } \
+                if ( node == parent->left ) { \
+                    node = parent; \
+                    name##_right_rotate(tree, node); \
+                    parent = node->parent; \
+                } \
+                parent->red = 0; \
+                grandparent->red = 1; \
+                name##_left_rotate(tree, grandparent); \
+            } \
+        } \
+        tree->root->red = 0; \
+    } \
+    \
+    static inline value_type *name##_add(struct name *tree, key_type key, value_type value) { \
+        struct name##_node *parent = NULL; \
+        struct name##_node *iterator = tree->root; \
+        int smaller = 0; \
+        while ( iterator != NULL ) { \
+            parent = iterator; \
+            smaller = compare(key, iterator->key) < 0; \
+            iterator = smaller ? iterator->left : iterator->right; \
+        } \
+        struct name##_node *node = RBT_MALLOC( sizeof(struct name##_node) ); \
+        if ( node == NULL ) { \
+            return NULL; \
+        } \
+        node->key = key; \
+        node->value = value; \
+        node->left = NULL; \
+        node->right = NULL; \
+        node->parent = parent; \
+        node->red = 1; \
+        if ( parent == NULL ) { \
+            tree->root = node; \
+        } else if ( smaller ) { \
+            parent->left = node; \
+        } else { \
+            parent->right = node; \
+        } \
+        tree->node_count++; \
+        name##_insert_fixup(tree, node); \
+        return &node->value; \
+    }
+
+#define RBT_GENERATE_REMOVE(name, key_type, compare) \
+    static inline void name##_remove_fixup(struct name *tree, struct name##_node *node, struct name##_node *parent) { \
+        while ( node != tree->root && !name##_is_red(node) ) { \
+            if ( node == parent->left ) { \
+                struct name##_node *sibling = parent->right; \
+                if ( sibling->red ) { \
+                    sibling->red = 0; \
+                    parent->red = 1; \
+                    name##_left_rotate(tree, parent); \
+                    sibling = parent->right; \
+                } \
+                if ( !name##_is_red(sibling->left) && !name##_is_red(sibling->right) ) { \
+                    sibling->red = 1; \
+                    node = parent; \
+                    parent = node->parent; \
+                    continue; \
+                } \
+                if ( !name##_is_red(sibling->right) ) { \
+                    sibling->left->red = 0; \
+                    sibling->red = 1; \
+                    name##_right_rotate(tree, sibling); \
+                    sibling = parent->right; \
+                } \
+                sibling->red = parent->red; \
+                parent->red = 0; \
+                sibling->right->red = 0; \
+                name##_left_rotate(tree, parent); \
+                node = tree->root; \
+            } else { \
+                struct name##_node *sibling = parent->left; \
+                if ( sibling->red ) { \
+                    sibling->red = 0; \
+                    parent->red = 1; \
+                    name##_right_rotate(tree, parent); \
+                    sibling = parent->left; \
+                } \
+                if ( !name##_is_red(sibling->left) && !name##_is_red(sibling->right) ) { \
+                    sibling->red = 1; \
+                    node = parent; \
+                    parent = node->parent; \
+                    continue; \
+                } \
+                if ( !name##_is_red(sibling->left) ) { \
+                    sibling->right->red = 0; \
+                    sibling->red = 1; \
+                    name##_left_rotate(tree, sibling); \
+                    sibling = parent->left; \
+                } \
+                sibling->red = parent->red; \
+                parent->red = 0; \
+                sibling->left->red = 0; \
+                name##_right_rotate(tree, parent); \
+                node = tree->root; \
+            } \
+        } \
+        if ( node != NULL ) { \
+            node->red = 0; \
+        } \
+    } \
+    \
+    static inline void name##_remove(struct name *tree, struct name##_node *node) { \
+        struct name##_node *point; \
+        struct name##_node *point_parent; \
+        int removed_red = node->red; \
+        if ( node->left == NULL ) { \
+            point = node->right; \
+            point_parent = node->parent; \
+            name##_replace_child(tree, node, node->right); \
+        } else if ( node->right == NULL ) { \
+            point = node->left; \
+            point_parent = node->parent; \
+            name##_replace_child(tree, node, node->left); \
+        } else { \
+            struct name##_node *successor = node->right; \
+            while ( successor->left != NULL ) { \
+                successor = successor->left; \
+            } \
+            removed_red = successor->red; \
+            point = successor->right; \
+            if ( successor->parent == node ) { \
+                point_parent = successor; \
+            } else { \
+                point_parent = successor->parent; \
+                name##_replace_child(tree, successor, successor->right); \
+                successor->right = node->right; \
+                successor->right->parent = successor; \
+            } \
+            name##_replace_child(tree, node, successor); \
+            successor->left = node->left; \
+            successor->left->parent = successor; \
+            successor->red = node->red; \
+        } \
+        if ( !removed_red ) { \
+            name##_remove_fixup(tree, point, point_parent); \
+        } \
+        RBT_FREE(node); \
+        tree->node_count--; \
+    } \
+    \
+    static inline struct name##_node *name##_find_node(struct name *tree, key_type key) { \
+        struct name##_node *iterator = tree->root; \
+        while ( iterator != NULL ) { \
+            int order = compare(key, iterator->key); \
+            if ( order == 0 ) { \
+                return iterator; \
+            } \
+            iterator = order < 0 ? iterator->left : iterator->right; \
+        } \
+        return NULL; \
+    } \
+    \
+    static inline int name##_delete(struct name *tree, key_type key) { \
+        struct name##_node *node = name##_find_node(tree, key); \
+        if ( node == NULL ) { \
+            return 0; \
+        } \
+        name##_remove(tree, node); \
+        return 1; \
+    }
+
+#define RBT_GENERATE_LOOKUP(name, key_type, value_type, compare) \
+    static inline value_type *name##_find(struct name *tree, key_type key) { \
+        struct name##_node *node = name##_find_node(tree, key); \
+        return node == NULL ? NULL : &node->value; \
+    } \
+    \
+    static inline int name##_get_minimum(struct name *tree, key_type *key, value_type *value) { \
+        struct name##_node *node = tree->root; \
+        if ( node == NULL ) { \
+            return 0; \
+        } \
+        while ( node->left != NULL ) { \
+            node = node->left; \
+        } \
+        if ( key ) { \
+            *key = node->key; \
+        } \
+        if ( value ) { \
+            *value = node->value; \
+        } \
+        return 1; \
+    } \
+    \
+    static inline int name##_get_maximum(struct name *tree, key_type *key, value_type *value) { \
+        struct name##_node *node = tree->root; \
+        if ( node == NULL ) { \
+            return 0; \
+        } \
+        while ( node->right != NULL ) { \
+            node = node->right; \
+        } \
+        if ( key ) { \
+            *key = node->key; \
+        } \
+        if ( value ) { \
+            *value = node->value; \
+        } \
+        return 1; \
+    }
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * Memory-mapped RBT tree
+ * The whole tree lives in a file mapped into memory. Nodes refer to each other, and to their
+ * values, by offsets from the start of the mapping instead of pointers, so the file can be
+ * mapped at any address: reopening a tree is a single mmap, and nodes are paged in on demand
+ * by the lookups that touch them. Nodes and values are allocated inside the mapping by the
+ * tree itself, growing the file as needed.
+ *
+ * A file can be opened read-only by any number of processes for shared lookups, as long as
+ * no process modifies it at the same time. The file is not crash consistent: changes reach the
+ * disk in page order when the kernel writes them back, or on RBT_mapped_sync, so a process dying
+ * in the middle of a change can leave a corrupt tree behind. See RBTreeDurable.h for that.
+ **/
+#ifndef _HEADER_FILE_RBTMapped_20261019174016_
+#define _HEADER_FILE_RBTMapped_20261019174016_
+
+#include "RBTree.h"
+
+/**
+ * Mapped tree facade. The root, node count and allocator state are stored in the file.
+ */
+struct RBT_Mapped_Tree {
+    int fd;
+    int read_only;
+    unsigned char *base;
+    size_t mapped_size;
+};
+
+/**
+ * Opens, or creates unless "read_only" is set, the mapped tree stored in the file at the given path.
+ * The memory allocation of the RBT_Mapped_Tree is owned by the caller.
+ * @returns a non-zero value on success, and zero on failure or if the file is not a mapped tree.
+ */
+int RBT_mapped_open(struct RBT_Mapped_Tree *tree, const char *path, int read_only);
+
+/**
+ * Syncs a writable tree to disk, and unmaps and closes the file.
+ * @returns a non-zero value if the tree was synced, zero otherwise.
+ */
+int RBT_mapped_close(struct RBT_Mapped_Tree *tree);
+
+/**
+ * Adds a copy of the "size" bytes at "value" under the given key.
+ * @returns a non-zero value on success, zero on failure or if the tree is read-only.
+ */
+int RBT_mapped_add(struct RBT_Mapped_Tree *tree, uintmax_t key, const void *value, size_t size);
+
+/**
+ * Delete an element with the given key, releasing its node and value to the in-file allocator.
+ * @returns a non-zero value on successful deletion, zero otherwise.
+ */
+int RBT_mapped_delete(struct RBT_Mapped_Tree *tree, uintmax_t key);
+
+/**
+ * Finds the value stored under the given key. "size" is an optional output variable receiving
+ * the size of the value.
+ * @returns the found value inside the mapping, valid until the tree is next modified, or NULL.
+ */
+const void *RBT_mapped_find(struct RBT_Mapped_Tree *tree, uintmax_t key, size_t *size);
+
+/**
+ * Finds the element with the trees' maximum key value. "key", "value" and "size" are
+ * optional output variables.
+ * @returns a non-zero value if any element was found, zero otherwise.
+ */
+int RBT_mapped_get_maximum(struct RBT_Mapped_Tree *tree, uintmax_t *key, const void **value, size_t *size);
+
+/**
+ * Finds the element with the trees' minimum key value. "key", "value" and "size" are
+ * optional output variables.
+ * @returns a non-zero value if any element was found, zero otherwise.
+ */
+int RBT_mapped_get_minimum(struct RBT_Mapped_Tree *tree, uintmax_t *key, const void **value, size_t *size);
+
+/**
+ * @returns the number of elements in the tree.
+ */
+uintmax_t RBT_mapped_node_count(struct RBT_Mapped_Tree *tree);
+
+/**
+ * Writes every modified page of the mapping back to the file.
+ * @returns a non-zero value on success, zero on failure.
+ */
+int RBT_mapped_sync(struct RBT_Mapped_Tree *tree);
+
+#endif
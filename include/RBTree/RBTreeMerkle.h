@@ -0,0 +1,49 @@
+/**
+ * Merkle hashed RBT tree
+ * An augmentation keeping a hash of the contents of every subtree. The hash is a polynomial
+ * over the element hashes in key order, so it depends only on the elements and never on the
+ * shape of the tree: replicas built in different orders hash alike, and the hash of any key
+ * range is available through RBT_range_aggregate.
+ *
+ * RBT_diff compares two hashed trees range by range, only descending into ranges whose hashes
+ * differ, so trees with d differing keys are compared in O(d log^2 n) rather than O(n).
+ **/
+#ifndef _HEADER_FILE_RBTMerkle_20261019180154_
+#define _HEADER_FILE_RBTMerkle_20261019180154_
+
+#include "RBTree.h"
+
+/**
+ * Aggregate of a key range: the polynomial hash of its elements, and the base raised to the
+ * number of elements. Both are reduced modulo the prime 2^61 - 1.
+ */
+struct RBT_Merkle_Hash {
+    uint64_t hash;
+    uint64_t power;
+};
+
+/**
+ * Merkle augmentation. "hash_value" maps the data of an element to a hash of its contents,
+ * and may be NULL to only hash the keys, as data references rarely mean anything across replicas.
+ */
+struct RBT_Merkle {
+    struct RBT_Augment augment;
+    uint64_t (*hash_value)(void *data, void *context);
+    void *context;
+};
+
+/**
+ * Fills in a Merkle augmentation, which is then enabled on an empty tree with
+ * RBT_set_augment(tree, &merkle->augment). The RBT_Merkle has to outlive the tree.
+ */
+void RBT_merkle_init(struct RBT_Merkle *merkle, uint64_t (*hash_value)(void *data, void *context), void *context);
+
+/**
+ * Calls "visit" for every key whose elements differ between the trees, in ascending key order,
+ * stopping early when "visit" returns zero. Both trees must be augmented with Merkle augmentations
+ * hashing values the same way.
+ * @returns a non-zero value if every difference was visited, zero otherwise.
+ */
+int RBT_diff(struct RBT_Tree *a, struct RBT_Tree *b, int (*visit)(uintmax_t key, void *context), void *context);
+
+#endif
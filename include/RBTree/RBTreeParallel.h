@@ -0,0 +1,49 @@
+/**
+ * Parallel bulk operations on RBT trees
+ * Whole tree passes are split into subtree tasks, which are executed by a small
+ * work-stealing pool of threads started for the duration of each call.
+ *
+ * None of these functions synchronize with other users of the tree, so the tree
+ * must not be modified by anyone else while a bulk operation is running.
+ * Trees using the RBT_ENGINE_BPLUS engine have no subtrees to hand out, so every
+ * function but RBT_parallel_deinit_tree fails on them.
+ **/
+#ifndef _HEADER_FILE_RBTParallel_20261019154436_
+#define _HEADER_FILE_RBTParallel_20261019154436_
+
+#include "RBTree.h"
+
+/**
+ * Calls "visit" once for every element of the tree, from up to "threads" threads at once.
+ * The elements are visited in no particular order.
+ * @returns a non-zero value on success, zero if the worker threads could not be started.
+ */
+int RBT_parallel_for_each(struct RBT_Tree *tree, void (*visit)(uintmax_t key, void *data, void *context), void *context, unsigned threads);
+
+/**
+ * Reduces every element of the tree with the given monoid into "out", in ascending key order.
+ * The tree is cut into subtrees at a fixed depth, and the partial results are combined in key order,
+ * so the result only depends on the tree and not on the number of threads or their scheduling.
+ * "out" must point to at least monoid->size bytes.
+ * @returns a non-zero value on success, zero on failure.
+ */
+int RBT_parallel_reduce(struct RBT_Tree *tree, const struct RBT_Augment *monoid, void *out, unsigned threads);
+
+/**
+ * De-initializes the tree like RBT_deinit_tree, freeing disjoint subtrees from up to "threads" threads.
+ * The hash index, the lookup filter and the capacity are freed along with the nodes.
+ * The tree is left empty afterwards.
+ */
+void RBT_parallel_deinit_tree(struct RBT_Tree *tree, void (*data_deallocator)(void *), unsigned threads);
+
+/**
+ * Builds a balanced tree from "count" keys in ascending order, using up to "threads" threads.
+ * "values" is optional, and the tree must be empty and not a sequence. Nodes are allocated concurrently, so RBT_MALLOC
+ * has to be thread safe. A tree with a capacity is evicted down to it once built, ranking the keys
+ * from least to most recent in ascending order. The build fails up front if "count" nodes would take
+ * the tree past its memory budget, even when a capacity would evict some of them afterwards.
+ * @returns a non-zero value on success, zero on failure in which case the tree is left empty.
+ */
+int RBT_parallel_build(struct RBT_Tree *tree, const uintmax_t *keys, void **values, size_t count, unsigned threads);
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * Red-black key set
+ * A red-black tree only storing keys, for trees used as membership indexes. The nodes carry
+ * no data reference, making them a pointer smaller than struct RBT_Node, and every key is
+ * stored at most once.
+ *
+ * The interface mirrors the one of the RBT tree, with a RBT_Set_ prefix.
+ **/
+#ifndef _HEADER_FILE_RBTSet_20261019182410_
+#define _HEADER_FILE_RBTSet_20261019182410_
+
+#include "RBTree.h"
+
+/**
+ * Set node, carrying a key as well as reference to sub and parent nodes.
+ * Coloring is determined by the most significant bit of the key, as for struct RBT_Node.
+ */
+struct RBT_Set_Node {
+    uintmax_t key;
+    struct RBT_Set_Node *left;
+    struct RBT_Set_Node *right;
+    struct RBT_Set_Node *parent;
+};
+
+/**
+ * Front facade for the set carrying the root node, as well as the number of keys.
+ * RBT_NODE_COUNT works on this facade as well.
+ */
+struct RBT_Set {
+    struct RBT_Set_Node *root;
+    uintmax_t node_count;
+};
+
+/**
+ * Set initialization. The memory allocation of the RBT_Set is owned by the caller.
+ * @returns a non-zero value on success, and zero on failure.
+ */
+int RBT_Set_init(struct RBT_Set *set);
+
+/**
+ * Set de-initialization. Deallocates every node of the set, but not the RBT_Set itself.
+ */
+void RBT_Set_deinit(struct RBT_Set *set);
+
+/**
+ * Adds a key to the set, unless it is already a member.
+ * @returns a non-zero value if the key was added, zero if it was a member already or allocation failed.
+ */
+int RBT_Set_insert(struct RBT_Set *set, uintmax_t key);
+
+/**
+ * @returns a non-zero value if the key is a member of the set, zero otherwise.
+ */
+int RBT_Set_contains(struct RBT_Set *set, uintmax_t key);
+
+/**
+ * Removes a key from the set.
+ * @returns a non-zero value if the key was a member, zero otherwise.
+ */
+int RBT_Set_erase(struct RBT_Set *set, uintmax_t key);
+
+/**
+ * Visits every key of the set in ascending order. The iteration stops early when "visit"
+ * returns zero. The set must not be modified while it is being visited.
+ * @returns a non-zero value if every key was visited, zero otherwise.
+ */
+int RBT_Set_for_each(struct RBT_Set *set, int (*visit)(uintmax_t key, void *context), void *context);
+
+/**
+ * Finds the smallest key of the set. "key" is an optional output variable.
+ * @returns a non-zero value if the set is not empty, zero otherwise.
+ */
+int RBT_Set_get_minimum(struct RBT_Set *set, uintmax_t *key);
+
+/**
+ * Finds the largest key of the set. "key" is an optional output variable.
+ * @returns a non-zero value if the set is not empty, zero otherwise.
+ */
+int RBT_Set_get_maximum(struct RBT_Set *set, uintmax_t *key);
+
+#endif
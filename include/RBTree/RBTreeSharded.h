@@ -0,0 +1,98 @@
+/**
+ * Range partitioned RBT tree
+ * The key space is split into ordered ranges, each backed by its own RBT tree
+ * and lock, so writers working on disjoint key ranges do not contend.
+ *
+ * Shards are split at their median key when they grow past the split threshold,
+ * and adjacent shards are merged again when they become sparsely populated.
+ **/
+#ifndef _HEADER_FILE_RBTSharded_20261019153012_
+#define _HEADER_FILE_RBTSharded_20261019153012_
+
+#include "RBTree.h"
+#include <pthread.h>
+
+/**
+ * A single key range of a sharded tree, holding every key from "lower" up to
+ * the lower bound of the next shard. A shard found to hold nothing but "uniform_key"
+ * when it was due for a split is marked "uniform", as equal keys cannot be split apart.
+ */
+struct RBT_Shard {
+    uintmax_t lower;
+    struct RBT_Tree tree;
+    pthread_mutex_t lock;
+    int uniform;
+    uintmax_t uniform_key;
+};
+
+/**
+ * Sharded tree facade. The shard layout is protected by a reader-writer lock,
+ * that is only taken exclusively while shards are split or merged.
+ */
+struct RBT_Sharded_Tree {
+    struct RBT_Shard **shards;
+    size_t shard_count;
+    size_t minimum_shard_count;
+    uintmax_t split_threshold;
+    pthread_rwlock_t layout_lock;
+};
+
+/**
+ * Sharded tree initialization. The key space is split into "shard_count" equally wide ranges,
+ * and a shard is split in two when it holds more than "split_threshold" nodes.
+ * The memory allocation of the RBT_Sharded_Tree is owned by the caller.
+ * @returns a non-zero value on success, and zero on failure.
+ */
+int RBT_init_sharded_tree(struct RBT_Sharded_Tree *tree, size_t shard_count, uintmax_t split_threshold);
+
+/**
+ * Sharded tree de-initialization.
+ * Deallocates every shard, calling the data_deallocator, if any, for every value stored in the tree.
+ */
+void RBT_deinit_sharded_tree(struct RBT_Sharded_Tree *tree, void (*data_deallocator)(void *));
+
+/**
+ * Adds a new node to the shard owning the key. Safe to call concurrently.
+ * @returns The added value, if any, NULL otherwise.
+ */
+void *RBT_sharded_add(struct RBT_Sharded_Tree *tree, uintmax_t key, void *data);
+
+/**
+ * Deletes a node with the given key. Safe to call concurrently.
+ * @returns a non-zero value on successful deletion, zero otherwise.
+ */
+int RBT_sharded_delete(struct RBT_Sharded_Tree *tree, uintmax_t key);
+
+/**
+ * Finds a value given a key. Safe to call concurrently.
+ * @returns the found value, if any, NULL otherwise.
+ */
+void *RBT_sharded_find(struct RBT_Sharded_Tree *tree, uintmax_t key);
+
+/**
+ * Finds the key and value of the element with the smallest key across all shards.
+ * "key" and "value" are both optional output variables.
+ * @returns a non-zero value if any element was found, zero otherwise.
+ */
+int RBT_sharded_get_minimum(struct RBT_Sharded_Tree *tree, uintmax_t *key, void **value);
+
+/**
+ * Finds the key and value of the element with the largest key across all shards.
+ * "key" and "value" are both optional output variables.
+ * @returns a non-zero value if any element was found, zero otherwise.
+ */
+int RBT_sharded_get_maximum(struct RBT_Sharded_Tree *tree, uintmax_t *key, void **value);
+
+/**
+ * Visits every element in ascending key order across all shards, stopping early when "visit"
+ * returns zero. Every shard is locked while it is visited, so "visit" must not modify the tree.
+ * @returns a non-zero value if every element was visited, zero otherwise.
+ */
+int RBT_sharded_for_each(struct RBT_Sharded_Tree *tree, int (*visit)(uintmax_t key, void *data, void *context), void *context);
+
+/**
+ * Sums the node counts of all shards.
+ */
+uintmax_t RBT_sharded_node_count(struct RBT_Sharded_Tree *tree);
+
+#endif
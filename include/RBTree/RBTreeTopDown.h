@@ -0,0 +1,78 @@
+/**
+ * Top-down red-black tree
+ * An alternative engine rebalancing in a single pass from the root down during
+ * both insertion and deletion. As no fixup ever walks back up the tree, nodes
+ * carry no parent reference and are a pointer smaller than struct RBT_Node.
+ *
+ * The interface mirrors the one of the RBT tree, with a RBT_TD_ prefix.
+ **/
+#ifndef _HEADER_FILE_RBTTopDown_20261019161322_
+#define _HEADER_FILE_RBTTopDown_20261019161322_
+
+#include "RBTree.h"
+
+/**
+ * Top-down tree node, carrying a key, a data reference and the two sub nodes,
+ * with link[0] being the left and link[1] the right sub node.
+ * Coloring is determined by the most significant bit of the key, as for struct RBT_Node.
+ */
+struct RBT_TD_Node {
+    uintmax_t key;
+    void *data;
+    struct RBT_TD_Node *link[2];
+};
+
+/**
+ * Front facade for the top-down tree carrying the root node, as well as some meta data.
+ * RBT_NODE_COUNT works on this facade as well.
+ */
+struct RBT_TD_Tree {
+    struct RBT_TD_Node *root;
+    uintmax_t node_count;
+};
+
+/**
+ * Top-down tree initialization. The memory allocation of the RBT_TD_Tree is owned by the caller.
+ * @returns a non-zero value on success, and zero on failure.
+ */
+int RBT_TD_init_tree(struct RBT_TD_Tree *tree);
+
+/**
+ * Top-down tree de-initialization. Deallocates every node, calling the data_deallocator,
+ * if provided, for every value stored in the tree.
+ */
+void RBT_TD_deinit_tree(struct RBT_TD_Tree *tree, void (*data_deallocator)(void *));
+
+/**
+ * Adds a new node to the tree with the given key and value.
+ * @returns The added value, if any, NULL otherwise.
+ */
+void *RBT_TD_add(struct RBT_TD_Tree *tree, uintmax_t key, void *data);
+
+/**
+ * Delete a node with the given key from the tree.
+ * @returns a non-zero value on successful deletion, zero otherwise.
+ */
+int RBT_TD_delete(struct RBT_TD_Tree *tree, uintmax_t key);
+
+/**
+ * Finds a value in the tree given a key.
+ * @returns the found value, if any, NULL otherwise.
+ */
+void *RBT_TD_find(struct RBT_TD_Tree *tree, uintmax_t key);
+
+/**
+ * Finds the key and value of the element with the trees' maximum key value.
+ * "key" and "value" are both optional output variables.
+ * @returns a non-zero value if any element was found, zero otherwise.
+ */
+int RBT_TD_get_maximum(struct RBT_TD_Tree *tree, uintmax_t *key, void **value);
+
+/**
+ * Finds the key and value of the element with the trees' minimum key value.
+ * "key" and "value" are both optional output variables.
+ * @returns a non-zero value if any element was found, zero otherwise.
+ */
+int RBT_TD_get_minimum(struct RBT_TD_Tree *tree, uintmax_t *key, void **value);
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * Workload traces
+ * A trace records the calls made on a RBT tree, so that a production workload can be replayed
+ * against another build of the library with the redblacktree_replay tool. Every RBT_add, RBT_find,
+ * RBT_delete, RBT_get_minimum and RBT_get_maximum on a tree with a trace set is recorded with its
+ * key and the time it was made at.
+ *
+ * Events are buffered in the trace and written in blocks, each taking a few bytes: the operation,
+ * the key and the time since the previous event, both as variable length integers.
+ * A trace is not synchronized, so trees sharing one must not be used from several threads at once.
+ **/
+#ifndef _HEADER_FILE_RBTTrace_20261019190411_
+#define _HEADER_FILE_RBTTrace_20261019190411_
+
+#include "RBTree.h"
+#include <stdio.h>
+
+#define RBT_TRACE_BUFFER_SIZE 65536
+
+/**
+ * Recorded operations.
+ */
+enum RBT_Trace_Operation {
+    RBT_TRACE_ADD = 1,
+    RBT_TRACE_FIND,
+    RBT_TRACE_DELETE,
+    RBT_TRACE_MINIMUM,
+    RBT_TRACE_MAXIMUM
+};
+
+/**
+ * A recorded call. "key" is zero for RBT_TRACE_MINIMUM and RBT_TRACE_MAXIMUM, and "timestamp"
+ * counts the nanoseconds since the trace was opened.
+ */
+struct RBT_Trace_Event {
+    enum RBT_Trace_Operation operation;
+    uintmax_t key;
+    uint64_t timestamp;
+};
+
+/**
+ * Trace being recorded or read. "failed" is set once a write failed, or a read found the file corrupt.
+ */
+struct RBT_Trace {
+    FILE *file;
+    uint64_t start;
+    uint64_t timestamp;
+    uintmax_t event_count;
+    int failed;
+    size_t buffered;
+    unsigned char buffer[RBT_TRACE_BUFFER_SIZE];
+};
+
+/**
+ * Creates, or truncates, the trace file at the given path for recording.
+ * The memory allocation of the RBT_Trace is owned by the caller.
+ * @returns a non-zero value on success, and zero on failure.
+ */
+int RBT_trace_open(struct RBT_Trace *trace, const char *path);
+
+/**
+ * Opens the trace file at the given path for reading with RBT_trace_read.
+ * @returns a non-zero value on success, and zero if the file cannot be read or is not a trace.
+ */
+int RBT_trace_open_read(struct RBT_Trace *trace, const char *path);
+
+/**
+ * Writes any buffered events, and closes the trace file. Trees must not record to the trace any more.
+ * @returns a non-zero value if every event was written, or the whole file was read, zero otherwise.
+ */
+int RBT_trace_close(struct RBT_Trace *trace);
+
+/**
+ * Starts recording the calls on a tree to "trace", or stops recording if "trace" is NULL.
+ * Several trees may record to the same trace.
+ * @returns a non-zero value on success, zero otherwise.
+ */
+int RBT_set_trace(struct RBT_Tree *tree, struct RBT_Trace *trace);
+
+/**
+ * Records a call. Only needed for calls made on something else than a RBT tree.
+ */
+void RBT_trace_record(struct RBT_Trace *trace, enum RBT_Trace_Operation operation, uintmax_t key);
+
+/**
+ * Reads the next event of a trace opened with RBT_trace_open_read.
+ * @returns a non-zero value if an event was read, zero at the end of the trace or if it is corrupt.
+ */
+int RBT_trace_read(struct RBT_Trace *trace, struct RBT_Trace_Event *event);
+
+#endif
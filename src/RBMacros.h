@@ -23,4 +23,24 @@
 
 #define RBT_KEYVALUE(key) (key & (~RBT_COLOR_BITMASK))
 
+// under the WAVL policy the same bit holds the parity of the rank of a node, NULL nodes having rank -1
+#define RBT_RANK_PARITY(node) ((node) == NULL || ((node)->key & RBT_COLOR_BITMASK) != 0)
+#define RBT_FLIP_RANK(node) ( (node)->key ^= RBT_COLOR_BITMASK )
+#define RBT_SAME_PARITY(a, b) (RBT_RANK_PARITY(a) == RBT_RANK_PARITY(b))
+
+// relaxed atomic counters where the compiler provides them, as trees may live in several threads
+#if defined(__GNUC__)
+#define RBT_COUNTER_ADD(counter, value) ((void) __atomic_add_fetch(&(counter), (value), __ATOMIC_RELAXED))
+#define RBT_COUNTER_SUB(counter, value) ((void) __atomic_sub_fetch(&(counter), (value), __ATOMIC_RELAXED))
+#define RBT_COUNTER_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#else
+#define RBT_COUNTER_ADD(counter, value) ((void) ((counter) += (value)))
+#define RBT_COUNTER_SUB(counter, value) ((void) ((counter) -= (value)))
+#define RBT_COUNTER_LOAD(counter) (counter)
+#endif
+
+// aggregates of augmented trees are stored right after the node
+#define RBT_NODE_AGGREGATE(node) ((void *) ((node) + 1))
+#define RBT_AGGREGATE_OF(tree, node) ((node) ? RBT_NODE_AGGREGATE(node) : (tree)->augment->identity)
+
 #endif
\ No newline at end of file
@@ -6,17 +6,65 @@
  * Implemented by Anders Busch (2016-2021)
  **/
 #include "RBTree/RBTree.h"
+#include "RBTree/RBTreeTrace.h"
+#include "RBTree/RBTreeBPlus.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 #include "RBMacros.h"
+#include "RBTreeInternal.h"
+#include "RBTreeRebalance.h"
+
+char RBT_tombstone;
+
+// memory held by every tree of the process, see RBT_get_global_memory_usage
+static uintmax_t RBT_global_nodes;
+static uintmax_t RBT_global_slack;
+static uintmax_t RBT_global_auxiliary;
+
+// subtree sizes of sequences, kept as the aggregate of a built-in augmentation
+#define RBT_SUBTREE_SIZE(node) ((node) ? *(uintmax_t *) RBT_NODE_AGGREGATE(node) : 0)
+
+static const uintmax_t RBT_sequence_empty = 0;
+
+static void RBT_sequence_lift(void *out, uintmax_t key, void *data, void *context) {
+    ((void) key); ((void) data); ((void) context);
+    *(uintmax_t *) out = 1;
+}
+
+static void RBT_sequence_combine(void *out, const void *left, const void *right, void *context) {
+    ((void) context);
+    *(uintmax_t *) out = *(const uintmax_t *) left + *(const uintmax_t *) right;
+}
+
+const struct RBT_Augment RBT_sequence_augment = {
+    sizeof(uintmax_t), &RBT_sequence_empty, RBT_sequence_lift, RBT_sequence_combine, NULL
+};
 
 
 /* ---- PRIVATE FUNCTIONS ---- */
 
 
-static inline struct RBT_Node *RBT_new_node(struct RBT_Tree *tree, uintmax_t key, void *data ) {
-    struct RBT_Node *new_node = RBT_MALLOC( sizeof(struct RBT_Node) );
+// sizes the nodes of an empty tree for the options enabled on it, dropping a reserve of another size
+static inline void RBT_update_node_size(struct RBT_Tree *tree) {
+    if ( tree->root != NULL ) {
+        return;
+    }
+    size_t node_size = sizeof(struct RBT_Node) + RBT_AUGMENT_SPACE(tree);
+    if ( RBT_IS_RECENCY_TRACKED(tree) ) {
+        node_size += sizeof(struct RBT_Recency);
+    }
+    if ( RBT_OPTION(tree, reserve) != NULL && node_size != tree->node_size ) {
+        RBT_shrink_to_fit(tree);
+    }
+    tree->node_size = node_size;
+}
+
+static inline struct RBT_Node *RBT_init_node(struct RBT_Node *new_node, uintmax_t key, void *data) {
     if ( !new_node ) {
         return NULL;
     }
@@ -28,11 +76,24 @@ static inline struct RBT_Node *RBT_new_node(struct RBT_Tree *tree, uintmax_t key
     return new_node;
 }
 
+// takes a node from the reserve of the tree, if any is left, before falling back to malloc
+static inline struct RBT_Node *RBT_new_node(struct RBT_Tree *tree, uintmax_t key, void *data ) {
+    struct RBT_Node *new_node = RBT_OPTION(tree, reserve);
+
+    if ( new_node == NULL ) {
+        return RBT_init_node(RBT_MALLOC( tree->node_size ), key, data);
+    }
+    tree->extension->reserve = new_node->right;
+    tree->extension->reserved--;
+    RBT_account_auxiliary(RBT_USABLE_SIZE(new_node, tree->node_size), 0);
+    return RBT_init_node(new_node, key, data);
+}
+
 static inline void RBT_destroy_node(struct RBT_Tree *tree, struct RBT_Node *node, void (*freedata)(void *)) {
     if ( !node || !tree ) {
         return;
     }
-    if (freedata) {
+    if ( freedata && !RBT_IS_DEAD(node) ) {
         freedata(node->data);
     }
     node->left = NULL;
@@ -77,53 +138,128 @@ static inline struct RBT_Node *RBT_maximum(struct RBT_Node *node) {
     return iterator;
 }
 
-static inline void RBT_left_rotate(struct RBT_Tree *tree, struct RBT_Node *node) {
+static inline struct RBT_Node *RBT_successor(struct RBT_Node *node) {
     if ( node->right != NULL ) {
-        struct RBT_Node *right_node = node->right;
-        node->right = right_node->left;
+        return RBT_minimum( node->right );
+    }
+    struct RBT_Node *parent = node->parent;
+    while ( parent != NULL && node == parent->right ) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
 
-        if ( right_node->left != NULL ) {
-            right_node->left->parent = node;
-        }
-        right_node->parent = node->parent;
+static inline struct RBT_Node *RBT_predecessor(struct RBT_Node *node) {
+    if ( node->left != NULL ) {
+        return RBT_maximum( node->left );
+    }
+    struct RBT_Node *parent = node->parent;
+    while ( parent != NULL && node == parent->left ) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
 
-        if ( node->parent == NULL ) {
-            tree->root = right_node;
-        } else if ( node == node->parent->left ) {
-            node->parent->left = right_node;
-        } else {
-            node->parent->right = right_node;
-        }
-        right_node->left = node;
-        node->parent = right_node;
+// dead nodes contribute nothing to the aggregates
+static inline void RBT_lift(struct RBT_Tree *tree, struct RBT_Node *node, void *out) {
+    const struct RBT_Augment *augment = tree->augment;
+    if ( RBT_IS_DEAD(node) ) {
+        memcpy(out, augment->identity, augment->size);
+    } else {
+        augment->lift(out, RBT_KEYVALUE(node->key), node->data, augment->context);
     }
 }
 
-static inline void RBT_right_rotate(struct RBT_Tree *tree, struct RBT_Node *node) {
-    if ( node->left != NULL ) {
-        struct RBT_Node *left_node = node->left;
-        node->left = left_node->right;
+static inline void RBT_pull_aggregate(struct RBT_Tree *tree, struct RBT_Node *node) {
+    const struct RBT_Augment *augment = tree->augment;
+    union RBT_Aggregate_Buffer lifted, partial;
 
-        if ( left_node->right != NULL ) {
-            left_node->right->parent = node;
-        }
-        left_node->parent = node->parent;
+    RBT_lift(tree, node, lifted.bytes);
+    augment->combine(partial.bytes, RBT_AGGREGATE_OF(tree, node->left), lifted.bytes, augment->context);
+    augment->combine(RBT_NODE_AGGREGATE(node), partial.bytes, RBT_AGGREGATE_OF(tree, node->right), augment->context);
+}
 
-        if ( node->parent == NULL ) {
-            tree->root = left_node;
-        } else if ( node == node->parent->left ){
-            node->parent->left = left_node;
-        } else {
-            node->parent->right = left_node;
-        }
-        left_node->right = node;
-        node->parent = left_node;
+static inline void RBT_pull_path(struct RBT_Tree *tree, struct RBT_Node *node) {
+    if ( tree->augment == NULL ) {
+        return;
+    }
+    while ( node != NULL ) {
+        RBT_pull_aggregate(tree, node);
+        node = node->parent;
+    }
+}
+
+static inline void RBT_recency_push(struct RBT_Tree *tree, struct RBT_Node *node) {
+    struct RBT_Capacity *capacity = tree->extension->capacity;
+    struct RBT_Recency *links = RBT_RECENCY_OF(tree, node);
+
+    links->newer = NULL;
+    links->older = capacity->newest;
+    if ( capacity->newest != NULL ) {
+        RBT_RECENCY_OF(tree, capacity->newest)->newer = node;
+    } else {
+        capacity->oldest = node;
+    }
+    capacity->newest = node;
+}
+
+static inline void RBT_recency_unlink(struct RBT_Tree *tree, struct RBT_Node *node) {
+    struct RBT_Capacity *capacity = tree->extension->capacity;
+    struct RBT_Recency *links = RBT_RECENCY_OF(tree, node);
+
+    if ( links->newer != NULL ) {
+        RBT_RECENCY_OF(tree, links->newer)->older = links->older;
+    } else {
+        capacity->newest = links->older;
+    }
+    if ( links->older != NULL ) {
+        RBT_RECENCY_OF(tree, links->older)->newer = links->newer;
+    } else {
+        capacity->oldest = links->newer;
+    }
+}
+
+// moves a live node to the front of the recency list, if the tree keeps one
+static inline void RBT_recency_touch(struct RBT_Tree *tree, struct RBT_Node *node) {
+    if ( RBT_IS_RECENCY_TRACKED(tree) && tree->extension->capacity->newest != node ) {
+        RBT_recency_unlink(tree, node);
+        RBT_recency_push(tree, node);
+    }
+}
+
+// notes a live key leaving the tree, whose bits stay in the lookup filter until it is rebuilt
+static inline void RBT_unfilter(struct RBT_Tree *tree) {
+    struct RBT_Filter *filter = RBT_OPTION(tree, filter);
+
+    if ( filter != NULL ) {
+        filter->stale++;
+    }
+}
+
+// rebuilds the lookup filter from the live keys once it has filled up or gone stale
+static inline void RBT_refresh_filter(struct RBT_Tree *tree) {
+    struct RBT_Filter *filter = RBT_OPTION(tree, filter);
+
+    if ( filter != NULL && RBT_filter_is_due(filter) ) {
+        RBT_set_lookup_filter(tree, 1);
     }
 }
 
-static inline struct RBT_Node *RBT_find_parent(struct RBT_Tree *tree, struct RBT_Node *node) {
+// rotations keep the aggregates of augmented trees up to date, the lowered node first
+static inline void RBT_rotated(struct RBT_Tree *tree, struct RBT_Node *lower, struct RBT_Node *upper) {
+    if ( tree->augment != NULL ) {
+        RBT_pull_aggregate(tree, lower);
+        RBT_pull_aggregate(tree, upper);
+    }
+}
+
+RBT_GENERATE_REBALANCE(RBT, struct RBT_Tree, struct RBT_Node, RBT_rotated)
+
+static inline struct RBT_Node *RBT_find_parent(struct RBT_Node *start, struct RBT_Node *node) {
     struct RBT_Node *parent = NULL;
-    struct RBT_Node *iterator = tree->root;
+    struct RBT_Node *iterator = start;
 
     while ( iterator != NULL ) { // traversal of the tree finding parent of node
         parent = iterator;
@@ -137,108 +273,146 @@ static inline struct RBT_Node *RBT_find_parent(struct RBT_Tree *tree, struct RBT
     return parent;
 }
 
-static inline void RBT_insert_fixup(struct RBT_Tree *tree, struct RBT_Node *node ) {
-    if ( tree == NULL || node == NULL ) {
-        return;
-    }
-    while ( RBT_IS_RED( node->parent ) ) {
-        if ( node->parent == node->parent->parent->left ) {
-            struct RBT_Node *right_node = node->parent->parent->right;
-            if ( RBT_IS_RED( right_node ) ) {
-                // uncle and parent of node is red -> color them black
-                RBT_SET_BLACK( node->parent );
-                RBT_SET_BLACK( right_node );
-                RBT_SET_RED( node->parent->parent );
-                node = node->parent->parent;
+/*
+ * WAVL rebalancing, after Haeupler, Sen and Tarjan. Every node has a rank, exceeding the ranks of
+ * its children by 1 or 2, and the rank of a leaf is 0. Only the rank parities are kept, which is
+ * enough as a rank difference is known to be one of two values at every step.
+ */
+
+// the new leaf is a 0-child, sharing the rank of its parent, while their parities match
+static inline void RBT_wavl_insert_fixup(struct RBT_Tree *tree, struct RBT_Node *node) {
+    struct RBT_Node *parent = node->parent;
+
+    while ( parent != NULL && RBT_SAME_PARITY(node, parent) ) {
+        if ( node == parent->left ) {
+            struct RBT_Node *sibling = parent->right;
+            if ( !RBT_SAME_PARITY(sibling, parent) ) {
+                // sibling is a 1-child -> promote the parent, which may now be a 0-child itself
+                RBT_FLIP_RANK(parent);
+                node = parent;
+                parent = node->parent;
                 continue;
-            } else if ( node == node->parent->right ) {
-                // uncle is black
-                node = node->parent;
+            }
+            struct RBT_Node *inner = node->right;
+            if ( RBT_SAME_PARITY(inner, node) ) {
+                RBT_right_rotate(tree, parent);
+                RBT_FLIP_RANK(parent);
+            } else {
+                // the inner grandchild is a 1-child -> it becomes the root of the subtree
                 RBT_left_rotate(tree, node);
+                RBT_right_rotate(tree, parent);
+                RBT_FLIP_RANK(inner);
+                RBT_FLIP_RANK(node);
+                RBT_FLIP_RANK(parent);
             }
-
-            RBT_SET_BLACK(node->parent);
-            RBT_SET_RED(node->parent->parent);
-            RBT_right_rotate(tree, node->parent->parent);
         } else {
-            struct RBT_Node *left_node = node->parent->parent->left;
-            if ( RBT_IS_RED( left_node ) ) {
-                RBT_SET_BLACK( node->parent );
-                RBT_SET_BLACK( left_node );
-                RBT_SET_RED( node->parent->parent );
-                node = node->parent->parent;
+            struct RBT_Node *sibling = parent->left;
+            if ( !RBT_SAME_PARITY(sibling, parent) ) {
+                RBT_FLIP_RANK(parent);
+                node = parent;
+                parent = node->parent;
                 continue;
-            } else if ( node == node->parent->left ) {
-                node = node->parent;
+            }
+            struct RBT_Node *inner = node->left;
+            if ( RBT_SAME_PARITY(inner, node) ) {
+                RBT_left_rotate(tree, parent);
+                RBT_FLIP_RANK(parent);
+            } else {
                 RBT_right_rotate(tree, node);
+                RBT_left_rotate(tree, parent);
+                RBT_FLIP_RANK(inner);
+                RBT_FLIP_RANK(node);
+                RBT_FLIP_RANK(parent);
             }
-            RBT_SET_BLACK(node->parent);
-            RBT_SET_RED(node->parent->parent);
-            RBT_left_rotate(tree, node->parent->parent);
         }
+        return;
     }
-    RBT_SET_BLACK(tree->root);
 }
 
-static inline void RBT_remove_fixup(struct RBT_Tree *tree, struct RBT_Node *node) {
-    while ( RBT_IS_BLACK( node ) && node != tree->root ) {
-        if ( node == node->parent->left ) {
-            struct RBT_Node *sibling = node->parent->right;
-            if ( RBT_IS_RED( sibling ) ) {
-                RBT_SET_BLACK( sibling );
-                RBT_SET_RED( node->parent );
-                RBT_left_rotate( tree, node->parent );
-                sibling = node->parent->right;
-            }
-            if ( RBT_IS_BLACK( sibling->left ) && RBT_IS_BLACK( sibling->right ) ) {
-                RBT_SET_RED( sibling );
-                node = node->parent;
-            } else if ( RBT_IS_BLACK( sibling->right ) ) {
-                RBT_SET_BLACK(sibling->left);
-                RBT_SET_RED(sibling);
-                RBT_right_rotate( tree, sibling );
-                sibling = node->parent->right;
+// node took the place of an unlinked node, becoming a 2- or 3-child, the latter when its parity differs from its parent
+static inline void RBT_wavl_remove_fixup(struct RBT_Tree *tree, struct RBT_Node *node, struct RBT_Node *parent) {
+    if ( parent == NULL ) {
+        return;
+    }
+    if ( parent->left == NULL && parent->right == NULL ) {
+        // a 2,2-leaf is demoted to rank 0
+        RBT_FLIP_RANK(parent);
+        node = parent;
+        parent = node->parent;
+    }
+    while ( parent != NULL && !RBT_SAME_PARITY(node, parent) ) {
+        if ( node == parent->left ) {
+            struct RBT_Node *sibling = parent->right;
+            if ( RBT_SAME_PARITY(sibling, parent) ) {
+                // sibling is a 2-child -> demote the parent, which may now be a 3-child itself
+                RBT_FLIP_RANK(parent);
+            } else if ( RBT_SAME_PARITY(sibling->left, sibling) && RBT_SAME_PARITY(sibling->right, sibling) ) {
+                // sibling is a 2,2 1-child -> demote both
+                RBT_FLIP_RANK(parent);
+                RBT_FLIP_RANK(sibling);
+            } else if ( !RBT_SAME_PARITY(sibling->right, sibling) ) {
+                RBT_left_rotate(tree, parent);
+                RBT_FLIP_RANK(sibling);
+                RBT_FLIP_RANK(parent);
+                if ( parent->left == NULL && parent->right == NULL ) {
+                    RBT_FLIP_RANK(parent);
+                }
+                return;
+            } else {
+                // only the inner nephew is a 1-child -> it is promoted twice, the parent demoted twice
+                RBT_right_rotate(tree, sibling);
+                RBT_left_rotate(tree, parent);
+                RBT_FLIP_RANK(sibling);
+                return;
             }
-            RBT_COPY_COLOR(sibling, node->parent);
-            RBT_SET_BLACK(node->parent);
-            RBT_SET_BLACK(sibling->right);
-            RBT_left_rotate( tree, node->parent );
-            node = tree->root;
         } else {
-            struct RBT_Node *sibling = node->parent->left;
-            if ( RBT_IS_RED( sibling ) ) {
-                RBT_SET_BLACK( sibling );
-                RBT_SET_RED( node->parent );
-                RBT_right_rotate( tree, node->parent );
-                sibling = node->parent->left;
+            struct RBT_Node *sibling = parent->left;
+            if ( RBT_SAME_PARITY(sibling, parent) ) {
+                RBT_FLIP_RANK(parent);
+            } else if ( RBT_SAME_PARITY(sibling->right, sibling) && RBT_SAME_PARITY(sibling->left, sibling) ) {
+                RBT_FLIP_RANK(parent);
+                RBT_FLIP_RANK(sibling);
+            } else if ( !RBT_SAME_PARITY(sibling->left, sibling) ) {
+                RBT_right_rotate(tree, parent);
+                RBT_FLIP_RANK(sibling);
+                RBT_FLIP_RANK(parent);
+                if ( parent->left == NULL && parent->right == NULL ) {
+                    RBT_FLIP_RANK(parent);
+                }
+                return;
+            } else {
+                RBT_left_rotate(tree, sibling);
+                RBT_right_rotate(tree, parent);
+                RBT_FLIP_RANK(sibling);
+                return;
             }
-            if ( RBT_IS_BLACK( sibling->right ) && RBT_IS_BLACK( sibling->left ) ) {
-                RBT_SET_RED( sibling );
-                node = node->parent;
-            } else if ( RBT_IS_BLACK( sibling->left ) ) {
-                RBT_SET_BLACK(sibling->right);
-                RBT_SET_RED(sibling);
-                RBT_left_rotate( tree, sibling );
-                sibling = node->parent->left;
-            }
-            RBT_COPY_COLOR(sibling, node->parent);
-            RBT_SET_BLACK(node->parent);
-            RBT_SET_BLACK(sibling->left);
-            RBT_right_rotate( tree, node->parent );
-            node = tree->root;
         }
+        node = parent;
+        parent = node->parent;
     }
-    RBT_SET_BLACK(node);
 }
 
-static inline struct RBT_Node *RBT_insert(struct RBT_Tree *tree, struct RBT_Node *node) {
-    struct RBT_Node *parent = RBT_find_parent(tree, node);
+// climbs from the hint to the lowest ancestor whose subtree spans the key, which must not be below the hints' key
+static inline struct RBT_Node *RBT_finger_start(struct RBT_Tree *tree, struct RBT_Node *hint, uintmax_t key) {
+    if ( hint == NULL ) {
+        return tree->root;
+    }
+    while ( hint->parent != NULL ) {
+        if ( hint == hint->parent->left && RBT_KEYVALUE(key) < RBT_KEYVALUE(hint->parent->key) ) {
+            break;
+        }
+        hint = hint->parent;
+    }
+    return hint;
+}
 
+// links a detached node in as a leaf below parent, or as the root if parent is NULL, and rebalances
+static inline void RBT_attach(struct RBT_Tree *tree, struct RBT_Node *parent, int left, struct RBT_Node *node) {
     node->parent = parent; // setting parent node and fixing forward pointers
 
     if ( parent == NULL ) {
         tree->root = node;
-    } else if ( RBT_KEYVALUE(node->key) < RBT_KEYVALUE(parent->key) ) {
+    } else if ( left ) {
         parent->left = node;
     } else {
         parent->right = node;
@@ -246,23 +420,58 @@ static inline struct RBT_Node *RBT_insert(struct RBT_Tree *tree, struct RBT_Node
 
     node->left = NULL;
     node->right = NULL;
-    RBT_SET_RED(node);
-    RBT_insert_fixup( tree, node );
-    return node;
+    RBT_pull_path( tree, node );
+    if ( tree->balance == RBT_BALANCE_WAVL ) {
+        RBT_SET_BLACK(node); // leaves have rank 0
+        RBT_wavl_insert_fixup( tree, node );
+    } else {
+        RBT_SET_RED(node);
+        RBT_insert_fixup( tree, node );
+    }
 }
 
-static inline void RBT_transplant_tree(struct RBT_Tree *tree, struct RBT_Node *old, struct RBT_Node *transplant) {
+static inline struct RBT_Node *RBT_insert_from(struct RBT_Tree *tree, struct RBT_Node *start, struct RBT_Node *node) {
+    if ( node == NULL ) {
+        return NULL;
+    }
+    struct RBT_Node *parent = RBT_find_parent(start, node);
+    struct RBT_Extension *extension = tree->extension;
 
-    if ( old->parent == NULL ) {
-        tree->root = transplant;
-    } else if ( old == old->parent->left ) {
-        old->parent->left = transplant;
-    } else {
-        old->parent->right = transplant;
+    RBT_attach(tree, parent, parent != NULL && RBT_KEYVALUE(node->key) < RBT_KEYVALUE(parent->key), node);
+    if ( extension == NULL ) {
+        return node;
     }
-    if ( transplant != NULL ) {
-        transplant->parent = old->parent;
+    if ( extension->index != NULL ) {
+        RBT_index_insert( tree, node );
     }
+    if ( RBT_IS_RECENCY_TRACKED(tree) ) {
+        RBT_recency_push( tree, node );
+    }
+    if ( extension->filter != NULL ) {
+        RBT_filter_insert( extension->filter, node->key );
+        RBT_refresh_filter( tree );
+    }
+    return node;
+}
+
+static inline struct RBT_Node *RBT_insert(struct RBT_Tree *tree, struct RBT_Node *node) {
+    return RBT_insert_from(tree, tree->root, node);
+}
+
+// finds the node at a position of a sequence, counting the nodes to the left of it from the subtree sizes
+static inline struct RBT_Node *RBT_sequence_node(struct RBT_Node *node, uintmax_t position) {
+    while ( node != NULL ) {
+        uintmax_t left_size = RBT_SUBTREE_SIZE(node->left);
+        if ( position < left_size ) {
+            node = node->left;
+        } else if ( position == left_size ) {
+            return node;
+        } else {
+            position -= left_size + 1;
+            node = node->right;
+        }
+    }
+    return NULL;
 }
 
 static inline struct RBT_Node *RBT_iterative_find(struct RBT_Node *node, uintmax_t key) {
@@ -278,119 +487,1574 @@ static inline struct RBT_Node *RBT_iterative_find(struct RBT_Node *node, uintmax
     return iterator;
 }
 
-static inline int RBT_remove(struct RBT_Tree *tree, struct RBT_Node *node ) {
-    if ( tree == NULL || node == NULL ) {
-        return 0;
+/*
+ * finds the leftmost node with the given key which is dead or alive as requested.
+ * Equal keys are adjacent in key order, but may be spread over both sides of the first match.
+ */
+static inline struct RBT_Node *RBT_find_state(struct RBT_Node *node, uintmax_t key, int dead) {
+    struct RBT_Node *first = NULL;
+
+    key = RBT_KEYVALUE(key);
+    while ( node != NULL ) {
+        if ( RBT_KEYVALUE(node->key) < key ) {
+            node = node->right;
+        } else {
+            if ( RBT_KEYVALUE(node->key) == key ) {
+                first = node;
+            }
+            node = node->left;
+        }
+    }
+    for ( ; first != NULL && RBT_KEYVALUE(first->key) == key; first = RBT_successor(first) ) {
+        if ( RBT_IS_DEAD(first) == dead ) {
+            return first;
+        }
     }
+    return NULL;
+}
 
-    struct RBT_Node *point;
-    struct RBT_Node *old = node;
-    uintmax_t old_color = node->key;
+static inline struct RBT_Node *RBT_find_live(struct RBT_Tree *tree, uintmax_t key) {
+    struct RBT_Extension *extension = tree->extension;
 
-    if ( node->left == NULL ) {
-        point = node->right;
-        RBT_transplant_tree(tree, node, node->right);
-    } else if ( node->right == NULL ) {
-        point = node->left;
-        RBT_transplant_tree(tree, node, node->left);
-    } else if ( node->right == NULL && node->left == NULL ) {
-        // this step is needed since the book uses the T.nill definition
-        // which is always black and is a allocated object (in contrast to our NULL)
-        RBT_transplant_tree(tree, node, NULL);
-    } else {
-        old = RBT_minimum( node->right );
-        old_color = old->key;
-        point = old->right;
+    if ( extension != NULL && extension->filter != NULL && !RBT_filter_may_contain(extension->filter, key) ) {
+        return NULL;
+    }
+    if ( extension != NULL && extension->index != NULL ) {
+        return RBT_index_find(tree, key);
+    }
+    if ( tree->dead_count == 0 ) {
+        return RBT_iterative_find(tree->root, key);
+    }
+    return RBT_find_state(tree->root, key, 0);
+}
+
+// hands the index entry of a node about to be removed or killed to another live node with its key
+static inline void RBT_unindex(struct RBT_Tree *tree, struct RBT_Node *node) {
+    uintmax_t key = RBT_KEYVALUE(node->key);
+    struct RBT_Node *other;
+
+    if ( RBT_OPTION(tree, index) == NULL || RBT_index_find(tree, key) != node ) {
+        return;
+    }
+    other = RBT_successor(node);
+    while ( other != NULL && RBT_KEYVALUE(other->key) == key && RBT_IS_DEAD(other) ) {
+        other = RBT_successor(other);
+    }
+    if ( other == NULL || RBT_KEYVALUE(other->key) != key ) {
+        other = RBT_predecessor(node);
+        while ( other != NULL && RBT_KEYVALUE(other->key) == key && RBT_IS_DEAD(other) ) {
+            other = RBT_predecessor(other);
+        }
+    }
+    RBT_index_replace(tree, key, (other != NULL && RBT_KEYVALUE(other->key) == key) ? other : NULL);
+}
+
+/*
+ * climbs from node to the lowest ancestor whose subtree holds every node with the key. Moving up
+ * from a left child passes an upper bound of the subtree, and from a right child a lower bound.
+ * Both bounds must be strict, as equal keys may sit on either side, so a key equal to the one of
+ * node climbs all the way to the root.
+ */
+static inline struct RBT_Node *RBT_finger_climb(struct RBT_Node *node, uintmax_t key) {
+    int below = key < RBT_KEYVALUE(node->key);
+    int above = key > RBT_KEYVALUE(node->key);
 
-        if ( old->parent == node ) {
-            if ( point != NULL ) {
-                point->parent = old;
+    while ( node->parent != NULL ) {
+        struct RBT_Node *parent = node->parent;
+        if ( node == parent->left ) {
+            if ( above && key < RBT_KEYVALUE(parent->key) ) {
+                break;
             }
-        } else {
-            RBT_transplant_tree(tree, old, old->right);
-            old->right = node->right;
-            old->right->parent = old;
+        } else if ( below && key > RBT_KEYVALUE(parent->key) ) {
+            break;
         }
-        RBT_transplant_tree(tree, node, old);
-        old->left = node->left;
-        old->left->parent = old;
-        RBT_COPY_COLOR(old, node);
+        node = parent;
+    }
+    return node;
+}
+
+// unlinks the node from the tree and rebalances, leaving the node itself alone
+static inline void RBT_unlink(struct RBT_Tree *tree, struct RBT_Node *node) {
+    struct RBT_Node *point;
+    struct RBT_Node *point_parent;
+    uintmax_t old_color = RBT_detach(tree, node, &point, &point_parent);
+
+    RBT_pull_path(tree, point_parent);
+    if ( tree->balance == RBT_BALANCE_WAVL ) {
+        RBT_wavl_remove_fixup(tree, point, point_parent);
+    } else if ( RBT_IS_KEY_BLACK(old_color) ) {
+        RBT_remove_fixup(tree, point, point_parent);
+    }
+}
+
+static inline int RBT_remove(struct RBT_Tree *tree, struct RBT_Node *node ) {
+    if ( tree == NULL || node == NULL ) {
+        return 0;
     }
-    if ( RBT_IS_KEY_BLACK(old_color) ) {
-        RBT_remove_fixup(tree, point);
+    RBT_unindex(tree, node);
+    if ( RBT_IS_RECENCY_TRACKED(tree) ) {
+        RBT_recency_unlink(tree, node);
     }
+    RBT_unlink(tree, node);
+    RBT_account_nodes(tree, node, 1, 0);
     RBT_FREE(node);
     tree->node_count--;
+    tree->generation++;
+    RBT_unfilter(tree);
+    RBT_refresh_filter(tree);
 
     return 1;
 }
 
+// picks the live element to evict under the policy of a tree at its capacity
+static inline struct RBT_Node *RBT_eviction_victim(struct RBT_Tree *tree) {
+    struct RBT_Node *node;
 
-/* --- PUBLIC FUNCTIONS --- */
+    switch ( tree->extension->capacity->policy ) {
+    case RBT_EVICT_MINIMUM:
+        for ( node = RBT_minimum(tree->root); node != NULL && RBT_IS_DEAD(node); node = RBT_successor(node) );
+        return node;
+    case RBT_EVICT_MAXIMUM:
+        for ( node = RBT_maximum(tree->root); node != NULL && RBT_IS_DEAD(node); node = RBT_predecessor(node) );
+        return node;
+    default:
+        return tree->extension->capacity->oldest;
+    }
+}
 
+// removes the victim, handing its key and value to the eviction callback once it has left the tree
+static inline void RBT_evict(struct RBT_Tree *tree, struct RBT_Node *victim) {
+    struct RBT_Capacity *capacity = tree->extension->capacity;
+    uintmax_t key = RBT_KEYVALUE(victim->key);
+    void *data = victim->data;
 
-int RBT_init_tree(struct RBT_Tree *tree) {
-    if ( !tree ) {
-        return 0;
+    RBT_remove(tree, victim);
+    if ( capacity->evicted != NULL ) {
+        capacity->evicted(key, data, capacity->context);
     }
-    tree->root = NULL;
-    tree->node_count = 0;
-    return 1;
 }
 
-void RBT_deinit_tree(struct RBT_Tree *tree, void (*freedata)(void *)) {
-    RBT_recursive_destroy(tree, tree->root, freedata);
+static inline void RBT_evict_to_capacity(struct RBT_Tree *tree) {
+    while ( tree->node_count > tree->extension->capacity->limit ) {
+        RBT_evict(tree, RBT_eviction_victim(tree));
+    }
 }
 
-void *RBT_add( struct RBT_Tree *tree, uintmax_t key, void *data ) {
-    tree->node_count++;
-    struct RBT_Node *inserted = RBT_insert(tree, RBT_new_node(tree, key, data));
-    return (inserted == NULL) ? inserted : inserted->data;
+static void RBT_suffix_aggregate(struct RBT_Tree *tree, struct RBT_Node *node, uintmax_t lo, void *out) {
+    const struct RBT_Augment *augment = tree->augment;
+    union RBT_Aggregate_Buffer lifted, partial, accumulated;
+
+    // the matching nodes are visited in descending order, each preceding the accumulated range
+    memcpy(out, augment->identity, augment->size);
+    while ( node != NULL ) {
+        if ( RBT_KEYVALUE(node->key) >= lo ) {
+            RBT_lift(tree, node, lifted.bytes);
+            augment->combine(partial.bytes, lifted.bytes, RBT_AGGREGATE_OF(tree, node->right), augment->context);
+            augment->combine(accumulated.bytes, partial.bytes, out, augment->context);
+            memcpy(out, accumulated.bytes, augment->size);
+            node = node->left;
+        } else {
+            node = node->right;
+        }
+    }
 }
 
-void *RBT_find(struct RBT_Tree *tree, uintmax_t key) {
-    if ( tree == NULL ) {
+static void RBT_prefix_aggregate(struct RBT_Tree *tree, struct RBT_Node *node, uintmax_t hi, void *out) {
+    const struct RBT_Augment *augment = tree->augment;
+    union RBT_Aggregate_Buffer lifted, partial, accumulated;
+
+    // the matching nodes are visited in ascending order, each following the accumulated range
+    memcpy(out, augment->identity, augment->size);
+    while ( node != NULL ) {
+        if ( RBT_KEYVALUE(node->key) <= hi ) {
+            RBT_lift(tree, node, lifted.bytes);
+            augment->combine(partial.bytes, RBT_AGGREGATE_OF(tree, node->left), lifted.bytes, augment->context);
+            augment->combine(accumulated.bytes, out, partial.bytes, augment->context);
+            memcpy(out, accumulated.bytes, augment->size);
+            node = node->right;
+        } else {
+            node = node->left;
+        }
+    }
+}
+
+// unlinks the live nodes below node into an ascending list through their right pointers, freeing the dead ones
+static void RBT_flatten_live(struct RBT_Node *node, struct RBT_Node **list) {
+    while ( node != NULL ) {
+        struct RBT_Node *left = node->left;
+        RBT_flatten_live(node->right, list);
+        if ( RBT_IS_DEAD(node) ) {
+            RBT_FREE(node);
+        } else {
+            node->right = *list;
+            *list = node;
+        }
+        node = left;
+    }
+}
+
+// links the first count nodes of the list into a balanced subtree
+static struct RBT_Node *RBT_build_from_list(struct RBT_Tree *tree, struct RBT_Node **list, uintmax_t count, unsigned depth, unsigned full_levels) {
+    if ( count == 0 ) {
         return NULL;
     }
-    struct RBT_Node *node = RBT_iterative_find(tree->root, key);
-    return node == NULL ? node : node->data;
+    struct RBT_Node *left = RBT_build_from_list(tree, list, count / 2, depth + 1, full_levels);
+    struct RBT_Node *node = *list;
+    *list = node->right;
+
+    node->parent = NULL;
+    node->left = left;
+    node->right = RBT_build_from_list(tree, list, count - count / 2 - 1, depth + 1, full_levels);
+    if ( node->left != NULL ) {
+        node->left->parent = node;
+    }
+    if ( node->right != NULL ) {
+        node->right->parent = node;
+    }
+    RBT_set_built_color(tree, node, count, depth, full_levels);
+    if ( tree->augment != NULL ) {
+        RBT_pull_aggregate(tree, node);
+    }
+    return node;
 }
 
-int RBT_delete(struct RBT_Tree *tree, uintmax_t key) {
-    struct RBT_Node *find_node = RBT_iterative_find( tree->root, key );
+static inline void RBT_purge_if_due(struct RBT_Tree *tree) {
+    uintmax_t total = tree->node_count + tree->dead_count;
+    if ( tree->purge_percent <= 100 && tree->dead_count * 100 >= total * tree->purge_percent ) {
+        RBT_purge(tree);
+    }
+}
 
-    if ( find_node != NULL ) {
-        return RBT_remove( tree, find_node );
+// number of complete levels in a tree of count nodes
+static inline unsigned RBT_full_levels(uintmax_t count) {
+    unsigned full_levels = 0;
+    while ( full_levels < 8 * sizeof(uintmax_t) - 1 && ((UINTMAX_C(2) << full_levels) - 1) <= count ) {
+        full_levels++;
     }
-    return 0;
+    return full_levels;
 }
 
-int RBT_get_maximum(struct RBT_Tree *tree, uintmax_t *key, void **value) {
-    struct RBT_Node *node = RBT_maximum(tree->root);
-    if (!node) {
-        return 0;
+// bytes taken by a node of the tree, slack included, going by "sample" or else any node the tree holds
+static inline uintmax_t RBT_node_cost(struct RBT_Tree *tree, struct RBT_Node *sample) {
+    if ( sample == NULL ) {
+        sample = tree->root != NULL ? tree->root : RBT_OPTION(tree, reserve);
     }
-    if (key) {
-        *key = RBT_KEYVALUE(node->key);
+    return sample != NULL ? RBT_USABLE_SIZE(sample, tree->node_size) : tree->node_size;
+}
+
+// whether the budget of a tree leaves room for "count" more nodes costing as much as "sample"
+static inline int RBT_fits_budget(struct RBT_Tree *tree, uintmax_t count, struct RBT_Node *sample) {
+    struct RBT_Memory_Usage usage;
+    uintmax_t budget = RBT_OPTION(tree, memory_budget);
+
+    if ( budget == 0 ) {
+        return 1;
     }
-    if (value) {
-        *value = node->data;
+    RBT_get_memory_usage(tree, &usage);
+    return usage.nodes + usage.slack + usage.auxiliary + count * RBT_node_cost(tree, sample) <= budget;
+}
+
+// whether the budget of a tree leaves room for "count" more nodes, slack included
+static inline int RBT_within_budget(struct RBT_Tree *tree, uintmax_t count) {
+    uintmax_t reserved = RBT_OPTION(tree, reserved);
+
+    // reserved nodes already count as auxiliary memory
+    count = count > reserved ? count - reserved : 0;
+    return RBT_fits_budget(tree, count, NULL);
+}
+
+// index of the first inline entry with a key above the given one
+static inline size_t RBT_inline_upper(struct RBT_Tree *tree, uintmax_t key) {
+    size_t i = 0;
+    while ( i < tree->node_count && tree->extension->inline_keys[i] <= key ) {
+        i++;
     }
+    return i;
+}
 
-    return 1;
+// index of an inline entry with the given key, or the entry count if there is none
+static inline size_t RBT_inline_find(struct RBT_Tree *tree, uintmax_t key) {
+    size_t i = 0;
+    while ( i < tree->node_count && tree->extension->inline_keys[i] != key ) {
+        i++;
+    }
+    return i;
 }
 
-int RBT_get_minimum(struct RBT_Tree *tree, uintmax_t *key, void **value) {
-    struct RBT_Node *node = RBT_minimum(tree->root);
-    if (!node) {
+static inline void RBT_inline_insert(struct RBT_Tree *tree, uintmax_t key, void *data) {
+    size_t at = RBT_inline_upper(tree, key);
+    for ( size_t i = tree->node_count; i > at; --i ) {
+        tree->extension->inline_keys[i] = tree->extension->inline_keys[i - 1];
+        tree->extension->inline_data[i] = tree->extension->inline_data[i - 1];
+    }
+    tree->extension->inline_keys[at] = key;
+    tree->extension->inline_data[at] = data;
+    tree->node_count++;
+}
+
+static inline void RBT_inline_erase(struct RBT_Tree *tree, size_t at) {
+    tree->node_count--;
+    for ( size_t i = at; i < tree->node_count; ++i ) {
+        tree->extension->inline_keys[i] = tree->extension->inline_keys[i + 1];
+        tree->extension->inline_data[i] = tree->extension->inline_data[i + 1];
+    }
+}
+
+// moves the elements of a tree with inline entries back into the array once at most "limit" are left
+static inline void RBT_demote_inline(struct RBT_Tree *tree, uintmax_t limit) {
+    size_t i = 0;
+
+    if ( !RBT_OPTION(tree, inline_entries) || tree->root == NULL || tree->node_count > limit ) {
+        return;
+    }
+    for ( struct RBT_Node *node = RBT_minimum(tree->root); node != NULL; node = RBT_successor(node) ) {
+        tree->extension->inline_keys[i] = RBT_KEYVALUE(node->key);
+        tree->extension->inline_data[i] = node->data;
+        i++;
+    }
+    RBT_account_nodes(tree, tree->root, tree->node_count, 0);
+    RBT_recursive_destroy(tree, tree->root, NULL);
+    tree->root = NULL;
+    tree->generation++;
+}
+
+static inline int RBT_leave_inline(struct RBT_Tree *tree) {
+    if ( !RBT_promote_inline(tree) ) {
         return 0;
     }
-    if (key) {
-        *key = RBT_KEYVALUE(node->key);
+    if ( tree->extension != NULL ) {
+        tree->extension->inline_entries = 0;
     }
-    if (value) {
-        *value = node->data;
+    return 1;
+}
+
+// frees the B+-tree of a tree using the RBT_ENGINE_BPLUS engine, calling freedata on every value if provided
+static inline void RBT_drop_engine(struct RBT_Tree *tree, void (*freedata)(void *)) {
+    if ( RBT_IS_BPLUS(tree) ) {
+        RBT_BP_deinit_tree(tree->extension->bplus, freedata);
+        free(tree->extension->bplus);
+        tree->extension->bplus = NULL;
+    }
+}
+
+
+// black height of a subtree, counting the NULL leaves
+static inline unsigned RBT_black_height(struct RBT_Node *node) {
+    unsigned height = 1;
+    for ( ; node != NULL; node = node->left ) {
+        if ( RBT_IS_BLACK(node) ) {
+            height++;
+        }
+    }
+    return height;
+}
+
+/*
+ * joins two detached subtrees, with no key of "left" above the key of pivot and no key of "right"
+ * below it, into a single subtree. The pivot is linked in where the spine of the higher subtree
+ * comes down to the black height of the lower one, so a join only costs the difference of the
+ * black heights, which are passed in and handed back along with the subtrees.
+ */
+static struct RBT_Node *RBT_join(const struct RBT_Augment *augment, struct RBT_Node *left, unsigned left_height,
+        struct RBT_Node *pivot, struct RBT_Node *right, unsigned right_height, unsigned *height) {
+    struct RBT_Tree scratch;
+    struct RBT_Node *node;
+    struct RBT_Node *parent = NULL;
+    unsigned node_height;
+
+    RBT_init_tree(&scratch);
+    scratch.augment = augment;
+    if ( RBT_IS_RED(left) ) {
+        RBT_SET_BLACK(left);
+        left_height++;
+    }
+    if ( RBT_IS_RED(right) ) {
+        RBT_SET_BLACK(right);
+        right_height++;
+    }
+    pivot->parent = NULL;
+    pivot->left = left;
+    pivot->right = right;
+
+    if ( left_height == right_height ) {
+        if ( left != NULL ) {
+            left->parent = pivot;
+        }
+        if ( right != NULL ) {
+            right->parent = pivot;
+        }
+        RBT_SET_BLACK(pivot);
+        RBT_pull_path(&scratch, pivot);
+        *height = left_height + 1;
+        return pivot;
     }
 
+    if ( left_height > right_height ) {
+        node_height = left_height;
+        for ( node = left; node != NULL && (RBT_IS_RED(node) || node_height > right_height); node = node->right ) {
+            node_height -= RBT_IS_BLACK(node);
+            parent = node;
+        }
+        parent->right = pivot;
+        pivot->left = node;
+        if ( right != NULL ) {
+            right->parent = pivot;
+        }
+        scratch.root = left;
+        *height = left_height;
+    } else {
+        node_height = right_height;
+        for ( node = right; node != NULL && (RBT_IS_RED(node) || node_height > left_height); node = node->left ) {
+            node_height -= RBT_IS_BLACK(node);
+            parent = node;
+        }
+        parent->left = pivot;
+        pivot->right = node;
+        if ( left != NULL ) {
+            left->parent = pivot;
+        }
+        scratch.root = right;
+        *height = right_height;
+    }
+    if ( node != NULL ) {
+        node->parent = pivot;
+    }
+    pivot->parent = parent;
+    RBT_SET_RED(pivot);
+    RBT_pull_path(&scratch, pivot);
+    *height += RBT_insert_fixup(&scratch, pivot);
+    return scratch.root;
+}
+
+/*
+ * splits a detached subtree of the given black height into the nodes with keys below "bound" and
+ * the rest, or with "by_position" set, into the first "bound" nodes of a sequence and the rest.
+ * The pieces hanging off the search path are joined on the way back up, and as their black heights
+ * grow along the path the joins add up to O(log n).
+ */
+static void RBT_split(const struct RBT_Augment *augment, struct RBT_Node *node, unsigned height, uintmax_t bound,
+        int by_position, struct RBT_Node **less, unsigned *less_height, struct RBT_Node **rest, unsigned *rest_height) {
+    struct RBT_Node *piece;
+    unsigned piece_height;
+
+    if ( node == NULL ) {
+        *less = NULL;
+        *rest = NULL;
+        *less_height = 1;
+        *rest_height = 1;
+        return;
+    }
+    struct RBT_Node *left = node->left;
+    struct RBT_Node *right = node->right;
+    unsigned child_height = height - RBT_IS_BLACK(node);
+    uintmax_t left_size = by_position ? RBT_SUBTREE_SIZE(left) : 0;
+    int below = by_position ? left_size < bound : RBT_KEYVALUE(node->key) < bound;
+
+    if ( left != NULL ) {
+        left->parent = NULL;
+    }
+    if ( right != NULL ) {
+        right->parent = NULL;
+    }
+    if ( below ) {
+        uintmax_t right_bound = by_position ? bound - left_size - 1 : bound;
+        RBT_split(augment, right, child_height, right_bound, by_position, &piece, &piece_height, rest, rest_height);
+        *less = RBT_join(augment, left, child_height, node, piece, piece_height, less_height);
+    } else {
+        RBT_split(augment, left, child_height, bound, by_position, less, less_height, &piece, &piece_height);
+        *rest = RBT_join(augment, piece, piece_height, node, right, child_height, rest_height);
+    }
+}
+
+// joins two detached subtrees without a pivot, by taking the minimum of "right" out as the pivot
+static struct RBT_Node *RBT_join_pieces(const struct RBT_Augment *augment, struct RBT_Node *left, unsigned left_height,
+        struct RBT_Node *right) {
+    struct RBT_Tree scratch;
+    struct RBT_Node *pivot;
+    unsigned height;
+
+    if ( left == NULL || right == NULL ) {
+        return left != NULL ? left : right;
+    }
+    RBT_init_tree(&scratch);
+    scratch.augment = augment;
+    scratch.root = right;
+    pivot = RBT_minimum(right);
+    RBT_unlink(&scratch, pivot);
+    return RBT_join(augment, left, left_height, pivot, scratch.root, RBT_black_height(scratch.root), &height);
+}
+
+// unlinks the nodes in the closed range one by one into an ascending list through their right pointers
+static struct RBT_Node *RBT_unlink_range(struct RBT_Tree *tree, uintmax_t lo, uintmax_t hi) {
+    struct RBT_Node *detached = NULL;
+    struct RBT_Node **tail = &detached;
+    struct RBT_Node *node = NULL;
+
+    for ( struct RBT_Node *iterator = tree->root; iterator != NULL; ) {
+        if ( RBT_KEYVALUE(iterator->key) >= lo ) {
+            node = iterator;
+            iterator = iterator->left;
+        } else {
+            iterator = iterator->right;
+        }
+    }
+    while ( node != NULL && RBT_KEYVALUE(node->key) <= hi ) {
+        struct RBT_Node *next = RBT_successor(node);
+        RBT_unlink(tree, node);
+        node->parent = NULL;
+        node->left = NULL;
+        node->right = NULL;
+        *tail = node;
+        tail = &node->right;
+        node = next;
+    }
+    return detached;
+}
+
+// counts the live and dead nodes of a detached subtree, dropping the live keys from the hash index and recency list
+static void RBT_count_detached(struct RBT_Tree *tree, struct RBT_Node *node, uintmax_t *live, uintmax_t *dead) {
+    while ( node != NULL ) {
+        RBT_count_detached(tree, node->left, live, dead);
+        if ( RBT_IS_DEAD(node) ) {
+            (*dead)++;
+        } else {
+            (*live)++;
+            if ( RBT_OPTION(tree, index) != NULL ) {
+                RBT_index_replace(tree, node->key, NULL);
+            }
+            if ( RBT_IS_RECENCY_TRACKED(tree) ) {
+                RBT_recency_unlink(tree, node);
+            }
+            RBT_unfilter(tree);
+        }
+        node = node->right;
+    }
+}
+
+
+/* --- INTERNAL FUNCTIONS --- */
+
+
+void RBT_set_built_color(struct RBT_Tree *tree, struct RBT_Node *node, uintmax_t count, unsigned depth, unsigned full_levels) {
+    if ( tree->balance == RBT_BALANCE_WAVL ) {
+        // halving the count gives subtrees of height floor(log2(count))
+        unsigned rank = 0;
+        while ( count > 1 ) {
+            count >>= 1;
+            rank++;
+        }
+        if ( rank & 1 ) {
+            RBT_SET_RED(node);
+        } else {
+            RBT_SET_BLACK(node);
+        }
+    } else if ( depth >= full_levels ) {
+        RBT_SET_RED(node);
+    } else {
+        RBT_SET_BLACK(node);
+    }
+}
+
+void RBT_restore_capacity(struct RBT_Tree *tree) {
+    struct RBT_Capacity *capacity = RBT_OPTION(tree, capacity);
+
+    if ( capacity == NULL ) {
+        return;
+    }
+    capacity->newest = NULL;
+    capacity->oldest = NULL;
+    if ( RBT_IS_RECENCY_TRACKED(tree) ) {
+        for ( struct RBT_Node *node = RBT_minimum(tree->root); node != NULL; node = RBT_successor(node) ) {
+            if ( !RBT_IS_DEAD(node) ) {
+                RBT_recency_push(tree, node);
+            }
+        }
+    }
+    RBT_evict_to_capacity(tree);
+}
+
+void RBT_account_nodes(struct RBT_Tree *tree, struct RBT_Node *sample, uintmax_t count, int allocated) {
+    if ( sample == NULL || count == 0 ) {
+        return;
+    }
+    uintmax_t bytes = count * tree->node_size;
+    RBT_account_memory(bytes, count * (RBT_USABLE_SIZE(sample, tree->node_size) - tree->node_size), allocated);
+}
+
+void RBT_account_memory(uintmax_t bytes, uintmax_t slack, int allocated) {
+    if ( allocated ) {
+        RBT_COUNTER_ADD(RBT_global_nodes, bytes);
+        RBT_COUNTER_ADD(RBT_global_slack, slack);
+    } else {
+        RBT_COUNTER_SUB(RBT_global_nodes, bytes);
+        RBT_COUNTER_SUB(RBT_global_slack, slack);
+    }
+}
+
+void RBT_account_auxiliary(size_t bytes, int allocated) {
+    if ( allocated ) {
+        RBT_COUNTER_ADD(RBT_global_auxiliary, (uintmax_t) bytes);
+    } else {
+        RBT_COUNTER_SUB(RBT_global_auxiliary, (uintmax_t) bytes);
+    }
+}
+
+struct RBT_Extension *RBT_extend(struct RBT_Tree *tree) {
+    if ( tree->extension == NULL ) {
+        tree->extension = calloc( 1, sizeof(struct RBT_Extension) );
+    }
+    return tree->extension;
+}
+
+int RBT_promote_inline(struct RBT_Tree *tree) {
+    struct RBT_Node *list = NULL;
+
+    if ( !RBT_IS_INLINE(tree) || tree->node_count == 0 ) {
+        return 1;
+    }
+    struct RBT_Extension *extension = tree->extension;
+    // chained through the right pointers from the last entry down, as RBT_build_from_list takes them
+    for ( uintmax_t i = tree->node_count; i > 0; --i ) {
+        struct RBT_Node *node = RBT_new_node(tree, extension->inline_keys[i - 1], extension->inline_data[i - 1]);
+        if ( node == NULL ) {
+            while ( list != NULL ) {
+                struct RBT_Node *right = list->right;
+                RBT_destroy_node(tree, list, NULL);
+                list = right;
+            }
+            return 0;
+        }
+        node->right = list;
+        list = node;
+    }
+    RBT_account_nodes(tree, list, tree->node_count, 1);
+    tree->root = RBT_build_from_list(tree, &list, tree->node_count, 0, RBT_full_levels(tree->node_count));
+    tree->generation++;
+    return 1;
+}
+
+struct RBT_Node *RBT_allocate_node(struct RBT_Tree *tree, uintmax_t key, void *data) {
+    return RBT_init_node(RBT_MALLOC( tree->node_size ), key, data);
+}
+
+void RBT_release_node(struct RBT_Tree *tree, struct RBT_Node *node, void (*freedata)(void *)) {
+    RBT_destroy_node(tree, node, freedata);
+}
+
+int RBT_budget_allows(struct RBT_Tree *tree, uintmax_t count) {
+    return RBT_fits_budget(tree, count, NULL);
+}
+
+void RBT_update_aggregate(struct RBT_Tree *tree, struct RBT_Node *node) {
+    RBT_pull_aggregate(tree, node);
+}
+
+// whether a tree can be split and joined by key, holding nothing that points at its nodes
+static inline int RBT_is_splittable(struct RBT_Tree *tree) {
+    return tree->balance == RBT_BALANCE_RED_BLACK && tree->dead_count == 0 && RBT_OPTION(tree, index) == NULL &&
+        RBT_OPTION(tree, filter) == NULL && RBT_OPTION(tree, capacity) == NULL && !RBT_OPTION(tree, inline_entries) &&
+        !RBT_IS_BPLUS(tree) && !RBT_IS_SEQUENCE(tree);
+}
+
+int RBT_split_tree(struct RBT_Tree *tree, uintmax_t key, uintmax_t moved, struct RBT_Tree *upper) {
+    struct RBT_Node *less, *greater;
+    unsigned less_height, greater_height;
+
+    if ( tree == upper || !RBT_is_splittable(tree) || !RBT_is_splittable(upper) ||
+         !RBT_IS_EMPTY(upper) || tree->augment != upper->augment || moved > tree->node_count ) {
+        return 0;
+    }
+    RBT_split(tree->augment, tree->root, RBT_black_height(tree->root), RBT_KEYVALUE(key), 0,
+        &less, &less_height, &greater, &greater_height);
+    tree->root = less;
+    upper->root = greater;
+    if ( less != NULL ) {
+        RBT_SET_BLACK(less);
+    }
+    if ( greater != NULL ) {
+        RBT_SET_BLACK(greater);
+    }
+    tree->node_count -= moved;
+    upper->node_count = moved;
+    tree->generation++;
+    upper->generation++;
+    return 1;
+}
+
+int RBT_join_tree(struct RBT_Tree *tree, struct RBT_Tree *upper) {
+    if ( tree == upper || !RBT_is_splittable(tree) || !RBT_is_splittable(upper) || tree->augment != upper->augment ) {
+        return 0;
+    }
+    tree->root = RBT_join_pieces(tree->augment, tree->root, RBT_black_height(tree->root), upper->root);
+    if ( tree->root != NULL ) {
+        tree->root->parent = NULL;
+        RBT_SET_BLACK(tree->root);
+    }
+    tree->node_count += upper->node_count;
+    tree->generation++;
+    upper->root = NULL;
+    upper->node_count = 0;
+    upper->generation++;
+    return 1;
+}
+
+struct RBT_Node *RBT_insert_after(struct RBT_Tree *tree, struct RBT_Node *hint, struct RBT_Node *node) {
+    if ( node == NULL ) {
+        return NULL;
+    }
+    RBT_insert_from(tree, RBT_finger_start(tree, hint, node->key), node);
+    RBT_account_nodes(tree, node, 1, 1);
+    tree->node_count++;
+    return node;
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_init_tree(struct RBT_Tree *tree) {
+    if ( !tree ) {
+        return 0;
+    }
+    tree->root = NULL;
+    tree->node_count = 0;
+    tree->augment = NULL;
+    tree->dead_count = 0;
+    tree->purge_percent = 0;
+    tree->generation = 0;
+    tree->balance = RBT_BALANCE_RED_BLACK;
+    tree->extension = NULL;
+    RBT_update_node_size(tree);
+    return 1;
+}
+
+void RBT_deinit_tree(struct RBT_Tree *tree, void (*freedata)(void *)) {
+    RBT_index_destroy(tree);
+    RBT_filter_destroy(tree);
+    tree->generation++;
+    if ( RBT_IS_INLINE(tree) && freedata ) {
+        for ( uintmax_t i = 0; i < tree->node_count; ++i ) {
+            freedata(tree->extension->inline_data[i]);
+        }
+    }
+    RBT_drop_engine(tree, freedata);
+    RBT_account_nodes(tree, tree->root, tree->node_count + tree->dead_count, 0);
+    RBT_recursive_destroy(tree, tree->root, freedata);
+    // the inline entries go with the extension, so the counts must not outlive it
+    tree->root = NULL;
+    tree->node_count = 0;
+    tree->dead_count = 0;
+    if ( RBT_OPTION(tree, capacity) != NULL ) {
+        RBT_account_auxiliary(sizeof(struct RBT_Capacity), 0);
+        free(tree->extension->capacity);
+    }
+    RBT_shrink_to_fit(tree);
+    free(tree->extension);
+    tree->extension = NULL;
+}
+
+void *RBT_add( struct RBT_Tree *tree, uintmax_t key, void *data ) {
+    if ( RBT_IS_SEQUENCE(tree) ) {
+        return NULL;
+    }
+    if ( RBT_OPTION(tree, trace) != NULL ) {
+        RBT_trace_record(tree->extension->trace, RBT_TRACE_ADD, RBT_KEYVALUE(key));
+    }
+    if ( RBT_IS_BPLUS(tree) ) {
+        data = RBT_BP_add(tree->extension->bplus, key, data);
+        tree->node_count = tree->extension->bplus->node_count;
+        return data;
+    }
+    if ( RBT_IS_INLINE(tree) ) {
+        if ( tree->node_count < RBT_INLINE_CAPACITY ) {
+            RBT_inline_insert(tree, RBT_KEYVALUE(key), data);
+            return data;
+        }
+        // the entries move into nodes along with the new element, so all of them count towards the budget
+        if ( !RBT_within_budget(tree, tree->node_count + 1) || !RBT_promote_inline(tree) ) {
+            return NULL;
+        }
+    }
+    struct RBT_Node *dead = tree->dead_count > 0 ? RBT_find_state(tree->root, key, 1) : NULL;
+    struct RBT_Capacity *capacity = RBT_OPTION(tree, capacity);
+    int evicting = capacity != NULL && tree->node_count >= capacity->limit;
+
+    // reviving a dead node or replacing an evicted one takes no more memory
+    if ( dead == NULL && !evicting && !RBT_within_budget(tree, 1) ) {
+        return NULL;
+    }
+    if ( evicting ) {
+        struct RBT_Node *victim = RBT_eviction_victim(tree);
+
+        // the new element is turned away if it would be the first to go
+        if ( (capacity->policy == RBT_EVICT_MINIMUM && RBT_KEYVALUE(key) < RBT_KEYVALUE(victim->key)) ||
+             (capacity->policy == RBT_EVICT_MAXIMUM && RBT_KEYVALUE(key) > RBT_KEYVALUE(victim->key)) ) {
+            if ( capacity->evicted != NULL ) {
+                capacity->evicted(RBT_KEYVALUE(key), data, capacity->context);
+            }
+            return NULL;
+        }
+        RBT_evict(tree, victim);
+    }
+    if ( dead != NULL ) {
+        dead->data = data;
+        tree->dead_count--;
+        tree->node_count++;
+        RBT_pull_path(tree, dead);
+        if ( RBT_OPTION(tree, index) != NULL ) {
+            RBT_index_insert(tree, dead);
+        }
+        if ( RBT_IS_RECENCY_TRACKED(tree) ) {
+            RBT_recency_push(tree, dead);
+        }
+        if ( RBT_OPTION(tree, filter) != NULL ) {
+            RBT_filter_insert(tree->extension->filter, dead->key);
+            RBT_refresh_filter(tree);
+        }
+        return data;
+    }
+    // the count only grows once the node exists, so a failed allocation leaves the tree as it was
+    struct RBT_Node *node = RBT_new_node(tree, key, data);
+    if ( node == NULL ) {
+        return NULL;
+    }
+    tree->node_count++;
+    RBT_account_nodes(tree, node, 1, 1);
+    return RBT_insert(tree, node)->data;
+}
+
+void *RBT_find(struct RBT_Tree *tree, uintmax_t key) {
+    if ( tree == NULL || RBT_IS_SEQUENCE(tree) ) {
+        return NULL;
+    }
+    if ( RBT_OPTION(tree, trace) != NULL ) {
+        RBT_trace_record(tree->extension->trace, RBT_TRACE_FIND, RBT_KEYVALUE(key));
+    }
+    if ( RBT_IS_BPLUS(tree) ) {
+        return RBT_BP_find(tree->extension->bplus, key);
+    }
+    if ( RBT_IS_INLINE(tree) ) {
+        size_t at = RBT_inline_find(tree, RBT_KEYVALUE(key));
+        return at < tree->node_count ? tree->extension->inline_data[at] : NULL;
+    }
+    struct RBT_Node *node = RBT_find_live(tree, key);
+    if ( node == NULL ) {
+        return NULL;
+    }
+    RBT_recency_touch(tree, node);
+    return node->data;
+}
+
+int RBT_delete(struct RBT_Tree *tree, uintmax_t key) {
+    if ( RBT_IS_SEQUENCE(tree) ) {
+        return 0;
+    }
+    if ( RBT_OPTION(tree, trace) != NULL ) {
+        RBT_trace_record(tree->extension->trace, RBT_TRACE_DELETE, RBT_KEYVALUE(key));
+    }
+    if ( RBT_IS_BPLUS(tree) ) {
+        int deleted = RBT_BP_delete(tree->extension->bplus, key);
+        tree->node_count = tree->extension->bplus->node_count;
+        return deleted;
+    }
+    if ( RBT_IS_INLINE(tree) ) {
+        size_t at = RBT_inline_find(tree, RBT_KEYVALUE(key));
+        if ( at == tree->node_count ) {
+            return 0;
+        }
+        RBT_inline_erase(tree, at);
+        return 1;
+    }
+    struct RBT_Node *find_node = RBT_find_live( tree, key );
+
+    if ( find_node == NULL ) {
+        return 0;
+    }
+    if ( tree->purge_percent == 0 ) {
+        int removed = RBT_remove( tree, find_node );
+        // demoting below the promotion point keeps a tree hovering around it from copying back and forth
+        RBT_demote_inline(tree, RBT_INLINE_CAPACITY / 2);
+        return removed;
+    }
+    RBT_unindex(tree, find_node);
+    if ( RBT_IS_RECENCY_TRACKED(tree) ) {
+        RBT_recency_unlink(tree, find_node);
+    }
+    find_node->data = &RBT_tombstone;
+    tree->node_count--;
+    tree->dead_count++;
+    RBT_unfilter(tree);
+    RBT_pull_path(tree, find_node);
+    RBT_purge_if_due(tree);
+    RBT_refresh_filter(tree);
+    return 1;
+}
+
+int RBT_get_maximum(struct RBT_Tree *tree, uintmax_t *key, void **value) {
+    if ( RBT_OPTION(tree, trace) != NULL ) {
+        RBT_trace_record(tree->extension->trace, RBT_TRACE_MAXIMUM, 0);
+    }
+    if ( RBT_IS_BPLUS(tree) ) {
+        return RBT_BP_get_maximum(tree->extension->bplus, key, value);
+    }
+    if ( RBT_IS_INLINE(tree) ) {
+        if ( tree->node_count == 0 ) {
+            return 0;
+        }
+        if (key) {
+            *key = tree->extension->inline_keys[tree->node_count - 1];
+        }
+        if (value) {
+            *value = tree->extension->inline_data[tree->node_count - 1];
+        }
+        return 1;
+    }
+    struct RBT_Node *node = RBT_maximum(tree->root);
+    while ( node != NULL && RBT_IS_DEAD(node) ) {
+        node = RBT_predecessor(node);
+    }
+    if (!node) {
+        return 0;
+    }
+    if (key) {
+        *key = RBT_KEYVALUE(node->key);
+    }
+    if (value) {
+        *value = node->data;
+    }
+
+    return 1;
+}
+
+int RBT_get_minimum(struct RBT_Tree *tree, uintmax_t *key, void **value) {
+    if ( RBT_OPTION(tree, trace) != NULL ) {
+        RBT_trace_record(tree->extension->trace, RBT_TRACE_MINIMUM, 0);
+    }
+    if ( RBT_IS_BPLUS(tree) ) {
+        return RBT_BP_get_minimum(tree->extension->bplus, key, value);
+    }
+    if ( RBT_IS_INLINE(tree) ) {
+        if ( tree->node_count == 0 ) {
+            return 0;
+        }
+        if (key) {
+            *key = tree->extension->inline_keys[0];
+        }
+        if (value) {
+            *value = tree->extension->inline_data[0];
+        }
+        return 1;
+    }
+    struct RBT_Node *node = RBT_minimum(tree->root);
+    while ( node != NULL && RBT_IS_DEAD(node) ) {
+        node = RBT_successor(node);
+    }
+    if (!node) {
+        return 0;
+    }
+    if (key) {
+        *key = RBT_KEYVALUE(node->key);
+    }
+    if (value) {
+        *value = node->data;
+    }
+
+    return 1;
+}
+
+int RBT_for_each(struct RBT_Tree *tree, int (*visit)(uintmax_t key, void *data, void *context), void *context) {
+    if ( tree == NULL || visit == NULL ) {
+        return 0;
+    }
+    if ( RBT_IS_BPLUS(tree) ) {
+        return RBT_BP_for_each(tree->extension->bplus, visit, context);
+    }
+    if ( RBT_IS_INLINE(tree) ) {
+        for ( uintmax_t i = 0; i < tree->node_count; ++i ) {
+            if ( !visit(tree->extension->inline_keys[i], tree->extension->inline_data[i], context) ) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for ( struct RBT_Node *node = RBT_minimum(tree->root); node != NULL; node = RBT_successor(node) ) {
+        if ( !RBT_IS_DEAD(node) && !visit(RBT_KEYVALUE(node->key), node->data, context) ) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int RBT_set_augment(struct RBT_Tree *tree, const struct RBT_Augment *augment) {
+    if ( tree == NULL || !RBT_IS_EMPTY(tree) || RBT_IS_SEQUENCE(tree) || RBT_IS_BPLUS(tree) ) {
+        return 0;
+    }
+    if ( augment != NULL && augment->size > RBT_AGGREGATE_MAX_SIZE ) {
+        return 0;
+    }
+    if ( augment != NULL && tree->extension != NULL ) {
+        tree->extension->inline_entries = 0;
+    }
+    tree->augment = augment;
+    RBT_update_node_size(tree);
+    return 1;
+}
+
+int RBT_range_aggregate(struct RBT_Tree *tree, uintmax_t lo, uintmax_t hi, void *out) {
+    if ( tree == NULL || tree->augment == NULL || RBT_IS_SEQUENCE(tree) ) {
+        return 0;
+    }
+    const struct RBT_Augment *augment = tree->augment;
+    struct RBT_Node *split = tree->root;
+
+    // descend to the topmost node inside the range, where the range boundaries diverge
+    while ( split != NULL && lo <= hi ) {
+        if ( RBT_KEYVALUE(split->key) < lo ) {
+            split = split->right;
+        } else if ( RBT_KEYVALUE(split->key) > hi ) {
+            split = split->left;
+        } else {
+            break;
+        }
+    }
+    if ( split == NULL || lo > hi ) {
+        memcpy(out, augment->identity, augment->size);
+        return 1;
+    }
+
+    union RBT_Aggregate_Buffer left, right, lifted, partial;
+
+    RBT_suffix_aggregate(tree, split->left, lo, left.bytes);
+    RBT_prefix_aggregate(tree, split->right, hi, right.bytes);
+    RBT_lift(tree, split, lifted.bytes);
+    augment->combine(partial.bytes, left.bytes, lifted.bytes, augment->context);
+    augment->combine(out, partial.bytes, right.bytes, augment->context);
+
+    return 1;
+}
+
+int RBT_refresh_aggregate(struct RBT_Tree *tree, uintmax_t key) {
+    if ( tree == NULL || RBT_IS_SEQUENCE(tree) || RBT_IS_BPLUS(tree) ) {
+        return 0;
+    }
+    struct RBT_Node *node = RBT_find_live( tree, key );
+    if ( node == NULL ) {
+        return 0;
+    }
+    RBT_pull_path(tree, node);
+    return 1;
+}
+
+int RBT_set_lazy_delete(struct RBT_Tree *tree, unsigned purge_percent) {
+    if ( tree == NULL || RBT_IS_SEQUENCE(tree) || RBT_IS_BPLUS(tree) ) {
+        return 0;
+    }
+    if ( purge_percent > 0 && !RBT_leave_inline(tree) ) {
+        return 0;
+    }
+    tree->purge_percent = purge_percent;
+    if ( purge_percent == 0 ) {
+        RBT_purge(tree);
+    }
+    return 1;
+}
+
+uintmax_t RBT_purge(struct RBT_Tree *tree) {
+    struct RBT_Node *list = NULL;
+    uintmax_t purged = tree->dead_count;
+
+    if ( purged == 0 ) {
+        return 0;
+    }
+    RBT_account_nodes(tree, tree->root, purged, 0);
+    RBT_flatten_live(tree->root, &list);
+    tree->root = RBT_build_from_list(tree, &list, tree->node_count, 0, RBT_full_levels(tree->node_count));
+    tree->dead_count = 0;
+    tree->generation++;
+    return purged;
+}
+
+int RBT_set_hash_index(struct RBT_Tree *tree, int enabled) {
+    if ( tree == NULL || RBT_IS_SEQUENCE(tree) || RBT_IS_BPLUS(tree) || (enabled && !RBT_leave_inline(tree)) ) {
+        return 0;
+    }
+    RBT_index_destroy(tree);
+    if ( !enabled ) {
+        return 1;
+    }
+    if ( !RBT_index_create(tree, tree->node_count) ) {
+        return 0;
+    }
+    for ( struct RBT_Node *node = RBT_minimum(tree->root); node != NULL; node = RBT_successor(node) ) {
+        if ( !RBT_IS_DEAD(node) ) {
+            RBT_index_insert(tree, node);
+        }
+    }
+    return RBT_OPTION(tree, index) != NULL;
+}
+
+int RBT_set_lookup_filter(struct RBT_Tree *tree, int enabled) {
+    if ( tree == NULL || RBT_IS_SEQUENCE(tree) || RBT_IS_BPLUS(tree) || (enabled && !RBT_leave_inline(tree)) ) {
+        return 0;
+    }
+    RBT_filter_destroy(tree);
+    if ( !enabled ) {
+        return 1;
+    }
+    if ( !RBT_filter_create(tree, tree->node_count) ) {
+        return 0;
+    }
+    for ( struct RBT_Node *node = RBT_minimum(tree->root); node != NULL; node = RBT_successor(node) ) {
+        if ( !RBT_IS_DEAD(node) ) {
+            RBT_filter_insert(tree->extension->filter, node->key);
+        }
+    }
+    return 1;
+}
+
+void *RBT_finger_find(struct RBT_Tree *tree, struct RBT_Finger *finger, uintmax_t key) {
+    struct RBT_Node *start = tree->root;
+    struct RBT_Node *last = NULL;
+    struct RBT_Node *node;
+
+    key = RBT_KEYVALUE(key);
+    if ( RBT_IS_SEQUENCE(tree) ) {
+        return NULL;
+    }
+    if ( RBT_IS_BPLUS(tree) ) {
+        return RBT_BP_find(tree->extension->bplus, key);
+    }
+    if ( RBT_IS_INLINE(tree) ) {
+        size_t at = RBT_inline_find(tree, key);
+        return at < tree->node_count ? tree->extension->inline_data[at] : NULL;
+    }
+    if ( RBT_OPTION(tree, filter) != NULL && !RBT_filter_may_contain(tree->extension->filter, key) ) {
+        return NULL;
+    }
+    if ( finger->node != NULL && finger->generation == tree->generation ) {
+        if ( RBT_KEYVALUE(finger->node->key) == key && !RBT_IS_DEAD(finger->node) ) {
+            RBT_recency_touch(tree, finger->node);
+            return finger->node->data;
+        }
+        start = RBT_finger_climb(finger->node, key);
+    }
+    if ( RBT_OPTION(tree, index) != NULL ) {
+        node = RBT_index_find(tree, key);
+    } else if ( tree->dead_count > 0 ) {
+        node = RBT_find_state(start, key, 0);
+    } else {
+        for ( node = start; node != NULL && RBT_KEYVALUE(node->key) != key; ) {
+            last = node;
+            node = key < RBT_KEYVALUE(node->key) ? node->left : node->right;
+        }
+    }
+
+    // a miss leaves the finger where the search ended, so the next nearby key is still close
+    finger->node = node != NULL ? node : (last != NULL ? last : start);
+    finger->generation = tree->generation;
+    if ( node == NULL ) {
+        return NULL;
+    }
+    RBT_recency_touch(tree, node);
+    return node->data;
+}
+
+int RBT_set_capacity(struct RBT_Tree *tree, uintmax_t capacity, enum RBT_Eviction policy,
+        void (*evicted)(uintmax_t key, void *data, void *context), void *context) {
+    if ( tree == NULL || RBT_IS_SEQUENCE(tree) || RBT_IS_BPLUS(tree) ) {
+        return 0;
+    }
+    if ( capacity == 0 ) {
+        if ( RBT_OPTION(tree, capacity) != NULL ) {
+            RBT_account_auxiliary(sizeof(struct RBT_Capacity), 0);
+            free(tree->extension->capacity);
+            tree->extension->capacity = NULL;
+        }
+        RBT_update_node_size(tree);
+        return 1;
+    }
+    int tracked = RBT_IS_RECENCY_TRACKED(tree);
+    if ( policy == RBT_EVICT_LEAST_RECENT && !tracked && !RBT_IS_EMPTY(tree) ) {
+        return 0;
+    }
+    struct RBT_Extension *extension = RBT_extend(tree);
+    if ( extension == NULL || !RBT_leave_inline(tree) ) {
+        return 0;
+    }
+    if ( extension->capacity == NULL ) {
+        extension->capacity = malloc( sizeof(struct RBT_Capacity) );
+        if ( extension->capacity == NULL ) {
+            return 0;
+        }
+        RBT_account_auxiliary(sizeof(struct RBT_Capacity), 1);
+    }
+    if ( !tracked ) {
+        extension->capacity->newest = NULL;
+        extension->capacity->oldest = NULL;
+    }
+    extension->capacity->limit = capacity;
+    extension->capacity->policy = policy;
+    extension->capacity->evicted = evicted;
+    extension->capacity->context = context;
+    RBT_update_node_size(tree);
+    RBT_evict_to_capacity(tree);
+    return 1;
+}
+
+int RBT_set_balance(struct RBT_Tree *tree, enum RBT_Balance balance) {
+    if ( tree == NULL || !RBT_IS_EMPTY(tree) || RBT_IS_SEQUENCE(tree) || RBT_IS_BPLUS(tree) ) {
+        return 0;
+    }
+    if ( balance != RBT_BALANCE_RED_BLACK && balance != RBT_BALANCE_WAVL ) {
+        return 0;
+    }
+    tree->balance = balance;
+    return 1;
+}
+
+int RBT_set_engine(struct RBT_Tree *tree, enum RBT_Engine engine) {
+    struct RBT_BP_Tree *bplus;
+
+    if ( tree == NULL || !RBT_IS_EMPTY(tree) ) {
+        return 0;
+    }
+    if ( engine == RBT_ENGINE_RED_BLACK ) {
+        RBT_drop_engine(tree, NULL);
+        return 1;
+    }
+    if ( engine != RBT_ENGINE_BPLUS ) {
+        return 0;
+    }
+    if ( RBT_IS_BPLUS(tree) ) {
+        return 1;
+    }
+    // the trace is the only option that does not work on the nodes
+    if ( tree->augment != NULL || tree->purge_percent > 0 || tree->balance != RBT_BALANCE_RED_BLACK ||
+         RBT_OPTION(tree, index) != NULL || RBT_OPTION(tree, filter) != NULL || RBT_OPTION(tree, capacity) != NULL ||
+         RBT_OPTION(tree, inline_entries) || RBT_OPTION(tree, memory_budget) > 0 || RBT_OPTION(tree, reserve) != NULL ) {
+        return 0;
+    }
+    bplus = malloc( sizeof(struct RBT_BP_Tree) );
+    if ( bplus == NULL || RBT_extend(tree) == NULL ) {
+        free(bplus);
+        return 0;
+    }
+    RBT_BP_init_tree(bplus);
+    tree->extension->bplus = bplus;
+    return 1;
+}
+
+int RBT_set_inline_entries(struct RBT_Tree *tree, int enabled) {
+    if ( tree == NULL || RBT_IS_BPLUS(tree) ) {
+        return 0;
+    }
+    if ( !enabled ) {
+        return RBT_leave_inline(tree);
+    }
+    if ( tree->augment != NULL || tree->purge_percent > 0 || RBT_OPTION(tree, index) != NULL ||
+         RBT_OPTION(tree, filter) != NULL || RBT_OPTION(tree, capacity) != NULL || RBT_extend(tree) == NULL ) {
+        return 0;
+    }
+    tree->extension->inline_entries = 1;
+    RBT_demote_inline(tree, RBT_INLINE_CAPACITY);
+    return 1;
+}
+
+int RBT_get_memory_usage(struct RBT_Tree *tree, struct RBT_Memory_Usage *usage) {
+    if ( tree == NULL || usage == NULL ) {
+        return 0;
+    }
+    if ( RBT_IS_BPLUS(tree) ) {
+        usage->nodes = tree->extension->bplus->bytes;
+        usage->slack = tree->extension->bplus->slack;
+        usage->auxiliary = 0;
+        return 1;
+    }
+    // every node has the same size, so the nodes allocated do not need counting one by one
+    uintmax_t nodes = RBT_IS_INLINE(tree) ? 0 : tree->node_count + tree->dead_count;
+    usage->nodes = nodes * tree->node_size;
+    usage->slack = 0;
+    if ( tree->root != NULL ) {
+        usage->slack = nodes * (RBT_USABLE_SIZE(tree->root, tree->node_size) - tree->node_size);
+    }
+    usage->auxiliary = 0;
+    struct RBT_Extension *extension = tree->extension;
+    if ( extension == NULL ) {
+        return 1;
+    }
+    if ( extension->index != NULL ) {
+        usage->auxiliary += RBT_index_size(extension->index);
+    }
+    if ( extension->filter != NULL ) {
+        usage->auxiliary += RBT_filter_size(extension->filter);
+    }
+    if ( extension->capacity != NULL ) {
+        usage->auxiliary += sizeof(struct RBT_Capacity);
+    }
+    if ( extension->reserve != NULL ) {
+        usage->auxiliary += extension->reserved * RBT_USABLE_SIZE(extension->reserve, tree->node_size);
+    }
+    return 1;
+}
+
+void RBT_get_global_memory_usage(struct RBT_Memory_Usage *usage) {
+    if ( usage == NULL ) {
+        return;
+    }
+    usage->nodes = RBT_COUNTER_LOAD(RBT_global_nodes);
+    usage->slack = RBT_COUNTER_LOAD(RBT_global_slack);
+    usage->auxiliary = RBT_COUNTER_LOAD(RBT_global_auxiliary);
+}
+
+int RBT_set_memory_budget(struct RBT_Tree *tree, uintmax_t budget) {
+    if ( tree == NULL || RBT_IS_BPLUS(tree) ) {
+        return 0;
+    }
+    if ( budget == 0 && tree->extension == NULL ) {
+        return 1;
+    }
+    if ( RBT_extend(tree) == NULL ) {
+        return 0;
+    }
+    tree->extension->memory_budget = budget;
+    return 1;
+}
+
+int RBT_reserve(struct RBT_Tree *tree, uintmax_t count) {
+    struct RBT_Node *reserve = NULL;
+    struct RBT_Node *last = NULL;
+    uintmax_t missing;
+
+    if ( tree == NULL || RBT_IS_BPLUS(tree) ) {
+        return 0;
+    }
+    missing = count > RBT_OPTION(tree, reserved) ? count - RBT_OPTION(tree, reserved) : 0;
+    if ( missing == 0 ) {
+        return 1;
+    }
+    if ( RBT_extend(tree) == NULL ) {
+        return 0;
+    }
+    // every node is written through, so its pages are faulted in now rather than on the insert taking it
+    for ( uintmax_t i = 0; i < missing; ++i ) {
+        struct RBT_Node *node = RBT_MALLOC( tree->node_size );
+        // the first node tells the size the allocator gave, which the reserve is charged for
+        if ( node != NULL && i == 0 && !RBT_fits_budget(tree, missing, node) ) {
+            RBT_FREE(node);
+            node = NULL;
+        }
+        if ( node == NULL ) {
+            while ( reserve != NULL ) {
+                node = reserve->right;
+                RBT_FREE(reserve);
+                reserve = node;
+            }
+            return 0;
+        }
+        memset(node, 0, tree->node_size);
+        node->right = reserve;
+        reserve = node;
+        if ( last == NULL ) {
+            last = node;
+        }
+    }
+    RBT_account_auxiliary(missing * RBT_USABLE_SIZE(reserve, tree->node_size), 1);
+    last->right = tree->extension->reserve;
+    tree->extension->reserve = reserve;
+    tree->extension->reserved += missing;
+    return 1;
+}
+
+uintmax_t RBT_shrink_to_fit(struct RBT_Tree *tree) {
+    struct RBT_Extension *extension;
+    uintmax_t released;
+
+    if ( tree == NULL || RBT_OPTION(tree, reserve) == NULL ) {
+        return 0;
+    }
+    extension = tree->extension;
+    released = extension->reserved;
+    RBT_account_auxiliary(released * RBT_USABLE_SIZE(extension->reserve, tree->node_size), 0);
+    while ( extension->reserve != NULL ) {
+        struct RBT_Node *right = extension->reserve->right;
+        RBT_FREE(extension->reserve);
+        extension->reserve = right;
+    }
+    extension->reserved = 0;
+    return released;
+}
+
+uintmax_t RBT_delete_range(struct RBT_Tree *tree, uintmax_t lo, uintmax_t hi, struct RBT_Node **detached) {
+    struct RBT_Node *less, *rest, *middle, *greater;
+    unsigned less_height, rest_height, middle_height, greater_height;
+    uintmax_t live = 0;
+    uintmax_t dead = 0;
+
+    if ( detached != NULL ) {
+        *detached = NULL;
+    }
+    // detached elements are handed out as nodes
+    if ( tree == NULL || RBT_IS_SEQUENCE(tree) || RBT_IS_BPLUS(tree) || !RBT_promote_inline(tree) ||
+         tree->root == NULL || lo > hi || lo > RBT_KEY_MAX ) {
+        return 0;
+    }
+    if ( tree->balance == RBT_BALANCE_WAVL ) {
+        // splits and joins go by black heights, which WAVL ranks do not provide
+        middle = RBT_unlink_range(tree, lo, hi);
+    } else {
+        RBT_split(tree->augment, tree->root, RBT_black_height(tree->root), lo, 0, &less, &less_height, &rest, &rest_height);
+        if ( hi >= RBT_KEY_MAX ) {
+            middle = rest;
+            greater = NULL;
+        } else {
+            RBT_split(tree->augment, rest, rest_height, hi + 1, 0, &middle, &middle_height, &greater, &greater_height);
+        }
+        tree->root = RBT_join_pieces(tree->augment, less, less_height, greater);
+        if ( tree->root != NULL ) {
+            tree->root->parent = NULL;
+            RBT_SET_BLACK(tree->root);
+        }
+    }
+
+    RBT_count_detached(tree, middle, &live, &dead);
+    RBT_account_nodes(tree, middle, live + dead, 0);
+    tree->node_count -= live;
+    tree->dead_count -= dead;
+    RBT_refresh_filter(tree);
+    if ( middle != NULL ) {
+        tree->generation++;
+    }
+    RBT_demote_inline(tree, RBT_INLINE_CAPACITY / 2);
+    if ( detached != NULL ) {
+        *detached = middle;
+    } else {
+        RBT_free_detached(middle, NULL);
+    }
+    return live;
+}
+
+uintmax_t RBT_delete_below(struct RBT_Tree *tree, uintmax_t key, struct RBT_Node **detached) {
+    if ( key == 0 ) {
+        if ( detached != NULL ) {
+            *detached = NULL;
+        }
+        return 0;
+    }
+    return RBT_delete_range(tree, 0, key - 1, detached);
+}
+
+void RBT_free_detached(struct RBT_Node *detached, void (*freedata)(void *)) {
+    while ( detached != NULL ) {
+        struct RBT_Node *right = detached->right;
+        RBT_free_detached(detached->left, freedata);
+        if ( freedata && !RBT_IS_DEAD(detached) ) {
+            freedata(detached->data);
+        }
+        RBT_FREE(detached);
+        detached = right;
+    }
+}
+
+int RBT_sequence_init(struct RBT_Tree *tree) {
+    if ( !RBT_init_tree(tree) ) {
+        return 0;
+    }
+    tree->augment = &RBT_sequence_augment;
+    RBT_update_node_size(tree);
+    return 1;
+}
+
+void *RBT_sequence_insert_at(struct RBT_Tree *tree, uintmax_t position, void *data) {
+    struct RBT_Node *parent = NULL;
+    int left = 0;
+
+    if ( tree == NULL || !RBT_IS_SEQUENCE(tree) || position > tree->node_count ) {
+        return NULL;
+    }
+    if ( !RBT_within_budget(tree, 1) ) {
+        return NULL;
+    }
+    struct RBT_Node *node = RBT_new_node(tree, 0, data);
+    if ( node == NULL ) {
+        return NULL;
+    }
+
+    // the new node goes right before the node now at the position, or after the last one
+    if ( position == tree->node_count ) {
+        parent = RBT_maximum(tree->root);
+    } else {
+        struct RBT_Node *next = RBT_sequence_node(tree->root, position);
+        if ( next->left == NULL ) {
+            parent = next;
+            left = 1;
+        } else {
+            parent = RBT_maximum(next->left);
+        }
+    }
+    RBT_attach(tree, parent, left, node);
+    RBT_account_nodes(tree, node, 1, 1);
+    tree->node_count++;
+    return data;
+}
+
+int RBT_sequence_erase_at(struct RBT_Tree *tree, uintmax_t position) {
+    if ( tree == NULL || !RBT_IS_SEQUENCE(tree) || position >= tree->node_count ) {
+        return 0;
+    }
+    return RBT_remove(tree, RBT_sequence_node(tree->root, position));
+}
+
+void *RBT_sequence_get(struct RBT_Tree *tree, uintmax_t position) {
+    if ( tree == NULL || !RBT_IS_SEQUENCE(tree) || position >= tree->node_count ) {
+        return NULL;
+    }
+    return RBT_sequence_node(tree->root, position)->data;
+}
+
+int RBT_sequence_split(struct RBT_Tree *tree, uintmax_t position, struct RBT_Tree *rest) {
+    struct RBT_Node *less, *greater;
+    unsigned less_height, greater_height;
+
+    if ( tree == NULL || rest == NULL || rest == tree || !RBT_IS_SEQUENCE(tree) || position > tree->node_count ) {
+        return 0;
+    }
+    // the options of an empty "rest" go, as they do not apply to sequences, but elements would leak
+    if ( !RBT_IS_EMPTY(rest) ) {
+        return 0;
+    }
+    RBT_deinit_tree(rest, NULL);
+    if ( !RBT_sequence_init(rest) ) {
+        return 0;
+    }
+    RBT_split(tree->augment, tree->root, RBT_black_height(tree->root), position, 1,
+        &less, &less_height, &greater, &greater_height);
+    tree->root = less;
+    rest->root = greater;
+    rest->node_count = tree->node_count - position;
+    tree->node_count = position;
+    if ( less != NULL ) {
+        RBT_SET_BLACK(less);
+    }
+    if ( greater != NULL ) {
+        RBT_SET_BLACK(greater);
+    }
+    tree->generation++;
+    return 1;
+}
+
+int RBT_sequence_concat(struct RBT_Tree *tree, struct RBT_Tree *other) {
+    if ( tree == NULL || other == NULL || tree == other || !RBT_IS_SEQUENCE(tree) || !RBT_IS_SEQUENCE(other) ) {
+        return 0;
+    }
+    tree->root = RBT_join_pieces(tree->augment, tree->root, RBT_black_height(tree->root), other->root);
+    if ( tree->root != NULL ) {
+        tree->root->parent = NULL;
+        RBT_SET_BLACK(tree->root);
+    }
+    tree->node_count += other->node_count;
+    tree->generation++;
+    other->root = NULL;
+    other->node_count = 0;
+    other->generation++;
     return 1;
 }
@@ -0,0 +1,521 @@
+/**
+ * Cache-conscious B+-tree
+ *
+ * Every node keeps its keys in one contiguous array, so the search within a node streams
+ * through a couple of cache lines instead of chasing a pointer per comparison. The search
+ * counts the keys below the probe over the whole fixed size array without early exit,
+ * which compilers turn into vector compares; the unused slots hold UINTMAX_MAX so they
+ * never count.
+ *
+ * Nodes are split when full and rebalanced by borrowing from, or merging with, a sibling
+ * once they fall below half full. Only the root may be less than half full.
+ **/
+#include "RBTree/RBTreeBPlus.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "RBMacros.h"
+#include "RBTreeInternal.h"
+
+#define RBT_BP_MINIMUM (RBT_BP_ORDER / 2)
+#define RBT_BP_MAX_HEIGHT 64
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+static inline void RBT_BP_pad(struct RBT_BP_Node *node) {
+    for ( unsigned i = node->count; i < RBT_BP_ORDER; ++i ) {
+        node->keys[i] = UINTMAX_MAX;
+    }
+}
+
+// number of keys in the node smaller than the given key
+static inline unsigned RBT_BP_lower_bound(const struct RBT_BP_Node *node, uintmax_t key) {
+    unsigned position = 0;
+    for ( unsigned i = 0; i < RBT_BP_ORDER; ++i ) {
+        position += node->keys[i] < key;
+    }
+    return position;
+}
+
+// number of keys in the node smaller than or equal to the given key
+static inline unsigned RBT_BP_upper_bound(const struct RBT_BP_Node *node, uintmax_t key) {
+    unsigned position = 0;
+    for ( unsigned i = 0; i < RBT_BP_ORDER; ++i ) {
+        position += node->keys[i] <= key;
+    }
+    return position;
+}
+
+// adds a node to the memory usage of the tree and of the process, or removes it if "allocated" is zero
+static inline void RBT_BP_account(struct RBT_BP_Tree *tree, struct RBT_BP_Node *node, int allocated) {
+    size_t size = node->leaf ? sizeof(struct RBT_BP_Leaf) : sizeof(struct RBT_BP_Inner);
+    uintmax_t slack = RBT_USABLE_SIZE(node, size) - size;
+
+    if ( allocated ) {
+        tree->bytes += size;
+        tree->slack += slack;
+    } else {
+        tree->bytes -= size;
+        tree->slack -= slack;
+    }
+    RBT_account_memory(size, slack, allocated);
+}
+
+static inline void RBT_BP_free(struct RBT_BP_Tree *tree, struct RBT_BP_Node *node) {
+    RBT_BP_account(tree, node, 0);
+    RBT_FREE(node);
+}
+
+static inline struct RBT_BP_Leaf *RBT_BP_new_leaf(struct RBT_BP_Tree *tree) {
+    struct RBT_BP_Leaf *leaf = RBT_MALLOC( sizeof(struct RBT_BP_Leaf) );
+    if ( !leaf ) {
+        return NULL;
+    }
+    leaf->node.count = 0;
+    leaf->node.leaf = 1;
+    leaf->next = NULL;
+    RBT_BP_pad(&leaf->node);
+    RBT_BP_account(tree, &leaf->node, 1);
+    return leaf;
+}
+
+static inline struct RBT_BP_Inner *RBT_BP_new_inner(struct RBT_BP_Tree *tree) {
+    struct RBT_BP_Inner *inner = RBT_MALLOC( sizeof(struct RBT_BP_Inner) );
+    if ( !inner ) {
+        return NULL;
+    }
+    inner->node.count = 0;
+    inner->node.leaf = 0;
+    RBT_BP_pad(&inner->node);
+    RBT_BP_account(tree, &inner->node, 1);
+    return inner;
+}
+
+static void RBT_BP_recursive_destroy(struct RBT_BP_Tree *tree, struct RBT_BP_Node *node, void (*freedata)(void *)) {
+    if ( node->leaf ) {
+        struct RBT_BP_Leaf *leaf = (struct RBT_BP_Leaf *) node;
+        for ( unsigned i = 0; freedata && i < node->count; ++i ) {
+            freedata(leaf->data[i]);
+        }
+    } else {
+        struct RBT_BP_Inner *inner = (struct RBT_BP_Inner *) node;
+        for ( unsigned i = 0; i <= node->count; ++i ) {
+            RBT_BP_recursive_destroy(tree, inner->children[i], freedata);
+        }
+    }
+    RBT_BP_free(tree, node);
+}
+
+static inline void RBT_BP_leaf_insert(struct RBT_BP_Leaf *leaf, unsigned slot, uintmax_t key, void *data) {
+    unsigned moved = leaf->node.count - slot;
+    memmove(&leaf->node.keys[slot + 1], &leaf->node.keys[slot], moved * sizeof(uintmax_t));
+    memmove(&leaf->data[slot + 1], &leaf->data[slot], moved * sizeof(void *));
+    leaf->node.keys[slot] = key;
+    leaf->data[slot] = data;
+    leaf->node.count++;
+}
+
+static inline void RBT_BP_leaf_erase(struct RBT_BP_Leaf *leaf, unsigned slot) {
+    unsigned moved = leaf->node.count - slot - 1;
+    memmove(&leaf->node.keys[slot], &leaf->node.keys[slot + 1], moved * sizeof(uintmax_t));
+    memmove(&leaf->data[slot], &leaf->data[slot + 1], moved * sizeof(void *));
+    leaf->node.count--;
+    leaf->node.keys[leaf->node.count] = UINTMAX_MAX;
+}
+
+// moves the upper half of a full leaf into the empty right leaf
+static inline void RBT_BP_leaf_split(struct RBT_BP_Leaf *leaf, struct RBT_BP_Leaf *right) {
+    unsigned moved = RBT_BP_ORDER - RBT_BP_MINIMUM;
+    memcpy(right->node.keys, &leaf->node.keys[RBT_BP_MINIMUM], moved * sizeof(uintmax_t));
+    memcpy(right->data, &leaf->data[RBT_BP_MINIMUM], moved * sizeof(void *));
+    right->node.count = moved;
+    leaf->node.count = RBT_BP_MINIMUM;
+    RBT_BP_pad(&leaf->node);
+
+    right->next = leaf->next;
+    leaf->next = right;
+}
+
+// inserts the separator key at slot, with the child to its right
+static inline void RBT_BP_inner_insert(struct RBT_BP_Inner *inner, unsigned slot, uintmax_t key, struct RBT_BP_Node *child) {
+    unsigned moved = inner->node.count - slot;
+    memmove(&inner->node.keys[slot + 1], &inner->node.keys[slot], moved * sizeof(uintmax_t));
+    memmove(&inner->children[slot + 2], &inner->children[slot + 1], moved * sizeof(struct RBT_BP_Node *));
+    inner->node.keys[slot] = key;
+    inner->children[slot + 1] = child;
+    inner->node.count++;
+}
+
+/*
+ * inserts the separator key and child into the full inner node, distributing the result over
+ * the inner node and the empty right node.
+ * Returns the middle key, which separates the two nodes in their parent.
+ */
+static uintmax_t RBT_BP_inner_split(struct RBT_BP_Inner *inner, struct RBT_BP_Inner *right, unsigned slot, uintmax_t key, struct RBT_BP_Node *child) {
+    uintmax_t keys[RBT_BP_ORDER + 1];
+    struct RBT_BP_Node *children[RBT_BP_ORDER + 2];
+
+    memcpy(keys, inner->node.keys, slot * sizeof(uintmax_t));
+    keys[slot] = key;
+    memcpy(&keys[slot + 1], &inner->node.keys[slot], (RBT_BP_ORDER - slot) * sizeof(uintmax_t));
+    memcpy(children, inner->children, (slot + 1) * sizeof(struct RBT_BP_Node *));
+    children[slot + 1] = child;
+    memcpy(&children[slot + 2], &inner->children[slot + 1], (RBT_BP_ORDER - slot) * sizeof(struct RBT_BP_Node *));
+
+    unsigned half = RBT_BP_ORDER / 2;
+    unsigned moved = RBT_BP_ORDER - half;
+    memcpy(inner->node.keys, keys, half * sizeof(uintmax_t));
+    memcpy(inner->children, children, (half + 1) * sizeof(struct RBT_BP_Node *));
+    inner->node.count = half;
+    RBT_BP_pad(&inner->node);
+
+    memcpy(right->node.keys, &keys[half + 1], moved * sizeof(uintmax_t));
+    memcpy(right->children, &children[half + 1], (moved + 1) * sizeof(struct RBT_BP_Node *));
+    right->node.count = moved;
+    RBT_BP_pad(&right->node);
+
+    return keys[half];
+}
+
+static void RBT_BP_borrow_left(struct RBT_BP_Inner *parent, unsigned index) {
+    struct RBT_BP_Node *node = parent->children[index];
+    struct RBT_BP_Node *left = parent->children[index - 1];
+
+    memmove(&node->keys[1], node->keys, node->count * sizeof(uintmax_t));
+    if ( node->leaf ) {
+        struct RBT_BP_Leaf *leaf = (struct RBT_BP_Leaf *) node;
+        memmove(&leaf->data[1], leaf->data, node->count * sizeof(void *));
+        node->keys[0] = left->keys[left->count - 1];
+        leaf->data[0] = ((struct RBT_BP_Leaf *) left)->data[left->count - 1];
+        parent->node.keys[index - 1] = node->keys[0];
+    } else {
+        struct RBT_BP_Inner *inner = (struct RBT_BP_Inner *) node;
+        memmove(&inner->children[1], inner->children, (node->count + 1) * sizeof(struct RBT_BP_Node *));
+        node->keys[0] = parent->node.keys[index - 1];
+        inner->children[0] = ((struct RBT_BP_Inner *) left)->children[left->count];
+        parent->node.keys[index - 1] = left->keys[left->count - 1];
+    }
+    node->count++;
+    left->count--;
+    left->keys[left->count] = UINTMAX_MAX;
+}
+
+static void RBT_BP_borrow_right(struct RBT_BP_Inner *parent, unsigned index) {
+    struct RBT_BP_Node *node = parent->children[index];
+    struct RBT_BP_Node *right = parent->children[index + 1];
+
+    if ( node->leaf ) {
+        struct RBT_BP_Leaf *leaf = (struct RBT_BP_Leaf *) right;
+        node->keys[node->count] = right->keys[0];
+        ((struct RBT_BP_Leaf *) node)->data[node->count] = leaf->data[0];
+        memmove(leaf->data, &leaf->data[1], (right->count - 1) * sizeof(void *));
+        memmove(right->keys, &right->keys[1], (right->count - 1) * sizeof(uintmax_t));
+        parent->node.keys[index] = right->keys[0];
+    } else {
+        struct RBT_BP_Inner *inner = (struct RBT_BP_Inner *) right;
+        node->keys[node->count] = parent->node.keys[index];
+        ((struct RBT_BP_Inner *) node)->children[node->count + 1] = inner->children[0];
+        parent->node.keys[index] = right->keys[0];
+        memmove(inner->children, &inner->children[1], right->count * sizeof(struct RBT_BP_Node *));
+        memmove(right->keys, &right->keys[1], (right->count - 1) * sizeof(uintmax_t));
+    }
+    node->count++;
+    right->count--;
+    right->keys[right->count] = UINTMAX_MAX;
+}
+
+// merges children[index + 1] into children[index], dropping their separator from the parent
+static void RBT_BP_merge(struct RBT_BP_Tree *tree, struct RBT_BP_Inner *parent, unsigned index) {
+    struct RBT_BP_Node *left = parent->children[index];
+    struct RBT_BP_Node *right = parent->children[index + 1];
+
+    if ( left->leaf ) {
+        struct RBT_BP_Leaf *left_leaf = (struct RBT_BP_Leaf *) left;
+        struct RBT_BP_Leaf *right_leaf = (struct RBT_BP_Leaf *) right;
+        memcpy(&left->keys[left->count], right->keys, right->count * sizeof(uintmax_t));
+        memcpy(&left_leaf->data[left->count], right_leaf->data, right->count * sizeof(void *));
+        left->count += right->count;
+        left_leaf->next = right_leaf->next;
+    } else {
+        left->keys[left->count] = parent->node.keys[index];
+        memcpy(&left->keys[left->count + 1], right->keys, right->count * sizeof(uintmax_t));
+        memcpy(&((struct RBT_BP_Inner *) left)->children[left->count + 1], ((struct RBT_BP_Inner *) right)->children,
+            (right->count + 1) * sizeof(struct RBT_BP_Node *));
+        left->count += right->count + 1;
+    }
+    RBT_BP_free(tree, right);
+
+    unsigned moved = parent->node.count - index - 1;
+    memmove(&parent->node.keys[index], &parent->node.keys[index + 1], moved * sizeof(uintmax_t));
+    memmove(&parent->children[index + 1], &parent->children[index + 2], moved * sizeof(struct RBT_BP_Node *));
+    parent->node.count--;
+    parent->node.keys[parent->node.count] = UINTMAX_MAX;
+}
+
+static void RBT_BP_rebalance(struct RBT_BP_Tree *tree, struct RBT_BP_Inner *parent, unsigned index) {
+    if ( parent->children[index]->count >= RBT_BP_MINIMUM ) {
+        return;
+    }
+    if ( index > 0 && parent->children[index - 1]->count > RBT_BP_MINIMUM ) {
+        RBT_BP_borrow_left(parent, index);
+    } else if ( index < parent->node.count && parent->children[index + 1]->count > RBT_BP_MINIMUM ) {
+        RBT_BP_borrow_right(parent, index);
+    } else if ( index > 0 ) {
+        RBT_BP_merge(tree, parent, index - 1);
+    } else {
+        RBT_BP_merge(tree, parent, index);
+    }
+}
+
+/*
+ * removes one element with the given key below node. Duplicates of a key may span several
+ * children, so every child whose range includes the key is tried from the left.
+ */
+static int RBT_BP_remove(struct RBT_BP_Tree *tree, struct RBT_BP_Node *node, uintmax_t key) {
+    unsigned slot = RBT_BP_lower_bound(node, key);
+
+    if ( node->leaf ) {
+        if ( slot == node->count || node->keys[slot] != key ) {
+            return 0;
+        }
+        RBT_BP_leaf_erase((struct RBT_BP_Leaf *) node, slot);
+        return 1;
+    }
+
+    struct RBT_BP_Inner *inner = (struct RBT_BP_Inner *) node;
+    for ( unsigned child = slot; child <= node->count; ++child ) {
+        if ( child > slot && node->keys[child - 1] != key ) {
+            break;
+        }
+        if ( RBT_BP_remove(tree, inner->children[child], key) ) {
+            RBT_BP_rebalance(tree, inner, child);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static inline struct RBT_BP_Node *RBT_BP_extreme(struct RBT_BP_Node *node, int dir) {
+    while ( !node->leaf ) {
+        node = ((struct RBT_BP_Inner *) node)->children[dir ? node->count : 0];
+    }
+    return node;
+}
+
+static inline int RBT_BP_get_extreme(struct RBT_BP_Tree *tree, int dir, uintmax_t *key, void **value) {
+    if ( tree->root == NULL ) {
+        return 0;
+    }
+    struct RBT_BP_Node *node = RBT_BP_extreme(tree->root, dir);
+    unsigned slot = dir ? node->count - 1 : 0;
+    if ( key ) {
+        *key = node->keys[slot];
+    }
+    if ( value ) {
+        *value = ((struct RBT_BP_Leaf *) node)->data[slot];
+    }
+    return 1;
+}
+
+
+/* --- INTERNAL FUNCTIONS --- */
+
+
+uintmax_t RBT_BP_count(struct RBT_BP_Tree *tree, uintmax_t key, uintmax_t limit) {
+    struct RBT_BP_Node *node = tree->root;
+    uintmax_t count = 0;
+
+    if ( node == NULL ) {
+        return 0;
+    }
+    key = RBT_KEYVALUE(key);
+    while ( !node->leaf ) {
+        node = ((struct RBT_BP_Inner *) node)->children[ RBT_BP_lower_bound(node, key) ];
+    }
+    // the run of equal keys starts in the leftmost leaf that may hold the key, and may span several leaves
+    struct RBT_BP_Leaf *leaf = (struct RBT_BP_Leaf *) node;
+    for ( unsigned slot = RBT_BP_lower_bound(node, key); leaf != NULL && count < limit; leaf = leaf->next, slot = 0 ) {
+        while ( slot < leaf->node.count && leaf->node.keys[slot] == key && count < limit ) {
+            count++;
+            slot++;
+        }
+        if ( slot < leaf->node.count ) {
+            break;
+        }
+    }
+    return count;
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_BP_init_tree(struct RBT_BP_Tree *tree) {
+    if ( !tree ) {
+        return 0;
+    }
+    tree->root = NULL;
+    tree->node_count = 0;
+    tree->height = 0;
+    tree->bytes = 0;
+    tree->slack = 0;
+    return 1;
+}
+
+void RBT_BP_deinit_tree(struct RBT_BP_Tree *tree, void (*freedata)(void *)) {
+    if ( tree->root != NULL ) {
+        RBT_BP_recursive_destroy(tree, tree->root, freedata);
+    }
+    RBT_BP_init_tree(tree);
+}
+
+void *RBT_BP_add(struct RBT_BP_Tree *tree, uintmax_t key, void *data) {
+    struct RBT_BP_Inner *path[RBT_BP_MAX_HEIGHT];
+    unsigned slots[RBT_BP_MAX_HEIGHT];
+    unsigned depth = 0;
+
+    key = RBT_KEYVALUE(key);
+    if ( tree->root == NULL ) {
+        struct RBT_BP_Leaf *leaf = RBT_BP_new_leaf(tree);
+        if ( !leaf ) {
+            return NULL;
+        }
+        tree->root = &leaf->node;
+        tree->height = 1;
+    }
+
+    struct RBT_BP_Node *node = tree->root;
+    while ( !node->leaf ) {
+        path[depth] = (struct RBT_BP_Inner *) node;
+        slots[depth] = RBT_BP_upper_bound(node, key);
+        node = path[depth]->children[slots[depth]];
+        depth++;
+    }
+
+    struct RBT_BP_Leaf *leaf = (struct RBT_BP_Leaf *) node;
+    unsigned slot = RBT_BP_upper_bound(node, key);
+    if ( node->count < RBT_BP_ORDER ) {
+        RBT_BP_leaf_insert(leaf, slot, key, data);
+        tree->node_count++;
+        return data;
+    }
+
+    // allocate every node the splits need before changing anything, so a failure leaves the tree intact
+    struct RBT_BP_Inner *spares[RBT_BP_MAX_HEIGHT];
+    unsigned spare_count = 0;
+    unsigned level = depth;
+    while ( level > 0 && path[level - 1]->node.count == RBT_BP_ORDER ) {
+        level--;
+    }
+    unsigned needed = depth - level + (level == 0);
+    struct RBT_BP_Leaf *right = RBT_BP_new_leaf(tree);
+    while ( right && spare_count < needed && (spares[spare_count] = RBT_BP_new_inner(tree)) != NULL ) {
+        spare_count++;
+    }
+    if ( !right || spare_count < needed ) {
+        while ( spare_count > 0 ) {
+            RBT_BP_free(tree, &spares[--spare_count]->node);
+        }
+        if ( right ) {
+            RBT_BP_free(tree, &right->node);
+        }
+        return NULL;
+    }
+
+    RBT_BP_leaf_split(leaf, right);
+    if ( slot <= RBT_BP_MINIMUM ) {
+        RBT_BP_leaf_insert(leaf, slot, key, data);
+    } else {
+        RBT_BP_leaf_insert(right, slot - RBT_BP_MINIMUM, key, data);
+    }
+    tree->node_count++;
+
+    uintmax_t separator = right->node.keys[0];
+    struct RBT_BP_Node *sibling = &right->node;
+    while ( depth > 0 ) {
+        depth--;
+        struct RBT_BP_Inner *parent = path[depth];
+        if ( parent->node.count < RBT_BP_ORDER ) {
+            RBT_BP_inner_insert(parent, slots[depth], separator, sibling);
+            return data;
+        }
+        struct RBT_BP_Inner *split = spares[--spare_count];
+        separator = RBT_BP_inner_split(parent, split, slots[depth], separator, sibling);
+        sibling = &split->node;
+    }
+
+    struct RBT_BP_Inner *root = spares[--spare_count];
+    root->node.keys[0] = separator;
+    root->node.count = 1;
+    root->children[0] = tree->root;
+    root->children[1] = sibling;
+    tree->root = &root->node;
+    tree->height++;
+    return data;
+}
+
+int RBT_BP_delete(struct RBT_BP_Tree *tree, uintmax_t key) {
+    if ( tree->root == NULL || !RBT_BP_remove(tree, tree->root, RBT_KEYVALUE(key)) ) {
+        return 0;
+    }
+    tree->node_count--;
+
+    struct RBT_BP_Node *root = tree->root;
+    if ( root->count == 0 ) {
+        tree->root = root->leaf ? NULL : ((struct RBT_BP_Inner *) root)->children[0];
+        tree->height--;
+        RBT_BP_free(tree, root);
+    }
+    return 1;
+}
+
+void *RBT_BP_find(struct RBT_BP_Tree *tree, uintmax_t key) {
+    struct RBT_BP_Node *node = tree->root;
+    if ( node == NULL ) {
+        return NULL;
+    }
+
+    key = RBT_KEYVALUE(key);
+    while ( !node->leaf ) {
+        node = ((struct RBT_BP_Inner *) node)->children[ RBT_BP_lower_bound(node, key) ];
+    }
+
+    // the leftmost leaf that may hold the key can end just before it
+    struct RBT_BP_Leaf *leaf = (struct RBT_BP_Leaf *) node;
+    unsigned slot = RBT_BP_lower_bound(node, key);
+    if ( slot == node->count ) {
+        leaf = leaf->next;
+        slot = 0;
+    }
+    if ( leaf == NULL || leaf->node.keys[slot] != key ) {
+        return NULL;
+    }
+    return leaf->data[slot];
+}
+
+int RBT_BP_get_maximum(struct RBT_BP_Tree *tree, uintmax_t *key, void **value) {
+    return RBT_BP_get_extreme(tree, 1, key, value);
+}
+
+int RBT_BP_get_minimum(struct RBT_BP_Tree *tree, uintmax_t *key, void **value) {
+    return RBT_BP_get_extreme(tree, 0, key, value);
+}
+
+int RBT_BP_for_each(struct RBT_BP_Tree *tree, int (*visit)(uintmax_t key, void *data, void *context), void *context) {
+    if ( tree->root == NULL ) {
+        return 1;
+    }
+    struct RBT_BP_Leaf *leaf = (struct RBT_BP_Leaf *) RBT_BP_extreme(tree->root, 0);
+    for ( ; leaf != NULL; leaf = leaf->next ) {
+        for ( unsigned i = 0; i < leaf->node.count; ++i ) {
+            if ( !visit(leaf->node.keys[i], leaf->data[i], context) ) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
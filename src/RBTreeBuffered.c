@@ -0,0 +1,236 @@
+/**
+ * Write buffered RBT tree
+ *
+ * The buffer is kept sorted by key, with the deletions of a key ahead of its additions, which
+ * is also the order the operations are merged in. A deletion only enters the buffer when there
+ * is no buffered addition of the key to cancel, so buffered deletions always target elements
+ * already in the tree.
+ **/
+#include "RBTree/RBTreeBuffered.h"
+#include <stdlib.h>
+#include <string.h>
+#include "RBMacros.h"
+#include "RBTreeInternal.h"
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+// index of the first buffered operation with a key not below the given key
+static inline size_t RBT_buffered_lower(struct RBT_Buffered_Tree *tree, uintmax_t key) {
+    size_t lo = 0, hi = tree->op_count;
+    while ( lo < hi ) {
+        size_t middle = lo + (hi - lo) / 2;
+        if ( tree->ops[middle].key < key ) {
+            lo = middle + 1;
+        } else {
+            hi = middle;
+        }
+    }
+    return lo;
+}
+
+static inline size_t RBT_buffered_upper(struct RBT_Buffered_Tree *tree, size_t lo, uintmax_t key) {
+    while ( lo < tree->op_count && tree->ops[lo].key == key ) {
+        lo++;
+    }
+    return lo;
+}
+
+static inline void RBT_buffered_insert_op(struct RBT_Buffered_Tree *tree, size_t index, uintmax_t key, void *data, int deletion) {
+    memmove(&tree->ops[index + 1], &tree->ops[index], (tree->op_count - index) * sizeof(struct RBT_Buffered_Op));
+    tree->ops[index].key = key;
+    tree->ops[index].data = data;
+    tree->ops[index].deletion = deletion;
+    tree->op_count++;
+}
+
+static inline void RBT_buffered_erase_op(struct RBT_Buffered_Tree *tree, size_t index) {
+    tree->op_count--;
+    memmove(&tree->ops[index], &tree->ops[index + 1], (tree->op_count - index) * sizeof(struct RBT_Buffered_Op));
+}
+
+// counts the live nodes with the given key, stopping once the limit is reached
+static uintmax_t RBT_count_nodes(struct RBT_Node *node, uintmax_t key, uintmax_t limit) {
+    uintmax_t count = 0;
+    while ( node != NULL && count < limit ) {
+        if ( key < RBT_KEYVALUE(node->key) ) {
+            node = node->left;
+        } else if ( key > RBT_KEYVALUE(node->key) ) {
+            node = node->right;
+        } else {
+            count += !RBT_IS_DEAD(node);
+            count += RBT_count_nodes(node->left, key, limit - count);
+            node = node->right;
+        }
+    }
+    return count;
+}
+
+// counts the elements of the tree with the given key, stopping once the limit is reached
+static uintmax_t RBT_count_key(struct RBT_Tree *tree, uintmax_t key, uintmax_t limit) {
+    uintmax_t count = 0;
+
+    if ( RBT_IS_BPLUS(tree) ) {
+        return RBT_BP_count(tree->extension->bplus, key, limit);
+    }
+    if ( !RBT_IS_INLINE(tree) ) {
+        return RBT_count_nodes(tree->root, key, limit);
+    }
+    for ( uintmax_t i = 0; i < tree->node_count && count < limit; ++i ) {
+        count += tree->extension->inline_keys[i] == key;
+    }
+    return count;
+}
+
+// whether nodes can be linked straight into the tree, with no option keeping track of them
+static inline int RBT_buffered_direct(struct RBT_Tree *tree) {
+    struct RBT_Extension *extension = tree->extension;
+
+    return tree->dead_count == 0 && (extension == NULL || (extension->memory_budget == 0 && extension->reserved == 0 &&
+        extension->capacity == NULL && extension->index == NULL && extension->filter == NULL &&
+        extension->trace == NULL && !extension->inline_entries && extension->bplus == NULL));
+}
+
+// adds through RBT_add, which does the bookkeeping of the options, and tells whether the addition is settled
+static int RBT_buffered_merge_add(struct RBT_Tree *tree, uintmax_t key, void *data) {
+    uintmax_t count = tree->node_count;
+    struct RBT_Capacity *capacity = RBT_OPTION(tree, capacity);
+    // at capacity an element is added in place of an evicted one, or turned away, which also settles it
+    int full = capacity != NULL && count >= capacity->limit;
+
+    RBT_add(tree, key, data);
+    return full ? tree->node_count == count : tree->node_count > count;
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_buffered_init_tree(struct RBT_Buffered_Tree *tree, size_t capacity) {
+    if ( tree == NULL || capacity == 0 ) {
+        return 0;
+    }
+    tree->ops = malloc( capacity * sizeof(struct RBT_Buffered_Op) );
+    if ( tree->ops == NULL ) {
+        return 0;
+    }
+    RBT_init_tree(&tree->tree);
+    tree->node_count = 0;
+    tree->op_count = 0;
+    tree->capacity = capacity;
+    return 1;
+}
+
+void RBT_buffered_deinit_tree(struct RBT_Buffered_Tree *tree, void (*freedata)(void *)) {
+    for ( size_t i = 0; freedata && i < tree->op_count; ++i ) {
+        if ( !tree->ops[i].deletion ) {
+            freedata(tree->ops[i].data);
+        }
+    }
+    RBT_deinit_tree(&tree->tree, freedata);
+    RBT_init_tree(&tree->tree);
+    free(tree->ops);
+    tree->ops = NULL;
+    tree->node_count = 0;
+    tree->op_count = 0;
+    tree->capacity = 0;
+}
+
+void *RBT_buffered_add(struct RBT_Buffered_Tree *tree, uintmax_t key, void *data) {
+    if ( tree->op_count == tree->capacity && !RBT_buffered_flush(tree) ) {
+        return NULL;
+    }
+    key = RBT_KEYVALUE(key);
+    size_t lo = RBT_buffered_lower(tree, key);
+    RBT_buffered_insert_op(tree, RBT_buffered_upper(tree, lo, key), key, data, 0);
+    tree->node_count++;
+    return data;
+}
+
+int RBT_buffered_delete(struct RBT_Buffered_Tree *tree, uintmax_t key) {
+    key = RBT_KEYVALUE(key);
+    size_t lo = RBT_buffered_lower(tree, key);
+    size_t hi = RBT_buffered_upper(tree, lo, key);
+
+    if ( hi > lo && !tree->ops[hi - 1].deletion ) {
+        RBT_buffered_erase_op(tree, hi - 1);
+        tree->node_count--;
+        return 1;
+    }
+    // every buffered operation on the key is a deletion of an element in the tree
+    if ( RBT_count_key(&tree->tree, key, hi - lo + 1) <= hi - lo ) {
+        return 0;
+    }
+    if ( tree->op_count == tree->capacity ) {
+        if ( !RBT_buffered_flush(tree) ) {
+            return 0;
+        }
+        hi = 0;
+    }
+    RBT_buffered_insert_op(tree, hi, key, NULL, 1);
+    tree->node_count--;
+    return 1;
+}
+
+void *RBT_buffered_find(struct RBT_Buffered_Tree *tree, uintmax_t key) {
+    key = RBT_KEYVALUE(key);
+    size_t lo = RBT_buffered_lower(tree, key);
+    size_t hi = RBT_buffered_upper(tree, lo, key);
+
+    if ( hi > lo && !tree->ops[hi - 1].deletion ) {
+        return tree->ops[hi - 1].data;
+    }
+    if ( hi > lo && RBT_count_key(&tree->tree, key, hi - lo + 1) <= hi - lo ) {
+        return NULL;
+    }
+    return RBT_find(&tree->tree, key);
+}
+
+int RBT_buffered_flush(struct RBT_Buffered_Tree *tree) {
+    struct RBT_Node *hint = NULL;
+    size_t merged;
+
+    for ( merged = 0; merged < tree->op_count; ++merged ) {
+        struct RBT_Buffered_Op *op = &tree->ops[merged];
+        if ( op->deletion ) {
+            // the deleted node might be the hint, or a purge might have relinked the tree
+            RBT_delete(&tree->tree, op->key);
+            hint = NULL;
+            continue;
+        }
+        if ( !RBT_buffered_direct(&tree->tree) ) {
+            if ( !RBT_buffered_merge_add(&tree->tree, op->key, op->data) ) {
+                break;
+            }
+            hint = NULL;
+            continue;
+        }
+        struct RBT_Node *node = RBT_allocate_node(&tree->tree, op->key, op->data);
+        if ( node == NULL ) {
+            break;
+        }
+        hint = RBT_insert_after(&tree->tree, hint, node);
+    }
+
+    tree->op_count -= merged;
+    memmove(tree->ops, &tree->ops[merged], tree->op_count * sizeof(struct RBT_Buffered_Op));
+    // a capacity can evict or turn away merged elements, so the count is taken from the tree again
+    tree->node_count = tree->tree.node_count;
+    for ( size_t i = 0; i < tree->op_count; ++i ) {
+        if ( tree->ops[i].deletion ) {
+            tree->node_count--;
+        } else {
+            tree->node_count++;
+        }
+    }
+    return tree->op_count == 0;
+}
+
+int RBT_buffered_get_maximum(struct RBT_Buffered_Tree *tree, uintmax_t *key, void **value) {
+    return RBT_buffered_flush(tree) && RBT_get_maximum(&tree->tree, key, value);
+}
+
+int RBT_buffered_get_minimum(struct RBT_Buffered_Tree *tree, uintmax_t *key, void **value) {
+    return RBT_buffered_flush(tree) && RBT_get_minimum(&tree->tree, key, value);
+}
@@ -0,0 +1,334 @@
+/**
+ * Concurrently written red-black tree
+ *
+ * Between rebalancing passes the tree only changes by new leaves being linked in, and by
+ * values being swapped for the tombstone and back. Every node above the spot an addition ends
+ * up at therefore stays where it is, so writers search without locks, and only lock the node
+ * they link the new leaf below, searching on if another writer linked a node there first.
+ *
+ * New nodes are red, so they keep the black heights intact, and the only violations they leave
+ * are red nodes below red parents. The rebalancing pass repairs them with the usual insertion
+ * fixup, one node at a time, in an order where every node comes after its pending ancestors:
+ * the repair of a node then only meets pending nodes as red uncles, which it may blacken, and
+ * the violations below it are left for the nodes further down the queue.
+ **/
+#include "RBTree/RBTreeConcurrent.h"
+#include <stdlib.h>
+#include "RBMacros.h"
+#include "RBTreeInternal.h"
+#include "RBTreeRebalance.h"
+
+#define RBT_LOAD(pointer) __atomic_load_n(pointer, __ATOMIC_ACQUIRE)
+#define RBT_STORE(pointer, value) __atomic_store_n(pointer, value, __ATOMIC_RELEASE)
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+static inline void RBT_spin_lock(unsigned *lock) {
+    while ( __atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) ) {
+        while ( __atomic_load_n(lock, __ATOMIC_RELAXED) ) {
+        }
+    }
+}
+
+static inline void RBT_spin_unlock(unsigned *lock) {
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+static inline struct RBT_Concurrent_Node *RBT_concurrent_new_node(uintmax_t key, void *data) {
+    struct RBT_Concurrent_Node *new_node = RBT_MALLOC( sizeof(struct RBT_Concurrent_Node) );
+    if ( !new_node ) {
+        return NULL;
+    }
+    new_node->key = key;
+    new_node->data = data;
+    new_node->left = NULL;
+    new_node->right = NULL;
+    new_node->parent = NULL;
+    new_node->pending = NULL;
+    new_node->lock = 0;
+    RBT_SET_RED(new_node);
+    return new_node;
+}
+
+static void RBT_concurrent_destroy(struct RBT_Concurrent_Node *node, void (*freedata)(void *)) {
+    while ( node != NULL ) {
+        struct RBT_Concurrent_Node *right = node->right;
+        RBT_concurrent_destroy(node->left, freedata);
+        if ( freedata && !RBT_IS_DEAD(node) ) {
+            freedata(node->data);
+        }
+        RBT_FREE(node);
+        node = right;
+    }
+}
+
+// the node is pushed before it is linked, so its children are always pushed after it
+static inline void RBT_push_pending(struct RBT_Concurrent_Tree *tree, struct RBT_Concurrent_Node *node) {
+    struct RBT_Concurrent_Node *head = __atomic_load_n(&tree->pending, __ATOMIC_RELAXED);
+    do {
+        node->pending = head;
+    } while ( !__atomic_compare_exchange_n(&tree->pending, &head, node, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED) );
+    RBT_COUNTER_ADD(tree->pending_count, 1);
+}
+
+static inline struct RBT_Concurrent_Node *RBT_concurrent_lookup(struct RBT_Concurrent_Tree *tree, uintmax_t key) {
+    struct RBT_Concurrent_Node *node = RBT_LOAD(&tree->root);
+
+    key = RBT_KEYVALUE(key);
+    while ( node != NULL && RBT_KEYVALUE(node->key) != key ) {
+        node = RBT_LOAD(key < RBT_KEYVALUE(node->key) ? &node->left : &node->right);
+    }
+    return node;
+}
+
+// rebalancing passes repair the pending nodes with the insertion fixup of the RBT tree
+RBT_GENERATE_REBALANCE_ROTATIONS(RBT_concurrent, struct RBT_Concurrent_Tree, struct RBT_Concurrent_Node, RBT_NOT_ROTATED)
+RBT_GENERATE_REBALANCE_INSERT(RBT_concurrent, struct RBT_Concurrent_Tree, struct RBT_Concurrent_Node)
+
+// unlinks the live nodes below node into an ascending list through their right pointers, freeing the dead ones
+static void RBT_concurrent_flatten_live(struct RBT_Concurrent_Node *node, struct RBT_Concurrent_Node **list) {
+    while ( node != NULL ) {
+        struct RBT_Concurrent_Node *left = node->left;
+        RBT_concurrent_flatten_live(node->right, list);
+        if ( RBT_IS_DEAD(node) ) {
+            RBT_FREE(node);
+        } else {
+            node->right = *list;
+            *list = node;
+        }
+        node = left;
+    }
+}
+
+// links the first count nodes of the list into a balanced subtree, red only on the incomplete bottom level
+static struct RBT_Concurrent_Node *RBT_concurrent_build(struct RBT_Concurrent_Node **list, uintmax_t count, unsigned depth, unsigned full_levels) {
+    if ( count == 0 ) {
+        return NULL;
+    }
+    struct RBT_Concurrent_Node *left = RBT_concurrent_build(list, count / 2, depth + 1, full_levels);
+    struct RBT_Concurrent_Node *node = *list;
+    *list = node->right;
+
+    node->parent = NULL;
+    node->left = left;
+    node->right = RBT_concurrent_build(list, count - count / 2 - 1, depth + 1, full_levels);
+    if ( node->left != NULL ) {
+        node->left->parent = node;
+    }
+    if ( node->right != NULL ) {
+        node->right->parent = node;
+    }
+    if ( depth >= full_levels ) {
+        RBT_SET_RED(node);
+    } else {
+        RBT_SET_BLACK(node);
+    }
+    return node;
+}
+
+// rebuilds the tree from its live nodes; the structure lock must be held exclusively
+static void RBT_concurrent_purge(struct RBT_Concurrent_Tree *tree) {
+    struct RBT_Concurrent_Node *list = NULL;
+    unsigned full_levels = 0;
+
+    RBT_concurrent_flatten_live(tree->root, &list);
+    while ( full_levels < 8 * sizeof(uintmax_t) - 1 && ((UINTMAX_C(2) << full_levels) - 1) <= tree->node_count ) {
+        full_levels++;
+    }
+    tree->root = RBT_concurrent_build(&list, tree->node_count, 0, full_levels);
+    __atomic_store_n(&tree->dead_count, 0, __ATOMIC_RELAXED);
+}
+
+static inline int RBT_concurrent_is_due(struct RBT_Concurrent_Tree *tree) {
+    uintmax_t dead = RBT_COUNTER_LOAD(tree->dead_count);
+    return tree->rebalance_threshold > 0 &&
+        (RBT_COUNTER_LOAD(tree->pending_count) >= tree->rebalance_threshold ||
+         (dead >= tree->rebalance_threshold && dead >= RBT_COUNTER_LOAD(tree->node_count)));
+}
+
+// runs a rebalancing pass once it is due, unless another writer is already running one
+static inline void RBT_concurrent_maintain(struct RBT_Concurrent_Tree *tree) {
+    if ( RBT_concurrent_is_due(tree) && !__atomic_exchange_n(&tree->rebalancing, 1, __ATOMIC_ACQUIRE) ) {
+        RBT_concurrent_rebalance(tree);
+        __atomic_store_n(&tree->rebalancing, 0, __ATOMIC_RELEASE);
+    }
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_concurrent_init_tree(struct RBT_Concurrent_Tree *tree, uintmax_t rebalance_threshold) {
+    if ( tree == NULL ) {
+        return 0;
+    }
+    if ( pthread_rwlock_init(&tree->structure_lock, NULL) != 0 ) {
+        return 0;
+    }
+    tree->root = NULL;
+    tree->pending = NULL;
+    tree->node_count = 0;
+    tree->dead_count = 0;
+    tree->pending_count = 0;
+    tree->rebalance_threshold = rebalance_threshold;
+    tree->root_lock = 0;
+    tree->rebalancing = 0;
+    return 1;
+}
+
+void RBT_concurrent_deinit_tree(struct RBT_Concurrent_Tree *tree, void (*freedata)(void *)) {
+    RBT_concurrent_destroy(tree->root, freedata);
+    tree->root = NULL;
+    tree->pending = NULL;
+    tree->node_count = 0;
+    tree->dead_count = 0;
+    tree->pending_count = 0;
+    pthread_rwlock_destroy(&tree->structure_lock);
+}
+
+void *RBT_concurrent_add(struct RBT_Concurrent_Tree *tree, uintmax_t key, void *data) {
+    struct RBT_Concurrent_Node **slot = &tree->root;
+    struct RBT_Concurrent_Node *parent = NULL;
+    struct RBT_Concurrent_Node *node = NULL;
+    unsigned *lock = &tree->root_lock;
+    void *added = NULL;
+
+    key = RBT_KEYVALUE(key);
+    pthread_rwlock_rdlock(&tree->structure_lock);
+    for ( ;; ) {
+        struct RBT_Concurrent_Node *current = RBT_LOAD(slot);
+        if ( current == NULL ) {
+            if ( node == NULL && (node = RBT_concurrent_new_node(key, data)) == NULL ) {
+                break;
+            }
+            RBT_spin_lock(lock);
+            if ( RBT_LOAD(slot) == NULL ) {
+                node->parent = parent;
+                RBT_push_pending(tree, node);
+                RBT_STORE(slot, node);
+                RBT_spin_unlock(lock);
+                RBT_COUNTER_ADD(tree->node_count, 1);
+                node = NULL;
+                added = data;
+                break;
+            }
+            // another writer linked a node here first, so the search goes on below it
+            RBT_spin_unlock(lock);
+            continue;
+        }
+        if ( key == RBT_KEYVALUE(current->key) ) {
+            void *expected = &RBT_tombstone;
+            if ( __atomic_compare_exchange_n(&current->data, &expected, data, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ) {
+                RBT_COUNTER_ADD(tree->node_count, 1);
+                RBT_COUNTER_SUB(tree->dead_count, 1);
+                added = data;
+            }
+            break;
+        }
+        parent = current;
+        lock = &current->lock;
+        slot = key < RBT_KEYVALUE(current->key) ? &current->left : &current->right;
+    }
+    pthread_rwlock_unlock(&tree->structure_lock);
+
+    RBT_FREE(node);
+    RBT_concurrent_maintain(tree);
+    return added;
+}
+
+int RBT_concurrent_delete(struct RBT_Concurrent_Tree *tree, uintmax_t key) {
+    int deleted = 0;
+
+    pthread_rwlock_rdlock(&tree->structure_lock);
+    struct RBT_Concurrent_Node *node = RBT_concurrent_lookup(tree, key);
+    if ( node != NULL ) {
+        void *data = RBT_LOAD(&node->data);
+        while ( data != &RBT_tombstone ) {
+            if ( __atomic_compare_exchange_n(&node->data, &data, (void *) &RBT_tombstone, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ) {
+                RBT_COUNTER_SUB(tree->node_count, 1);
+                RBT_COUNTER_ADD(tree->dead_count, 1);
+                deleted = 1;
+                break;
+            }
+        }
+    }
+    pthread_rwlock_unlock(&tree->structure_lock);
+
+    if ( deleted ) {
+        RBT_concurrent_maintain(tree);
+    }
+    return deleted;
+}
+
+void *RBT_concurrent_find(struct RBT_Concurrent_Tree *tree, uintmax_t key) {
+    void *found = NULL;
+
+    pthread_rwlock_rdlock(&tree->structure_lock);
+    struct RBT_Concurrent_Node *node = RBT_concurrent_lookup(tree, key);
+    if ( node != NULL ) {
+        found = RBT_LOAD(&node->data);
+        if ( found == &RBT_tombstone ) {
+            found = NULL;
+        }
+    }
+    pthread_rwlock_unlock(&tree->structure_lock);
+    return found;
+}
+
+void RBT_concurrent_rebalance(struct RBT_Concurrent_Tree *tree) {
+    struct RBT_Concurrent_Node *ordered = NULL;
+
+    pthread_rwlock_wrlock(&tree->structure_lock);
+    struct RBT_Concurrent_Node *pending = tree->pending;
+    tree->pending = NULL;
+    __atomic_store_n(&tree->pending_count, 0, __ATOMIC_RELAXED);
+
+    if ( tree->dead_count > 0 && tree->dead_count >= tree->node_count ) {
+        // the rebuilt tree is balanced, pending nodes included
+        RBT_concurrent_purge(tree);
+    } else {
+        // the queue holds the newest node first, while nodes must be repaired after their ancestors
+        while ( pending != NULL ) {
+            struct RBT_Concurrent_Node *next = pending->pending;
+            pending->pending = ordered;
+            ordered = pending;
+            pending = next;
+        }
+        for ( ; ordered != NULL; ordered = ordered->pending ) {
+            RBT_concurrent_insert_fixup(tree, ordered);
+        }
+    }
+    pthread_rwlock_unlock(&tree->structure_lock);
+}
+
+int RBT_concurrent_for_each(struct RBT_Concurrent_Tree *tree, int (*visit)(uintmax_t key, void *data, void *context), void *context) {
+    struct RBT_Concurrent_Node *node;
+    int completed = 1;
+
+    if ( tree == NULL || visit == NULL ) {
+        return 0;
+    }
+    pthread_rwlock_wrlock(&tree->structure_lock);
+    for ( node = tree->root; node != NULL && node->left != NULL; node = node->left );
+    while ( node != NULL && completed ) {
+        if ( !RBT_IS_DEAD(node) ) {
+            completed = visit(RBT_KEYVALUE(node->key), node->data, context);
+        }
+        if ( node->right != NULL ) {
+            for ( node = node->right; node->left != NULL; node = node->left );
+        } else {
+            while ( node->parent != NULL && node == node->parent->right ) {
+                node = node->parent;
+            }
+            node = node->parent;
+        }
+    }
+    pthread_rwlock_unlock(&tree->structure_lock);
+    return completed;
+}
+
+uintmax_t RBT_concurrent_node_count(struct RBT_Concurrent_Tree *tree) {
+    return RBT_COUNTER_LOAD(tree->node_count);
+}
@@ -0,0 +1,502 @@
+/**
+ * Durable red-black tree
+ *
+ * Log and checkpoint files both start with an 8 byte magic and the 64 bit generation
+ * they belong to, followed by records of:
+ *
+ *   u32 value size | u32 checksum | u8 operation | u64 key | value bytes
+ *
+ * with the checksum covering everything after it. Writing a checkpoint bumps the
+ * generation, so a log left over from before the checkpoint is never replayed on top
+ * of it, even if the process dies between renaming the checkpoint and restarting the log.
+ **/
+#define _POSIX_C_SOURCE 200809L
+#include "RBTree/RBTreeDurable.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#if defined(__APPLE__)
+#define fdatasync fsync
+#endif
+
+#define RBT_LOG_MAGIC "RBTLOG01"
+#define RBT_CHECKPOINT_MAGIC "RBTCKP01"
+#define RBT_FILE_HEADER_SIZE 16
+#define RBT_RECORD_HEADER_SIZE 17
+
+#define RBT_RECORD_ADD 1
+#define RBT_RECORD_DELETE 2
+
+// flush the batch early once it holds this many bytes, regardless of the group size
+#define RBT_BATCH_LIMIT (1 << 20)
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+// stored value, owned by the tree
+struct RBT_Durable_Value {
+    size_t size;
+    unsigned char bytes[];
+};
+
+struct RBT_Record {
+    unsigned char operation;
+    uintmax_t key;
+    struct RBT_Durable_Value *value;
+};
+
+static uint32_t RBT_checksum(const unsigned char *header, const void *value, size_t size) {
+    const unsigned char *bytes = value;
+    uint32_t hash = UINT32_C(2166136261);
+
+    // FNV-1a over the operation, key and value
+    for ( size_t i = 8; i < RBT_RECORD_HEADER_SIZE; ++i ) {
+        hash = (hash ^ header[i]) * UINT32_C(16777619);
+    }
+    for ( size_t i = 0; i < size; ++i ) {
+        hash = (hash ^ bytes[i]) * UINT32_C(16777619);
+    }
+    return hash;
+}
+
+static void RBT_encode_record(unsigned char *out, unsigned char operation, uintmax_t key, const void *value, size_t size) {
+    uint32_t size32 = (uint32_t) size;
+    uint64_t key64 = (uint64_t) key;
+
+    memcpy(out, &size32, 4);
+    out[8] = operation;
+    memcpy(out + 9, &key64, 8);
+    if ( size > 0 ) {
+        memcpy(out + RBT_RECORD_HEADER_SIZE, value, size);
+    }
+
+    uint32_t checksum = RBT_checksum(out, value, size);
+    memcpy(out + 4, &checksum, 4);
+}
+
+// reads the next record, returning zero at the end of the file or at the first torn or corrupt record
+static int RBT_read_record(FILE *file, struct RBT_Record *record) {
+    unsigned char header[RBT_RECORD_HEADER_SIZE];
+    uint32_t size, checksum;
+    uint64_t key;
+
+    if ( fread(header, 1, RBT_RECORD_HEADER_SIZE, file) != RBT_RECORD_HEADER_SIZE ) {
+        return 0;
+    }
+    memcpy(&size, header, 4);
+    memcpy(&checksum, header + 4, 4);
+    memcpy(&key, header + 9, 8);
+
+    struct RBT_Durable_Value *value = malloc( sizeof(struct RBT_Durable_Value) + size );
+    if ( value == NULL ) {
+        return 0;
+    }
+    value->size = size;
+    if ( fread(value->bytes, 1, size, file) != size || RBT_checksum(header, value->bytes, size) != checksum ) {
+        free(value);
+        return 0;
+    }
+    if ( header[8] != RBT_RECORD_ADD && header[8] != RBT_RECORD_DELETE ) {
+        free(value);
+        return 0;
+    }
+    record->operation = header[8];
+    record->key = key;
+    record->value = value;
+    return 1;
+}
+
+static void RBT_delete_value(struct RBT_Tree *tree, uintmax_t key) {
+    // RBT_find and RBT_delete descend to the same node, so this frees the deleted value
+    struct RBT_Durable_Value *value = RBT_find(tree, key);
+    RBT_delete(tree, key);
+    free(value);
+}
+
+// a record the tree turns away fails the recovery, as the tree would no longer match its files
+static int RBT_apply_record(struct RBT_Tree *tree, struct RBT_Record *record) {
+    if ( record->operation == RBT_RECORD_ADD ) {
+        if ( RBT_add(tree, record->key, record->value) == NULL ) {
+            free(record->value);
+            return 0;
+        }
+    } else {
+        RBT_delete_value(tree, record->key);
+        free(record->value);
+    }
+    return 1;
+}
+
+static int RBT_read_file_header(FILE *file, const char *magic, uintmax_t *generation) {
+    unsigned char header[RBT_FILE_HEADER_SIZE];
+    uint64_t generation64;
+
+    if ( fread(header, 1, RBT_FILE_HEADER_SIZE, file) != RBT_FILE_HEADER_SIZE || memcmp(header, magic, 8) != 0 ) {
+        return 0;
+    }
+    memcpy(&generation64, header + 8, 8);
+    *generation = generation64;
+    return 1;
+}
+
+static void RBT_encode_file_header(unsigned char *out, const char *magic, uintmax_t generation) {
+    uint64_t generation64 = generation;
+    memcpy(out, magic, 8);
+    memcpy(out + 8, &generation64, 8);
+}
+
+static int RBT_write_all(int fd, const void *buffer, size_t size) {
+    const unsigned char *bytes = buffer;
+    while ( size > 0 ) {
+        ssize_t written = write(fd, bytes, size);
+        if ( written < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return 0;
+        }
+        bytes += written;
+        size -= (size_t) written;
+    }
+    return 1;
+}
+
+static char *RBT_path_with_suffix(const char *path, const char *suffix) {
+    char *result = malloc( strlen(path) + strlen(suffix) + 1 );
+    if ( result != NULL ) {
+        strcpy(result, path);
+        strcat(result, suffix);
+    }
+    return result;
+}
+
+// syncs the directory holding the file, making a rename within it durable
+static void RBT_sync_directory(const char *path) {
+    const char *separator = strrchr(path, '/');
+    char *directory = separator == NULL ? RBT_path_with_suffix(".", "") : RBT_path_with_suffix(path, "");
+
+    if ( directory == NULL ) {
+        return;
+    }
+    if ( separator != NULL ) {
+        directory[separator == path ? 1 : separator - path] = '\0';
+    }
+    int fd = open(directory, O_RDONLY);
+    if ( fd >= 0 ) {
+        fsync(fd);
+        close(fd);
+    }
+    free(directory);
+}
+
+static int RBT_load_checkpoint(struct RBT_Durable_Tree *tree) {
+    FILE *file = fopen(tree->checkpoint_path, "rb");
+    struct RBT_Record record;
+    unsigned char count_bytes[8];
+    uint64_t count;
+
+    if ( file == NULL ) {
+        // no checkpoint has been written yet
+        tree->generation = 0;
+        return errno == ENOENT;
+    }
+    int loaded = RBT_read_file_header(file, RBT_CHECKPOINT_MAGIC, &tree->generation) &&
+        fread(count_bytes, 1, 8, file) == 8;
+
+    if ( loaded ) {
+        memcpy(&count, count_bytes, 8);
+        for ( uint64_t i = 0; i < count && loaded; ++i ) {
+            loaded = RBT_read_record(file, &record) && record.operation == RBT_RECORD_ADD;
+            if ( loaded ) {
+                loaded = RBT_apply_record(&tree->tree, &record);
+            }
+        }
+    }
+    fclose(file);
+    return loaded;
+}
+
+// replays the log of the current generation, setting "valid" to the size of its valid prefix
+static int RBT_replay_log(struct RBT_Durable_Tree *tree, uintmax_t *valid) {
+    FILE *file = fopen(tree->log_path, "rb");
+    struct RBT_Record record;
+    uintmax_t generation;
+    int applied = 1;
+
+    *valid = 0;
+    if ( file == NULL ) {
+        return 1;
+    }
+    if ( RBT_read_file_header(file, RBT_LOG_MAGIC, &generation) && generation == tree->generation ) {
+        *valid = RBT_FILE_HEADER_SIZE;
+        while ( applied && RBT_read_record(file, &record) ) {
+            applied = RBT_apply_record(&tree->tree, &record);
+            *valid = (uintmax_t) ftello(file);
+        }
+    }
+    fclose(file);
+    return applied;
+}
+
+static int RBT_restart_log(struct RBT_Durable_Tree *tree) {
+    unsigned char header[RBT_FILE_HEADER_SIZE];
+
+    RBT_encode_file_header(header, RBT_LOG_MAGIC, tree->generation);
+    if ( ftruncate(tree->log_fd, 0) != 0 || lseek(tree->log_fd, 0, SEEK_SET) != 0 ) {
+        return 0;
+    }
+    if ( !RBT_write_all(tree->log_fd, header, RBT_FILE_HEADER_SIZE) || fdatasync(tree->log_fd) != 0 ) {
+        return 0;
+    }
+    tree->log_size = RBT_FILE_HEADER_SIZE;
+    return 1;
+}
+
+// writes the pending batch to the log with a single fdatasync
+static int RBT_flush_batch(struct RBT_Durable_Tree *tree) {
+    if ( tree->failed ) {
+        return 0;
+    }
+    if ( tree->batch_size == 0 ) {
+        return 1;
+    }
+    if ( !RBT_write_all(tree->log_fd, tree->batch, tree->batch_size) || fdatasync(tree->log_fd) != 0 ) {
+        // cut off what made it to the file, or the retried batch would follow a torn record replay stops at
+        if ( ftruncate(tree->log_fd, (off_t) tree->log_size) != 0 ||
+             lseek(tree->log_fd, (off_t) tree->log_size, SEEK_SET) < 0 ) {
+            tree->failed = 1;
+        }
+        return 0;
+    }
+    tree->log_size += tree->batch_size;
+    tree->batch_size = 0;
+    tree->batch_count = 0;
+    return 1;
+}
+
+static int RBT_append_record(struct RBT_Durable_Tree *tree, unsigned char operation, uintmax_t key, const void *value, size_t size) {
+    size_t needed = tree->batch_size + RBT_RECORD_HEADER_SIZE + size;
+
+    if ( needed > tree->batch_capacity ) {
+        size_t capacity = tree->batch_capacity ? tree->batch_capacity : 4096;
+        while ( capacity < needed ) {
+            capacity *= 2;
+        }
+        unsigned char *batch = realloc( tree->batch, capacity );
+        if ( batch == NULL ) {
+            return 0;
+        }
+        tree->batch = batch;
+        tree->batch_capacity = capacity;
+    }
+    RBT_encode_record(tree->batch + tree->batch_size, operation, key, value, size);
+    tree->batch_size = needed;
+    tree->batch_count++;
+    return 1;
+}
+
+// group commit, called once the logged mutation is applied so a checkpoint includes it
+static int RBT_commit_if_due(struct RBT_Durable_Tree *tree) {
+    if ( tree->batch_count >= tree->group_size || tree->batch_size >= RBT_BATCH_LIMIT ) {
+        return RBT_durable_sync(tree);
+    }
+    return 1;
+}
+
+struct RBT_Checkpoint_Writer {
+    FILE *file;
+    unsigned char *buffer;
+    size_t capacity;
+};
+
+static int RBT_write_checkpoint_entry(uintmax_t key, void *data, void *context) {
+    struct RBT_Checkpoint_Writer *writer = context;
+    struct RBT_Durable_Value *value = data;
+    size_t size = RBT_RECORD_HEADER_SIZE + value->size;
+
+    if ( size > writer->capacity ) {
+        unsigned char *buffer = realloc( writer->buffer, size );
+        if ( buffer == NULL ) {
+            return 0;
+        }
+        writer->buffer = buffer;
+        writer->capacity = size;
+    }
+    RBT_encode_record(writer->buffer, RBT_RECORD_ADD, key, value->bytes, value->size);
+    return fwrite(writer->buffer, 1, size, writer->file) == size;
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_durable_open(struct RBT_Durable_Tree *tree, const char *path, size_t group_size, uintmax_t checkpoint_size) {
+    if ( tree == NULL || path == NULL ) {
+        return 0;
+    }
+    RBT_init_tree(&tree->tree);
+    tree->log_fd = -1;
+    tree->log_path = RBT_path_with_suffix(path, ".log");
+    tree->checkpoint_path = RBT_path_with_suffix(path, ".checkpoint");
+    tree->batch = NULL;
+    tree->batch_size = 0;
+    tree->batch_capacity = 0;
+    tree->batch_count = 0;
+    tree->group_size = group_size ? group_size : 1;
+    tree->checkpoint_size = checkpoint_size;
+    tree->failed = 0;
+
+    if ( tree->log_path == NULL || tree->checkpoint_path == NULL || !RBT_load_checkpoint(tree) ) {
+        RBT_durable_close(tree);
+        return 0;
+    }
+    uintmax_t valid;
+    if ( !RBT_replay_log(tree, &valid) ) {
+        RBT_durable_close(tree);
+        return 0;
+    }
+
+    tree->log_fd = open(tree->log_path, O_RDWR | O_CREAT, 0644);
+    if ( tree->log_fd < 0 ) {
+        RBT_durable_close(tree);
+        return 0;
+    }
+
+    // drop a torn tail, or restart a log that is missing or older than the checkpoint
+    if ( valid == 0 ) {
+        if ( !RBT_restart_log(tree) ) {
+            RBT_durable_close(tree);
+            return 0;
+        }
+    } else if ( ftruncate(tree->log_fd, (off_t) valid) != 0 || lseek(tree->log_fd, 0, SEEK_END) < 0 ) {
+        RBT_durable_close(tree);
+        return 0;
+    } else {
+        tree->log_size = valid;
+    }
+    return 1;
+}
+
+int RBT_durable_close(struct RBT_Durable_Tree *tree) {
+    int synced = 1;
+
+    if ( tree->log_fd >= 0 ) {
+        synced = RBT_flush_batch(tree);
+        close(tree->log_fd);
+        tree->log_fd = -1;
+    }
+    RBT_deinit_tree(&tree->tree, free);
+    RBT_init_tree(&tree->tree);
+    free(tree->batch);
+    free(tree->log_path);
+    free(tree->checkpoint_path);
+    tree->batch = NULL;
+    tree->log_path = NULL;
+    tree->checkpoint_path = NULL;
+    return synced;
+}
+
+int RBT_durable_add(struct RBT_Durable_Tree *tree, uintmax_t key, const void *value, size_t size) {
+    if ( tree->failed || size > UINT32_MAX || (value == NULL && size > 0) ) {
+        return 0;
+    }
+    struct RBT_Durable_Value *copy = malloc( sizeof(struct RBT_Durable_Value) + size );
+    if ( copy == NULL ) {
+        return 0;
+    }
+    copy->size = size;
+    if ( size > 0 ) {
+        memcpy(copy->bytes, value, size);
+    }
+    size_t batch_size = tree->batch_size;
+    size_t batch_count = tree->batch_count;
+    if ( !RBT_append_record(tree, RBT_RECORD_ADD, key, value, size) ) {
+        free(copy);
+        return 0;
+    }
+    // the record is only kept once the tree took the element, so the log never holds more than the tree
+    if ( RBT_add(&tree->tree, key, copy) == NULL ) {
+        tree->batch_size = batch_size;
+        tree->batch_count = batch_count;
+        free(copy);
+        return 0;
+    }
+    return RBT_commit_if_due(tree);
+}
+
+int RBT_durable_delete(struct RBT_Durable_Tree *tree, uintmax_t key) {
+    if ( tree->failed || RBT_find(&tree->tree, key) == NULL ) {
+        return 0;
+    }
+    if ( !RBT_append_record(tree, RBT_RECORD_DELETE, key, NULL, 0) ) {
+        return 0;
+    }
+    RBT_delete_value(&tree->tree, key);
+    return RBT_commit_if_due(tree);
+}
+
+const void *RBT_durable_find(struct RBT_Durable_Tree *tree, uintmax_t key, size_t *size) {
+    struct RBT_Durable_Value *value = RBT_find(&tree->tree, key);
+    if ( value == NULL ) {
+        return NULL;
+    }
+    if ( size ) {
+        *size = value->size;
+    }
+    return value->bytes;
+}
+
+int RBT_durable_sync(struct RBT_Durable_Tree *tree) {
+    if ( !RBT_flush_batch(tree) ) {
+        return 0;
+    }
+    if ( tree->checkpoint_size > 0 && tree->log_size > tree->checkpoint_size ) {
+        return RBT_durable_checkpoint(tree);
+    }
+    return 1;
+}
+
+int RBT_durable_checkpoint(struct RBT_Durable_Tree *tree) {
+    struct RBT_Checkpoint_Writer writer = { NULL, NULL, 0 };
+    unsigned char header[RBT_FILE_HEADER_SIZE];
+    uint64_t count = tree->tree.node_count;
+    char *temporary_path = RBT_path_with_suffix(tree->checkpoint_path, ".tmp");
+
+    if ( temporary_path == NULL || !RBT_flush_batch(tree) ) {
+        free(temporary_path);
+        return 0;
+    }
+    writer.file = fopen(temporary_path, "wb");
+    if ( writer.file == NULL ) {
+        free(temporary_path);
+        return 0;
+    }
+
+    RBT_encode_file_header(header, RBT_CHECKPOINT_MAGIC, tree->generation + 1);
+    int written = fwrite(header, 1, RBT_FILE_HEADER_SIZE, writer.file) == RBT_FILE_HEADER_SIZE &&
+        fwrite(&count, 1, 8, writer.file) == 8 &&
+        RBT_for_each(&tree->tree, RBT_write_checkpoint_entry, &writer) &&
+        fflush(writer.file) == 0 &&
+        fsync(fileno(writer.file)) == 0;
+
+    written = (fclose(writer.file) == 0) && written;
+    free(writer.buffer);
+
+    if ( !written || rename(temporary_path, tree->checkpoint_path) != 0 ) {
+        remove(temporary_path);
+        free(temporary_path);
+        return 0;
+    }
+    free(temporary_path);
+    RBT_sync_directory(tree->checkpoint_path);
+
+    // from here on the checkpoint holds everything, and the old log is ignored on recovery
+    tree->generation++;
+    return RBT_restart_log(tree);
+}
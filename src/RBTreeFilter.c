@@ -0,0 +1,127 @@
+/**
+ * Blocked Bloom filter in front of the tree
+ *
+ * Every key maps to one 64 byte block, aligned to a cache line, and sets one bit in each of
+ * the eight words of the block. A lookup therefore touches a single cache line, and with
+ * 16 bits per key a key that is not in the tree passes the filter well below 1% of the time.
+ *
+ * Bits cannot be cleared, so deleted keys keep passing until the filter is rebuilt. The tree
+ * rebuilds it from the live keys once as many keys have been added as it was sized for, or
+ * once half of the keys it was built from have been deleted, keeping both the false positive
+ * rate and the amortized cost of the rebuilds bounded.
+ **/
+#include "RBTree/RBTree.h"
+#include <stdlib.h>
+#include "RBMacros.h"
+#include "RBTreeInternal.h"
+
+#define RBT_FILTER_WORDS 8
+#define RBT_FILTER_BLOCK_BYTES (RBT_FILTER_WORDS * sizeof(uint64_t))
+#define RBT_FILTER_KEYS_PER_BLOCK 32
+#define RBT_FILTER_MINIMUM_KEYS 256
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+// finalizer of MurmurHash3
+static inline uint64_t RBT_filter_hash(uintmax_t key) {
+    uint64_t x = (uint64_t) key;
+    x ^= x >> 33;
+    x *= UINT64_C(0xff51afd7ed558ccd);
+    x ^= x >> 33;
+    x *= UINT64_C(0xc4ceb9fe1a85ec53);
+    x ^= x >> 33;
+    return x;
+}
+
+// the low hash bits pick the block, while a multiplicative rehash picks one bit in every word of it
+static inline uint64_t *RBT_filter_block(const struct RBT_Filter *filter, uint64_t hash) {
+    return filter->blocks + (size_t) (hash & filter->block_mask) * RBT_FILTER_WORDS;
+}
+
+static inline uint64_t RBT_filter_bit(uint64_t hash, unsigned word) {
+    uint64_t rehash = hash * UINT64_C(0x9e3779b97f4a7c15);
+    return UINT64_C(1) << ((rehash >> (16 + 6 * word)) & 63);
+}
+
+
+/* --- INTERNAL FUNCTIONS --- */
+
+
+int RBT_filter_create(struct RBT_Tree *tree, uintmax_t expected) {
+    struct RBT_Filter *filter;
+    uintmax_t capacity = RBT_FILTER_MINIMUM_KEYS;
+    size_t blocks;
+
+    if ( RBT_extend(tree) == NULL ) {
+        return 0;
+    }
+    filter = malloc( sizeof(struct RBT_Filter) );
+    if ( filter == NULL ) {
+        return 0;
+    }
+    // room for twice the expected keys, so a growing tree does not rebuild right away
+    while ( capacity < 2 * expected && capacity < (SIZE_MAX / RBT_FILTER_BLOCK_BYTES) / 2 ) {
+        capacity *= 2;
+    }
+    blocks = (size_t) (capacity / RBT_FILTER_KEYS_PER_BLOCK);
+
+    // one spare block to align the blocks to cache lines
+    filter->memory = calloc( blocks + 1, RBT_FILTER_BLOCK_BYTES );
+    if ( filter->memory == NULL ) {
+        free(filter);
+        return 0;
+    }
+    filter->blocks = (uint64_t *) (((uintptr_t) filter->memory + RBT_FILTER_BLOCK_BYTES - 1)
+        & ~((uintptr_t) RBT_FILTER_BLOCK_BYTES - 1));
+    filter->block_mask = blocks - 1;
+    filter->capacity = capacity;
+    filter->count = 0;
+    filter->stale = 0;
+    tree->extension->filter = filter;
+    RBT_account_auxiliary(RBT_filter_size(filter), 1);
+    return 1;
+}
+
+void RBT_filter_destroy(struct RBT_Tree *tree) {
+    struct RBT_Filter *filter = RBT_OPTION(tree, filter);
+
+    if ( filter != NULL ) {
+        RBT_account_auxiliary(RBT_filter_size(filter), 0);
+        free(filter->memory);
+        free(filter);
+        tree->extension->filter = NULL;
+    }
+}
+
+int RBT_filter_may_contain(const struct RBT_Filter *filter, uintmax_t key) {
+    uint64_t hash = RBT_filter_hash(RBT_KEYVALUE(key));
+    const uint64_t *block = RBT_filter_block(filter, hash);
+
+    for ( unsigned word = 0; word < RBT_FILTER_WORDS; ++word ) {
+        if ( (block[word] & RBT_filter_bit(hash, word)) == 0 ) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void RBT_filter_insert(struct RBT_Filter *filter, uintmax_t key) {
+    uint64_t hash = RBT_filter_hash(RBT_KEYVALUE(key));
+    uint64_t *block = RBT_filter_block(filter, hash);
+
+    for ( unsigned word = 0; word < RBT_FILTER_WORDS; ++word ) {
+        block[word] |= RBT_filter_bit(hash, word);
+    }
+    filter->count++;
+}
+
+int RBT_filter_is_due(const struct RBT_Filter *filter) {
+    return filter->count > filter->capacity ||
+        (filter->stale >= RBT_FILTER_MINIMUM_KEYS / 2 && 2 * filter->stale > filter->count);
+}
+
+size_t RBT_filter_size(const struct RBT_Filter *filter) {
+    return sizeof(struct RBT_Filter) + (filter->block_mask + 2) * RBT_FILTER_BLOCK_BYTES;
+}
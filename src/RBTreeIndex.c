@@ -0,0 +1,161 @@
+/**
+ * Hash side-index
+ *
+ * Open addressing table with linear probing from keys to tree nodes. The table holds one
+ * entry per distinct live key, pointing at any of the nodes carrying the key, and is kept
+ * at most half full. Erased entries are filled by shifting later entries of the probe
+ * sequence back, so lookups never have to skip deleted slots.
+ **/
+#include "RBTree/RBTree.h"
+#include <stdlib.h>
+#include "RBMacros.h"
+#include "RBTreeInternal.h"
+
+#define RBT_INDEX_MINIMUM_CAPACITY 16
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+// finalizer of MurmurHash3, spreading neighbouring keys over the whole table
+static inline size_t RBT_index_hash(uintmax_t key) {
+    uint64_t x = (uint64_t) key;
+    x ^= x >> 33;
+    x *= UINT64_C(0xff51afd7ed558ccd);
+    x ^= x >> 33;
+    x *= UINT64_C(0xc4ceb9fe1a85ec53);
+    x ^= x >> 33;
+    return (size_t) x;
+}
+
+static inline struct RBT_Index_Entry *RBT_index_probe(struct RBT_Hash_Index *index, uintmax_t key) {
+    size_t slot = RBT_index_hash(key) & index->mask;
+    while ( index->entries[slot].node != NULL && index->entries[slot].key != key ) {
+        slot = (slot + 1) & index->mask;
+    }
+    return &index->entries[slot];
+}
+
+static int RBT_index_resize(struct RBT_Hash_Index *index, size_t capacity) {
+    struct RBT_Index_Entry *entries = calloc( capacity, sizeof(struct RBT_Index_Entry) );
+    struct RBT_Index_Entry *old_entries = index->entries;
+    size_t old_capacity = index->mask + 1;
+
+    if ( entries == NULL ) {
+        return 0;
+    }
+    index->entries = entries;
+    index->mask = capacity - 1;
+    for ( size_t i = 0; old_entries != NULL && i < old_capacity; ++i ) {
+        if ( old_entries[i].node != NULL ) {
+            *RBT_index_probe(index, old_entries[i].key) = old_entries[i];
+        }
+    }
+    if ( old_entries != NULL ) {
+        RBT_account_auxiliary(old_capacity * sizeof(struct RBT_Index_Entry), 0);
+        free(old_entries);
+    }
+    RBT_account_auxiliary(capacity * sizeof(struct RBT_Index_Entry), 1);
+    return 1;
+}
+
+
+/* --- INTERNAL FUNCTIONS --- */
+
+
+int RBT_index_create(struct RBT_Tree *tree, uintmax_t expected) {
+    struct RBT_Hash_Index *index;
+    size_t capacity = RBT_INDEX_MINIMUM_CAPACITY;
+
+    if ( RBT_extend(tree) == NULL ) {
+        return 0;
+    }
+    index = malloc( sizeof(struct RBT_Hash_Index) );
+    if ( index == NULL ) {
+        return 0;
+    }
+    while ( capacity / 2 < expected ) {
+        capacity *= 2;
+    }
+    index->entries = NULL;
+    index->mask = 0;
+    index->count = 0;
+    if ( !RBT_index_resize(index, capacity) ) {
+        free(index);
+        return 0;
+    }
+    RBT_account_auxiliary(sizeof(struct RBT_Hash_Index), 1);
+    tree->extension->index = index;
+    return 1;
+}
+
+void RBT_index_destroy(struct RBT_Tree *tree) {
+    struct RBT_Hash_Index *index = RBT_OPTION(tree, index);
+
+    if ( index != NULL ) {
+        RBT_account_auxiliary(RBT_index_size(index), 0);
+        free(index->entries);
+        free(index);
+        tree->extension->index = NULL;
+    }
+}
+
+size_t RBT_index_size(const struct RBT_Hash_Index *index) {
+    return sizeof(struct RBT_Hash_Index) + (index->mask + 1) * sizeof(struct RBT_Index_Entry);
+}
+
+struct RBT_Node *RBT_index_find(struct RBT_Tree *tree, uintmax_t key) {
+    return RBT_index_probe(tree->extension->index, RBT_KEYVALUE(key))->node;
+}
+
+void RBT_index_insert(struct RBT_Tree *tree, struct RBT_Node *node) {
+    struct RBT_Hash_Index *index = tree->extension->index;
+    uintmax_t key = RBT_KEYVALUE(node->key);
+    struct RBT_Index_Entry *entry = RBT_index_probe(index, key);
+
+    if ( entry->node != NULL ) {
+        return;
+    }
+    if ( 2 * (index->count + 1) > index->mask + 1 ) {
+        // an incomplete index would answer wrongly, so it is dropped if it cannot grow
+        if ( !RBT_index_resize(index, 2 * (index->mask + 1)) ) {
+            RBT_index_destroy(tree);
+            return;
+        }
+        entry = RBT_index_probe(index, key);
+    }
+    entry->key = key;
+    entry->node = node;
+    index->count++;
+}
+
+void RBT_index_replace(struct RBT_Tree *tree, uintmax_t key, struct RBT_Node *node) {
+    struct RBT_Hash_Index *index = tree->extension->index;
+    struct RBT_Index_Entry *entry = RBT_index_probe(index, RBT_KEYVALUE(key));
+    size_t hole, slot;
+
+    if ( entry->node == NULL ) {
+        return;
+    }
+    if ( node != NULL ) {
+        entry->node = node;
+        return;
+    }
+
+    // backward shift deletion, moving every entry that can legally reach the hole into it
+    hole = (size_t) (entry - index->entries);
+    slot = hole;
+    index->count--;
+    for ( ;; ) {
+        slot = (slot + 1) & index->mask;
+        if ( index->entries[slot].node == NULL ) {
+            break;
+        }
+        size_t home = RBT_index_hash(index->entries[slot].key) & index->mask;
+        if ( ((slot - home) & index->mask) >= ((slot - hole) & index->mask) ) {
+            index->entries[hole] = index->entries[slot];
+            hole = slot;
+        }
+    }
+    index->entries[hole].node = NULL;
+}
@@ -0,0 +1,262 @@
+#ifndef _HEADER_FILE_RBTreeInternal_20261019154210_
+#define _HEADER_FILE_RBTreeInternal_20261019154210_
+
+/*
+ * Functions shared between the translation units of the library.
+ * These are not part of the public interface.
+ */
+
+#include "RBTree/RBTree.h"
+
+// stack storage for intermediate aggregates, aligned for any scalar aggregate member
+union RBT_Aggregate_Buffer {
+    uintmax_t integer;
+    long double floating;
+    void *pointer;
+    unsigned char bytes[RBT_AGGREGATE_MAX_SIZE];
+};
+
+// the data of nodes deleted from a tree using lazy deletion points at this marker
+extern char RBT_tombstone;
+
+#define RBT_IS_DEAD(node) ((node)->data == (void *) &RBT_tombstone)
+
+struct RBT_Index_Entry {
+    uintmax_t key;
+    struct RBT_Node *node;
+};
+
+// open addressing table from keys to one of the live nodes with the key, see RBTreeIndex.c
+struct RBT_Hash_Index {
+    struct RBT_Index_Entry *entries;
+    size_t mask;
+    size_t count;
+};
+
+// blocked Bloom filter of the keys added to a tree since it was built, see RBTreeFilter.c
+struct RBT_Filter {
+    void *memory;
+    uint64_t *blocks;
+    size_t block_mask;
+    uintmax_t capacity;
+    uintmax_t count;
+    uintmax_t stale;
+};
+
+// links of a node in the recency list of a tree evicting the least recent element
+struct RBT_Recency {
+    struct RBT_Node *newer;
+    struct RBT_Node *older;
+};
+
+// capacity bound of a tree, see RBT_set_capacity
+struct RBT_Capacity {
+    uintmax_t limit;
+    enum RBT_Eviction policy;
+    void (*evicted)(uintmax_t key, void *data, void *context);
+    void *context;
+    struct RBT_Node *newest;
+    struct RBT_Node *oldest;
+};
+
+// options rarely set on a tree, allocated along with the first of them, see RBT_extend
+struct RBT_Extension {
+    struct RBT_Hash_Index *index;
+    struct RBT_Capacity *capacity;
+    struct RBT_Filter *filter;
+    struct RBT_Trace *trace;
+    uintmax_t memory_budget;
+    struct RBT_Node *reserve;
+    uintmax_t reserved;
+    int inline_entries;
+    uintmax_t inline_keys[RBT_INLINE_CAPACITY];
+    void *inline_data[RBT_INLINE_CAPACITY];
+    struct RBT_BP_Tree *bplus;
+};
+
+// an option of a tree, or its default if the tree has no extension
+#define RBT_OPTION(tree, field) ((tree)->extension != NULL ? (tree)->extension->field : 0)
+
+/**
+ * Gives a tree its extension, if it has none yet, with every option in it off.
+ * @returns the extension of the tree, or NULL if allocation failed.
+ */
+struct RBT_Extension *RBT_extend(struct RBT_Tree *tree);
+
+// trees using the RBT_ENGINE_BPLUS engine keep their elements in the B+-tree of the extension
+#define RBT_IS_BPLUS(tree) (RBT_OPTION(tree, bplus) != NULL)
+
+// sequences keep subtree sizes as the aggregate of this built-in augmentation, see RBT_sequence_init
+extern const struct RBT_Augment RBT_sequence_augment;
+
+#define RBT_IS_SEQUENCE(tree) ((tree)->augment == &RBT_sequence_augment)
+
+struct RBT_BP_Tree;
+
+/**
+ * Counts the elements of a B+-tree with the given key, stopping once the limit is reached.
+ */
+uintmax_t RBT_BP_count(struct RBT_BP_Tree *tree, uintmax_t key, uintmax_t limit);
+
+#define RBT_IS_RECENCY_TRACKED(tree) \
+    (RBT_OPTION(tree, capacity) != NULL && (tree)->extension->capacity->policy == RBT_EVICT_LEAST_RECENT)
+
+// the recency links follow the aggregate, rounded up to keep the links aligned
+#define RBT_AUGMENT_SPACE(tree) \
+    ((tree)->augment ? ((tree)->augment->size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *) : 0)
+#define RBT_RECENCY_OF(tree, node) \
+    ((struct RBT_Recency *) ((unsigned char *) (node) + sizeof(struct RBT_Node) + RBT_AUGMENT_SPACE(tree)))
+
+/**
+ * Relinks the recency list of a tree evicting the least recent element through every live node,
+ * in ascending key order, and evicts down to the capacity of the tree if it has one. Used after
+ * the nodes of a tree have been linked or released by other means than the tree operations.
+ */
+void RBT_restore_capacity(struct RBT_Tree *tree);
+
+/**
+ * Colors a node linked by a balanced build as the root of a subtree of "count" nodes at "depth",
+ * with "full_levels" complete levels in the whole tree. Red-black trees get every level below the
+ * last complete one red, WAVL trees get the rank of every node set to the height of its subtree.
+ */
+void RBT_set_built_color(struct RBT_Tree *tree, struct RBT_Node *node, uintmax_t count, unsigned depth, unsigned full_levels);
+
+// trees with inline entries keep their elements in the extension while root is NULL
+#define RBT_IS_INLINE(tree) ((tree)->root == NULL && RBT_OPTION(tree, inline_entries))
+#define RBT_IS_EMPTY(tree) ((tree)->root == NULL && (tree)->node_count == 0)
+
+/**
+ * Moves the inline entries of a tree into nodes, leaving inline entries enabled.
+ * @returns a non-zero value on success, or if there was nothing to move, zero if allocation failed.
+ */
+int RBT_promote_inline(struct RBT_Tree *tree);
+
+/**
+ * Adds "count" nodes of the tree to the global memory usage, or removes them if "allocated" is zero,
+ * with "sample" being any one of them. Nodes are accounted for as they are linked into or leave
+ * the tree, so RBT_allocate_node and RBT_release_node leave the accounting to their callers.
+ */
+void RBT_account_nodes(struct RBT_Tree *tree, struct RBT_Node *sample, uintmax_t count, int allocated);
+
+/**
+ * Adds bytes of nodes, and their slack, to the global memory usage, or removes them if "allocated" is zero.
+ */
+void RBT_account_memory(uintmax_t bytes, uintmax_t slack, int allocated);
+
+/**
+ * Adds bytes of auxiliary structures to the global memory usage, or removes them if "allocated" is zero.
+ */
+void RBT_account_auxiliary(size_t bytes, int allocated);
+
+/**
+ * @returns the bytes held by a hash index.
+ */
+size_t RBT_index_size(const struct RBT_Hash_Index *index);
+
+/**
+ * @returns the bytes held by a lookup filter.
+ */
+size_t RBT_filter_size(const struct RBT_Filter *filter);
+
+/**
+ * Allocates a detached node sized for the given tree. The reserve of the tree is left alone,
+ * as parallel builds allocate from several threads at once.
+ * @returns the new node, or NULL if the allocation failed.
+ */
+struct RBT_Node *RBT_allocate_node(struct RBT_Tree *tree, uintmax_t key, void *data);
+
+/**
+ * Releases a detached node allocated for the given tree, calling freedata on its data if provided.
+ */
+void RBT_release_node(struct RBT_Tree *tree, struct RBT_Node *node, void (*freedata)(void *));
+
+/**
+ * Tells whether the memory budget of the tree, if any, leaves room for "count" more nodes, slack included.
+ * Reserved nodes are not drawn upon, so this suits callers allocating their nodes with RBT_allocate_node.
+ */
+int RBT_budget_allows(struct RBT_Tree *tree, uintmax_t count);
+
+/**
+ * Links a detached node into the tree, starting the search for its position from the
+ * previously inserted "hint" node, or the root if NULL. The key must not be smaller than
+ * the key of the hint, so inserting ascending keys only climbs as far as the next key.
+ * Nothing but the node count and memory accounting is updated, so the tree must not have a budget,
+ * reserve, capacity, hash index, lookup filter, trace, dead nodes, inline entries or B+-tree engine.
+ * @returns the inserted node.
+ */
+struct RBT_Node *RBT_insert_after(struct RBT_Tree *tree, struct RBT_Node *hint, struct RBT_Node *node);
+
+/**
+ * Moves every element with a key not below "key" into the empty tree "upper", in O(log n).
+ * Trees do not keep subtree sizes, so the caller passes the number of elements moved as "moved".
+ * Both trees must be red-black with the same augmentation, and without any other option set.
+ * @returns a non-zero value on success, zero if the trees cannot be split this way.
+ */
+int RBT_split_tree(struct RBT_Tree *tree, uintmax_t key, uintmax_t moved, struct RBT_Tree *upper);
+
+/**
+ * Moves every element of "upper", none of which has a key below any key of "tree", back into
+ * "tree" in O(log n), with the same requirements as RBT_split_tree.
+ * @returns a non-zero value on success, zero if the trees cannot be joined this way.
+ */
+int RBT_join_tree(struct RBT_Tree *tree, struct RBT_Tree *upper);
+
+/**
+ * Recomputes the aggregate of a single node of an augmented tree from its children.
+ */
+void RBT_update_aggregate(struct RBT_Tree *tree, struct RBT_Node *node);
+
+/**
+ * Allocates an empty hash index for the tree, sized for the expected number of keys.
+ * @returns a non-zero value on success, zero if the index could not be allocated.
+ */
+int RBT_index_create(struct RBT_Tree *tree, uintmax_t expected);
+
+/**
+ * Frees the hash index of the tree, if any.
+ */
+void RBT_index_destroy(struct RBT_Tree *tree);
+
+/**
+ * @returns the indexed node with the given key, if any, NULL otherwise.
+ */
+struct RBT_Node *RBT_index_find(struct RBT_Tree *tree, uintmax_t key);
+
+/**
+ * Indexes the node, unless its key is already indexed. The index is destroyed if it cannot grow.
+ */
+void RBT_index_insert(struct RBT_Tree *tree, struct RBT_Node *node);
+
+/**
+ * Points the entry of the key at another node carrying the key, or erases the entry if node is NULL.
+ */
+void RBT_index_replace(struct RBT_Tree *tree, uintmax_t key, struct RBT_Node *node);
+
+/**
+ * Allocates an empty lookup filter for the tree, sized for more than the expected number of keys.
+ * @returns a non-zero value on success, zero if the filter could not be allocated.
+ */
+int RBT_filter_create(struct RBT_Tree *tree, uintmax_t expected);
+
+/**
+ * Frees the lookup filter of the tree, if any.
+ */
+void RBT_filter_destroy(struct RBT_Tree *tree);
+
+/**
+ * @returns zero if the key was never added to the filter, a non-zero value if it may have been.
+ */
+int RBT_filter_may_contain(const struct RBT_Filter *filter, uintmax_t key);
+
+/**
+ * Adds a key to the filter.
+ */
+void RBT_filter_insert(struct RBT_Filter *filter, uintmax_t key);
+
+/**
+ * @returns a non-zero value once the filter has taken more keys than it was sized for, or enough
+ * of its keys have been deleted, that it should be rebuilt from the live keys of the tree.
+ */
+int RBT_filter_is_due(const struct RBT_Filter *filter);
+
+#endif
@@ -0,0 +1,410 @@
+/**
+ * Memory-mapped red-black tree
+ *
+ * The file starts with a header holding the magic, root offset, node count and allocator
+ * state, in native byte order. Offset zero lies within the header, so it doubles as NULL.
+ *
+ * Blocks are handed out by size class: multiples of 16 bytes up to 256 bytes, and powers
+ * of two above. Freed blocks are pushed onto a free list per class, linked through their
+ * first 8 bytes, and new blocks are carved from the end of the used space, doubling the
+ * file whenever it runs out. Doubling remaps the file, possibly to another address, so
+ * every block an operation needs is allocated before any node pointer is computed.
+ *
+ * Rebalancing is done top-down as in RBTreeTopDown.c, so nodes carry no parent offset.
+ **/
+#define _POSIX_C_SOURCE 200809L
+#include "RBTree/RBTreeMapped.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "RBMacros.h"
+
+#define RBT_MAPPED_MAGIC "RBTMAP01"
+#define RBT_MAPPED_CLASSES 64
+#define RBT_MAPPED_SMALL_CLASSES 16
+#define RBT_MAPPED_INITIAL_SIZE (64 * 1024)
+#define RBT_MAPPED_DATA_START ((sizeof(struct RBT_Mapped_Header) + 63) & ~(size_t) 63)
+
+#define RBT_MAPPED_HEADER(tree) ((struct RBT_Mapped_Header *) (tree)->base)
+#define RBT_MAPPED_NODE(tree, offset) ((offset) ? (struct RBT_Mapped_Node *) ((tree)->base + (offset)) : NULL)
+#define RBT_MAPPED_OFFSET(tree, node) ((node) ? (uint64_t) ((unsigned char *) (node) - (tree)->base) : 0)
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+struct RBT_Mapped_Header {
+    char magic[8];
+    uint64_t root;
+    uint64_t node_count;
+    uint64_t used;
+    uint64_t free_lists[RBT_MAPPED_CLASSES];
+};
+
+// link[0] is the left and link[1] the right sub node, coloring is kept in the key as for struct RBT_Node
+struct RBT_Mapped_Node {
+    uint64_t key;
+    uint64_t value;
+    uint64_t size;
+    uint64_t link[2];
+};
+
+static inline unsigned RBT_mapped_class(uint64_t size) {
+    if ( size <= 16 * RBT_MAPPED_SMALL_CLASSES ) {
+        return size == 0 ? 0 : (unsigned) ((size + 15) / 16 - 1);
+    }
+    unsigned size_class = RBT_MAPPED_SMALL_CLASSES;
+    while ( ((uint64_t) 512 << (size_class - RBT_MAPPED_SMALL_CLASSES)) < size ) {
+        size_class++;
+    }
+    return size_class;
+}
+
+static inline uint64_t RBT_mapped_class_size(unsigned size_class) {
+    if ( size_class < RBT_MAPPED_SMALL_CLASSES ) {
+        return 16 * (uint64_t) (size_class + 1);
+    }
+    return (uint64_t) 512 << (size_class - RBT_MAPPED_SMALL_CLASSES);
+}
+
+static int RBT_mapped_map(struct RBT_Mapped_Tree *tree, size_t size) {
+    int protection = tree->read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    void *base = mmap(NULL, size, protection, MAP_SHARED, tree->fd, 0);
+
+    if ( base == MAP_FAILED ) {
+        return 0;
+    }
+    if ( tree->base != NULL ) {
+        munmap(tree->base, tree->mapped_size);
+    }
+    tree->base = base;
+    tree->mapped_size = size;
+    return 1;
+}
+
+static int RBT_mapped_grow(struct RBT_Mapped_Tree *tree, uint64_t needed) {
+    size_t size = tree->mapped_size;
+    while ( size < needed ) {
+        size *= 2;
+    }
+    if ( ftruncate(tree->fd, (off_t) size) != 0 ) {
+        return 0;
+    }
+    return RBT_mapped_map(tree, size);
+}
+
+// returns the offset of a block of at least size bytes, or zero if the file could not grow
+static uint64_t RBT_mapped_allocate(struct RBT_Mapped_Tree *tree, uint64_t size) {
+    unsigned size_class = RBT_mapped_class(size);
+    uint64_t block = RBT_mapped_class_size(size_class);
+    uint64_t offset = RBT_MAPPED_HEADER(tree)->free_lists[size_class];
+
+    if ( offset != 0 ) {
+        memcpy(&RBT_MAPPED_HEADER(tree)->free_lists[size_class], tree->base + offset, sizeof(uint64_t));
+        return offset;
+    }
+    if ( RBT_MAPPED_HEADER(tree)->used + block > tree->mapped_size && !RBT_mapped_grow(tree, RBT_MAPPED_HEADER(tree)->used + block) ) {
+        return 0;
+    }
+    offset = RBT_MAPPED_HEADER(tree)->used;
+    RBT_MAPPED_HEADER(tree)->used += block;
+    return offset;
+}
+
+static void RBT_mapped_release(struct RBT_Mapped_Tree *tree, uint64_t offset, uint64_t size) {
+    unsigned size_class = RBT_mapped_class(size);
+    memcpy(tree->base + offset, &RBT_MAPPED_HEADER(tree)->free_lists[size_class], sizeof(uint64_t));
+    RBT_MAPPED_HEADER(tree)->free_lists[size_class] = offset;
+}
+
+static inline struct RBT_Mapped_Node *RBT_mapped_child(struct RBT_Mapped_Tree *tree, struct RBT_Mapped_Node *node, int dir) {
+    return RBT_MAPPED_NODE(tree, node->link[dir]);
+}
+
+// rotates the child opposite to dir up, coloring the old root red and the new root black
+static inline struct RBT_Mapped_Node *RBT_mapped_single_rotate(struct RBT_Mapped_Tree *tree, struct RBT_Mapped_Node *root, int dir) {
+    struct RBT_Mapped_Node *save = RBT_mapped_child(tree, root, !dir);
+
+    root->link[!dir] = save->link[dir];
+    save->link[dir] = RBT_MAPPED_OFFSET(tree, root);
+
+    RBT_SET_RED(root);
+    RBT_SET_BLACK(save);
+    return save;
+}
+
+static inline struct RBT_Mapped_Node *RBT_mapped_double_rotate(struct RBT_Mapped_Tree *tree, struct RBT_Mapped_Node *root, int dir) {
+    struct RBT_Mapped_Node *child = RBT_mapped_single_rotate(tree, RBT_mapped_child(tree, root, !dir), !dir);
+    root->link[!dir] = RBT_MAPPED_OFFSET(tree, child);
+    return RBT_mapped_single_rotate(tree, root, dir);
+}
+
+static inline int RBT_mapped_get_extreme(struct RBT_Mapped_Tree *tree, int dir, uintmax_t *key, const void **value, size_t *size) {
+    struct RBT_Mapped_Node *node = RBT_MAPPED_NODE(tree, RBT_MAPPED_HEADER(tree)->root);
+    if ( node == NULL ) {
+        return 0;
+    }
+    while ( node->link[dir] != 0 ) {
+        node = RBT_mapped_child(tree, node, dir);
+    }
+    if ( key ) {
+        *key = RBT_KEYVALUE(node->key);
+    }
+    if ( value ) {
+        *value = tree->base + node->value;
+    }
+    if ( size ) {
+        *size = (size_t) node->size;
+    }
+    return 1;
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_mapped_open(struct RBT_Mapped_Tree *tree, const char *path, int read_only) {
+    struct stat status;
+
+    tree->base = NULL;
+    tree->mapped_size = 0;
+    tree->read_only = read_only;
+    tree->fd = open(path, read_only ? O_RDONLY : O_RDWR | O_CREAT, 0644);
+    if ( tree->fd < 0 ) {
+        return 0;
+    }
+    if ( fstat(tree->fd, &status) != 0 ) {
+        close(tree->fd);
+        return 0;
+    }
+
+    if ( status.st_size == 0 && !read_only ) {
+        if ( ftruncate(tree->fd, RBT_MAPPED_INITIAL_SIZE) != 0 || !RBT_mapped_map(tree, RBT_MAPPED_INITIAL_SIZE) ) {
+            close(tree->fd);
+            return 0;
+        }
+        memset(tree->base, 0, RBT_MAPPED_DATA_START);
+        memcpy(RBT_MAPPED_HEADER(tree)->magic, RBT_MAPPED_MAGIC, 8);
+        RBT_MAPPED_HEADER(tree)->used = RBT_MAPPED_DATA_START;
+        return 1;
+    }
+
+    if ( (size_t) status.st_size < RBT_MAPPED_DATA_START || !RBT_mapped_map(tree, (size_t) status.st_size) ) {
+        close(tree->fd);
+        return 0;
+    }
+    if ( memcmp(RBT_MAPPED_HEADER(tree)->magic, RBT_MAPPED_MAGIC, 8) != 0 || RBT_MAPPED_HEADER(tree)->used > tree->mapped_size ) {
+        munmap(tree->base, tree->mapped_size);
+        close(tree->fd);
+        return 0;
+    }
+    return 1;
+}
+
+int RBT_mapped_close(struct RBT_Mapped_Tree *tree) {
+    int synced = tree->read_only || RBT_mapped_sync(tree);
+    munmap(tree->base, tree->mapped_size);
+    close(tree->fd);
+    tree->base = NULL;
+    tree->mapped_size = 0;
+    tree->fd = -1;
+    return synced;
+}
+
+int RBT_mapped_add(struct RBT_Mapped_Tree *tree, uintmax_t key, const void *value, size_t size) {
+    if ( tree->read_only ) {
+        return 0;
+    }
+
+    // allocate before taking any node pointers, as growing the file moves the mapping
+    uint64_t node_offset = RBT_mapped_allocate(tree, sizeof(struct RBT_Mapped_Node));
+    if ( node_offset == 0 ) {
+        return 0;
+    }
+    uint64_t value_offset = RBT_mapped_allocate(tree, size);
+    if ( value_offset == 0 ) {
+        RBT_mapped_release(tree, node_offset, sizeof(struct RBT_Mapped_Node));
+        return 0;
+    }
+    memcpy(tree->base + value_offset, value, size);
+
+    struct RBT_Mapped_Header *header = RBT_MAPPED_HEADER(tree);
+    struct RBT_Mapped_Node *node = RBT_MAPPED_NODE(tree, node_offset);
+    node->key = RBT_KEYVALUE(key);
+    node->value = value_offset;
+    node->size = size;
+    node->link[0] = 0;
+    node->link[1] = 0;
+    header->node_count++;
+
+    if ( header->root == 0 ) {
+        header->root = node_offset;
+        return 1;
+    }
+    RBT_SET_RED(node);
+
+    struct RBT_Mapped_Node head = { 0, 0, 0, { 0, header->root } };
+    struct RBT_Mapped_Node *great = &head;     // great-grandparent
+    struct RBT_Mapped_Node *grand = NULL;
+    struct RBT_Mapped_Node *parent = NULL;
+    struct RBT_Mapped_Node *iterator = RBT_MAPPED_NODE(tree, header->root);
+    int dir = 0;
+    int last = 0;
+
+    for (;;) {
+        if ( iterator == NULL ) {
+            parent->link[dir] = node_offset;
+            iterator = node;
+        } else if ( RBT_IS_RED( RBT_mapped_child(tree, iterator, 0) ) && RBT_IS_RED( RBT_mapped_child(tree, iterator, 1) ) ) {
+            // split the 4-node on the way down
+            RBT_SET_RED( iterator );
+            RBT_SET_BLACK( RBT_mapped_child(tree, iterator, 0) );
+            RBT_SET_BLACK( RBT_mapped_child(tree, iterator, 1) );
+        }
+
+        if ( RBT_IS_RED( iterator ) && RBT_IS_RED( parent ) ) {
+            int dir2 = great->link[1] == RBT_MAPPED_OFFSET(tree, grand);
+            struct RBT_Mapped_Node *rotated;
+            if ( iterator == RBT_mapped_child(tree, parent, last) ) {
+                rotated = RBT_mapped_single_rotate(tree, grand, !last);
+            } else {
+                rotated = RBT_mapped_double_rotate(tree, grand, !last);
+            }
+            great->link[dir2] = RBT_MAPPED_OFFSET(tree, rotated);
+        }
+
+        if ( iterator == node ) {
+            break;
+        }
+
+        // equal keys are placed to the right, as in RBT_insert
+        last = dir;
+        dir = RBT_KEYVALUE(iterator->key) <= RBT_KEYVALUE(key);
+
+        if ( grand != NULL ) {
+            great = grand;
+        }
+        grand = parent;
+        parent = iterator;
+        iterator = RBT_mapped_child(tree, iterator, dir);
+    }
+
+    header->root = head.link[1];
+    RBT_SET_BLACK( RBT_MAPPED_NODE(tree, header->root) );
+    return 1;
+}
+
+int RBT_mapped_delete(struct RBT_Mapped_Tree *tree, uintmax_t key) {
+    struct RBT_Mapped_Header *header = RBT_MAPPED_HEADER(tree);
+    if ( tree->read_only || header->root == 0 ) {
+        return 0;
+    }
+
+    struct RBT_Mapped_Node head = { 0, 0, 0, { 0, header->root } };
+    struct RBT_Mapped_Node *iterator = &head;
+    struct RBT_Mapped_Node *grand = NULL;
+    struct RBT_Mapped_Node *parent = NULL;
+    struct RBT_Mapped_Node *found = NULL;
+    int dir = 1;
+
+    key = RBT_KEYVALUE(key);
+    while ( iterator->link[dir] != 0 ) {
+        int last = dir;
+
+        grand = parent;
+        parent = iterator;
+        iterator = RBT_mapped_child(tree, iterator, dir);
+
+        // on a match, keep descending towards the in-order predecessor, which takes its place
+        dir = RBT_KEYVALUE(iterator->key) < key;
+        if ( RBT_KEYVALUE(iterator->key) == key ) {
+            found = iterator;
+        }
+
+        // push a red node down, so the node finally unlinked is red
+        if ( RBT_IS_BLACK( iterator ) && RBT_IS_BLACK( RBT_mapped_child(tree, iterator, dir) ) ) {
+            if ( RBT_IS_RED( RBT_mapped_child(tree, iterator, !dir) ) ) {
+                struct RBT_Mapped_Node *rotated = RBT_mapped_single_rotate(tree, iterator, dir);
+                parent->link[last] = RBT_MAPPED_OFFSET(tree, rotated);
+                parent = rotated;
+            } else {
+                struct RBT_Mapped_Node *sibling = RBT_mapped_child(tree, parent, !last);
+
+                if ( sibling == NULL ) {
+                    continue;
+                }
+                if ( RBT_IS_BLACK( RBT_mapped_child(tree, sibling, !last) ) && RBT_IS_BLACK( RBT_mapped_child(tree, sibling, last) ) ) {
+                    RBT_SET_BLACK( parent );
+                    RBT_SET_RED( sibling );
+                    RBT_SET_RED( iterator );
+                } else {
+                    int dir2 = grand->link[1] == RBT_MAPPED_OFFSET(tree, parent);
+                    struct RBT_Mapped_Node *rotated;
+
+                    if ( RBT_IS_RED( RBT_mapped_child(tree, sibling, last) ) ) {
+                        rotated = RBT_mapped_double_rotate(tree, parent, last);
+                    } else {
+                        rotated = RBT_mapped_single_rotate(tree, parent, last);
+                    }
+                    grand->link[dir2] = RBT_MAPPED_OFFSET(tree, rotated);
+                    RBT_SET_RED( iterator );
+                    RBT_SET_RED( rotated );
+                    RBT_SET_BLACK( RBT_mapped_child(tree, rotated, 0) );
+                    RBT_SET_BLACK( RBT_mapped_child(tree, rotated, 1) );
+                }
+            }
+        }
+    }
+
+    if ( found != NULL ) {
+        // the found node keeps its color, but takes the key and value of the unlinked node
+        RBT_mapped_release(tree, found->value, found->size);
+        found->key = (found->key & RBT_COLOR_BITMASK) | RBT_KEYVALUE(iterator->key);
+        found->value = iterator->value;
+        found->size = iterator->size;
+        parent->link[ parent->link[1] == RBT_MAPPED_OFFSET(tree, iterator) ] = iterator->link[ iterator->link[0] == 0 ];
+        RBT_mapped_release(tree, RBT_MAPPED_OFFSET(tree, iterator), sizeof(struct RBT_Mapped_Node));
+        header->node_count--;
+    }
+
+    header->root = head.link[1];
+    if ( header->root != 0 ) {
+        RBT_SET_BLACK( RBT_MAPPED_NODE(tree, header->root) );
+    }
+    return found != NULL;
+}
+
+const void *RBT_mapped_find(struct RBT_Mapped_Tree *tree, uintmax_t key, size_t *size) {
+    struct RBT_Mapped_Node *node = RBT_MAPPED_NODE(tree, RBT_MAPPED_HEADER(tree)->root);
+
+    key = RBT_KEYVALUE(key);
+    while ( node != NULL && RBT_KEYVALUE(node->key) != key ) {
+        node = RBT_mapped_child(tree, node, RBT_KEYVALUE(node->key) < key);
+    }
+    if ( node == NULL ) {
+        return NULL;
+    }
+    if ( size ) {
+        *size = (size_t) node->size;
+    }
+    return tree->base + node->value;
+}
+
+int RBT_mapped_get_maximum(struct RBT_Mapped_Tree *tree, uintmax_t *key, const void **value, size_t *size) {
+    return RBT_mapped_get_extreme(tree, 1, key, value, size);
+}
+
+int RBT_mapped_get_minimum(struct RBT_Mapped_Tree *tree, uintmax_t *key, const void **value, size_t *size) {
+    return RBT_mapped_get_extreme(tree, 0, key, value, size);
+}
+
+uintmax_t RBT_mapped_node_count(struct RBT_Mapped_Tree *tree) {
+    return RBT_MAPPED_HEADER(tree)->node_count;
+}
+
+int RBT_mapped_sync(struct RBT_Mapped_Tree *tree) {
+    return msync(tree->base, tree->mapped_size, MS_SYNC) == 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * Merkle hashed red-black tree
+ *
+ * A range of elements e1 .. ek in key order hashes to
+ *
+ *   h(e1) * B^(k-1) + h(e2) * B^(k-2) + ... + h(ek)   mod 2^61 - 1
+ *
+ * Carrying B^k next to the hash lets two adjacent ranges be combined as
+ * (left.hash * right.power + right.hash, left.power * right.power), which is associative
+ * with (0, 1) as identity, as the augmentation requires.
+ **/
+#include "RBTree/RBTreeMerkle.h"
+#include <stdlib.h>
+#include "RBMacros.h"
+
+#define RBT_MERKLE_PRIME ((UINT64_C(1) << 61) - 1)
+#define RBT_MERKLE_BASE UINT64_C(0x1d8e4e27c47d124f)
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+static const struct RBT_Merkle_Hash RBT_merkle_identity = { 0, 1 };
+
+static inline uint64_t RBT_merkle_reduce(uint64_t x) {
+    x = (x & RBT_MERKLE_PRIME) + (x >> 61);
+    return x >= RBT_MERKLE_PRIME ? x - RBT_MERKLE_PRIME : x;
+}
+
+// product modulo 2^61 - 1 of two reduced operands, from 32 bit halves as 2^61 is congruent to 1
+static inline uint64_t RBT_merkle_multiply(uint64_t a, uint64_t b) {
+    uint64_t a_high = a >> 32, a_low = a & UINT32_MAX;
+    uint64_t b_high = b >> 32, b_low = b & UINT32_MAX;
+    uint64_t high = a_high * b_high;
+    uint64_t middle = a_high * b_low + a_low * b_high;
+    uint64_t low = a_low * b_low;
+
+    uint64_t sum = (high << 3) + (middle >> 29) + ((middle & ((UINT64_C(1) << 29) - 1)) << 32)
+        + (low >> 61) + (low & RBT_MERKLE_PRIME);
+    return RBT_merkle_reduce(sum);
+}
+
+// finalizer of splitmix64
+static inline uint64_t RBT_merkle_mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return x ^ (x >> 31);
+}
+
+static void RBT_merkle_lift(void *out, uintmax_t key, void *data, void *context) {
+    struct RBT_Merkle *merkle = context;
+    struct RBT_Merkle_Hash *aggregate = out;
+    uint64_t value = merkle->hash_value ? merkle->hash_value(data, merkle->context) : 0;
+
+    aggregate->hash = RBT_merkle_mix((uint64_t) key ^ RBT_merkle_mix(value + RBT_MERKLE_BASE)) % RBT_MERKLE_PRIME;
+    aggregate->power = RBT_MERKLE_BASE % RBT_MERKLE_PRIME;
+}
+
+static void RBT_merkle_combine(void *out, const void *left, const void *right, void *context) {
+    const struct RBT_Merkle_Hash *a = left, *b = right;
+    struct RBT_Merkle_Hash *aggregate = out;
+    (void) context;
+
+    aggregate->hash = RBT_merkle_reduce(RBT_merkle_multiply(a->hash, b->power) + b->hash);
+    aggregate->power = RBT_merkle_multiply(a->power, b->power);
+}
+
+// topmost node with a key in the closed range, splitting the range roughly where the tree does
+static inline struct RBT_Node *RBT_merkle_split(struct RBT_Tree *tree, uintmax_t lo, uintmax_t hi) {
+    struct RBT_Node *node = tree->root;
+    while ( node != NULL ) {
+        if ( RBT_KEYVALUE(node->key) < lo ) {
+            node = node->right;
+        } else if ( RBT_KEYVALUE(node->key) > hi ) {
+            node = node->left;
+        } else {
+            break;
+        }
+    }
+    return node;
+}
+
+static inline int RBT_merkle_equal_range(struct RBT_Tree *a, struct RBT_Tree *b, uintmax_t lo, uintmax_t hi) {
+    struct RBT_Merkle_Hash hash_a, hash_b;
+    RBT_range_aggregate(a, lo, hi, &hash_a);
+    RBT_range_aggregate(b, lo, hi, &hash_b);
+    return hash_a.hash == hash_b.hash && hash_a.power == hash_b.power;
+}
+
+static int RBT_diff_range(struct RBT_Tree *a, struct RBT_Tree *b, uintmax_t lo, uintmax_t hi,
+        int (*visit)(uintmax_t key, void *context), void *context) {
+    if ( RBT_merkle_equal_range(a, b, lo, hi) ) {
+        return 1;
+    }
+    struct RBT_Node *split = RBT_merkle_split(a, lo, hi);
+    if ( split == NULL ) {
+        split = RBT_merkle_split(b, lo, hi);
+    }
+    if ( split == NULL ) {
+        return 1;
+    }
+
+    uintmax_t key = RBT_KEYVALUE(split->key);
+    if ( key > lo && !RBT_diff_range(a, b, lo, key - 1, visit, context) ) {
+        return 0;
+    }
+    if ( !RBT_merkle_equal_range(a, b, key, key) && !visit(key, context) ) {
+        return 0;
+    }
+    return key >= hi || RBT_diff_range(a, b, key + 1, hi, visit, context);
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+void RBT_merkle_init(struct RBT_Merkle *merkle, uint64_t (*hash_value)(void *data, void *context), void *context) {
+    merkle->augment.size = sizeof(struct RBT_Merkle_Hash);
+    merkle->augment.identity = &RBT_merkle_identity;
+    merkle->augment.lift = RBT_merkle_lift;
+    merkle->augment.combine = RBT_merkle_combine;
+    merkle->augment.context = merkle;
+    merkle->hash_value = hash_value;
+    merkle->context = context;
+}
+
+int RBT_diff(struct RBT_Tree *a, struct RBT_Tree *b, int (*visit)(uintmax_t key, void *context), void *context) {
+    if ( a == NULL || b == NULL || visit == NULL || a->augment == NULL || b->augment == NULL ) {
+        return 0;
+    }
+    if ( a->augment->size != sizeof(struct RBT_Merkle_Hash) || b->augment->size != sizeof(struct RBT_Merkle_Hash) ) {
+        return 0;
+    }
+    return RBT_diff_range(a, b, 0, RBT_KEY_MAX, visit, context);
+}
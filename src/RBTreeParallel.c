@@ -0,0 +1,541 @@
+/**
+ * Parallel bulk operations on red-black trees
+ *
+ * Every call starts a small pool of workers, each owning a deque of subtree tasks.
+ * Workers split the upper levels of their subtree into new tasks pushed to the
+ * bottom of their own deque, and idle workers steal the oldest, and therefore
+ * largest, tasks from the top of the other deques.
+ **/
+#include "RBTree/RBTreeParallel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "RBMacros.h"
+#include "RBTreeInternal.h"
+
+// depth at which RBT_parallel_reduce cuts the tree into subtree tasks
+#define RBT_REDUCE_DEPTH 8
+#define RBT_REDUCE_SLOTS ((2 << RBT_REDUCE_DEPTH) - 1)
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+struct RBT_Task {
+    struct RBT_Node *node;
+    struct RBT_Node *parent;
+    struct RBT_Node **link;
+    size_t first;
+    size_t count;
+    unsigned depth;
+};
+
+struct RBT_Pool;
+
+struct RBT_Worker {
+    struct RBT_Pool *pool;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    struct RBT_Task *tasks;
+    size_t top;
+    size_t bottom;
+    size_t capacity;
+    unsigned index;
+    int started;
+};
+
+struct RBT_Pool {
+    struct RBT_Worker *workers;
+    unsigned worker_count;
+    unsigned spawn_depth;
+    void (*run)(struct RBT_Pool *pool, struct RBT_Worker *worker, struct RBT_Task *task);
+    void *job;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    size_t pending;
+    size_t generation;
+};
+
+static int RBT_pool_init(struct RBT_Pool *pool, unsigned threads,
+        void (*run)(struct RBT_Pool *, struct RBT_Worker *, struct RBT_Task *), void *job) {
+    if ( threads == 0 ) {
+        threads = 1;
+    }
+    pool->workers = calloc( threads, sizeof(struct RBT_Worker) );
+    if ( pool->workers == NULL ) {
+        return 0;
+    }
+    pool->worker_count = threads;
+    pool->run = run;
+    pool->job = job;
+    pool->pending = 0;
+    pool->generation = 0;
+
+    // split until there are around sixteen tasks per worker
+    pool->spawn_depth = 4;
+    while ( (1u << (pool->spawn_depth - 4)) < threads && pool->spawn_depth < 24 ) {
+        pool->spawn_depth++;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wakeup, NULL);
+    for ( unsigned i = 0; i < threads; ++i ) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pthread_mutex_init(&pool->workers[i].lock, NULL);
+    }
+    return 1;
+}
+
+static void RBT_pool_destroy(struct RBT_Pool *pool) {
+    for ( unsigned i = 0; i < pool->worker_count; ++i ) {
+        pthread_mutex_destroy(&pool->workers[i].lock);
+        free(pool->workers[i].tasks);
+    }
+    pthread_cond_destroy(&pool->wakeup);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+}
+
+// pushes the task to the bottom of the workers deque, or runs it right away if the deque cannot grow
+static void RBT_pool_spawn(struct RBT_Worker *worker, struct RBT_Task task) {
+    struct RBT_Pool *pool = worker->pool;
+
+    pthread_mutex_lock(&worker->lock);
+    if ( worker->top == worker->bottom ) {
+        worker->top = worker->bottom = 0;
+    }
+    if ( worker->bottom == worker->capacity ) {
+        size_t capacity = worker->capacity ? worker->capacity * 2 : 32;
+        struct RBT_Task *tasks = realloc( worker->tasks, sizeof(struct RBT_Task) * capacity );
+        if ( tasks == NULL ) {
+            pthread_mutex_unlock(&worker->lock);
+            pool->run(pool, worker, &task);
+            return;
+        }
+        worker->tasks = tasks;
+        worker->capacity = capacity;
+    }
+    worker->tasks[worker->bottom++] = task;
+    pthread_mutex_unlock(&worker->lock);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pool->generation++;
+    pthread_cond_signal(&pool->wakeup);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static int RBT_pool_pop(struct RBT_Worker *worker, struct RBT_Task *task) {
+    int found = 0;
+    pthread_mutex_lock(&worker->lock);
+    if ( worker->top < worker->bottom ) {
+        *task = worker->tasks[--worker->bottom];
+        found = 1;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return found;
+}
+
+static int RBT_pool_steal(struct RBT_Worker *victim, struct RBT_Task *task) {
+    int found = 0;
+    pthread_mutex_lock(&victim->lock);
+    if ( victim->top < victim->bottom ) {
+        *task = victim->tasks[victim->top++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&victim->lock);
+    return found;
+}
+
+static void *RBT_pool_work(void *argument) {
+    struct RBT_Worker *worker = argument;
+    struct RBT_Pool *pool = worker->pool;
+    struct RBT_Task task;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        size_t generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        int found = RBT_pool_pop(worker, &task);
+        for ( unsigned i = 1; i < pool->worker_count && !found; ++i ) {
+            found = RBT_pool_steal(&pool->workers[(worker->index + i) % pool->worker_count], &task);
+        }
+
+        if ( found ) {
+            pool->run(pool, worker, &task);
+
+            pthread_mutex_lock(&pool->lock);
+            if ( --pool->pending == 0 ) {
+                pthread_cond_broadcast(&pool->wakeup);
+            }
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+
+        // nothing to do; sleep unless tasks were pushed while the deques were scanned
+        pthread_mutex_lock(&pool->lock);
+        if ( pool->pending == 0 ) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        if ( generation == pool->generation ) {
+            pthread_cond_wait(&pool->wakeup, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// runs every pushed task to completion, with the calling thread acting as the first worker
+static void RBT_pool_execute(struct RBT_Pool *pool) {
+    for ( unsigned i = 1; i < pool->worker_count; ++i ) {
+        struct RBT_Worker *worker = &pool->workers[i];
+        worker->started = pthread_create(&worker->thread, NULL, RBT_pool_work, worker) == 0;
+    }
+    RBT_pool_work(&pool->workers[0]);
+    for ( unsigned i = 1; i < pool->worker_count; ++i ) {
+        if ( pool->workers[i].started ) {
+            pthread_join(pool->workers[i].thread, NULL);
+        }
+    }
+}
+
+static inline void RBT_pool_spawn_subtree(struct RBT_Worker *worker, struct RBT_Node *node, unsigned depth) {
+    if ( node != NULL ) {
+        struct RBT_Task task = { node, NULL, NULL, 0, 0, depth };
+        RBT_pool_spawn(worker, task);
+    }
+}
+
+
+/* for each */
+
+struct RBT_For_Each_Job {
+    void (*visit)(uintmax_t key, void *data, void *context);
+    void *context;
+};
+
+static void RBT_visit_subtree(struct RBT_For_Each_Job *job, struct RBT_Node *node) {
+    while ( node != NULL ) {
+        RBT_visit_subtree(job, node->left);
+        if ( !RBT_IS_DEAD(node) ) {
+            job->visit(RBT_KEYVALUE(node->key), node->data, job->context);
+        }
+        node = node->right;
+    }
+}
+
+static void RBT_for_each_task(struct RBT_Pool *pool, struct RBT_Worker *worker, struct RBT_Task *task) {
+    struct RBT_For_Each_Job *job = pool->job;
+    struct RBT_Node *node = task->node;
+
+    for ( unsigned depth = task->depth; node != NULL; ++depth ) {
+        if ( depth >= pool->spawn_depth ) {
+            RBT_visit_subtree(job, node);
+            return;
+        }
+        RBT_pool_spawn_subtree(worker, node->right, depth + 1);
+        if ( !RBT_IS_DEAD(node) ) {
+            job->visit(RBT_KEYVALUE(node->key), node->data, job->context);
+        }
+        node = node->left;
+    }
+}
+
+
+/* teardown */
+
+struct RBT_Teardown_Job {
+    struct RBT_Tree *tree;
+    void (*freedata)(void *);
+};
+
+static void RBT_destroy_subtree(struct RBT_Teardown_Job *job, struct RBT_Node *node) {
+    while ( node != NULL ) {
+        struct RBT_Node *right = node->right;
+        RBT_destroy_subtree(job, node->left);
+        RBT_release_node(job->tree, node, job->freedata);
+        node = right;
+    }
+}
+
+static void RBT_teardown_task(struct RBT_Pool *pool, struct RBT_Worker *worker, struct RBT_Task *task) {
+    struct RBT_Teardown_Job *job = pool->job;
+    struct RBT_Node *node = task->node;
+
+    for ( unsigned depth = task->depth; node != NULL; ++depth ) {
+        if ( depth >= pool->spawn_depth ) {
+            RBT_destroy_subtree(job, node);
+            return;
+        }
+        struct RBT_Node *left = node->left;
+        RBT_pool_spawn_subtree(worker, node->right, depth + 1);
+        RBT_release_node(job->tree, node, job->freedata);
+        node = left;
+    }
+}
+
+
+// frees every node of the tree, leaving its options as they are, for the caller to account the nodes
+static void RBT_parallel_clear(struct RBT_Tree *tree, void (*freedata)(void *), unsigned threads) {
+    struct RBT_Teardown_Job job = { tree, freedata };
+    struct RBT_Pool pool;
+
+    if ( !RBT_pool_init(&pool, threads, RBT_teardown_task, &job) ) {
+        RBT_destroy_subtree(&job, tree->root);
+    } else {
+        RBT_pool_spawn_subtree(&pool.workers[0], tree->root, 0);
+        RBT_pool_execute(&pool);
+        RBT_pool_destroy(&pool);
+    }
+    tree->root = NULL;
+    tree->node_count = 0;
+    tree->dead_count = 0;
+    tree->generation++;
+}
+
+
+/* sorted build */
+
+struct RBT_Build_Job {
+    struct RBT_Tree *tree;
+    const uintmax_t *keys;
+    void **values;
+    unsigned full_levels;
+    pthread_mutex_t lock;
+    int failed;
+};
+
+// allocates the root of a subtree of count nodes, the middle one of which is at index
+static struct RBT_Node *RBT_build_node(struct RBT_Build_Job *job, size_t index, size_t count, unsigned depth, struct RBT_Node *parent) {
+    struct RBT_Node *node = RBT_allocate_node(job->tree, job->keys[index], job->values ? job->values[index] : NULL);
+    if ( node == NULL ) {
+        pthread_mutex_lock(&job->lock);
+        job->failed = 1;
+        pthread_mutex_unlock(&job->lock);
+        return NULL;
+    }
+    node->parent = parent;
+    RBT_set_built_color(job->tree, node, count, depth, job->full_levels);
+    return node;
+}
+
+static struct RBT_Node *RBT_build_subtree(struct RBT_Build_Job *job, size_t first, size_t count, unsigned depth, struct RBT_Node *parent) {
+    if ( count == 0 ) {
+        return NULL;
+    }
+    size_t middle = first + count / 2;
+    struct RBT_Node *node = RBT_build_node(job, middle, count, depth, parent);
+    if ( node == NULL ) {
+        return NULL;
+    }
+    node->left = RBT_build_subtree(job, first, count / 2, depth + 1, node);
+    node->right = RBT_build_subtree(job, middle + 1, count - count / 2 - 1, depth + 1, node);
+
+    if ( job->tree->augment != NULL ) {
+        RBT_update_aggregate(job->tree, node);
+    }
+    return node;
+}
+
+static void RBT_build_task(struct RBT_Pool *pool, struct RBT_Worker *worker, struct RBT_Task *task) {
+    struct RBT_Build_Job *job = pool->job;
+    struct RBT_Node *parent = task->parent;
+    struct RBT_Node **link = task->link;
+    size_t first = task->first;
+    size_t count = task->count;
+
+    for ( unsigned depth = task->depth; count > 0; ++depth ) {
+        if ( depth >= pool->spawn_depth ) {
+            *link = RBT_build_subtree(job, first, count, depth, parent);
+            return;
+        }
+        size_t middle = first + count / 2;
+        struct RBT_Node *node = RBT_build_node(job, middle, count, depth, parent);
+        *link = node;
+        if ( node == NULL ) {
+            return;
+        }
+
+        struct RBT_Task left = { NULL, node, &node->left, first, count / 2, depth + 1 };
+        RBT_pool_spawn(worker, left);
+
+        count = count - count / 2 - 1;
+        first = middle + 1;
+        parent = node;
+        link = &node->right;
+    }
+    *link = NULL;
+}
+
+// aggregates below the spawn depth are computed by the tasks, the levels above once they are all done
+static void RBT_build_top_aggregates(struct RBT_Tree *tree, struct RBT_Node *node, unsigned depth, unsigned spawn_depth) {
+    if ( node == NULL || depth >= spawn_depth ) {
+        return;
+    }
+    RBT_build_top_aggregates(tree, node->left, depth + 1, spawn_depth);
+    RBT_build_top_aggregates(tree, node->right, depth + 1, spawn_depth);
+    RBT_update_aggregate(tree, node);
+}
+
+
+/* deterministic reduction */
+
+struct RBT_Reduce_Job {
+    const struct RBT_Augment *monoid;
+    unsigned char *slots;
+};
+
+static void RBT_reduce_subtree(const struct RBT_Augment *monoid, struct RBT_Node *node, void *accumulated) {
+    union RBT_Aggregate_Buffer lifted, combined;
+
+    while ( node != NULL ) {
+        RBT_reduce_subtree(monoid, node->left, accumulated);
+        if ( !RBT_IS_DEAD(node) ) {
+            monoid->lift(lifted.bytes, RBT_KEYVALUE(node->key), node->data, monoid->context);
+            monoid->combine(combined.bytes, accumulated, lifted.bytes, monoid->context);
+            memcpy(accumulated, combined.bytes, monoid->size);
+        }
+        node = node->right;
+    }
+}
+
+static void RBT_reduce_task(struct RBT_Pool *pool, struct RBT_Worker *worker, struct RBT_Task *task) {
+    (void) worker;
+    struct RBT_Reduce_Job *job = pool->job;
+    RBT_reduce_subtree(job->monoid, task->node, job->slots + task->first * job->monoid->size);
+}
+
+// slots are laid out as the in-order positions of a complete tree of RBT_REDUCE_DEPTH + 1 levels
+static void RBT_plan_reduce(struct RBT_Pool *pool, struct RBT_Node *node, unsigned depth, size_t position) {
+    struct RBT_Reduce_Job *job = pool->job;
+    size_t slot = ((2 * position + 1) << (RBT_REDUCE_DEPTH - depth)) - 1;
+
+    if ( node == NULL ) {
+        return;
+    }
+    if ( depth == RBT_REDUCE_DEPTH ) {
+        struct RBT_Task task = { node, NULL, NULL, slot, 0, depth };
+        RBT_pool_spawn(&pool->workers[0], task);
+        return;
+    }
+    if ( !RBT_IS_DEAD(node) ) {
+        job->monoid->lift(job->slots + slot * job->monoid->size, RBT_KEYVALUE(node->key), node->data, job->monoid->context);
+    }
+    RBT_plan_reduce(pool, node->left, depth + 1, 2 * position);
+    RBT_plan_reduce(pool, node->right, depth + 1, 2 * position + 1);
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_parallel_for_each(struct RBT_Tree *tree, void (*visit)(uintmax_t key, void *data, void *context), void *context, unsigned threads) {
+    struct RBT_For_Each_Job job = { visit, context };
+    struct RBT_Pool pool;
+
+    if ( tree == NULL || visit == NULL || RBT_IS_BPLUS(tree) || !RBT_promote_inline(tree) ||
+         !RBT_pool_init(&pool, threads, RBT_for_each_task, &job) ) {
+        return 0;
+    }
+    RBT_pool_spawn_subtree(&pool.workers[0], tree->root, 0);
+    RBT_pool_execute(&pool);
+    RBT_pool_destroy(&pool);
+    return 1;
+}
+
+int RBT_parallel_reduce(struct RBT_Tree *tree, const struct RBT_Augment *monoid, void *out, unsigned threads) {
+    if ( tree == NULL || monoid == NULL || monoid->size > RBT_AGGREGATE_MAX_SIZE || RBT_IS_BPLUS(tree) ||
+         !RBT_promote_inline(tree) ) {
+        return 0;
+    }
+    struct RBT_Reduce_Job job = { monoid, malloc( monoid->size * RBT_REDUCE_SLOTS ) };
+    struct RBT_Pool pool;
+
+    if ( job.slots == NULL ) {
+        return 0;
+    }
+    if ( !RBT_pool_init(&pool, threads, RBT_reduce_task, &job) ) {
+        free(job.slots);
+        return 0;
+    }
+    for ( size_t i = 0; i < RBT_REDUCE_SLOTS; ++i ) {
+        memcpy(job.slots + i * monoid->size, monoid->identity, monoid->size);
+    }
+    RBT_plan_reduce(&pool, tree->root, 0, 0);
+    RBT_pool_execute(&pool);
+
+    union RBT_Aggregate_Buffer accumulated, combined;
+    memcpy(accumulated.bytes, monoid->identity, monoid->size);
+    for ( size_t i = 0; i < RBT_REDUCE_SLOTS; ++i ) {
+        monoid->combine(combined.bytes, accumulated.bytes, job.slots + i * monoid->size, monoid->context);
+        memcpy(accumulated.bytes, combined.bytes, monoid->size);
+    }
+    memcpy(out, accumulated.bytes, monoid->size);
+
+    RBT_pool_destroy(&pool);
+    free(job.slots);
+    return 1;
+}
+
+void RBT_parallel_deinit_tree(struct RBT_Tree *tree, void (*freedata)(void *), unsigned threads) {
+    if ( tree == NULL ) {
+        return;
+    }
+    // a handful of inline entries is not worth a thread pool, and a B+-tree has no subtrees to split
+    if ( !RBT_IS_INLINE(tree) && !RBT_IS_BPLUS(tree) ) {
+        RBT_account_nodes(tree, tree->root, tree->node_count + tree->dead_count, 0);
+        RBT_parallel_clear(tree, freedata, threads);
+    }
+    // with the nodes gone, this only frees the options and the reserve
+    RBT_deinit_tree(tree, freedata);
+    tree->node_count = 0;
+}
+
+int RBT_parallel_build(struct RBT_Tree *tree, const uintmax_t *keys, void **values, size_t count, unsigned threads) {
+    if ( tree == NULL || !RBT_IS_EMPTY(tree) || RBT_IS_BPLUS(tree) || RBT_IS_SEQUENCE(tree) ||
+        (keys == NULL && count > 0) || !RBT_budget_allows(tree, count) ) {
+        return 0;
+    }
+    for ( size_t i = 1; i < count; ++i ) {
+        if ( keys[i] < keys[i - 1] ) {
+            return 0;
+        }
+    }
+
+    struct RBT_Build_Job job = { tree, keys, values, 0, PTHREAD_MUTEX_INITIALIZER, 0 };
+    struct RBT_Pool pool;
+
+    // number of complete levels in a tree of count nodes
+    while ( job.full_levels < 8 * sizeof(size_t) - 1 && (((size_t) 2 << job.full_levels) - 1) <= count ) {
+        job.full_levels++;
+    }
+    if ( !RBT_pool_init(&pool, threads, RBT_build_task, &job) ) {
+        return 0;
+    }
+
+    struct RBT_Task task = { NULL, NULL, &tree->root, 0, count, 0 };
+    RBT_pool_spawn(&pool.workers[0], task);
+    RBT_pool_execute(&pool);
+
+    if ( job.failed ) {
+        RBT_pool_destroy(&pool);
+        RBT_parallel_clear(tree, NULL, threads);
+        return 0;
+    }
+    if ( tree->augment != NULL ) {
+        RBT_build_top_aggregates(tree, tree->root, 0, pool.spawn_depth);
+    }
+    tree->node_count = count;
+    RBT_account_nodes(tree, tree->root, count, 1);
+    RBT_pool_destroy(&pool);
+    RBT_restore_capacity(tree);
+    if ( RBT_OPTION(tree, index) != NULL ) {
+        RBT_set_hash_index(tree, 1);
+    }
+    if ( RBT_OPTION(tree, filter) != NULL ) {
+        RBT_set_lookup_filter(tree, 1);
+    }
+    return 1;
+}
@@ -1,6 +1,7 @@
 
 #include "RBTree/RBTreePrinter.h"
 #include "RBMacros.h"
+#include "RBTreeInternal.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -84,7 +85,7 @@ inline static void RBT_pretty_printer_helper( struct RBT_Node *node, struct RBT_
 
 
 void RBT_pretty_printer(struct RBT_Tree *tree) {
-    if ( tree == NULL ) {
+    if ( tree == NULL || !RBT_promote_inline(tree) ) {
         return;
     }
     struct RBT_Printer_Stack *stack = RBT_new_stack(2046);
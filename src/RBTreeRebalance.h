@@ -0,0 +1,214 @@
+#ifndef _HEADER_FILE_RBTreeRebalance_20261019231544_
+#define _HEADER_FILE_RBTreeRebalance_20261019231544_
+
+/*
+ * Red-black rebalancing shared by the trees of the library whose nodes keep the color in the
+ * highest bit of the key, see RBMacros.h. RBT_GENERATE_REBALANCE(prefix, tree_type, node_type, rotated)
+ * expands to static inline functions for a tree_type with a "root", and a node_type with "key",
+ * "left", "right" and "parent" members:
+ *
+ *   void prefix_transplant(tree_type *, node_type *old, node_type *transplant);
+ *   void prefix_left_rotate(tree_type *, node_type *);
+ *   void prefix_right_rotate(tree_type *, node_type *);
+ *   int prefix_insert_fixup(tree_type *, node_type *);
+ *   void prefix_remove_fixup(tree_type *, node_type *, node_type *parent);
+ *   uintmax_t prefix_detach(tree_type *, node_type *, node_type **point, node_type **point_parent);
+ *
+ * "rotated" is a function or function-like macro called as rotated(tree, lower, upper) after
+ * every rotation, with "upper" the node that moved up, for trees keeping data derived from
+ * the subtrees. RBT_NOT_ROTATED can be passed by trees keeping none.
+ */
+
+#include "RBMacros.h"
+
+#define RBT_NOT_ROTATED(tree, lower, upper) ((void) (tree), (void) (lower), (void) (upper))
+
+#define RBT_GENERATE_REBALANCE(prefix, tree_type, node_type, rotated) \
+    RBT_GENERATE_REBALANCE_ROTATIONS(prefix, tree_type, node_type, rotated) \
+    RBT_GENERATE_REBALANCE_INSERT(prefix, tree_type, node_type) \
+    RBT_GENERATE_REBALANCE_REMOVE(prefix, tree_type, node_type)
+
+#define RBT_GENERATE_REBALANCE_ROTATIONS(prefix, tree_type, node_type, rotated) \
+    static inline void prefix##_transplant(tree_type *tree, node_type *old, node_type *transplant) { \
+        if ( old->parent == NULL ) { \
+            tree->root = transplant; \
+        } else if ( old == old->parent->left ) { \
+            old->parent->left = transplant; \
+        } else { \
+            old->parent->right = transplant; \
+        } \
+        if ( transplant != NULL ) { \
+            transplant->parent = old->parent; \
+        } \
+    } \
+    \
+    static inline void prefix##_left_rotate(tree_type *tree, node_type *node) { \
+        node_type *right_node = node->right; \
+        node->right = right_node->left; \
+        if ( right_node->left != NULL ) { \
+            right_node->left->parent = node; \
+        } \
+        prefix##_transplant(tree, node, right_node); \
+        right_node->left = node; \
+        node->parent = right_node; \
+        rotated(tree, node, right_node); \
+    } \
+    \
+    static inline void prefix##_right_rotate(tree_type *tree, node_type *node) { \
+        node_type *left_node = node->left; \
+        node->left = left_node->right; \
+        if ( left_node->right != NULL ) { \
+            left_node->right->parent = node; \
+        } \
+        prefix##_transplant(tree, node, left_node); \
+        left_node->right = node; \
+        node->parent = left_node; \
+        rotated(tree, node, left_node); \
+    }
+
+/*
+ * repairs a red node below a red parent, returning whether the root ended up red and was blackened,
+ * growing the black height of the tree. A node blackened as an uncle on the way has nothing left to repair.
+ */
+#define RBT_GENERATE_REBALANCE_INSERT(prefix, tree_type, node_type) \
+    static inline int prefix##_insert_fixup(tree_type *tree, node_type *node) { \
+        while ( RBT_IS_RED( node ) && RBT_IS_RED( node->parent ) ) { \
+            node_type *parent = node->parent; \
+            node_type *grandparent = parent->parent; \
+            if ( parent == grandparent->left ) { \
+                node_type *uncle = grandparent->right; \
+                if ( RBT_IS_RED( uncle ) ) { \
+                    RBT_SET_BLACK( parent ); \
+                    RBT_SET_BLACK( uncle ); \
+                    RBT_SET_RED( grandparent ); \
+                    node = grandparent; \
+                    continue; \
+                } else if ( node == parent->right ) { \
+                    node = parent; \
+                    prefix##_left_rotate(tree, node); \
+                    parent = node->parent; \
+                } \
+                RBT_SET_BLACK(parent); \
+                RBT_SET_RED(grandparent); \
+                prefix##_right_rotate(tree, grandparent); \
+            } else { \
+                node_type *uncle = grandparent->left; \
+                if ( RBT_IS_RED( uncle ) ) { \
+                    RBT_SET_BLACK( parent ); \
+                    RBT_SET_BLACK( uncle ); \
+                    RBT_SET_RED( grandparent ); \
+                    node = grandparent; \
+                    continue; \
+                } else if ( node == parent->left ) { \
+                    node = parent; \
+                    prefix##_right_rotate(tree, node); \
+                    parent = node->parent; \
+                } \
+                RBT_SET_BLACK(parent); \
+                RBT_SET_RED(grandparent); \
+                prefix##_left_rotate(tree, grandparent); \
+            } \
+        } \
+        int grown = RBT_IS_RED(tree->root); \
+        RBT_SET_BLACK(tree->root); \
+        return grown; \
+    }
+
+/*
+ * detach unlinks a node, putting its in-order successor in its place if it has two children, and
+ * returns the key holding the color the tree lost at "point", the link left where a node went away,
+ * below "point_parent". remove_fixup repairs a lost black there; the parent is passed separately,
+ * as the point may be NULL.
+ */
+#define RBT_GENERATE_REBALANCE_REMOVE(prefix, tree_type, node_type) \
+    static inline void prefix##_remove_fixup(tree_type *tree, node_type *node, node_type *parent) { \
+        while ( node != tree->root && RBT_IS_BLACK( node ) ) { \
+            if ( node == parent->left ) { \
+                node_type *sibling = parent->right; \
+                if ( RBT_IS_RED( sibling ) ) { \
+                    RBT_SET_BLACK( sibling ); \
+                    RBT_SET_RED( parent ); \
+                    prefix##_left_rotate( tree, parent ); \
+                    sibling = parent->right; \
+                } \
+                if ( RBT_IS_BLACK( sibling->left ) && RBT_IS_BLACK( sibling->right ) ) { \
+                    RBT_SET_RED( sibling ); \
+                    node = parent; \
+                    parent = node->parent; \
+                    continue; \
+                } else if ( RBT_IS_BLACK( sibling->right ) ) { \
+                    RBT_SET_BLACK(sibling->left); \
+                    RBT_SET_RED(sibling); \
+                    prefix##_right_rotate( tree, sibling ); \
+                    sibling = parent->right; \
+                } \
+                RBT_COPY_COLOR(sibling, parent); \
+                RBT_SET_BLACK(parent); \
+                RBT_SET_BLACK(sibling->right); \
+                prefix##_left_rotate( tree, parent ); \
+                node = tree->root; \
+            } else { \
+                node_type *sibling = parent->left; \
+                if ( RBT_IS_RED( sibling ) ) { \
+                    RBT_SET_BLACK( sibling ); \
+                    RBT_SET_RED( parent ); \
+                    prefix##_right_rotate( tree, parent ); \
+                    sibling = parent->left; \
+                } \
+                if ( RBT_IS_BLACK( sibling->right ) && RBT_IS_BLACK( sibling->left ) ) { \
+                    RBT_SET_RED( sibling ); \
+                    node = parent; \
+                    parent = node->parent; \
+                    continue; \
+                } else if ( RBT_IS_BLACK( sibling->left ) ) { \
+                    RBT_SET_BLACK(sibling->right); \
+                    RBT_SET_RED(sibling); \
+                    prefix##_left_rotate( tree, sibling ); \
+                    sibling = parent->left; \
+                } \
+                RBT_COPY_COLOR(sibling, parent); \
+                RBT_SET_BLACK(parent); \
+                RBT_SET_BLACK(sibling->left); \
+                prefix##_right_rotate( tree, parent ); \
+                node = tree->root; \
+            } \
+        } \
+        if ( node != NULL ) { \
+            RBT_SET_BLACK(node); \
+        } \
+    } \
+    \
+    static inline uintmax_t prefix##_detach(tree_type *tree, node_type *node, node_type **point, node_type **point_parent) { \
+        uintmax_t old_color = node->key; \
+        if ( node->left == NULL ) { \
+            *point = node->right; \
+            *point_parent = node->parent; \
+            prefix##_transplant(tree, node, node->right); \
+        } else if ( node->right == NULL ) { \
+            *point = node->left; \
+            *point_parent = node->parent; \
+            prefix##_transplant(tree, node, node->left); \
+        } else { \
+            node_type *old = node->right; \
+            while ( old->left != NULL ) { \
+                old = old->left; \
+            } \
+            old_color = old->key; \
+            *point = old->right; \
+            if ( old->parent == node ) { \
+                *point_parent = old; \
+            } else { \
+                *point_parent = old->parent; \
+                prefix##_transplant(tree, old, old->right); \
+                old->right = node->right; \
+                old->right->parent = old; \
+            } \
+            prefix##_transplant(tree, node, old); \
+            old->left = node->left; \
+            old->left->parent = old; \
+            RBT_COPY_COLOR(old, node); \
+        } \
+        return old_color; \
+    }
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * Red-black key set
+ *
+ * The rebalancing is the one of the RBT tree, see RBTreeRebalance.h, on nodes without a data reference.
+ * Keys are kept unique, so an insertion ends its search at the key when it is present.
+ **/
+#include "RBTree/RBTreeSet.h"
+#include <stdlib.h>
+#include "RBMacros.h"
+#include "RBTreeRebalance.h"
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+static inline struct RBT_Set_Node *RBT_Set_new_node(uintmax_t key, struct RBT_Set_Node *parent) {
+    struct RBT_Set_Node *new_node = RBT_MALLOC( sizeof(struct RBT_Set_Node) );
+    if ( !new_node ) {
+        return NULL;
+    }
+    new_node->key = key;
+    new_node->left = NULL;
+    new_node->right = NULL;
+    new_node->parent = parent;
+    return new_node;
+}
+
+static void RBT_Set_recursive_destroy(struct RBT_Set_Node *node) {
+    while ( node != NULL ) {
+        struct RBT_Set_Node *right = node->right;
+        RBT_Set_recursive_destroy(node->left);
+        RBT_FREE(node);
+        node = right;
+    }
+}
+
+static inline struct RBT_Set_Node *RBT_Set_minimum(struct RBT_Set_Node *node) {
+    if ( node == NULL ) {
+        return NULL;
+    }
+    while ( node->left != NULL ) {
+        node = node->left;
+    }
+    return node;
+}
+
+static inline struct RBT_Set_Node *RBT_Set_maximum(struct RBT_Set_Node *node) {
+    if ( node == NULL ) {
+        return NULL;
+    }
+    while ( node->right != NULL ) {
+        node = node->right;
+    }
+    return node;
+}
+
+static inline struct RBT_Set_Node *RBT_Set_successor(struct RBT_Set_Node *node) {
+    if ( node->right != NULL ) {
+        return RBT_Set_minimum(node->right);
+    }
+    struct RBT_Set_Node *parent = node->parent;
+    while ( parent != NULL && node == parent->right ) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+RBT_GENERATE_REBALANCE(RBT_Set, struct RBT_Set, struct RBT_Set_Node, RBT_NOT_ROTATED)
+
+static inline void RBT_Set_remove(struct RBT_Set *set, struct RBT_Set_Node *node) {
+    struct RBT_Set_Node *point;
+    struct RBT_Set_Node *point_parent;
+
+    if ( RBT_IS_KEY_BLACK(RBT_Set_detach(set, node, &point, &point_parent)) ) {
+        RBT_Set_remove_fixup(set, point, point_parent);
+    }
+    RBT_FREE(node);
+    set->node_count--;
+}
+
+static inline struct RBT_Set_Node *RBT_Set_find(struct RBT_Set_Node *node, uintmax_t key) {
+    key = RBT_KEYVALUE(key);
+    while ( node != NULL && RBT_KEYVALUE(node->key) != key ) {
+        node = key < RBT_KEYVALUE(node->key) ? node->left : node->right;
+    }
+    return node;
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_Set_init(struct RBT_Set *set) {
+    if ( !set ) {
+        return 0;
+    }
+    set->root = NULL;
+    set->node_count = 0;
+    return 1;
+}
+
+void RBT_Set_deinit(struct RBT_Set *set) {
+    RBT_Set_recursive_destroy(set->root);
+    set->root = NULL;
+    set->node_count = 0;
+}
+
+int RBT_Set_insert(struct RBT_Set *set, uintmax_t key) {
+    struct RBT_Set_Node *parent = NULL;
+    struct RBT_Set_Node *iterator = set->root;
+
+    key = RBT_KEYVALUE(key);
+    while ( iterator != NULL ) {
+        if ( key == RBT_KEYVALUE(iterator->key) ) {
+            return 0;
+        }
+        parent = iterator;
+        iterator = key < RBT_KEYVALUE(iterator->key) ? iterator->left : iterator->right;
+    }
+    struct RBT_Set_Node *node = RBT_Set_new_node(key, parent);
+    if ( node == NULL ) {
+        return 0;
+    }
+    if ( parent == NULL ) {
+        set->root = node;
+    } else if ( key < RBT_KEYVALUE(parent->key) ) {
+        parent->left = node;
+    } else {
+        parent->right = node;
+    }
+    RBT_SET_RED(node);
+    RBT_Set_insert_fixup(set, node);
+    set->node_count++;
+    return 1;
+}
+
+int RBT_Set_contains(struct RBT_Set *set, uintmax_t key) {
+    return set != NULL && RBT_Set_find(set->root, key) != NULL;
+}
+
+int RBT_Set_erase(struct RBT_Set *set, uintmax_t key) {
+    struct RBT_Set_Node *node = RBT_Set_find(set->root, key);
+    if ( node == NULL ) {
+        return 0;
+    }
+    RBT_Set_remove(set, node);
+    return 1;
+}
+
+int RBT_Set_for_each(struct RBT_Set *set, int (*visit)(uintmax_t key, void *context), void *context) {
+    if ( set == NULL || visit == NULL ) {
+        return 0;
+    }
+    for ( struct RBT_Set_Node *node = RBT_Set_minimum(set->root); node != NULL; node = RBT_Set_successor(node) ) {
+        if ( !visit(RBT_KEYVALUE(node->key), context) ) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int RBT_Set_get_minimum(struct RBT_Set *set, uintmax_t *key) {
+    struct RBT_Set_Node *node = RBT_Set_minimum(set->root);
+    if ( !node ) {
+        return 0;
+    }
+    if ( key ) {
+        *key = RBT_KEYVALUE(node->key);
+    }
+    return 1;
+}
+
+int RBT_Set_get_maximum(struct RBT_Set *set, uintmax_t *key) {
+    struct RBT_Set_Node *node = RBT_Set_maximum(set->root);
+    if ( !node ) {
+        return 0;
+    }
+    if ( key ) {
+        *key = RBT_KEYVALUE(node->key);
+    }
+    return 1;
+}
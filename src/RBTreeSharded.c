@@ -0,0 +1,310 @@
+/**
+ * Range partitioned red-black tree
+ *
+ * Every shard is a plain RBT tree guarded by its own mutex. The ordered array of
+ * shards is guarded by a reader-writer lock, which regular operations take shared,
+ * and which is only taken exclusively to split or merge shards.
+ **/
+#include "RBTree/RBTreeSharded.h"
+#include <stdlib.h>
+#include "RBMacros.h"
+#include "RBTreeInternal.h"
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+// finds where to split a shard, walking its keys in order up to the first change of key past the middle
+struct RBT_Shard_Split {
+    uintmax_t middle;
+    uintmax_t index;
+    uintmax_t run_start;
+    uintmax_t run_key;
+    int found;
+};
+
+static int RBT_find_split(uintmax_t key, void *data, void *context) {
+    struct RBT_Shard_Split *split = context;
+    (void) data;
+
+    if ( split->index == 0 || key != split->run_key ) {
+        if ( split->index >= split->middle && split->index > 0 ) {
+            split->run_start = split->index;
+            split->run_key = key;
+            split->found = 1;
+            return 0;
+        }
+        split->run_start = split->index;
+        split->run_key = key;
+    }
+    split->index++;
+    return 1;
+}
+
+static inline struct RBT_Shard *RBT_new_shard(uintmax_t lower) {
+    struct RBT_Shard *shard = malloc( sizeof(struct RBT_Shard) );
+    if ( shard == NULL ) {
+        return NULL;
+    }
+    if ( pthread_mutex_init(&shard->lock, NULL) != 0 ) {
+        free(shard);
+        return NULL;
+    }
+    shard->lower = lower;
+    shard->uniform = 0;
+    RBT_init_tree(&shard->tree);
+    return shard;
+}
+
+static inline void RBT_destroy_shard(struct RBT_Shard *shard, void (*freedata)(void *)) {
+    RBT_deinit_tree(&shard->tree, freedata);
+    pthread_mutex_destroy(&shard->lock);
+    free(shard);
+}
+
+// index of the shard owning the key, i.e. the last shard with a lower bound not above the key
+static inline size_t RBT_shard_index(struct RBT_Sharded_Tree *tree, uintmax_t key) {
+    size_t low = 0;
+    size_t high = tree->shard_count;
+
+    while ( high - low > 1 ) {
+        size_t middle = low + (high - low) / 2;
+        if ( tree->shards[middle]->lower <= key ) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static inline struct RBT_Shard *RBT_lock_shard(struct RBT_Sharded_Tree *tree, uintmax_t key) {
+    pthread_rwlock_rdlock(&tree->layout_lock);
+    struct RBT_Shard *shard = tree->shards[ RBT_shard_index(tree, key) ];
+    pthread_mutex_lock(&shard->lock);
+    return shard;
+}
+
+static inline void RBT_unlock_shard(struct RBT_Sharded_Tree *tree, struct RBT_Shard *shard) {
+    pthread_mutex_unlock(&shard->lock);
+    pthread_rwlock_unlock(&tree->layout_lock);
+}
+
+static int RBT_insert_shard(struct RBT_Sharded_Tree *tree, size_t index, struct RBT_Shard *shard) {
+    struct RBT_Shard **shards = realloc( tree->shards, sizeof(struct RBT_Shard *) * (tree->shard_count + 1) );
+    if ( shards == NULL ) {
+        return 0;
+    }
+    for ( size_t i = tree->shard_count; i > index; --i ) {
+        shards[i] = shards[i - 1];
+    }
+    shards[index] = shard;
+    tree->shards = shards;
+    tree->shard_count++;
+    return 1;
+}
+
+static void RBT_remove_shard(struct RBT_Sharded_Tree *tree, size_t index) {
+    for ( size_t i = index; i + 1 < tree->shard_count; ++i ) {
+        tree->shards[i] = tree->shards[i + 1];
+    }
+    tree->shard_count--;
+}
+
+// splits the shard at its median key; the layout lock must be held exclusively
+static void RBT_split_shard(struct RBT_Sharded_Tree *tree, size_t index) {
+    struct RBT_Shard *shard = tree->shards[index];
+    uintmax_t count = shard->tree.node_count;
+    struct RBT_Shard_Split split = { count / 2, 0, 0, 0, 0 };
+
+    // equal keys must stay in the same shard, so move the split past a run of duplicates,
+    // or else back to the start of the run the keys end with
+    RBT_for_each(&shard->tree, RBT_find_split, &split);
+    if ( !split.found && split.run_start == 0 ) {
+        shard->uniform = 1;
+        shard->uniform_key = split.run_key;
+        return;
+    }
+
+    struct RBT_Shard *upper = RBT_new_shard(split.run_key);
+    if ( upper == NULL ) {
+        return;
+    }
+    if ( !RBT_split_tree(&shard->tree, split.run_key, count - split.run_start, &upper->tree) ) {
+        RBT_destroy_shard(upper, NULL);
+        return;
+    }
+    if ( !RBT_insert_shard(tree, index + 1, upper) ) {
+        RBT_join_tree(&shard->tree, &upper->tree);
+        RBT_destroy_shard(upper, NULL);
+    }
+}
+
+// merges the shard with its right neighbour; the layout lock must be held exclusively
+static void RBT_merge_shards(struct RBT_Sharded_Tree *tree, size_t index) {
+    struct RBT_Shard *shard = tree->shards[index];
+    struct RBT_Shard *upper = tree->shards[index + 1];
+
+    if ( !RBT_join_tree(&shard->tree, &upper->tree) ) {
+        return;
+    }
+    shard->uniform = 0;
+    RBT_remove_shard(tree, index + 1);
+    RBT_destroy_shard(upper, NULL);
+}
+
+static void RBT_rebalance_shards(struct RBT_Sharded_Tree *tree, uintmax_t key) {
+    pthread_rwlock_wrlock(&tree->layout_lock);
+
+    // the layout may have changed since the shard lock was released, so decide again
+    size_t index = RBT_shard_index(tree, key);
+    uintmax_t count = tree->shards[index]->tree.node_count;
+    uintmax_t merge_threshold = tree->split_threshold / 4;
+
+    if ( count > tree->split_threshold && !tree->shards[index]->uniform ) {
+        RBT_split_shard(tree, index);
+    } else if ( tree->shard_count > tree->minimum_shard_count ) {
+        if ( index + 1 < tree->shard_count &&
+             count + tree->shards[index + 1]->tree.node_count < merge_threshold ) {
+            RBT_merge_shards(tree, index);
+        } else if ( index > 0 &&
+             count + tree->shards[index - 1]->tree.node_count < merge_threshold ) {
+            RBT_merge_shards(tree, index - 1);
+        }
+    }
+
+    pthread_rwlock_unlock(&tree->layout_lock);
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_init_sharded_tree(struct RBT_Sharded_Tree *tree, size_t shard_count, uintmax_t split_threshold) {
+    if ( tree == NULL || shard_count == 0 || split_threshold < 2 ) {
+        return 0;
+    }
+    tree->shards = malloc( sizeof(struct RBT_Shard *) * shard_count );
+    if ( tree->shards == NULL ) {
+        return 0;
+    }
+    if ( pthread_rwlock_init(&tree->layout_lock, NULL) != 0 ) {
+        free(tree->shards);
+        return 0;
+    }
+    tree->shard_count = 0;
+    tree->minimum_shard_count = shard_count;
+    tree->split_threshold = split_threshold;
+
+    uintmax_t width = RBT_KEY_MAX / shard_count;
+    for ( size_t i = 0; i < shard_count; ++i ) {
+        struct RBT_Shard *shard = RBT_new_shard( width * i );
+        if ( shard == NULL ) {
+            RBT_deinit_sharded_tree(tree, NULL);
+            return 0;
+        }
+        tree->shards[tree->shard_count++] = shard;
+    }
+    return 1;
+}
+
+void RBT_deinit_sharded_tree(struct RBT_Sharded_Tree *tree, void (*freedata)(void *)) {
+    for ( size_t i = 0; i < tree->shard_count; ++i ) {
+        RBT_destroy_shard(tree->shards[i], freedata);
+    }
+    free(tree->shards);
+    tree->shards = NULL;
+    tree->shard_count = 0;
+    pthread_rwlock_destroy(&tree->layout_lock);
+}
+
+void *RBT_sharded_add(struct RBT_Sharded_Tree *tree, uintmax_t key, void *data) {
+    // shards are routed by the key the trees store, without the bit they keep for the color
+    key = RBT_KEYVALUE(key);
+    struct RBT_Shard *shard = RBT_lock_shard(tree, key);
+    void *added = RBT_add(&shard->tree, key, data);
+    if ( shard->uniform && key != shard->uniform_key ) {
+        shard->uniform = 0;
+    }
+    int oversized = shard->tree.node_count > tree->split_threshold && !shard->uniform;
+    RBT_unlock_shard(tree, shard);
+
+    if ( oversized ) {
+        RBT_rebalance_shards(tree, key);
+    }
+    return added;
+}
+
+int RBT_sharded_delete(struct RBT_Sharded_Tree *tree, uintmax_t key) {
+    key = RBT_KEYVALUE(key);
+    struct RBT_Shard *shard = RBT_lock_shard(tree, key);
+    int deleted = RBT_delete(&shard->tree, key);
+    int sparse = shard->tree.node_count < tree->split_threshold / 4 &&
+        tree->shard_count > tree->minimum_shard_count;
+    RBT_unlock_shard(tree, shard);
+
+    if ( deleted && sparse ) {
+        RBT_rebalance_shards(tree, key);
+    }
+    return deleted;
+}
+
+void *RBT_sharded_find(struct RBT_Sharded_Tree *tree, uintmax_t key) {
+    key = RBT_KEYVALUE(key);
+    struct RBT_Shard *shard = RBT_lock_shard(tree, key);
+    void *found = RBT_find(&shard->tree, key);
+    RBT_unlock_shard(tree, shard);
+    return found;
+}
+
+int RBT_sharded_get_minimum(struct RBT_Sharded_Tree *tree, uintmax_t *key, void **value) {
+    int found = 0;
+
+    pthread_rwlock_rdlock(&tree->layout_lock);
+    for ( size_t i = 0; i < tree->shard_count && !found; ++i ) {
+        pthread_mutex_lock(&tree->shards[i]->lock);
+        found = RBT_get_minimum(&tree->shards[i]->tree, key, value);
+        pthread_mutex_unlock(&tree->shards[i]->lock);
+    }
+    pthread_rwlock_unlock(&tree->layout_lock);
+    return found;
+}
+
+int RBT_sharded_get_maximum(struct RBT_Sharded_Tree *tree, uintmax_t *key, void **value) {
+    int found = 0;
+
+    pthread_rwlock_rdlock(&tree->layout_lock);
+    for ( size_t i = tree->shard_count; i > 0 && !found; --i ) {
+        pthread_mutex_lock(&tree->shards[i - 1]->lock);
+        found = RBT_get_maximum(&tree->shards[i - 1]->tree, key, value);
+        pthread_mutex_unlock(&tree->shards[i - 1]->lock);
+    }
+    pthread_rwlock_unlock(&tree->layout_lock);
+    return found;
+}
+
+int RBT_sharded_for_each(struct RBT_Sharded_Tree *tree, int (*visit)(uintmax_t key, void *data, void *context), void *context) {
+    int completed = 1;
+
+    pthread_rwlock_rdlock(&tree->layout_lock);
+    for ( size_t i = 0; i < tree->shard_count && completed; ++i ) {
+        pthread_mutex_lock(&tree->shards[i]->lock);
+        completed = RBT_for_each(&tree->shards[i]->tree, visit, context);
+        pthread_mutex_unlock(&tree->shards[i]->lock);
+    }
+    pthread_rwlock_unlock(&tree->layout_lock);
+    return completed;
+}
+
+uintmax_t RBT_sharded_node_count(struct RBT_Sharded_Tree *tree) {
+    uintmax_t count = 0;
+
+    pthread_rwlock_rdlock(&tree->layout_lock);
+    for ( size_t i = 0; i < tree->shard_count; ++i ) {
+        pthread_mutex_lock(&tree->shards[i]->lock);
+        count += RBT_NODE_COUNT(&tree->shards[i]->tree);
+        pthread_mutex_unlock(&tree->shards[i]->lock);
+    }
+    pthread_rwlock_unlock(&tree->layout_lock);
+    return count;
+}
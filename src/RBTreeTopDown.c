@@ -0,0 +1,259 @@
+/**
+ * Top-down red-black tree
+ *
+ * Insertion splits every node with two red children on the way down, and deletion
+ * pushes a red node down along the search path, so the node that is finally
+ * attached or removed can be handled without walking back up. The descent keeps
+ * the parent, grandparent and great-grandparent of the current node at hand, which
+ * is all the context the rotations need. A false root above the real root removes
+ * the special cases for rotations at the top of the tree.
+ **/
+#include "RBTree/RBTreeTopDown.h"
+#include <stdlib.h>
+#include "RBMacros.h"
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+static inline struct RBT_TD_Node *RBT_TD_new_node(uintmax_t key, void *data) {
+    struct RBT_TD_Node *new_node = RBT_MALLOC( sizeof(struct RBT_TD_Node) );
+    if ( !new_node ) {
+        return NULL;
+    }
+    new_node->key = key;
+    new_node->data = data;
+    new_node->link[0] = NULL;
+    new_node->link[1] = NULL;
+    return new_node;
+}
+
+static void RBT_TD_recursive_destroy(struct RBT_TD_Node *node, void (*freedata)(void *)) {
+    while ( node != NULL ) {
+        struct RBT_TD_Node *right = node->link[1];
+        RBT_TD_recursive_destroy(node->link[0], freedata);
+        if ( freedata ) {
+            freedata(node->data);
+        }
+        RBT_FREE(node);
+        node = right;
+    }
+}
+
+// rotates the child opposite to dir up, coloring the old root red and the new root black
+static inline struct RBT_TD_Node *RBT_TD_single_rotate(struct RBT_TD_Node *root, int dir) {
+    struct RBT_TD_Node *save = root->link[!dir];
+
+    root->link[!dir] = save->link[dir];
+    save->link[dir] = root;
+
+    RBT_SET_RED(root);
+    RBT_SET_BLACK(save);
+    return save;
+}
+
+static inline struct RBT_TD_Node *RBT_TD_double_rotate(struct RBT_TD_Node *root, int dir) {
+    root->link[!dir] = RBT_TD_single_rotate(root->link[!dir], !dir);
+    return RBT_TD_single_rotate(root, dir);
+}
+
+static inline struct RBT_TD_Node *RBT_TD_iterative_find(struct RBT_TD_Node *node, uintmax_t key) {
+    while ( node != NULL && RBT_KEYVALUE(node->key) != RBT_KEYVALUE(key) ) {
+        node = node->link[ RBT_KEYVALUE(node->key) < RBT_KEYVALUE(key) ];
+    }
+    return node;
+}
+
+static inline struct RBT_TD_Node *RBT_TD_extreme(struct RBT_TD_Node *node, int dir) {
+    if ( node == NULL ) {
+        return NULL;
+    }
+    while ( node->link[dir] != NULL ) {
+        node = node->link[dir];
+    }
+    return node;
+}
+
+static inline int RBT_TD_get_extreme(struct RBT_TD_Tree *tree, int dir, uintmax_t *key, void **value) {
+    struct RBT_TD_Node *node = RBT_TD_extreme(tree->root, dir);
+    if ( !node ) {
+        return 0;
+    }
+    if ( key ) {
+        *key = RBT_KEYVALUE(node->key);
+    }
+    if ( value ) {
+        *value = node->data;
+    }
+    return 1;
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_TD_init_tree(struct RBT_TD_Tree *tree) {
+    if ( !tree ) {
+        return 0;
+    }
+    tree->root = NULL;
+    tree->node_count = 0;
+    return 1;
+}
+
+void RBT_TD_deinit_tree(struct RBT_TD_Tree *tree, void (*freedata)(void *)) {
+    RBT_TD_recursive_destroy(tree->root, freedata);
+    tree->root = NULL;
+    tree->node_count = 0;
+}
+
+void *RBT_TD_add(struct RBT_TD_Tree *tree, uintmax_t key, void *data) {
+    struct RBT_TD_Node *node = RBT_TD_new_node(RBT_KEYVALUE(key), data);
+    if ( node == NULL ) {
+        return NULL;
+    }
+    tree->node_count++;
+
+    if ( tree->root == NULL ) {
+        tree->root = node;
+        return data;
+    }
+    RBT_SET_RED(node);
+
+    struct RBT_TD_Node head = { 0, NULL, { NULL, NULL } };
+    struct RBT_TD_Node *great = &head;     // great-grandparent
+    struct RBT_TD_Node *grand = NULL;
+    struct RBT_TD_Node *parent = NULL;
+    struct RBT_TD_Node *iterator = tree->root;
+    int dir = 0;
+    int last = 0;
+
+    head.link[1] = tree->root;
+    for (;;) {
+        if ( iterator == NULL ) {
+            parent->link[dir] = iterator = node;
+        } else if ( RBT_IS_RED( iterator->link[0] ) && RBT_IS_RED( iterator->link[1] ) ) {
+            // split the 4-node on the way down
+            RBT_SET_RED( iterator );
+            RBT_SET_BLACK( iterator->link[0] );
+            RBT_SET_BLACK( iterator->link[1] );
+        }
+
+        if ( RBT_IS_RED( iterator ) && RBT_IS_RED( parent ) ) {
+            int dir2 = great->link[1] == grand;
+            if ( iterator == parent->link[last] ) {
+                great->link[dir2] = RBT_TD_single_rotate(grand, !last);
+            } else {
+                great->link[dir2] = RBT_TD_double_rotate(grand, !last);
+            }
+        }
+
+        if ( iterator == node ) {
+            break;
+        }
+
+        // equal keys are placed to the right, as in RBT_insert
+        last = dir;
+        dir = RBT_KEYVALUE(iterator->key) <= RBT_KEYVALUE(key);
+
+        if ( grand != NULL ) {
+            great = grand;
+        }
+        grand = parent;
+        parent = iterator;
+        iterator = iterator->link[dir];
+    }
+
+    tree->root = head.link[1];
+    RBT_SET_BLACK(tree->root);
+    return data;
+}
+
+int RBT_TD_delete(struct RBT_TD_Tree *tree, uintmax_t key) {
+    if ( tree->root == NULL ) {
+        return 0;
+    }
+
+    struct RBT_TD_Node head = { 0, NULL, { NULL, tree->root } };
+    struct RBT_TD_Node *iterator = &head;
+    struct RBT_TD_Node *grand = NULL;
+    struct RBT_TD_Node *parent = NULL;
+    struct RBT_TD_Node *found = NULL;
+    int dir = 1;
+
+    key = RBT_KEYVALUE(key);
+    while ( iterator->link[dir] != NULL ) {
+        int last = dir;
+
+        grand = parent;
+        parent = iterator;
+        iterator = iterator->link[dir];
+
+        // on a match, keep descending towards the in-order predecessor, which takes its place
+        dir = RBT_KEYVALUE(iterator->key) < key;
+        if ( RBT_KEYVALUE(iterator->key) == key ) {
+            found = iterator;
+        }
+
+        // push a red node down, so the node finally unlinked is red
+        if ( RBT_IS_BLACK( iterator ) && RBT_IS_BLACK( iterator->link[dir] ) ) {
+            if ( RBT_IS_RED( iterator->link[!dir] ) ) {
+                parent = parent->link[last] = RBT_TD_single_rotate(iterator, dir);
+            } else {
+                struct RBT_TD_Node *sibling = parent->link[!last];
+
+                if ( sibling == NULL ) {
+                    continue;
+                }
+                if ( RBT_IS_BLACK( sibling->link[!last] ) && RBT_IS_BLACK( sibling->link[last] ) ) {
+                    RBT_SET_BLACK( parent );
+                    RBT_SET_RED( sibling );
+                    RBT_SET_RED( iterator );
+                } else {
+                    int dir2 = grand->link[1] == parent;
+
+                    if ( RBT_IS_RED( sibling->link[last] ) ) {
+                        grand->link[dir2] = RBT_TD_double_rotate(parent, last);
+                    } else {
+                        grand->link[dir2] = RBT_TD_single_rotate(parent, last);
+                    }
+                    RBT_SET_RED( iterator );
+                    RBT_SET_RED( grand->link[dir2] );
+                    RBT_SET_BLACK( grand->link[dir2]->link[0] );
+                    RBT_SET_BLACK( grand->link[dir2]->link[1] );
+                }
+            }
+        }
+    }
+
+    if ( found != NULL ) {
+        // the found node keeps its color, but takes the key and value of the unlinked node
+        found->key = (found->key & RBT_COLOR_BITMASK) | RBT_KEYVALUE(iterator->key);
+        found->data = iterator->data;
+        parent->link[ parent->link[1] == iterator ] = iterator->link[ iterator->link[0] == NULL ];
+        RBT_FREE(iterator);
+        tree->node_count--;
+    }
+
+    tree->root = head.link[1];
+    if ( tree->root != NULL ) {
+        RBT_SET_BLACK(tree->root);
+    }
+    return found != NULL;
+}
+
+void *RBT_TD_find(struct RBT_TD_Tree *tree, uintmax_t key) {
+    if ( tree == NULL ) {
+        return NULL;
+    }
+    struct RBT_TD_Node *node = RBT_TD_iterative_find(tree->root, key);
+    return node == NULL ? node : node->data;
+}
+
+int RBT_TD_get_maximum(struct RBT_TD_Tree *tree, uintmax_t *key, void **value) {
+    return RBT_TD_get_extreme(tree, 1, key, value);
+}
+
+int RBT_TD_get_minimum(struct RBT_TD_Tree *tree, uintmax_t *key, void **value) {
+    return RBT_TD_get_extreme(tree, 0, key, value);
+}
@@ -0,0 +1,189 @@
+/**
+ * Workload traces
+ *
+ * A trace file starts with an 8 byte magic, followed by records of:
+ *
+ *   u8 operation | varint key | varint nanoseconds since the previous record
+ *
+ * where the key is left out for RBT_TRACE_MINIMUM and RBT_TRACE_MAXIMUM, and varints hold
+ * 7 bits per byte, least significant first, with the top bit set on all but the last byte.
+ * A record torn by the recording process dying ends the trace early, marking it as failed.
+ **/
+#define _POSIX_C_SOURCE 200809L
+#include "RBTree/RBTreeTrace.h"
+#include <string.h>
+#include <time.h>
+#include "RBTreeInternal.h"
+
+#define RBT_TRACE_MAGIC "RBTTRC01"
+#define RBT_TRACE_MAGIC_SIZE 8
+#define RBT_VARINT_MAX_SIZE 10
+
+// an operation byte and two varints
+#define RBT_RECORD_MAX_SIZE (1 + 2 * RBT_VARINT_MAX_SIZE)
+
+
+/* ---- PRIVATE FUNCTIONS ---- */
+
+
+static inline uint64_t RBT_trace_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * UINT64_C(1000000000) + (uint64_t) now.tv_nsec;
+}
+
+static inline int RBT_trace_has_key(unsigned operation) {
+    return operation == RBT_TRACE_ADD || operation == RBT_TRACE_FIND || operation == RBT_TRACE_DELETE;
+}
+
+static inline size_t RBT_put_varint(unsigned char *out, uint64_t value) {
+    size_t size = 0;
+    while ( value >= 0x80 ) {
+        out[size++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = (unsigned char) value;
+    return size;
+}
+
+// reads a varint, failing the trace if it is torn or too long
+static int RBT_get_varint(struct RBT_Trace *trace, uint64_t *value) {
+    *value = 0;
+    for ( unsigned shift = 0; shift < 7 * RBT_VARINT_MAX_SIZE; shift += 7 ) {
+        int byte = getc(trace->file);
+        if ( byte == EOF ) {
+            break;
+        }
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+        if ( (byte & 0x80) == 0 ) {
+            return 1;
+        }
+    }
+    trace->failed = 1;
+    return 0;
+}
+
+static int RBT_trace_flush(struct RBT_Trace *trace) {
+    if ( trace->buffered > 0 && fwrite(trace->buffer, 1, trace->buffered, trace->file) != trace->buffered ) {
+        trace->failed = 1;
+    }
+    trace->buffered = 0;
+    return !trace->failed;
+}
+
+static int RBT_trace_init(struct RBT_Trace *trace, const char *path, const char *mode) {
+    if ( trace == NULL || path == NULL ) {
+        return 0;
+    }
+    trace->file = fopen(path, mode);
+    if ( trace->file == NULL ) {
+        return 0;
+    }
+    trace->start = RBT_trace_clock();
+    trace->timestamp = 0;
+    trace->event_count = 0;
+    trace->failed = 0;
+    trace->buffered = 0;
+    return 1;
+}
+
+
+/* --- PUBLIC FUNCTIONS --- */
+
+
+int RBT_trace_open(struct RBT_Trace *trace, const char *path) {
+    if ( !RBT_trace_init(trace, path, "wb") ) {
+        return 0;
+    }
+    memcpy(trace->buffer, RBT_TRACE_MAGIC, RBT_TRACE_MAGIC_SIZE);
+    trace->buffered = RBT_TRACE_MAGIC_SIZE;
+    return 1;
+}
+
+int RBT_trace_open_read(struct RBT_Trace *trace, const char *path) {
+    char magic[RBT_TRACE_MAGIC_SIZE];
+
+    if ( !RBT_trace_init(trace, path, "rb") ) {
+        return 0;
+    }
+    if ( fread(magic, 1, sizeof(magic), trace->file) != sizeof(magic) ||
+         memcmp(magic, RBT_TRACE_MAGIC, RBT_TRACE_MAGIC_SIZE) != 0 ) {
+        fclose(trace->file);
+        trace->file = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+int RBT_trace_close(struct RBT_Trace *trace) {
+    if ( trace == NULL || trace->file == NULL ) {
+        return 0;
+    }
+    RBT_trace_flush(trace);
+    if ( fclose(trace->file) != 0 ) {
+        trace->failed = 1;
+    }
+    trace->file = NULL;
+    return !trace->failed;
+}
+
+int RBT_set_trace(struct RBT_Tree *tree, struct RBT_Trace *trace) {
+    if ( tree == NULL ) {
+        return 0;
+    }
+    if ( trace == NULL && tree->extension == NULL ) {
+        return 1;
+    }
+    if ( RBT_extend(tree) == NULL ) {
+        return 0;
+    }
+    tree->extension->trace = trace;
+    return 1;
+}
+
+void RBT_trace_record(struct RBT_Trace *trace, enum RBT_Trace_Operation operation, uintmax_t key) {
+    uint64_t timestamp = RBT_trace_clock() - trace->start;
+    unsigned char *out;
+
+    if ( trace->buffered + RBT_RECORD_MAX_SIZE > RBT_TRACE_BUFFER_SIZE ) {
+        RBT_trace_flush(trace);
+    }
+    out = trace->buffer + trace->buffered;
+    *out++ = (unsigned char) operation;
+    if ( RBT_trace_has_key(operation) ) {
+        out += RBT_put_varint(out, (uint64_t) key);
+    }
+    out += RBT_put_varint(out, timestamp - trace->timestamp);
+    trace->buffered = (size_t) (out - trace->buffer);
+    trace->timestamp = timestamp;
+    trace->event_count++;
+}
+
+int RBT_trace_read(struct RBT_Trace *trace, struct RBT_Trace_Event *event) {
+    uint64_t key = 0;
+    uint64_t elapsed;
+
+    if ( trace == NULL || trace->file == NULL || trace->failed ) {
+        return 0;
+    }
+    int operation = getc(trace->file);
+    if ( operation == EOF ) {
+        return 0;
+    }
+    if ( operation < RBT_TRACE_ADD || operation > RBT_TRACE_MAXIMUM ) {
+        trace->failed = 1;
+        return 0;
+    }
+    if ( RBT_trace_has_key((unsigned) operation) && !RBT_get_varint(trace, &key) ) {
+        return 0;
+    }
+    if ( !RBT_get_varint(trace, &elapsed) ) {
+        return 0;
+    }
+    trace->timestamp += elapsed;
+    trace->event_count++;
+    event->operation = (enum RBT_Trace_Operation) operation;
+    event->key = (uintmax_t) key;
+    event->timestamp = trace->timestamp;
+    return 1;
+}
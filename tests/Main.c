@@ -1,4 +1,16 @@
 #include "RBTreeTest.h"
+#include "RBTreeShardedTest.h"
+#include "RBTreeParallelTest.h"
+#include "RBTreeGenerateTest.h"
+#include "RBTreeTopDownTest.h"
+#include "RBTreeDurableTest.h"
+#include "RBTreeBPlusTest.h"
+#include "RBTreeBufferedTest.h"
+#include "RBTreeMappedTest.h"
+#include "RBTreeMerkleTest.h"
+#include "RBTreeSetTest.h"
+#include "RBTreeConcurrentTest.h"
+#include "RBTreeTraceTest.h"
 #include "cutest/cutest.h"
 
 TEST_LIST = {
@@ -8,5 +20,48 @@ TEST_LIST = {
        { "getting minimum and maximum from empty tree", RBT_test_min_max_null },
        { "deleting nodes in tree", RBT_test_remove },
        { "static allocation", RBT_test_static_allocate_nodes },
+       { "deleting every node in tree", RBT_test_remove_all },
+       { "aggregating key ranges", RBT_test_range_aggregate },
+       { "lazy deletion and purging", RBT_test_lazy_delete },
+       { "hash index for exact lookups", RBT_test_hash_index },
+       { "finger search from the last lookup", RBT_test_finger_find },
+       { "deleting key ranges by splitting", RBT_test_delete_range },
+       { "evicting from a tree at its capacity", RBT_test_capacity },
+       { "positional sequence operations", RBT_test_sequence },
+       { "WAVL balancing policy", RBT_test_wavl_balance },
+       { "lookup filter turning away misses", RBT_test_lookup_filter },
+       { "memory accounting and budgets", RBT_test_memory_accounting },
+       { "inline entries of small trees", RBT_test_inline_entries },
+       { "reserving nodes ahead of additions", RBT_test_reserve },
+       { "concurrent writers on sharded tree", RBT_test_sharded_concurrent_add },
+       { "splitting and merging shards", RBT_test_sharded_split_merge },
+       { "shards of duplicate keys", RBT_test_sharded_duplicates },
+       { "parallel sorted build and teardown", RBT_test_parallel_build },
+       { "parallel teardown of a configured tree", RBT_test_parallel_deinit_options },
+       { "parallel visiting of every node", RBT_test_parallel_for_each },
+       { "deterministic parallel reduction", RBT_test_parallel_reduce },
+       { "generated type specialized tree", RBT_test_generated_tree },
+       { "top-down insertion and deletion", RBT_test_top_down_operations },
+       { "top-down tree with duplicate keys", RBT_test_top_down_duplicates },
+       { "recovering a durable tree from its log", RBT_test_durable_recovery },
+       { "checkpointing a durable tree", RBT_test_durable_checkpoint },
+       { "cutting torn writes off a durable log", RBT_test_durable_short_write },
+       { "durable additions the tree turns away", RBT_test_durable_refused_add },
+       { "B+-tree insertion and deletion", RBT_test_bplus_operations },
+       { "B+-tree with duplicate keys", RBT_test_bplus_duplicates },
+       { "RBT interface on the B+-tree engine", RBT_test_bplus_engine },
+       { "buffered additions and deletions", RBT_test_buffered_operations },
+       { "merging ascending write buffers", RBT_test_buffered_ascending_merge },
+       { "write buffers over a configured tree", RBT_test_buffered_options },
+       { "reopening a memory-mapped tree", RBT_test_mapped_reopen },
+       { "reusing space in a memory-mapped tree", RBT_test_mapped_reuse_space },
+       { "hashing trees independently of their shape", RBT_test_merkle_order_independent },
+       { "diffing Merkle hashed trees", RBT_test_merkle_diff },
+       { "key set insertion and erasure", RBT_test_set_operations },
+       { "ordered iteration of key sets", RBT_test_set_ordered_iteration },
+       { "concurrent writers with relaxed balancing", RBT_test_concurrent_writers },
+       { "rebalancing and purging concurrent trees", RBT_test_concurrent_maintenance },
+       { "recording and reading workload traces", RBT_test_trace_round_trip },
+       { "reading truncated workload traces", RBT_test_trace_truncated },
        { 0 }
 };
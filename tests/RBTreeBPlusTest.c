@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeBPlusTest.h"
+#include "RBTree/RBTreeBuffered.h"
+#include "RBTreeInternal.h"
+
+// returns the depth of the leaves below node, or zero if the node or its subtree is malformed
+static unsigned RBT_BP_check_node(struct RBT_BP_Node *node, int is_root, uintmax_t lower, uintmax_t upper) {
+    if ( node->count > RBT_BP_ORDER || (!is_root && node->count < RBT_BP_ORDER / 2) ) {
+        return 0;
+    }
+    for ( unsigned i = 0; i < RBT_BP_ORDER; ++i ) {
+        if ( i < node->count && (node->keys[i] < lower || node->keys[i] > upper || (i > 0 && node->keys[i - 1] > node->keys[i])) ) {
+            return 0;
+        }
+        if ( i >= node->count && node->keys[i] != UINTMAX_MAX ) {
+            return 0;
+        }
+    }
+    if ( node->leaf ) {
+        return 1;
+    }
+    struct RBT_BP_Inner *inner = (struct RBT_BP_Inner *) node;
+    unsigned depth = 0;
+    for ( unsigned i = 0; i <= node->count; ++i ) {
+        uintmax_t child_lower = i == 0 ? lower : node->keys[i - 1];
+        uintmax_t child_upper = i == node->count ? upper : node->keys[i];
+        unsigned child_depth = RBT_BP_check_node(inner->children[i], 0, child_lower, child_upper);
+        if ( child_depth == 0 || (depth != 0 && child_depth != depth) ) {
+            return 0;
+        }
+        depth = child_depth;
+    }
+    return depth + 1;
+}
+
+static void RBT_test_is_BP_tree(struct RBT_BP_Tree *tree) {
+    if ( tree->root == NULL ) {
+        TEST_CHECK( RBT_NODE_COUNT(tree) == 0 && tree->height == 0 );
+        return;
+    }
+    TEST_CHECK_( RBT_BP_check_node(tree->root, 1, 0, UINTMAX_MAX) == tree->height, "B+ properties: malformed node or unequal leaf depth" );
+}
+
+static int RBT_BP_count_ordered(uintmax_t key, void *data, void *context) {
+    uintmax_t *state = context;
+    (void) data;
+    if ( state[1] > 0 && key < state[0] ) {
+        return 0;
+    }
+    state[0] = key;
+    state[1]++;
+    return 1;
+}
+
+void RBT_test_bplus_operations() {
+    static int values[8192];
+    static int present[8192];
+    struct RBT_BP_Tree tree;
+
+    RBT_BP_init_tree(&tree);
+
+    srand(11);
+    for ( int i = 0; i < 60000; ++i ) {
+        int key = rand() % 8192;
+        if ( present[key] ) {
+            TEST_CHECK( RBT_BP_delete(&tree, key) );
+            present[key] = 0;
+        } else {
+            TEST_CHECK( RBT_BP_add(&tree, key, &values[key]) == &values[key] );
+            present[key] = 1;
+        }
+        if ( i % 2000 == 0 ) {
+            RBT_test_is_BP_tree(&tree);
+        }
+    }
+    RBT_test_is_BP_tree(&tree);
+    TEST_CHECK( tree.height > 1 );
+
+    uintmax_t count = 0;
+    int minimum = -1, maximum = -1;
+    for ( int key = 0; key < 8192; ++key ) {
+        TEST_CHECK( RBT_BP_find(&tree, key) == (present[key] ? &values[key] : NULL) );
+        if ( present[key] ) {
+            count++;
+            minimum = minimum < 0 ? key : minimum;
+            maximum = key;
+        }
+    }
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == count );
+    TEST_CHECK( !RBT_BP_delete(&tree, 10000) );
+    TEST_CHECK( RBT_BP_find(&tree, 10000) == NULL );
+
+    uintmax_t key;
+    void *value;
+    TEST_CHECK( RBT_BP_get_minimum(&tree, &key, &value) && key == (uintmax_t) minimum && value == &values[minimum] );
+    TEST_CHECK( RBT_BP_get_maximum(&tree, &key, NULL) && key == (uintmax_t) maximum );
+
+    uintmax_t state[2] = { 0, 0 };
+    TEST_CHECK( RBT_BP_for_each(&tree, RBT_BP_count_ordered, state) );
+    TEST_CHECK( state[1] == count );
+
+    for ( int key = 0; key < 8192; ++key ) {
+        TEST_CHECK( RBT_BP_delete(&tree, key) == present[key] );
+    }
+    TEST_CHECK( tree.root == NULL && RBT_NODE_COUNT(&tree) == 0 && tree.bytes == 0 && tree.slack == 0 );
+    TEST_CHECK( !RBT_BP_get_minimum(&tree, NULL, NULL) );
+
+    RBT_BP_deinit_tree(&tree, NULL);
+}
+
+void RBT_test_bplus_duplicates() {
+    struct RBT_BP_Tree tree;
+    RBT_BP_init_tree(&tree);
+
+    for ( int i = 0; i < 1024; ++i ) {
+        RBT_BP_add(&tree, i % 4, NULL);
+    }
+    RBT_test_is_BP_tree(&tree);
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == 1024 );
+
+    int deleted = 0;
+    while ( RBT_BP_delete(&tree, 2) ) {
+        deleted++;
+        if ( deleted % 32 == 0 ) {
+            RBT_test_is_BP_tree(&tree);
+        }
+    }
+    TEST_CHECK( deleted == 256 );
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == 768 );
+    RBT_test_is_BP_tree(&tree);
+
+    uintmax_t state[2] = { 0, 0 };
+    TEST_CHECK( RBT_BP_for_each(&tree, RBT_BP_count_ordered, state) && state[1] == 768 );
+
+    for ( int i = 0; i < 768; ++i ) {
+        TEST_CHECK( RBT_BP_delete(&tree, (i % 3 == 2) ? 3 : i % 3) );
+    }
+    TEST_CHECK( tree.root == NULL );
+
+    RBT_BP_deinit_tree(&tree, NULL);
+}
+
+void RBT_test_bplus_engine() {
+    static int values[4096];
+    static int present[4096];
+    struct RBT_Tree tree;
+    struct RBT_Memory_Usage usage, before, after;
+    struct RBT_Finger finger = RBT_FINGER_INIT;
+
+    // options working on the binary nodes rule the engine out, and are refused by it
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_hash_index(&tree, 1) && !RBT_set_engine(&tree, RBT_ENGINE_BPLUS) );
+    RBT_deinit_tree(&tree, NULL);
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_engine(&tree, RBT_ENGINE_BPLUS) && RBT_set_engine(&tree, RBT_ENGINE_BPLUS) );
+    TEST_CHECK( !RBT_set_hash_index(&tree, 1) && !RBT_set_lookup_filter(&tree, 1) );
+    TEST_CHECK( !RBT_set_capacity(&tree, 8, RBT_EVICT_MINIMUM, NULL, NULL) && !RBT_set_lazy_delete(&tree, 50) );
+    TEST_CHECK( !RBT_set_inline_entries(&tree, 1) && !RBT_set_balance(&tree, RBT_BALANCE_WAVL) );
+    TEST_CHECK( !RBT_set_memory_budget(&tree, 4096) && !RBT_reserve(&tree, 8) );
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) && usage.nodes == 0 && usage.slack == 0 );
+    RBT_get_global_memory_usage(&before);
+
+    srand(23);
+    for ( int i = 0; i < 40000; ++i ) {
+        int key = rand() % 4096;
+        if ( present[key] ) {
+            TEST_CHECK( RBT_delete(&tree, key) );
+            present[key] = 0;
+        } else {
+            TEST_CHECK( RBT_add(&tree, key, &values[key]) == &values[key] );
+            present[key] = 1;
+        }
+    }
+    RBT_test_is_BP_tree(tree.extension->bplus);
+    TEST_CHECK( tree.root == NULL && !RBT_set_engine(&tree, RBT_ENGINE_RED_BLACK) );
+
+    // the wide nodes are accounted for like binary ones, in the tree and in the whole process
+    RBT_get_global_memory_usage(&after);
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) && usage.nodes >= sizeof(struct RBT_BP_Leaf) );
+    TEST_CHECK( after.nodes - before.nodes == usage.nodes && after.slack - before.slack == usage.slack );
+
+    uintmax_t count = 0;
+    int minimum = -1, maximum = -1;
+    for ( int key = 0; key < 4096; ++key ) {
+        TEST_CHECK( RBT_find(&tree, key) == (present[key] ? &values[key] : NULL) );
+        TEST_CHECK( RBT_finger_find(&tree, &finger, key) == (present[key] ? &values[key] : NULL) );
+        if ( present[key] ) {
+            count++;
+            minimum = minimum < 0 ? key : minimum;
+            maximum = key;
+        }
+    }
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == count && !RBT_delete(&tree, 5000) );
+
+    uintmax_t key;
+    void *value;
+    TEST_CHECK( RBT_get_minimum(&tree, &key, &value) && key == (uintmax_t) minimum && value == &values[minimum] );
+    TEST_CHECK( RBT_get_maximum(&tree, &key, NULL) && key == (uintmax_t) maximum );
+
+    uintmax_t state[2] = { 0, 0 };
+    TEST_CHECK( RBT_for_each(&tree, RBT_BP_count_ordered, state) && state[1] == count );
+    TEST_CHECK( RBT_delete_range(&tree, 0, 4096, NULL) == 0 && RBT_NODE_COUNT(&tree) == count );
+
+    RBT_deinit_tree(&tree, NULL);
+    TEST_CHECK( tree.extension == NULL && RBT_NODE_COUNT(&tree) == 0 );
+    RBT_get_global_memory_usage(&after);
+    TEST_CHECK( after.nodes == before.nodes && after.slack == before.slack );
+
+    // a write buffer counts duplicates in the B+-tree when deciding whether a deletion has anything left
+    struct RBT_Buffered_Tree buffered;
+    TEST_CHECK( RBT_buffered_init_tree(&buffered, 16) && RBT_set_engine(&buffered.tree, RBT_ENGINE_BPLUS) );
+    for ( int i = 0; i < 200; ++i ) {
+        RBT_buffered_add(&buffered, i % 2, &values[i % 2]);
+    }
+    TEST_CHECK( RBT_buffered_flush(&buffered) && RBT_NODE_COUNT(&buffered.tree) == 200 );
+    for ( int i = 0; i < 100; ++i ) {
+        TEST_CHECK( RBT_buffered_delete(&buffered, 1) );
+    }
+    TEST_CHECK( !RBT_buffered_delete(&buffered, 1) && RBT_buffered_find(&buffered, 1) == NULL );
+    TEST_CHECK( RBT_buffered_flush(&buffered) && RBT_find(&buffered.tree, 1) == NULL );
+    TEST_CHECK( RBT_NODE_COUNT(&buffered.tree) == 100 && RBT_find(&buffered.tree, 0) == &values[0] );
+    RBT_buffered_deinit_tree(&buffered, NULL);
+}
@@ -0,0 +1,10 @@
+#ifndef _HEADER_FILE_RBTreeBPlusTest_20261019165530_
+#define _HEADER_FILE_RBTreeBPlusTest_20261019165530_
+
+#include "RBTree/RBTreeBPlus.h"
+
+void RBT_test_bplus_operations(void);
+void RBT_test_bplus_duplicates(void);
+void RBT_test_bplus_engine(void);
+
+#endif
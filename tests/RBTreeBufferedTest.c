@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeBufferedTest.h"
+#include "RBTreeTest.h"
+
+void RBT_test_buffered_operations() {
+    static int values[512];
+    static int counts[512];
+    struct RBT_Buffered_Tree tree;
+    uintmax_t count = 0;
+
+    TEST_CHECK( !RBT_buffered_init_tree(&tree, 0) );
+    TEST_CHECK( RBT_buffered_init_tree(&tree, 16) );
+
+    srand(17);
+    for ( int i = 0; i < 20000; ++i ) {
+        int key = rand() % 512;
+        if ( rand() % 2 ) {
+            TEST_CHECK( RBT_buffered_add(&tree, key, &values[key]) == &values[key] );
+            counts[key]++;
+            count++;
+        } else {
+            TEST_CHECK( RBT_buffered_delete(&tree, key) == (counts[key] > 0) );
+            if ( counts[key] > 0 ) {
+                counts[key]--;
+                count--;
+            }
+        }
+        key = rand() % 512;
+        TEST_CHECK( RBT_buffered_find(&tree, key) == (counts[key] > 0 ? &values[key] : NULL) );
+        TEST_CHECK( RBT_NODE_COUNT(&tree) == count );
+    }
+
+    TEST_CHECK( RBT_buffered_flush(&tree) && tree.op_count == 0 );
+    TEST_CHECK( RBT_NODE_COUNT(&tree.tree) == count );
+    RBT_test_is_RB_tree(&tree.tree);
+
+    int minimum = -1, maximum = -1;
+    for ( int key = 0; key < 512; ++key ) {
+        TEST_CHECK( RBT_buffered_find(&tree, key) == (counts[key] > 0 ? &values[key] : NULL) );
+        if ( counts[key] > 0 ) {
+            minimum = minimum < 0 ? key : minimum;
+            maximum = key;
+        }
+    }
+    uintmax_t key;
+    TEST_CHECK( RBT_buffered_get_minimum(&tree, &key, NULL) && key == (uintmax_t) minimum );
+    TEST_CHECK( RBT_buffered_get_maximum(&tree, &key, NULL) && key == (uintmax_t) maximum );
+
+    RBT_buffered_deinit_tree(&tree, NULL);
+}
+
+void RBT_test_buffered_ascending_merge() {
+    static int values[4096];
+    struct RBT_Buffered_Tree tree;
+
+    TEST_CHECK( RBT_buffered_init_tree(&tree, 256) );
+
+    // interleaved batches, so every merge inserts between nodes of earlier merges
+    for ( int batch = 0; batch < 16; ++batch ) {
+        for ( int i = batch; i < 4096; i += 16 ) {
+            RBT_buffered_add(&tree, i, &values[i]);
+        }
+        TEST_CHECK( tree.op_count == 0 || RBT_buffered_flush(&tree) );
+        RBT_test_is_RB_tree(&tree.tree);
+    }
+    TEST_CHECK( RBT_NODE_COUNT(&tree.tree) == 4096 );
+
+    // a deletion cancels a buffered addition without reaching the tree
+    RBT_buffered_add(&tree, 5000, &values[0]);
+    TEST_CHECK( tree.op_count == 1 && RBT_buffered_delete(&tree, 5000) && tree.op_count == 0 );
+    TEST_CHECK( !RBT_buffered_delete(&tree, 5000) );
+
+    TEST_CHECK( RBT_buffered_delete(&tree, 7) && tree.op_count == 1 );
+    TEST_CHECK( RBT_buffered_find(&tree, 7) == NULL );
+    TEST_CHECK( !RBT_buffered_delete(&tree, 7) );
+    TEST_CHECK( RBT_buffered_add(&tree, 7, &values[1]) == &values[1] );
+    TEST_CHECK( RBT_buffered_find(&tree, 7) == &values[1] );
+    TEST_CHECK( RBT_buffered_flush(&tree) && RBT_find(&tree.tree, 7) == &values[1] );
+
+    for ( int i = 0; i < 4096; ++i ) {
+        TEST_CHECK( RBT_find(&tree.tree, i) == &values[i == 7 ? 1 : i] );
+    }
+
+    RBT_buffered_deinit_tree(&tree, NULL);
+}
+
+static void RBT_count_evicted(uintmax_t key, void *data, void *context) {
+    (void)key;
+    (void)data;
+    ++*(int *)context;
+}
+
+void RBT_test_buffered_options() {
+    static int values[64];
+    struct RBT_Buffered_Tree tree;
+    int evicted = 0;
+
+    // inline entries, filling the array and moving into nodes within a single merge
+    TEST_CHECK( RBT_buffered_init_tree(&tree, 8) );
+    TEST_CHECK( RBT_set_inline_entries(&tree.tree, 1) );
+    for ( int i = 0; i < 3; ++i ) {
+        RBT_buffered_add(&tree, i, &values[i]);
+    }
+    TEST_CHECK( RBT_buffered_flush(&tree) && RBT_NODE_COUNT(&tree.tree) == 3 && tree.tree.root == NULL );
+    TEST_CHECK( RBT_buffered_delete(&tree, 1) && RBT_buffered_find(&tree, 1) == NULL );
+    TEST_CHECK( !RBT_buffered_delete(&tree, 1) );
+    for ( int i = 8; i < 40; ++i ) {
+        RBT_buffered_add(&tree, i, &values[i]);
+    }
+    TEST_CHECK( RBT_buffered_flush(&tree) && RBT_NODE_COUNT(&tree.tree) == 34 );
+    RBT_test_is_RB_tree(&tree.tree);
+    for ( int i = 0; i < 40; ++i ) {
+        TEST_CHECK( RBT_find(&tree.tree, i) == (i == 0 || i == 2 || i >= 8 ? &values[i] : NULL) );
+    }
+    RBT_buffered_deinit_tree(&tree, NULL);
+
+    // the hash index learns about every merged node
+    TEST_CHECK( RBT_buffered_init_tree(&tree, 16) );
+    TEST_CHECK( RBT_set_hash_index(&tree.tree, 1) );
+    for ( int i = 63; i >= 0; --i ) {
+        RBT_buffered_add(&tree, i, &values[i]);
+    }
+    TEST_CHECK( RBT_buffered_flush(&tree) && RBT_NODE_COUNT(&tree.tree) == 64 );
+    RBT_test_is_RB_tree(&tree.tree);
+    for ( int i = 0; i < 64; ++i ) {
+        TEST_CHECK( RBT_find(&tree.tree, i) == &values[i] );
+    }
+    RBT_buffered_deinit_tree(&tree, NULL);
+
+    // a bounded tree evicts while merging, and turns away what it would evict right away
+    TEST_CHECK( RBT_buffered_init_tree(&tree, 16) );
+    TEST_CHECK( RBT_set_capacity(&tree.tree, 10, RBT_EVICT_MINIMUM, RBT_count_evicted, &evicted) );
+    for ( int i = 32; i < 64; ++i ) {
+        RBT_buffered_add(&tree, i, &values[i]);
+    }
+    TEST_CHECK( RBT_buffered_flush(&tree) && tree.op_count == 0 );
+    TEST_CHECK( RBT_NODE_COUNT(&tree.tree) == 10 && RBT_NODE_COUNT(&tree) == 10 && evicted == 22 );
+    RBT_buffered_add(&tree, 0, &values[0]);
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == 11 );
+    TEST_CHECK( RBT_buffered_flush(&tree) && evicted == 23 && RBT_find(&tree.tree, 0) == NULL );
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == 10 );
+    RBT_test_is_RB_tree(&tree.tree);
+    for ( int i = 54; i < 64; ++i ) {
+        TEST_CHECK( RBT_find(&tree.tree, i) == &values[i] );
+    }
+    RBT_buffered_deinit_tree(&tree, NULL);
+}
@@ -0,0 +1,10 @@
+#ifndef _HEADER_FILE_RBTreeBufferedTest_20261019172240_
+#define _HEADER_FILE_RBTreeBufferedTest_20261019172240_
+
+#include "RBTree/RBTreeBuffered.h"
+
+void RBT_test_buffered_operations(void);
+void RBT_test_buffered_ascending_merge(void);
+void RBT_test_buffered_options(void);
+
+#endif
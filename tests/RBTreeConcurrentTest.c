@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "cutest/pub_cutest.h"
+#include "RBMacros.h"
+#include "RBTreeConcurrentTest.h"
+
+#define WRITERS 4
+#define KEYS_PER_WRITER 4000
+
+struct RBT_test_concurrent_writer {
+    struct RBT_Concurrent_Tree *tree;
+    uintmax_t first;
+    pthread_t thread;
+};
+
+// spreads the keys of every writer over the whole key space
+static uintmax_t scattered_key(uintmax_t i) {
+    return (i * UINT64_C(0x9e3779b97f4a7c15)) >> 24;
+}
+
+static void *concurrent_writer(void *argument) {
+    struct RBT_test_concurrent_writer *writer = argument;
+    for ( uintmax_t i = writer->first; i < writer->first + KEYS_PER_WRITER; ++i ) {
+        RBT_concurrent_add(writer->tree, scattered_key(i), writer);
+        // every writer deletes a third of its own keys again
+        if ( i % 3 == 0 ) {
+            RBT_concurrent_delete(writer->tree, scattered_key(i));
+        }
+    }
+    return NULL;
+}
+
+// black height of a valid subtree, or -1 if it breaks a red-black or search tree property
+static int valid_black_height(struct RBT_Concurrent_Node *node, struct RBT_Concurrent_Node *parent) {
+    if ( node == NULL ) {
+        return 1;
+    }
+    if ( node->parent != parent || (RBT_IS_RED(node) && RBT_IS_RED(parent)) ) {
+        return -1;
+    }
+    if ( (node->left != NULL && RBT_KEYVALUE(node->left->key) >= RBT_KEYVALUE(node->key)) ||
+         (node->right != NULL && RBT_KEYVALUE(node->right->key) <= RBT_KEYVALUE(node->key)) ) {
+        return -1;
+    }
+    int left = valid_black_height(node->left, node);
+    int right = valid_black_height(node->right, node);
+    if ( left < 0 || left != right ) {
+        return -1;
+    }
+    return left + RBT_IS_BLACK(node);
+}
+
+static int count_element(uintmax_t key, void *data, void *context) {
+    (void) key; (void) data;
+    ++*(uintmax_t *) context;
+    return 1;
+}
+
+void RBT_test_concurrent_writers() {
+    struct RBT_Concurrent_Tree tree;
+    struct RBT_test_concurrent_writer writers[WRITERS];
+
+    TEST_CHECK( RBT_concurrent_init_tree(&tree, 64) );
+    for ( int i = 0; i < WRITERS; ++i ) {
+        writers[i].tree = &tree;
+        writers[i].first = (uintmax_t) i * KEYS_PER_WRITER;
+        pthread_create(&writers[i].thread, NULL, concurrent_writer, &writers[i]);
+    }
+    for ( int i = 0; i < WRITERS; ++i ) {
+        pthread_join(writers[i].thread, NULL);
+    }
+    RBT_concurrent_rebalance(&tree);
+
+    TEST_CHECK( tree.pending == NULL && valid_black_height(tree.root, NULL) > 0 );
+    TEST_CHECK( RBT_concurrent_node_count(&tree) == WRITERS * KEYS_PER_WRITER * 2 / 3 );
+    uintmax_t visited = 0;
+    TEST_CHECK( RBT_concurrent_for_each(&tree, count_element, &visited) );
+    TEST_CHECK( visited == RBT_concurrent_node_count(&tree) );
+    for ( uintmax_t i = 0; i < WRITERS * KEYS_PER_WRITER; ++i ) {
+        void *expected = i % 3 == 0 ? NULL : &writers[i / KEYS_PER_WRITER];
+        TEST_CHECK_( RBT_concurrent_find(&tree, scattered_key(i)) == expected, "key %ju", scattered_key(i) );
+    }
+    TEST_CHECK( RBT_concurrent_add(&tree, scattered_key(1), NULL) == NULL );
+    RBT_concurrent_deinit_tree(&tree, NULL);
+}
+
+void RBT_test_concurrent_maintenance() {
+    static long int values[4096];
+    struct RBT_Concurrent_Tree tree;
+
+    // without a threshold, ascending keys grow a single path until the tree is rebalanced
+    TEST_CHECK( RBT_concurrent_init_tree(&tree, 0) );
+    for ( int key = 0; key < 4096; ++key ) {
+        TEST_CHECK( RBT_concurrent_add(&tree, key, &values[key]) == &values[key] );
+    }
+    TEST_CHECK( tree.pending_count == 4096 && valid_black_height(tree.root, NULL) < 0 );
+    RBT_concurrent_rebalance(&tree);
+    TEST_CHECK( tree.pending_count == 0 && valid_black_height(tree.root, NULL) > 0 );
+
+    // deleting most keys leaves dead nodes until a pass finds half of the tree dead
+    for ( int key = 0; key < 3000; ++key ) {
+        TEST_CHECK( RBT_concurrent_delete(&tree, key) );
+    }
+    TEST_CHECK( !RBT_concurrent_delete(&tree, 0) && RBT_concurrent_find(&tree, 0) == NULL );
+    TEST_CHECK( RBT_concurrent_add(&tree, 0, &values[0]) == &values[0] );
+    TEST_CHECK( tree.dead_count == 2999 && tree.pending_count == 0 );
+    RBT_concurrent_rebalance(&tree);
+    TEST_CHECK( tree.dead_count == 0 && valid_black_height(tree.root, NULL) > 0 );
+    TEST_CHECK( RBT_concurrent_node_count(&tree) == 1097 );
+    for ( int key = 0; key < 4096; ++key ) {
+        TEST_CHECK( RBT_concurrent_find(&tree, key) == (key == 0 || key >= 3000 ? &values[key] : NULL) );
+    }
+    RBT_concurrent_deinit_tree(&tree, NULL);
+}
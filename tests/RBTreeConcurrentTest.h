@@ -0,0 +1,9 @@
+#ifndef _HEADER_FILE_RBTreeConcurrentTest_20261019185602_
+#define _HEADER_FILE_RBTreeConcurrentTest_20261019185602_
+
+#include "RBTree/RBTreeConcurrent.h"
+
+void RBT_test_concurrent_writers(void);
+void RBT_test_concurrent_maintenance(void);
+
+#endif
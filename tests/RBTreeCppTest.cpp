@@ -0,0 +1,135 @@
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include "RBTree/RBTree.hpp"
+#include "cutest/cutest.h"
+
+namespace {
+
+// counts the copies made of a value, which the map should never need
+struct tracked {
+    static int copies;
+
+    explicit tracked(int value) : value(value) {}
+    tracked(const tracked &other) : value(other.value) { ++copies; }
+    tracked(tracked &&other) noexcept : value(other.value) { other.value = -1; }
+    tracked &operator=(const tracked &other) { value = other.value; ++copies; return *this; }
+    tracked &operator=(tracked &&other) noexcept { value = other.value; other.value = -1; return *this; }
+
+    int value;
+};
+
+int tracked::copies = 0;
+
+}
+
+void RBT_test_cpp_map_operations() {
+    rbt::map<int, std::unique_ptr<int>> owners;
+    std::unique_ptr<int> spare(new int(7));
+
+    TEST_CHECK( owners.try_emplace(3, new int(3)).second );
+    TEST_CHECK( owners.emplace(1, std::unique_ptr<int>(new int(1))).second );
+    // a present key leaves the argument of try_emplace alone
+    TEST_CHECK( !owners.try_emplace(3, std::move(spare)).second );
+    TEST_CHECK( spare != nullptr && *spare == 7 );
+    TEST_CHECK( owners.insert_or_assign(3, std::move(spare)).second == false );
+    TEST_CHECK( *owners.at(3) == 7 && spare == nullptr );
+    TEST_CHECK( owners.size() == 2 );
+
+    rbt::map<int, tracked> values;
+    for ( int i = 0; i < 100; ++i ) {
+        values.try_emplace(i, i * 2);
+    }
+    values.emplace(std::piecewise_construct, std::forward_as_tuple(100), std::forward_as_tuple(200));
+    values.insert(std::make_pair(101, tracked(202)));
+    values.insert_or_assign(102, tracked(204));
+    rbt::map<int, tracked> moved(std::move(values));
+    TEST_CHECK( tracked::copies == 0 );
+    TEST_CHECK( values.empty() && moved.size() == 103 );
+
+    rbt::map<int, tracked> copied(moved);
+    TEST_CHECK( tracked::copies == 103 );
+    TEST_CHECK( copied.find(57)->second.value == 114 );
+    TEST_CHECK( copied.lower_bound(50)->first == 50 );
+    TEST_CHECK( copied.upper_bound(50)->first == 51 );
+    TEST_CHECK( (--copied.end())->first == 102 );
+
+    // random operations checked against std::map, in order
+    rbt::map<int, std::string> tree;
+    std::map<int, std::string> reference;
+    std::srand(23);
+    for ( int i = 0; i < 20000; ++i ) {
+        int key = std::rand() % 500;
+        if ( std::rand() % 3 == 0 ) {
+            TEST_CHECK( tree.erase(key) == reference.erase(key) );
+        } else {
+            TEST_CHECK( tree.try_emplace(key, std::to_string(i)).second
+                == reference.emplace(key, std::to_string(i)).second );
+        }
+    }
+    TEST_CHECK( tree.size() == reference.size() );
+    tree[1000] = "added";
+    reference[1000] = "added";
+    auto expected = reference.begin();
+    for ( const auto &element : tree ) {
+        TEST_CHECK( element.first == expected->first && element.second == expected->second );
+        ++expected;
+    }
+    auto reverse = reference.rbegin();
+    for ( auto position = tree.rbegin(); position != tree.rend(); ++position, ++reverse ) {
+        TEST_CHECK( position->first == reverse->first );
+    }
+    for ( auto position = tree.begin(); position != tree.end(); ) {
+        position = position->first % 2 ? tree.erase(position) : std::next(position);
+    }
+    for ( const auto &element : tree ) {
+        TEST_CHECK( element.first % 2 == 0 );
+    }
+}
+
+void RBT_test_cpp_map_node_handles() {
+    rbt::map<int, std::string> source, target;
+    for ( int i = 0; i < 64; ++i ) {
+        source.try_emplace(i, "value " + std::to_string(i));
+    }
+    target.try_emplace(100, "taken");
+
+    const std::string *element = &source.at(10);
+    auto handle = source.extract(10);
+    TEST_CHECK( !handle.empty() && handle.key() == 10 );
+    TEST_CHECK( source.size() == 63 && !source.contains(10) );
+    TEST_CHECK( !source.extract(10) );
+
+    // the node moves over as is, and keeps the address of its element
+    auto inserted = target.insert(std::move(handle));
+    TEST_CHECK( inserted.inserted && handle.empty() && inserted.node.empty() );
+    TEST_CHECK( &inserted.position->second == element );
+    TEST_CHECK( &target.at(10) == element );
+
+    // a key already present hands the node back
+    handle = source.extract(source.begin());
+    handle.key() = 100;
+    inserted = target.insert(std::move(handle));
+    TEST_CHECK( !inserted.inserted && inserted.position->second == "taken" );
+    TEST_CHECK( inserted.node.mapped() == "value 0" );
+    inserted.node.key() = 101;
+    TEST_CHECK( target.insert(std::move(inserted.node)).inserted );
+    TEST_CHECK( target.size() == 3 && target.at(101) == "value 0" );
+
+    while ( !source.empty() ) {
+        target.insert(source.extract(source.begin()));
+    }
+    TEST_CHECK( target.size() == 65 );
+    int previous = -1;
+    for ( const auto &element : target ) {
+        TEST_CHECK( element.first > previous );
+        previous = element.first;
+    }
+}
+
+TEST_LIST = {
+       { "C++ map operations", RBT_test_cpp_map_operations },
+       { "moving nodes between C++ maps", RBT_test_cpp_map_node_handles },
+       { nullptr, nullptr }
+};
@@ -0,0 +1,184 @@
+#define _XOPEN_SOURCE 700
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeDurableTest.h"
+
+static void durable_test_path(char *path, size_t size, const char *name) {
+    const char *directory = getenv("TMPDIR");
+    snprintf(path, size, "%s/rbt_%s_%ld", directory ? directory : "/tmp", name, (long) rand());
+}
+
+static void durable_test_remove(const char *path) {
+    char file[512];
+    snprintf(file, sizeof(file), "%s.log", path);
+    remove(file);
+    snprintf(file, sizeof(file), "%s.checkpoint", path);
+    remove(file);
+}
+
+void RBT_test_durable_recovery() {
+    struct RBT_Durable_Tree tree;
+    char path[256], log[300];
+    size_t size;
+
+    durable_test_path(path, sizeof(path), "recovery");
+    snprintf(log, sizeof(log), "%s.log", path);
+
+    TEST_CHECK( RBT_durable_open(&tree, path, 8, 0) );
+    for ( int i = 0; i < 100; ++i ) {
+        TEST_CHECK( RBT_durable_add(&tree, i, &i, sizeof(i)) );
+    }
+    for ( int i = 0; i < 100; i += 2 ) {
+        TEST_CHECK( RBT_durable_delete(&tree, i) );
+    }
+    TEST_CHECK( !RBT_durable_delete(&tree, 1000) );
+    TEST_CHECK( RBT_durable_close(&tree) );
+
+    // a torn record at the end of the log is dropped on recovery
+    FILE *file = fopen(log, "ab");
+    if ( TEST_CHECK( file != NULL ) ) {
+        fwrite("\x20\x00\x00\x00garbage", 1, 11, file);
+        fclose(file);
+    }
+
+    TEST_CHECK( RBT_durable_open(&tree, path, 8, 0) );
+    TEST_CHECK( RBT_NODE_COUNT(&tree.tree) == 50 );
+    for ( int i = 0; i < 100; ++i ) {
+        const int *value = RBT_durable_find(&tree, i, &size);
+        if ( i % 2 == 0 ) {
+            TEST_CHECK( value == NULL );
+        } else if ( TEST_CHECK( value != NULL ) ) {
+            TEST_CHECK( size == sizeof(int) && *value == i );
+        }
+    }
+
+    const char text[] = "appended after recovery";
+    TEST_CHECK( RBT_durable_add(&tree, 500, text, sizeof(text)) );
+    TEST_CHECK( RBT_durable_close(&tree) );
+
+    TEST_CHECK( RBT_durable_open(&tree, path, 8, 0) );
+    TEST_CHECK( RBT_NODE_COUNT(&tree.tree) == 51 );
+    const char *found = RBT_durable_find(&tree, 500, NULL);
+    TEST_CHECK( found != NULL && strcmp(found, text) == 0 );
+    RBT_durable_close(&tree);
+
+    durable_test_remove(path);
+}
+
+void RBT_test_durable_checkpoint() {
+    struct RBT_Durable_Tree tree;
+    char path[256];
+    uintmax_t value;
+
+    durable_test_path(path, sizeof(path), "checkpoint");
+
+    TEST_CHECK( RBT_durable_open(&tree, path, 16, 4096) );
+    for ( uintmax_t i = 0; i < 2000; ++i ) {
+        value = i * i;
+        TEST_CHECK( RBT_durable_add(&tree, i, &value, sizeof(value)) );
+    }
+    TEST_CHECK( tree.generation > 0 );
+    for ( uintmax_t i = 0; i < 2000; i += 3 ) {
+        TEST_CHECK( RBT_durable_delete(&tree, i) );
+    }
+    uintmax_t generation = tree.generation;
+    TEST_CHECK( RBT_durable_close(&tree) );
+
+    TEST_CHECK( RBT_durable_open(&tree, path, 16, 4096) );
+    TEST_CHECK( tree.generation == generation );
+    TEST_CHECK( RBT_NODE_COUNT(&tree.tree) == 2000 - 667 );
+    for ( uintmax_t i = 0; i < 2000; ++i ) {
+        const uintmax_t *found = RBT_durable_find(&tree, i, NULL);
+        TEST_CHECK( (found == NULL) == (i % 3 == 0) );
+        if ( found != NULL ) {
+            TEST_CHECK( *found == i * i );
+        }
+    }
+
+    TEST_CHECK( RBT_durable_checkpoint(&tree) );
+    TEST_CHECK( RBT_durable_close(&tree) );
+    TEST_CHECK( RBT_durable_open(&tree, path, 16, 0) );
+    TEST_CHECK( RBT_NODE_COUNT(&tree.tree) == 2000 - 667 );
+    RBT_durable_close(&tree);
+
+    durable_test_remove(path);
+}
+
+void RBT_test_durable_short_write() {
+    struct RBT_Durable_Tree tree;
+    struct rlimit limit, original;
+    struct stat status;
+    char path[256], log[300];
+    uintmax_t value;
+
+    durable_test_path(path, sizeof(path), "short_write");
+    snprintf(log, sizeof(log), "%s.log", path);
+    TEST_CHECK( RBT_durable_open(&tree, path, 64, 0) );
+    for ( uintmax_t i = 0; i < 10; ++i ) {
+        value = i;
+        TEST_CHECK( RBT_durable_add(&tree, i, &value, sizeof(value)) );
+    }
+    TEST_CHECK( RBT_durable_sync(&tree) );
+
+    // a file size limit a few records past the end makes the next sync write only part of the batch
+    TEST_CHECK( getrlimit(RLIMIT_FSIZE, &original) == 0 );
+    void (*handler)(int) = signal(SIGXFSZ, SIG_IGN);
+    limit = original;
+    limit.rlim_cur = (rlim_t) tree.log_size + 100;
+    TEST_CHECK( setrlimit(RLIMIT_FSIZE, &limit) == 0 );
+    for ( uintmax_t i = 10; i < 20; ++i ) {
+        value = i;
+        TEST_CHECK( RBT_durable_add(&tree, i, &value, sizeof(value)) );
+    }
+    TEST_CHECK( !RBT_durable_sync(&tree) );
+    TEST_CHECK( stat(log, &status) == 0 && (uintmax_t) status.st_size == tree.log_size );
+
+    // the retried batch lands right after the last synced record
+    TEST_CHECK( setrlimit(RLIMIT_FSIZE, &original) == 0 );
+    signal(SIGXFSZ, handler);
+    TEST_CHECK( RBT_durable_sync(&tree) );
+    TEST_CHECK( RBT_durable_close(&tree) );
+
+    TEST_CHECK( RBT_durable_open(&tree, path, 64, 0) );
+    TEST_CHECK( RBT_NODE_COUNT(&tree.tree) == 20 );
+    for ( uintmax_t i = 0; i < 20; ++i ) {
+        const uintmax_t *found = RBT_durable_find(&tree, i, NULL);
+        TEST_CHECK( found != NULL && *found == i );
+    }
+    RBT_durable_close(&tree);
+
+    durable_test_remove(path);
+}
+
+void RBT_test_durable_refused_add() {
+    struct RBT_Durable_Tree tree;
+    char path[256];
+    uintmax_t value;
+
+    durable_test_path(path, sizeof(path), "refused_add");
+    TEST_CHECK( RBT_durable_open(&tree, path, 64, 0) );
+
+    // once full, a capacity evicting the minimum turns away every smaller key, which must not be logged
+    TEST_CHECK( RBT_set_capacity(&tree.tree, 5, RBT_EVICT_MINIMUM, NULL, NULL) );
+    for ( uintmax_t i = 10; i > 0; --i ) {
+        value = i;
+        TEST_CHECK( RBT_durable_add(&tree, i, &value, sizeof(value)) == (i > 5) );
+    }
+    TEST_CHECK( tree.batch_count == 5 && RBT_NODE_COUNT(&tree.tree) == 5 );
+    TEST_CHECK( RBT_durable_close(&tree) );
+
+    TEST_CHECK( RBT_durable_open(&tree, path, 64, 0) );
+    TEST_CHECK( RBT_NODE_COUNT(&tree.tree) == 5 );
+    for ( uintmax_t i = 1; i <= 10; ++i ) {
+        const uintmax_t *found = RBT_durable_find(&tree, i, NULL);
+        TEST_CHECK( (found != NULL && *found == i) == (i > 5) );
+    }
+    RBT_durable_close(&tree);
+
+    durable_test_remove(path);
+}
@@ -0,0 +1,11 @@
+#ifndef _HEADER_FILE_RBTreeDurableTest_20261019163809_
+#define _HEADER_FILE_RBTreeDurableTest_20261019163809_
+
+#include "RBTree/RBTreeDurable.h"
+
+void RBT_test_durable_recovery(void);
+void RBT_test_durable_checkpoint(void);
+void RBT_test_durable_short_write(void);
+void RBT_test_durable_refused_add(void);
+
+#endif
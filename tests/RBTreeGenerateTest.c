@@ -0,0 +1,73 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeGenerateTest.h"
+#include "RBTree/RBTreeGenerate.h"
+
+#define INT_COMPARE(a, b) (((a) > (b)) - ((a) < (b)))
+
+struct point {
+    double x;
+    double y;
+};
+
+RBT_GENERATE(point_tree, int, struct point, INT_COMPARE)
+
+static int point_tree_black_height(struct point_tree_node *node) {
+    if ( node == NULL ) {
+        return 1;
+    }
+    if ( node->red && (point_tree_is_red(node->left) || point_tree_is_red(node->right)) ) {
+        return 0;
+    }
+    int left = point_tree_black_height(node->left);
+    int right = point_tree_black_height(node->right);
+    if ( left == 0 || left != right ) {
+        return 0;
+    }
+    return left + !node->red;
+}
+
+void RBT_test_generated_tree() {
+    static int present[1000];
+    struct point_tree tree;
+    point_tree_init(&tree);
+
+    srand(11);
+    for ( int i = 0; i < 4000; ++i ) {
+        int key = rand() % 1000;
+        if ( present[key] ) {
+            TEST_CHECK( point_tree_delete(&tree, key) );
+            present[key] = 0;
+        } else {
+            struct point point = { key, -key };
+            struct point *stored = point_tree_add(&tree, key, point);
+            TEST_CHECK( stored != NULL && stored->x == key );
+            present[key] = 1;
+        }
+    }
+    TEST_CHECK_( point_tree_black_height(tree.root) != 0, "RB properties of generated tree" );
+    TEST_CHECK( !point_tree_is_red(tree.root) );
+
+    uintmax_t count = 0;
+    int minimum = -1, maximum = -1;
+    for ( int key = 0; key < 1000; ++key ) {
+        struct point *found = point_tree_find(&tree, key);
+        TEST_CHECK( (found != NULL) == present[key] );
+        if ( found != NULL ) {
+            TEST_CHECK( found->y == -key );
+            count++;
+            minimum = minimum < 0 ? key : minimum;
+            maximum = key;
+        }
+    }
+    TEST_CHECK( tree.node_count == count );
+
+    int key;
+    struct point value;
+    TEST_CHECK( point_tree_get_minimum(&tree, &key, &value) && key == minimum && value.x == minimum );
+    TEST_CHECK( point_tree_get_maximum(&tree, &key, NULL) && key == maximum );
+
+    point_tree_deinit(&tree, NULL);
+    TEST_CHECK( !point_tree_get_minimum(&tree, NULL, NULL) );
+}
@@ -0,0 +1,6 @@
+#ifndef _HEADER_FILE_RBTreeGenerateTest_20261019160744_
+#define _HEADER_FILE_RBTreeGenerateTest_20261019160744_
+
+void RBT_test_generated_tree(void);
+
+#endif
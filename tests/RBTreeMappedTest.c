@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeMappedTest.h"
+
+static void mapped_test_path(char *path, size_t size, const char *name) {
+    const char *directory = getenv("TMPDIR");
+    snprintf(path, size, "%s/rbt_mapped_%s_%ld", directory ? directory : "/tmp", name, (long) rand());
+}
+
+static long mapped_test_file_size(const char *path) {
+    struct stat status;
+    return stat(path, &status) == 0 ? (long) status.st_size : -1;
+}
+
+void RBT_test_mapped_reopen() {
+    struct RBT_Mapped_Tree tree, reader;
+    char path[256];
+    char value[64];
+    size_t size;
+
+    mapped_test_path(path, sizeof(path), "reopen");
+    TEST_CHECK( RBT_mapped_open(&tree, path, 0) );
+
+    // enough values to grow, and remap, the file several times
+    for ( int i = 0; i < 20000; ++i ) {
+        int length = snprintf(value, sizeof(value), "value %d", i);
+        TEST_CHECK( RBT_mapped_add(&tree, (i * 7919) % 20000, value, (size_t) length) );
+    }
+    for ( int key = 0; key < 20000; key += 3 ) {
+        TEST_CHECK( RBT_mapped_delete(&tree, key) );
+    }
+    TEST_CHECK( !RBT_mapped_delete(&tree, 30000) );
+    uintmax_t count = RBT_mapped_node_count(&tree);
+    TEST_CHECK( count == 20000 - 6667 );
+    TEST_CHECK( RBT_mapped_close(&tree) );
+
+    TEST_CHECK( RBT_mapped_open(&reader, path, 1) );
+    TEST_CHECK( RBT_mapped_node_count(&reader) == count );
+    TEST_CHECK( !RBT_mapped_add(&reader, 1, "x", 1) && !RBT_mapped_delete(&reader, 1) );
+    for ( int i = 0; i < 20000; ++i ) {
+        int key = (i * 7919) % 20000;
+        const char *found = RBT_mapped_find(&reader, key, &size);
+        if ( key % 3 == 0 ) {
+            TEST_CHECK( found == NULL );
+        } else {
+            int length = snprintf(value, sizeof(value), "value %d", i);
+            TEST_CHECK_( found != NULL && size == (size_t) length && memcmp(found, value, size) == 0, "key %d", key );
+        }
+    }
+    uintmax_t key;
+    TEST_CHECK( RBT_mapped_get_minimum(&reader, &key, NULL, NULL) && key == 1 );
+    TEST_CHECK( RBT_mapped_get_maximum(&reader, &key, NULL, NULL) && key == 19999 );
+    TEST_CHECK( RBT_mapped_close(&reader) );
+
+    // a file that is not a mapped tree is refused
+    FILE *file = fopen(path, "r+b");
+    if ( TEST_CHECK( file != NULL ) ) {
+        fputs("garbage!", file);
+        fclose(file);
+    }
+    TEST_CHECK( !RBT_mapped_open(&reader, path, 1) );
+    remove(path);
+}
+
+void RBT_test_mapped_reuse_space() {
+    struct RBT_Mapped_Tree tree;
+    char path[256];
+    char value[300];
+
+    mapped_test_path(path, sizeof(path), "reuse");
+    memset(value, 'v', sizeof(value));
+    TEST_CHECK( RBT_mapped_open(&tree, path, 0) );
+
+    for ( int i = 0; i < 1000; ++i ) {
+        TEST_CHECK( RBT_mapped_add(&tree, i, value, (size_t) (i % 300)) );
+    }
+    TEST_CHECK( RBT_mapped_sync(&tree) );
+    long size = mapped_test_file_size(path);
+
+    // deleted nodes and values are reused, so churn does not grow the file
+    for ( int round = 0; round < 20; ++round ) {
+        for ( int i = 0; i < 1000; ++i ) {
+            TEST_CHECK( RBT_mapped_delete(&tree, i) );
+            TEST_CHECK( RBT_mapped_add(&tree, i, value, (size_t) (i % 300)) );
+        }
+    }
+    TEST_CHECK( RBT_mapped_node_count(&tree) == 1000 );
+    TEST_CHECK( mapped_test_file_size(path) == size );
+
+    for ( int i = 0; i < 1000; ++i ) {
+        TEST_CHECK( RBT_mapped_delete(&tree, i) );
+    }
+    TEST_CHECK( RBT_mapped_node_count(&tree) == 0 && !RBT_mapped_get_minimum(&tree, NULL, NULL, NULL) );
+    TEST_CHECK( RBT_mapped_close(&tree) );
+    remove(path);
+}
@@ -0,0 +1,9 @@
+#ifndef _HEADER_FILE_RBTreeMappedTest_20261019175236_
+#define _HEADER_FILE_RBTreeMappedTest_20261019175236_
+
+#include "RBTree/RBTreeMapped.h"
+
+void RBT_test_mapped_reopen(void);
+void RBT_test_mapped_reuse_space(void);
+
+#endif
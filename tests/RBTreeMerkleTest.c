@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeMerkleTest.h"
+
+struct merkle_test_diff {
+    uintmax_t keys[16];
+    int count;
+};
+
+static uint64_t merkle_test_hash_value(void *data, void *context) {
+    (void) context;
+    return (uint64_t) *(int*) data;
+}
+
+static int merkle_test_collect(uintmax_t key, void *context) {
+    struct merkle_test_diff *diff = context;
+    if ( diff->count < 16 ) {
+        diff->keys[diff->count] = key;
+    }
+    diff->count++;
+    return 1;
+}
+
+static int merkle_test_stop(uintmax_t key, void *context) {
+    (void) key;
+    ++*(int*) context;
+    return 0;
+}
+
+void RBT_test_merkle_order_independent() {
+    struct RBT_Merkle merkle;
+    struct RBT_Tree ascending, scattered;
+    struct RBT_Merkle_Hash hash_ascending, hash_scattered;
+    struct merkle_test_diff diff = { {0}, 0 };
+    static int values[1000];
+
+    RBT_merkle_init(&merkle, merkle_test_hash_value, NULL);
+    RBT_init_tree(&ascending);
+    RBT_init_tree(&scattered);
+    TEST_CHECK( RBT_set_augment(&ascending, &merkle.augment) );
+    TEST_CHECK( RBT_set_augment(&scattered, &merkle.augment) );
+
+    for ( int i = 0; i < 1000; ++i ) {
+        values[i] = i * 3;
+        TEST_CHECK( RBT_add(&ascending, i, &values[i]) != NULL );
+    }
+    for ( int i = 0; i < 1000; ++i ) {
+        int key = (i * 7919) % 1000;
+        TEST_CHECK( RBT_add(&scattered, key, &values[key]) != NULL );
+    }
+
+    TEST_CHECK( RBT_range_aggregate(&ascending, 0, RBT_KEY_MAX, &hash_ascending) );
+    TEST_CHECK( RBT_range_aggregate(&scattered, 0, RBT_KEY_MAX, &hash_scattered) );
+    TEST_CHECK( hash_ascending.hash == hash_scattered.hash );
+    TEST_CHECK( hash_ascending.power == hash_scattered.power );
+    TEST_CHECK( RBT_diff(&ascending, &scattered, merkle_test_collect, &diff) );
+    TEST_CHECK( diff.count == 0 );
+
+    RBT_deinit_tree(&ascending, NULL);
+    RBT_deinit_tree(&scattered, NULL);
+}
+
+void RBT_test_merkle_diff() {
+    struct RBT_Merkle merkle;
+    struct RBT_Tree a, b, plain;
+    struct merkle_test_diff diff = { {0}, 0 };
+    static int values[1000];
+    int changed = -1;
+    int stops = 0;
+
+    RBT_merkle_init(&merkle, merkle_test_hash_value, NULL);
+    RBT_init_tree(&a);
+    RBT_init_tree(&b);
+    RBT_init_tree(&plain);
+    TEST_CHECK( RBT_set_augment(&a, &merkle.augment) );
+    TEST_CHECK( RBT_set_augment(&b, &merkle.augment) );
+
+    for ( int i = 0; i < 1000; ++i ) {
+        values[i] = i;
+        TEST_CHECK( RBT_add(&a, i, &values[i]) != NULL );
+        TEST_CHECK( RBT_add(&b, 999 - i, &values[999 - i]) != NULL );
+    }
+
+    // a key only in b, a key only in a, and a key whose value differs
+    TEST_CHECK( RBT_add(&b, 5000, &values[0]) != NULL );
+    TEST_CHECK( RBT_delete(&b, 17) );
+    TEST_CHECK( RBT_delete(&b, 612) );
+    TEST_CHECK( RBT_add(&b, 612, &changed) != NULL );
+
+    TEST_CHECK( RBT_diff(&a, &b, merkle_test_collect, &diff) );
+    TEST_CHECK( diff.count == 3 );
+    TEST_CHECK( diff.keys[0] == 17 );
+    TEST_CHECK( diff.keys[1] == 612 );
+    TEST_CHECK( diff.keys[2] == 5000 );
+
+    TEST_CHECK( !RBT_diff(&a, &b, merkle_test_stop, &stops) );
+    TEST_CHECK( stops == 1 );
+    TEST_CHECK( !RBT_diff(&a, &plain, merkle_test_collect, &diff) );
+
+    RBT_deinit_tree(&a, NULL);
+    RBT_deinit_tree(&b, NULL);
+    RBT_deinit_tree(&plain, NULL);
+}
@@ -0,0 +1,9 @@
+#ifndef _HEADER_FILE_RBTreeMerkleTest_20261019180912_
+#define _HEADER_FILE_RBTreeMerkleTest_20261019180912_
+
+#include "RBTree/RBTreeMerkle.h"
+
+void RBT_test_merkle_order_independent(void);
+void RBT_test_merkle_diff(void);
+
+#endif
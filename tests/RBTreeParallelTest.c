@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeParallelTest.h"
+#include "RBTreeTest.h"
+
+#define BUILD_COUNT 100000
+
+static uintmax_t *sorted_keys(size_t count) {
+    uintmax_t *keys = malloc( sizeof(uintmax_t) * count );
+    for ( size_t i = 0; i < count; ++i ) {
+        keys[i] = i * 2;
+    }
+    return keys;
+}
+
+void RBT_test_parallel_build() {
+    uintmax_t *keys = sorted_keys(BUILD_COUNT);
+    struct RBT_Tree tree;
+
+    for ( size_t count = 0; count < 70; ++count ) {
+        RBT_init_tree(&tree);
+        TEST_CHECK( RBT_parallel_build(&tree, keys, NULL, count, 3) );
+        TEST_CHECK( RBT_NODE_COUNT(&tree) == count );
+        RBT_test_is_RB_tree(&tree);
+        RBT_parallel_deinit_tree(&tree, NULL, 3);
+    }
+
+    void **values = malloc( sizeof(void *) * BUILD_COUNT );
+    for ( size_t i = 0; i < BUILD_COUNT; ++i ) {
+        values[i] = &keys[i];
+    }
+
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_parallel_build(&tree, keys, values, BUILD_COUNT, 4) );
+    RBT_test_is_RB_tree(&tree);
+    TEST_CHECK( RBT_find(&tree, 2 * 777) == &keys[777] );
+    TEST_CHECK( RBT_find(&tree, 2 * 777 + 1) == NULL );
+    TEST_CHECK( !RBT_parallel_build(&tree, keys, NULL, 10, 4) );
+
+    RBT_delete(&tree, 0);
+    RBT_add(&tree, 1, NULL);
+    RBT_test_is_RB_tree(&tree);
+
+    RBT_parallel_deinit_tree(&tree, NULL, 4);
+    TEST_CHECK( tree.root == NULL && RBT_NODE_COUNT(&tree) == 0 );
+
+    keys[10] = 0;
+    TEST_CHECK( !RBT_parallel_build(&tree, keys, NULL, BUILD_COUNT, 4) );
+    keys[10] = 20;
+
+    // the whole build is checked against the budget before any node is allocated
+    struct RBT_Memory_Usage usage;
+    TEST_CHECK( RBT_set_memory_budget(&tree, 200) );
+    TEST_CHECK( !RBT_parallel_build(&tree, keys, NULL, 1000, 4) && RBT_NODE_COUNT(&tree) == 0 );
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) && usage.nodes == 0 );
+    TEST_CHECK( RBT_set_memory_budget(&tree, 1000000) );
+    TEST_CHECK( RBT_parallel_build(&tree, keys, NULL, 1000, 4) && RBT_NODE_COUNT(&tree) == 1000 );
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) && usage.nodes + usage.slack + usage.auxiliary <= 1000000 );
+    RBT_parallel_deinit_tree(&tree, NULL, 4);
+
+    // sequences are ordered by position, so keys cannot be built into them
+    TEST_CHECK( RBT_sequence_init(&tree) );
+    TEST_CHECK( !RBT_parallel_build(&tree, keys, NULL, 10, 4) && RBT_NODE_COUNT(&tree) == 0 );
+    RBT_deinit_tree(&tree, NULL);
+
+    free(values);
+    free(keys);
+}
+
+void RBT_test_parallel_deinit_options() {
+    uintmax_t *keys = sorted_keys(BUILD_COUNT);
+    struct RBT_Memory_Usage before, after;
+    struct RBT_Tree tree;
+
+    // the index, the filter and the capacity go along with the nodes, as with RBT_deinit_tree
+    RBT_get_global_memory_usage(&before);
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_hash_index(&tree, 1) && RBT_set_lookup_filter(&tree, 1) );
+    TEST_CHECK( RBT_set_capacity(&tree, BUILD_COUNT / 2, RBT_EVICT_MINIMUM, NULL, NULL) );
+    TEST_CHECK( RBT_parallel_build(&tree, keys, NULL, BUILD_COUNT, 4) );
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == BUILD_COUNT / 2 && RBT_find(&tree, 0) == NULL );
+    RBT_parallel_deinit_tree(&tree, NULL, 4);
+    TEST_CHECK( tree.root == NULL && RBT_NODE_COUNT(&tree) == 0 );
+    TEST_CHECK( tree.extension == NULL );
+    RBT_get_global_memory_usage(&after);
+    TEST_CHECK( after.nodes == before.nodes && after.auxiliary == before.auxiliary );
+
+    free(keys);
+}
+
+struct RBT_test_visits {
+    pthread_mutex_t lock;
+    uintmax_t key_sum;
+    uintmax_t visited;
+};
+
+static void count_visit(uintmax_t key, void *data, void *context) {
+    (void) data;
+    struct RBT_test_visits *visits = context;
+    pthread_mutex_lock(&visits->lock);
+    visits->key_sum += key;
+    visits->visited++;
+    pthread_mutex_unlock(&visits->lock);
+}
+
+void RBT_test_parallel_for_each() {
+    uintmax_t *keys = sorted_keys(BUILD_COUNT);
+    struct RBT_test_visits visits = { PTHREAD_MUTEX_INITIALIZER, 0, 0 };
+    struct RBT_Tree tree;
+
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_parallel_build(&tree, keys, NULL, BUILD_COUNT, 4) );
+    TEST_CHECK( RBT_parallel_for_each(&tree, count_visit, &visits, 4) );
+
+    TEST_CHECK( visits.visited == BUILD_COUNT );
+    TEST_CHECK( visits.key_sum == (uintmax_t) BUILD_COUNT * (BUILD_COUNT - 1) );
+
+    RBT_parallel_deinit_tree(&tree, NULL, 4);
+    free(keys);
+}
+
+// key concatenation, which is associative but not commutative
+struct RBT_test_digest {
+    uintmax_t hash;
+    uintmax_t power;
+};
+
+static const struct RBT_test_digest digest_identity = { 0, 1 };
+
+static void digest_lift(void *out, uintmax_t key, void *data, void *context) {
+    (void) data; (void) context;
+    struct RBT_test_digest *digest = out;
+    digest->hash = key + 1;
+    digest->power = 31;
+}
+
+static void digest_combine(void *out, const void *left, const void *right, void *context) {
+    (void) context;
+    const struct RBT_test_digest *a = left, *b = right;
+    struct RBT_test_digest *digest = out;
+    digest->hash = a->hash * b->power + b->hash;
+    digest->power = a->power * b->power;
+}
+
+void RBT_test_parallel_reduce() {
+    static const struct RBT_Augment digest = {
+        sizeof(struct RBT_test_digest), &digest_identity, digest_lift, digest_combine, NULL
+    };
+    struct RBT_test_digest expected = digest_identity, single, parallel, augmented;
+    struct RBT_Tree tree;
+
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_augment(&tree, &digest) );
+    srand(7);
+    for ( int i = 0; i < 20000; ++i ) {
+        RBT_add(&tree, rand() % 50000, NULL);
+    }
+    for ( uintmax_t key = 0; key < 50000; key += 3 ) {
+        RBT_delete(&tree, key);
+    }
+
+    TEST_CHECK( RBT_parallel_reduce(&tree, &digest, &single, 1) );
+    TEST_CHECK( RBT_parallel_reduce(&tree, &digest, &parallel, 8) );
+    TEST_CHECK( RBT_range_aggregate(&tree, 0, RBT_KEY_MAX, &augmented) );
+    TEST_CHECK( single.hash == parallel.hash && single.power == parallel.power );
+    TEST_CHECK( single.hash == augmented.hash && single.power == augmented.power );
+    TEST_CHECK( single.hash != expected.hash );
+
+    RBT_parallel_deinit_tree(&tree, NULL, 8);
+
+    uintmax_t *keys = sorted_keys(BUILD_COUNT);
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_augment(&tree, &digest) );
+    TEST_CHECK( RBT_parallel_build(&tree, keys, NULL, BUILD_COUNT, 4) );
+    for ( size_t i = 0; i < BUILD_COUNT; ++i ) {
+        struct RBT_test_digest lifted, combined;
+        digest_lift(&lifted, keys[i], NULL, NULL);
+        digest_combine(&combined, &expected, &lifted, NULL);
+        expected = combined;
+    }
+    TEST_CHECK( RBT_parallel_reduce(&tree, &digest, &parallel, 4) );
+    TEST_CHECK( RBT_range_aggregate(&tree, 0, RBT_KEY_MAX, &augmented) );
+    TEST_CHECK( parallel.hash == expected.hash && augmented.hash == expected.hash );
+
+    RBT_parallel_deinit_tree(&tree, NULL, 4);
+    free(keys);
+}
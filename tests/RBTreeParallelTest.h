@@ -0,0 +1,11 @@
+#ifndef _HEADER_FILE_RBTreeParallelTest_20261019155302_
+#define _HEADER_FILE_RBTreeParallelTest_20261019155302_
+
+#include "RBTree/RBTreeParallel.h"
+
+void RBT_test_parallel_build(void);
+void RBT_test_parallel_deinit_options(void);
+void RBT_test_parallel_for_each(void);
+void RBT_test_parallel_reduce(void);
+
+#endif
@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeSetTest.h"
+#include "RBMacros.h"
+
+static int RBT_Set_black_height(struct RBT_Set_Node *node) {
+    if ( node == NULL ) {
+        return 1;
+    }
+    if ( RBT_IS_RED(node) && (RBT_IS_RED(node->left) || RBT_IS_RED(node->right)) ) {
+        return 0;
+    }
+    if ( (node->left != NULL && node->left->parent != node) || (node->right != NULL && node->right->parent != node) ) {
+        return 0;
+    }
+    int left = RBT_Set_black_height(node->left);
+    int right = RBT_Set_black_height(node->right);
+    if ( left == 0 || left != right ) {
+        return 0;
+    }
+    return left + RBT_IS_BLACK(node);
+}
+
+static void RBT_test_is_set(struct RBT_Set *set) {
+    TEST_CHECK_( RBT_IS_BLACK(set->root), "RB properties: root is not black" );
+    TEST_CHECK_( RBT_Set_black_height(set->root) != 0, "RB properties: red violation, unequal black height or broken links" );
+}
+
+void RBT_test_set_operations() {
+    static char present[2048];
+    struct RBT_Set set;
+    uintmax_t key;
+
+    TEST_CHECK( sizeof(struct RBT_Set_Node) + sizeof(void *) == sizeof(struct RBT_Node) );
+    RBT_Set_init(&set);
+    TEST_CHECK( !RBT_Set_get_minimum(&set, &key) && !RBT_Set_get_maximum(&set, NULL) );
+    TEST_CHECK( !RBT_Set_erase(&set, 1) );
+
+    srand(43);
+    for ( int i = 0; i < 20000; ++i ) {
+        int member = rand() % 2048;
+        if ( rand() % 2 ) {
+            TEST_CHECK( RBT_Set_insert(&set, member) == !present[member] );
+            present[member] = 1;
+        } else {
+            TEST_CHECK( RBT_Set_erase(&set, member) == present[member] );
+            present[member] = 0;
+        }
+        if ( i % 500 == 0 ) {
+            RBT_test_is_set(&set);
+        }
+    }
+    RBT_test_is_set(&set);
+
+    uintmax_t count = 0;
+    int minimum = -1, maximum = -1;
+    for ( int member = 0; member < 2048; ++member ) {
+        TEST_CHECK( RBT_Set_contains(&set, member) == present[member] );
+        if ( present[member] ) {
+            count++;
+            minimum = minimum < 0 ? member : minimum;
+            maximum = member;
+        }
+    }
+    TEST_CHECK( RBT_NODE_COUNT(&set) == count );
+    TEST_CHECK( RBT_Set_get_minimum(&set, &key) && key == (uintmax_t) minimum );
+    TEST_CHECK( RBT_Set_get_maximum(&set, &key) && key == (uintmax_t) maximum );
+
+    RBT_Set_deinit(&set);
+    TEST_CHECK( set.root == NULL && RBT_NODE_COUNT(&set) == 0 );
+}
+
+struct RBT_test_visits {
+    uintmax_t last;
+    uintmax_t count;
+    int ordered;
+};
+
+static int record_visit(uintmax_t key, void *context) {
+    struct RBT_test_visits *visits = context;
+    visits->ordered &= visits->count == 0 || key > visits->last;
+    visits->last = key;
+    return ++visits->count < 600;
+}
+
+void RBT_test_set_ordered_iteration() {
+    struct RBT_Set set;
+    struct RBT_test_visits visits = { 0, 0, 1 };
+
+    RBT_Set_init(&set);
+    for ( uintmax_t i = 0; i < 1000; ++i ) {
+        RBT_Set_insert(&set, (i * 7919) % 1000);
+        RBT_Set_insert(&set, (i * 7919) % 1000);
+    }
+    TEST_CHECK( RBT_NODE_COUNT(&set) == 1000 );
+    TEST_CHECK( RBT_Set_insert(&set, RBT_KEY_MAX) && RBT_Set_contains(&set, RBT_KEY_MAX) );
+    TEST_CHECK( RBT_Set_erase(&set, RBT_KEY_MAX) );
+    RBT_test_is_set(&set);
+
+    TEST_CHECK( !RBT_Set_for_each(&set, record_visit, &visits) );
+    TEST_CHECK( visits.count == 600 && visits.ordered && visits.last == 599 );
+    RBT_Set_deinit(&set);
+}
@@ -0,0 +1,9 @@
+#ifndef _HEADER_FILE_RBTreeSetTest_20261019182655_
+#define _HEADER_FILE_RBTreeSetTest_20261019182655_
+
+#include "RBTree/RBTreeSet.h"
+
+void RBT_test_set_operations(void);
+void RBT_test_set_ordered_iteration(void);
+
+#endif
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeShardedTest.h"
+#include "RBTreeTest.h"
+
+#define WRITERS 4
+#define KEYS_PER_WRITER 2000
+
+struct RBT_test_writer {
+    struct RBT_Sharded_Tree *tree;
+    uintmax_t first_key;
+    pthread_t thread;
+};
+
+static void *sharded_writer(void *argument) {
+    struct RBT_test_writer *writer = argument;
+    for ( uintmax_t key = 0; key < KEYS_PER_WRITER; ++key ) {
+        RBT_sharded_add(writer->tree, writer->first_key + key, NULL);
+    }
+    return NULL;
+}
+
+struct RBT_test_order {
+    uintmax_t previous;
+    uintmax_t visited;
+    int ordered;
+};
+
+static int check_order(uintmax_t key, void *data, void *context) {
+    (void) data;
+    struct RBT_test_order *order = context;
+    if ( order->visited > 0 && key < order->previous ) {
+        order->ordered = 0;
+    }
+    order->previous = key;
+    order->visited++;
+    return 1;
+}
+
+void RBT_test_sharded_concurrent_add() {
+    struct RBT_Sharded_Tree tree;
+    struct RBT_test_writer writers[WRITERS];
+
+    TEST_CHECK( RBT_init_sharded_tree(&tree, 2, 256) );
+
+    for ( int i = 0; i < WRITERS; ++i ) {
+        writers[i].tree = &tree;
+        writers[i].first_key = (uintmax_t) i * KEYS_PER_WRITER;
+        pthread_create(&writers[i].thread, NULL, sharded_writer, &writers[i]);
+    }
+    for ( int i = 0; i < WRITERS; ++i ) {
+        pthread_join(writers[i].thread, NULL);
+    }
+
+    TEST_CHECK( RBT_sharded_node_count(&tree) == WRITERS * KEYS_PER_WRITER );
+    TEST_CHECK( tree.shard_count > 2 );
+
+    struct RBT_test_order order = { 0, 0, 1 };
+    TEST_CHECK( RBT_sharded_for_each(&tree, check_order, &order) );
+    TEST_CHECK( order.ordered && order.visited == WRITERS * KEYS_PER_WRITER );
+
+    uintmax_t key;
+    TEST_CHECK( RBT_sharded_get_minimum(&tree, &key, NULL) && key == 0 );
+    TEST_CHECK( RBT_sharded_get_maximum(&tree, &key, NULL) && key == WRITERS * KEYS_PER_WRITER - 1 );
+
+    RBT_deinit_sharded_tree(&tree, NULL);
+}
+
+void RBT_test_sharded_split_merge() {
+    struct RBT_Sharded_Tree tree;
+    static int values[1000];
+
+    TEST_CHECK( RBT_init_sharded_tree(&tree, 1, 64) );
+
+    for ( int i = 0; i < 1000; ++i ) {
+        RBT_sharded_add(&tree, i, &values[i]);
+    }
+    size_t split_count = tree.shard_count;
+    TEST_CHECK( split_count >= 1000 / 64 );
+    TEST_CHECK( RBT_sharded_find(&tree, 500) == &values[500] );
+    TEST_CHECK( RBT_sharded_find(&tree, 1000) == NULL );
+    TEST_CHECK( RBT_sharded_find(&tree, (RBT_KEY_MAX + 1) | 500) == &values[500] );
+    for ( size_t i = 0; i < tree.shard_count; ++i ) {
+        RBT_test_is_RB_tree(&tree.shards[i]->tree);
+    }
+
+    for ( int i = 0; i < 990; ++i ) {
+        TEST_CHECK( RBT_sharded_delete(&tree, i) );
+    }
+    TEST_CHECK( tree.shard_count < split_count );
+    TEST_CHECK( RBT_sharded_node_count(&tree) == 10 );
+
+    uintmax_t key;
+    void *value;
+    TEST_CHECK( RBT_sharded_get_minimum(&tree, &key, &value) && key == 990 && value == &values[990] );
+
+    RBT_deinit_sharded_tree(&tree, NULL);
+}
+
+void RBT_test_sharded_duplicates() {
+    struct RBT_Sharded_Tree tree;
+    static int values[200];
+
+    // a shard of equal keys cannot be split, and stops trying until another key comes in
+    TEST_CHECK( RBT_init_sharded_tree(&tree, 1, 8) );
+    for ( int i = 0; i < 100; ++i ) {
+        RBT_sharded_add(&tree, 5, &values[i]);
+    }
+    TEST_CHECK( tree.shard_count == 1 && tree.shards[0]->uniform );
+    TEST_CHECK( RBT_sharded_node_count(&tree) == 100 );
+
+    // the split then lands where the run of duplicates ends
+    for ( int i = 6; i < 16; ++i ) {
+        RBT_sharded_add(&tree, i, &values[i]);
+    }
+    TEST_CHECK( tree.shard_count > 1 && tree.shards[1]->lower == 6 );
+    TEST_CHECK( RBT_NODE_COUNT(&tree.shards[0]->tree) == 100 );
+    TEST_CHECK( RBT_sharded_node_count(&tree) == 110 );
+    for ( size_t i = 0; i < tree.shard_count; ++i ) {
+        RBT_test_is_RB_tree(&tree.shards[i]->tree);
+    }
+    TEST_CHECK( RBT_sharded_find(&tree, 15) == &values[15] );
+
+    RBT_deinit_sharded_tree(&tree, NULL);
+}
@@ -0,0 +1,10 @@
+#ifndef _HEADER_FILE_RBTreeShardedTest_20261019153547_
+#define _HEADER_FILE_RBTreeShardedTest_20261019153547_
+
+#include "RBTree/RBTreeSharded.h"
+
+void RBT_test_sharded_concurrent_add(void);
+void RBT_test_sharded_split_merge(void);
+void RBT_test_sharded_duplicates(void);
+
+#endif
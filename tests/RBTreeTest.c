@@ -1,7 +1,9 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "cutest/pub_cutest.h"
 #include "RBTreeTest.h"
+#include "RBTreeInternal.h"
 
 static int default_keys[] = { 10, 12, 20, 34, 6, 3 };
 static long int *default_values;
@@ -253,4 +255,816 @@ void RBT_test_static_allocate_nodes() {
     TEST_CHECK( RBT_NODE_COUNT(&tree) == 2 );
 
     RBT_deinit_tree(&tree, nofree);
-}
\ No newline at end of file
+}
+void RBT_test_remove_all() {
+    struct RBT_Tree tree;
+    RBT_init_tree(&tree);
+
+    srand(42);
+    for ( int i = 0; i < 512; ++i ) {
+        RBT_add(&tree, rand() % 1024, NULL);
+    }
+    RBT_test_is_RB_tree(&tree);
+
+    for ( int key = 0; key < 1024; ++key ) {
+        while ( RBT_delete(&tree, key) ) {
+            RBT_test_is_RB_tree(&tree);
+        }
+    }
+
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == 0 );
+    TEST_CHECK( tree.root == NULL );
+
+    RBT_deinit_tree(&tree, nofree);
+}
+
+struct RBT_test_sum {
+    long int sum;
+    long int count;
+};
+
+static const struct RBT_test_sum sum_identity = { 0, 0 };
+
+static void sum_lift(void *out, uintmax_t key, void *data, void *context) {
+    (void) key; (void) context;
+    struct RBT_test_sum *aggregate = out;
+    aggregate->sum = *((long int *) data);
+    aggregate->count = 1;
+}
+
+static void sum_combine(void *out, const void *left, const void *right, void *context) {
+    (void) context;
+    const struct RBT_test_sum *a = left, *b = right;
+    struct RBT_test_sum *aggregate = out;
+    aggregate->sum = a->sum + b->sum;
+    aggregate->count = a->count + b->count;
+}
+
+void RBT_test_range_aggregate() {
+    static const struct RBT_Augment sum_augment = {
+        sizeof(struct RBT_test_sum), &sum_identity, sum_lift, sum_combine, NULL
+    };
+    static long int values[256];
+    struct RBT_Tree tree;
+    struct RBT_test_sum result;
+
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_augment(&tree, &sum_augment) );
+    TEST_CHECK( RBT_range_aggregate(&tree, 0, 100, &result) && result.count == 0 );
+
+    for ( int i = 0; i < 256; ++i ) {
+        values[i] = i * 3;
+        RBT_add(&tree, (i * 7) % 256, &values[i]);
+    }
+    for ( int key = 0; key < 256; key += 5 ) {
+        RBT_delete(&tree, key);
+    }
+    RBT_test_is_RB_tree(&tree);
+
+    for ( uintmax_t lo = 0; lo < 256; lo += 13 ) {
+        for ( uintmax_t hi = lo; hi < 270; hi += 17 ) {
+            struct RBT_test_sum expected = { 0, 0 };
+            for ( int i = 0; i < 256; ++i ) {
+                uintmax_t key = (i * 7) % 256;
+                if ( key % 5 != 0 && key >= lo && key <= hi ) {
+                    expected.sum += values[i];
+                    expected.count++;
+                }
+            }
+            TEST_CHECK( RBT_range_aggregate(&tree, lo, hi, &result) );
+            TEST_CHECK_( result.sum == expected.sum && result.count == expected.count,
+                "aggregate of [%ju; %ju]", lo, hi );
+        }
+    }
+
+    values[1] = 1000;
+    TEST_CHECK( RBT_refresh_aggregate(&tree, 7) );
+    TEST_CHECK( RBT_range_aggregate(&tree, 7, 7, &result) && result.sum == 1000 );
+
+    TEST_CHECK( !RBT_set_augment(&tree, NULL) );
+
+    RBT_deinit_tree(&tree, nofree);
+}
+
+static int count_visits(uintmax_t key, void *data, void *context) {
+    ((void) key);
+    ((void) data);
+    (*(uintmax_t *) context)++;
+    return 1;
+}
+
+void RBT_test_lazy_delete() {
+    static const struct RBT_Augment sum_augment = {
+        sizeof(struct RBT_test_sum), &sum_identity, sum_lift, sum_combine, NULL
+    };
+    static long int values[512];
+    struct RBT_Tree tree;
+    struct RBT_test_sum result;
+
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_augment(&tree, &sum_augment) );
+    TEST_CHECK( RBT_set_lazy_delete(&tree, 101) );
+
+    for ( int i = 0; i < 512; ++i ) {
+        values[i] = i;
+        RBT_add(&tree, i / 2, &values[i]);
+    }
+    for ( int key = 0; key < 256; key += 2 ) {
+        TEST_CHECK( RBT_delete(&tree, key) );
+    }
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == 384 && tree.dead_count == 128 );
+
+    // one duplicate of every deleted key is dead, the other one is still found
+    for ( int key = 0; key < 256; ++key ) {
+        long int *found = RBT_find(&tree, key);
+        TEST_CHECK( found != NULL && *found / 2 == key );
+    }
+    for ( int key = 0; key < 256; key += 4 ) {
+        TEST_CHECK( RBT_delete(&tree, key) );
+        TEST_CHECK( RBT_find(&tree, key) == NULL );
+        TEST_CHECK( !RBT_delete(&tree, key) );
+    }
+
+    uintmax_t minimum, visits = 0;
+    TEST_CHECK( RBT_get_minimum(&tree, &minimum, NULL) && minimum == 1 );
+    TEST_CHECK( RBT_for_each(&tree, count_visits, &visits) && visits == RBT_NODE_COUNT(&tree) );
+    TEST_CHECK( RBT_range_aggregate(&tree, 0, 3, &result) && result.count == 5 && result.sum == 2 + 3 + *(long int *) RBT_find(&tree, 2) + 6 + 7 );
+
+    // reinserting a deleted key revives its tombstone
+    uintmax_t dead = tree.dead_count;
+    TEST_CHECK( RBT_add(&tree, 0, &values[0]) == &values[0] );
+    TEST_CHECK( tree.dead_count == dead - 1 && RBT_find(&tree, 0) == &values[0] );
+
+    uintmax_t live = RBT_NODE_COUNT(&tree);
+    TEST_CHECK( RBT_purge(&tree) == dead - 1 );
+    TEST_CHECK( tree.dead_count == 0 && RBT_NODE_COUNT(&tree) == live );
+    RBT_test_is_RB_tree(&tree);
+    TEST_CHECK( RBT_range_aggregate(&tree, 0, 255, &result) && (uintmax_t) result.count == live );
+
+    // deleting half of the remaining nodes crosses a 25 percent threshold and purges
+    TEST_CHECK( RBT_set_lazy_delete(&tree, 25) );
+    for ( int key = 1; key < 256; key += 2 ) {
+        RBT_delete(&tree, key);
+        TEST_CHECK( tree.dead_count * 4 < RBT_NODE_COUNT(&tree) + tree.dead_count );
+    }
+    RBT_test_is_RB_tree(&tree);
+
+    TEST_CHECK( RBT_set_lazy_delete(&tree, 0) && tree.dead_count == 0 );
+    RBT_test_is_RB_tree(&tree);
+
+    RBT_deinit_tree(&tree, nofree);
+}
+
+void RBT_test_hash_index() {
+    static int values[1024];
+    static int counts[1024];
+    struct RBT_Tree tree;
+    size_t distinct = 0;
+
+    RBT_init_tree(&tree);
+    for ( int key = 0; key < 1024; key += 3 ) {
+        RBT_add(&tree, key, &values[key]);
+        counts[key]++;
+        distinct++;
+    }
+    TEST_CHECK( RBT_set_hash_index(&tree, 1) && tree.extension->index->count == distinct );
+
+    srand(23);
+    for ( int i = 0; i < 30000; ++i ) {
+        int key = rand() % 1024;
+        if ( i == 15000 ) {
+            TEST_CHECK( RBT_set_lazy_delete(&tree, 30) );
+        }
+        if ( rand() % 2 ) {
+            RBT_add(&tree, key, &values[key]);
+            distinct += counts[key] == 0;
+            counts[key]++;
+        } else {
+            TEST_CHECK( RBT_delete(&tree, key) == (counts[key] > 0) );
+            if ( counts[key] > 0 ) {
+                counts[key]--;
+                distinct -= counts[key] == 0;
+            }
+        }
+        key = rand() % 1024;
+        TEST_CHECK( RBT_find(&tree, key) == (counts[key] > 0 ? &values[key] : NULL) );
+    }
+    TEST_CHECK( RBT_OPTION(&tree, index) != NULL && tree.extension->index->count == distinct );
+    RBT_test_is_RB_tree(&tree);
+
+    TEST_CHECK( RBT_set_hash_index(&tree, 0) && RBT_OPTION(&tree, index) == NULL );
+    for ( int key = 0; key < 1024; ++key ) {
+        TEST_CHECK( RBT_find(&tree, key) == (counts[key] > 0 ? &values[key] : NULL) );
+    }
+
+    RBT_deinit_tree(&tree, nofree);
+}
+
+void RBT_test_finger_find() {
+    static int values[4096];
+    struct RBT_Tree tree;
+    struct RBT_Finger finger = RBT_FINGER_INIT;
+
+    RBT_init_tree(&tree);
+    for ( int key = 0; key < 4096; key += 2 ) {
+        RBT_add(&tree, key, &values[key]);
+    }
+    RBT_add(&tree, 100, &values[100]);
+
+    // a random walk over nearby keys, hitting and missing
+    srand(29);
+    int key = 2048;
+    for ( int i = 0; i < 20000; ++i ) {
+        key = (key + rand() % 33 - 16 + 4096) % 4096;
+        TEST_CHECK_( RBT_finger_find(&tree, &finger, key) == RBT_find(&tree, key), "finger lookup of %d", key );
+        if ( i % 1000 == 999 ) {
+            RBT_delete(&tree, key & ~1);
+            RBT_add(&tree, key | 1, &values[key | 1]);
+        }
+    }
+
+    // ascending batch lookups, as in a merge-join
+    struct RBT_Finger batch = RBT_FINGER_INIT;
+    for ( int k = 0; k < 4096; ++k ) {
+        TEST_CHECK( RBT_finger_find(&tree, &batch, k) == RBT_find(&tree, k) );
+    }
+
+    TEST_CHECK( RBT_set_lazy_delete(&tree, 101) );
+    TEST_CHECK( RBT_delete(&tree, 100) && RBT_finger_find(&tree, &batch, 100) == &values[100] );
+    TEST_CHECK( RBT_delete(&tree, 100) && RBT_finger_find(&tree, &batch, 100) == NULL );
+    for ( int k = 4095; k >= 0; --k ) {
+        TEST_CHECK( RBT_finger_find(&tree, &batch, k) == RBT_find(&tree, k) );
+    }
+
+    RBT_deinit_tree(&tree, nofree);
+}
+
+static int freed_values;
+
+static void count_free(void *item) {
+    ((void) item);
+    freed_values++;
+}
+
+// every child must point back at its parent, and keys must be ordered
+static int has_consistent_links(struct RBT_Node *node, uintmax_t lo, uintmax_t hi) {
+    if ( node == NULL ) {
+        return 1;
+    }
+    uintmax_t key = RBT_KEYVALUE(node->key);
+    if ( key < lo || key > hi ) {
+        return 0;
+    }
+    if ( (node->left != NULL && node->left->parent != node) || (node->right != NULL && node->right->parent != node) ) {
+        return 0;
+    }
+    return has_consistent_links(node->left, lo, key) && has_consistent_links(node->right, key, hi);
+}
+
+void RBT_test_delete_range() {
+    static const struct RBT_Augment sum_augment = {
+        sizeof(struct RBT_test_sum), &sum_identity, sum_lift, sum_combine, NULL
+    };
+    static long int values[4096];
+    struct RBT_Tree tree;
+    struct RBT_Node *detached;
+    struct RBT_test_sum result;
+
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_augment(&tree, &sum_augment) );
+    for ( int i = 0; i < 4096; ++i ) {
+        values[i] = i;
+    }
+    for ( int i = 0; i < 4096; ++i ) {
+        RBT_add(&tree, (i * 7919) % 4096, &values[(i * 7919) % 4096]);
+    }
+    RBT_add(&tree, 1500, &values[1500]);
+    RBT_add(&tree, 3000, &values[3000]);
+
+    TEST_CHECK( RBT_delete_range(&tree, 1000, 1999, &detached) == 1001 );
+    TEST_CHECK( tree.node_count == 4098 - 1001 );
+    TEST_CHECK( RBT_find(&tree, 1500) == NULL && RBT_find(&tree, 1000) == NULL && RBT_find(&tree, 1999) == NULL );
+    TEST_CHECK( RBT_find(&tree, 999) == &values[999] && RBT_find(&tree, 2000) == &values[2000] );
+    RBT_test_is_RB_tree(&tree);
+    TEST_CHECK( has_consistent_links(tree.root, 0, RBT_KEY_MAX) );
+    freed_values = 0;
+    RBT_free_detached(detached, count_free);
+    TEST_CHECK( freed_values == 1001 );
+
+    TEST_CHECK( RBT_delete_below(&tree, 500, NULL) == 500 );
+    TEST_CHECK( RBT_delete_range(&tree, 3500, RBT_KEY_MAX, NULL) == 596 );
+    TEST_CHECK( RBT_delete_range(&tree, 5000, 6000, NULL) == 0 );
+    TEST_CHECK( RBT_delete_below(&tree, 0, &detached) == 0 && detached == NULL );
+    TEST_CHECK( tree.node_count == 2001 );
+    RBT_test_is_RB_tree(&tree);
+    TEST_CHECK( has_consistent_links(tree.root, 0, RBT_KEY_MAX) );
+    TEST_CHECK( RBT_range_aggregate(&tree, 0, RBT_KEY_MAX, &result) );
+    TEST_CHECK( result.count == 2001 && result.sum == (500 + 999) * 250 + (2000 + 3499) * 750 + 3000 );
+
+    // random ranges, checking the tree after every cut
+    srand(31);
+    while ( tree.root != NULL ) {
+        uintmax_t lo = rand() % 4096;
+        uintmax_t hi = lo + rand() % 300;
+        uintmax_t before = tree.node_count;
+        uintmax_t expected = 0;
+        for ( uintmax_t key = lo; key <= hi; ++key ) {
+            expected += RBT_find(&tree, key) != NULL;
+        }
+        expected += (lo <= 3000 && hi >= 3000 && RBT_find(&tree, 3000) != NULL);
+        TEST_CHECK( RBT_delete_range(&tree, lo, hi, NULL) == expected );
+        TEST_CHECK( tree.node_count == before - expected );
+        RBT_test_is_RB_tree(&tree);
+        TEST_CHECK( has_consistent_links(tree.root, 0, RBT_KEY_MAX) );
+        TEST_CHECK( RBT_range_aggregate(&tree, 0, RBT_KEY_MAX, &result) && result.count == (long int) tree.node_count );
+    }
+    RBT_deinit_tree(&tree, nofree);
+
+    // tombstones in the range are dropped as well, along with the index entries
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_lazy_delete(&tree, 101) );
+    TEST_CHECK( RBT_set_hash_index(&tree, 1) );
+    for ( int key = 0; key < 1000; ++key ) {
+        RBT_add(&tree, key, &values[key]);
+    }
+    for ( int key = 10; key < 20; ++key ) {
+        TEST_CHECK( RBT_delete(&tree, key) );
+    }
+    TEST_CHECK( RBT_delete_below(&tree, 50, NULL) == 40 );
+    TEST_CHECK( tree.dead_count == 0 && tree.node_count == 950 );
+    TEST_CHECK( RBT_find(&tree, 5) == NULL && RBT_find(&tree, 50) == &values[50] );
+    TEST_CHECK( RBT_add(&tree, 15, &values[15]) == &values[15] && RBT_find(&tree, 15) == &values[15] );
+    RBT_test_is_RB_tree(&tree);
+    RBT_deinit_tree(&tree, nofree);
+}
+
+struct eviction_log {
+    int count;
+    uintmax_t last_key;
+    void *last_data;
+};
+
+static void log_eviction(uintmax_t key, void *data, void *context) {
+    struct eviction_log *log = context;
+    log->count++;
+    log->last_key = key;
+    log->last_data = data;
+}
+
+void RBT_test_capacity() {
+    static const struct RBT_Augment sum_augment = {
+        sizeof(struct RBT_test_sum), &sum_identity, sum_lift, sum_combine, NULL
+    };
+    static long int values[256];
+    struct eviction_log log = { 0, 0, NULL };
+    struct RBT_Tree tree;
+    struct RBT_Finger finger = RBT_FINGER_INIT;
+    struct RBT_test_sum result;
+    uintmax_t key;
+
+    // keeping the largest keys
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_capacity(&tree, 100, RBT_EVICT_MINIMUM, log_eviction, &log) );
+    for ( int i = 0; i < 200; ++i ) {
+        TEST_CHECK( RBT_add(&tree, i, &values[i]) == &values[i] );
+    }
+    TEST_CHECK( tree.node_count == 100 && log.count == 100 && log.last_key == 99 && log.last_data == &values[99] );
+    TEST_CHECK( RBT_get_minimum(&tree, &key, NULL) && key == 100 );
+    TEST_CHECK( RBT_add(&tree, 5, &values[5]) == NULL );
+    TEST_CHECK( log.count == 101 && log.last_key == 5 && tree.node_count == 100 );
+    TEST_CHECK( RBT_set_capacity(&tree, 10, RBT_EVICT_MAXIMUM, log_eviction, &log) );
+    TEST_CHECK( tree.node_count == 10 && RBT_get_maximum(&tree, &key, NULL) && key == 109 );
+    RBT_test_is_RB_tree(&tree);
+    TEST_CHECK( !RBT_set_capacity(&tree, 10, RBT_EVICT_LEAST_RECENT, NULL, NULL) );
+    RBT_deinit_tree(&tree, nofree);
+
+    // evicting the least recently added or found element
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_capacity(&tree, 4, RBT_EVICT_LEAST_RECENT, log_eviction, &log) );
+    TEST_CHECK( RBT_set_augment(&tree, &sum_augment) );
+    TEST_CHECK( RBT_set_hash_index(&tree, 1) );
+    for ( int i = 1; i <= 4; ++i ) {
+        values[i] = i;
+        RBT_add(&tree, i, &values[i]);
+    }
+    TEST_CHECK( RBT_find(&tree, 1) == &values[1] );
+    RBT_add(&tree, 5, &values[5]);
+    TEST_CHECK( log.last_key == 2 && RBT_find(&tree, 2) == NULL );
+    TEST_CHECK( RBT_finger_find(&tree, &finger, 3) == &values[3] );
+    RBT_add(&tree, 6, &values[6]);
+    TEST_CHECK( log.last_key == 4 );
+    TEST_CHECK( RBT_delete(&tree, 5) );
+    log.count = 0;
+    RBT_add(&tree, 7, &values[7]);
+    TEST_CHECK( log.count == 0 );
+    RBT_add(&tree, 8, &values[8]);
+    TEST_CHECK( log.count == 1 && log.last_key == 1 );
+
+    // tombstones leave the recency list, and revived elements are the most recent
+    TEST_CHECK( RBT_set_lazy_delete(&tree, 101) );
+    TEST_CHECK( RBT_delete(&tree, 6) );
+    RBT_add(&tree, 6, &values[6]);
+    RBT_add(&tree, 9, &values[9]);
+    TEST_CHECK( log.count == 2 && log.last_key == 3 );
+    TEST_CHECK( RBT_delete_range(&tree, 7, 8, NULL) == 2 );
+    RBT_add(&tree, 10, &values[10]);
+    RBT_add(&tree, 11, &values[11]);
+    TEST_CHECK( log.count == 2 );
+    RBT_add(&tree, 12, &values[12]);
+    TEST_CHECK( log.count == 3 && log.last_key == 6 );
+    TEST_CHECK( RBT_range_aggregate(&tree, 0, RBT_KEY_MAX, &result) && result.count == 4 );
+    TEST_CHECK( RBT_set_capacity(&tree, 2, RBT_EVICT_LEAST_RECENT, log_eviction, &log) );
+    TEST_CHECK( tree.node_count == 2 && RBT_find(&tree, 11) != NULL && RBT_find(&tree, 12) != NULL );
+    RBT_test_is_RB_tree(&tree);
+    RBT_deinit_tree(&tree, nofree);
+}
+
+void RBT_test_sequence() {
+    static int values[2048];
+    static int *model[4096];
+    struct RBT_Tree sequence, rest;
+    uintmax_t length = 0;
+
+    TEST_CHECK( RBT_sequence_init(&sequence) );
+    TEST_CHECK( RBT_sequence_insert_at(&sequence, 1, &values[0]) == NULL );
+    TEST_CHECK( RBT_sequence_get(&sequence, 0) == NULL );
+
+    // key operations and options would break the position order, so sequences refuse them
+    TEST_CHECK( RBT_add(&sequence, 0, &values[0]) == NULL && RBT_find(&sequence, 0) == NULL );
+    TEST_CHECK( !RBT_delete(&sequence, 0) && !RBT_set_augment(&sequence, NULL) );
+    TEST_CHECK( !RBT_set_hash_index(&sequence, 1) && !RBT_set_lazy_delete(&sequence, 50) );
+    TEST_CHECK( !RBT_set_capacity(&sequence, 10, RBT_EVICT_MINIMUM, NULL, NULL) );
+    TEST_CHECK( sequence.node_count == 0 && sequence.augment != NULL );
+
+    // random edits checked against an array
+    srand(37);
+    for ( int i = 0; i < 6000; ++i ) {
+        if ( length > 0 && rand() % 3 == 0 ) {
+            uintmax_t position = rand() % length;
+            TEST_CHECK( RBT_sequence_erase_at(&sequence, position) );
+            for ( uintmax_t j = position; j + 1 < length; ++j ) {
+                model[j] = model[j + 1];
+            }
+            length--;
+        } else {
+            uintmax_t position = rand() % (length + 1);
+            int *value = &values[i % 2048];
+            TEST_CHECK( RBT_sequence_insert_at(&sequence, position, value) == value );
+            for ( uintmax_t j = length; j > position; --j ) {
+                model[j] = model[j - 1];
+            }
+            model[position] = value;
+            length++;
+        }
+    }
+    TEST_CHECK( sequence.node_count == length );
+    TEST_CHECK( !RBT_sequence_erase_at(&sequence, length) );
+    for ( uintmax_t j = 0; j < length; ++j ) {
+        TEST_CHECK_( RBT_sequence_get(&sequence, j) == model[j], "element at %ju", j );
+    }
+    RBT_test_is_RB_tree(&sequence);
+
+    // splitting in the middle and joining the halves in the opposite order
+    uintmax_t middle = length / 3;
+    TEST_CHECK( !RBT_sequence_split(&sequence, middle, &sequence) );
+    RBT_init_tree(&rest);
+    TEST_CHECK( RBT_sequence_split(&sequence, middle, &rest) );
+    TEST_CHECK( sequence.node_count == middle && rest.node_count == length - middle );
+    RBT_test_is_RB_tree(&sequence);
+    RBT_test_is_RB_tree(&rest);
+    TEST_CHECK( RBT_sequence_get(&rest, 0) == model[middle] );
+    TEST_CHECK( RBT_sequence_concat(&rest, &sequence) );
+    TEST_CHECK( sequence.node_count == 0 && sequence.root == NULL && rest.node_count == length );
+    RBT_test_is_RB_tree(&rest);
+    TEST_CHECK( has_consistent_links(rest.root, 0, 0) );
+    for ( uintmax_t j = 0; j < length; ++j ) {
+        TEST_CHECK( RBT_sequence_get(&rest, j) == model[(j + middle) % length] );
+    }
+    TEST_CHECK( RBT_sequence_split(&rest, length, &sequence) && sequence.node_count == 0 );
+    TEST_CHECK( !RBT_sequence_split(&rest, length + 1, &sequence) );
+    TEST_CHECK( !RBT_sequence_split(&sequence, 0, &rest) && rest.node_count == length );
+
+    RBT_deinit_tree(&rest, nofree);
+    RBT_deinit_tree(&sequence, nofree);
+}
+
+// rank of a WAVL subtree, deduced from the rank parities, or -2 if the rank rule is broken
+static int wavl_rank(struct RBT_Node *node) {
+    if ( node == NULL ) {
+        return -1;
+    }
+    int left = wavl_rank(node->left);
+    int right = wavl_rank(node->right);
+    if ( left < -1 || right < -1 ) {
+        return -2;
+    }
+    int low = left < right ? left : right;
+    int rank = (left > right ? left : right) + 1;
+    if ( ((rank & 1) != 0) != RBT_IS_RED(node) ) {
+        rank++;
+    }
+    if ( rank - low > 2 || (node->left == NULL && node->right == NULL && rank != 0) ) {
+        return -2;
+    }
+    return rank;
+}
+
+static int tree_height(struct RBT_Node *node) {
+    if ( node == NULL ) {
+        return 0;
+    }
+    int left = tree_height(node->left);
+    int right = tree_height(node->right);
+    return 1 + (left > right ? left : right);
+}
+
+void RBT_test_wavl_balance() {
+    static const struct RBT_Augment sum_augment = {
+        sizeof(struct RBT_test_sum), &sum_identity, sum_lift, sum_combine, NULL
+    };
+    static long int values[4096];
+    static char present[4096];
+    struct RBT_Tree tree, red_black;
+    struct RBT_test_sum result;
+
+    // ascending keys leave an AVL shaped tree well below the red-black one
+    RBT_init_tree(&tree);
+    RBT_init_tree(&red_black);
+    TEST_CHECK( RBT_set_balance(&tree, RBT_BALANCE_WAVL) );
+    for ( int key = 0; key < 4096; ++key ) {
+        values[key] = key;
+        RBT_add(&tree, key, &values[key]);
+        RBT_add(&red_black, key, &values[key]);
+    }
+    TEST_CHECK( !RBT_set_balance(&tree, RBT_BALANCE_RED_BLACK) );
+    TEST_CHECK( wavl_rank(tree.root) >= 0 );
+    TEST_CHECK_( tree_height(tree.root) == 13, "height %d", tree_height(tree.root) );
+    TEST_CHECK( tree_height(tree.root) < tree_height(red_black.root) );
+    RBT_deinit_tree(&tree, nofree);
+    RBT_deinit_tree(&red_black, nofree);
+
+    // random updates, keeping the ranks and aggregates in order
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_set_balance(&tree, RBT_BALANCE_WAVL) );
+    TEST_CHECK( RBT_set_augment(&tree, &sum_augment) );
+    srand(41);
+    for ( int i = 0; i < 20000; ++i ) {
+        int key = rand() % 4096;
+        if ( present[key] ) {
+            TEST_CHECK( RBT_delete(&tree, key) );
+        } else {
+            RBT_add(&tree, key, &values[key]);
+        }
+        present[key] = !present[key];
+    }
+    TEST_CHECK( wavl_rank(tree.root) >= 0 );
+    TEST_CHECK( has_consistent_links(tree.root, 0, RBT_KEY_MAX) );
+    TEST_CHECK( RBT_range_aggregate(&tree, 0, RBT_KEY_MAX, &result) && result.count == (long int) tree.node_count );
+    for ( int key = 0; key < 4096; ++key ) {
+        TEST_CHECK_( RBT_find(&tree, key) == (present[key] ? &values[key] : NULL), "key %d", key );
+    }
+
+    // ranges are unlinked one by one, and purging rebuilds with valid ranks
+    uintmax_t expected = 0;
+    for ( int key = 1000; key <= 2999; ++key ) {
+        expected += present[key];
+    }
+    TEST_CHECK( RBT_delete_range(&tree, 1000, 2999, NULL) == expected );
+    TEST_CHECK( wavl_rank(tree.root) >= 0 );
+    TEST_CHECK( has_consistent_links(tree.root, 0, RBT_KEY_MAX) );
+    TEST_CHECK( RBT_find(&tree, 999) == (present[999] ? &values[999] : NULL) && RBT_find(&tree, 1000) == NULL );
+    TEST_CHECK( RBT_set_lazy_delete(&tree, 101) );
+    for ( int key = 0; key < 1000; ++key ) {
+        RBT_delete(&tree, key);
+    }
+    TEST_CHECK( RBT_purge(&tree) > 0 );
+    TEST_CHECK( wavl_rank(tree.root) >= 0 );
+    TEST_CHECK( RBT_range_aggregate(&tree, 0, RBT_KEY_MAX, &result) && result.count == (long int) tree.node_count );
+    TEST_CHECK( RBT_set_lazy_delete(&tree, 0) );
+    while ( tree.root != NULL ) {
+        TEST_CHECK( RBT_delete(&tree, RBT_KEYVALUE(tree.root->key)) );
+    }
+    TEST_CHECK( tree.node_count == 0 );
+    RBT_deinit_tree(&tree, nofree);
+
+    TEST_CHECK( RBT_sequence_init(&tree) );
+    TEST_CHECK( !RBT_set_balance(&tree, RBT_BALANCE_WAVL) );
+    RBT_deinit_tree(&tree, nofree);
+}
+
+void RBT_test_lookup_filter() {
+    static long int values[8192];
+    static char present[8192];
+    struct RBT_Tree tree;
+    struct RBT_Finger finger = RBT_FINGER_INIT;
+
+    // enabling the filter on a filled tree, where it has to turn away nearly every miss
+    RBT_init_tree(&tree);
+    for ( int key = 0; key < 8192; key += 2 ) {
+        RBT_add(&tree, key, &values[key]);
+        present[key] = 1;
+    }
+    TEST_CHECK( RBT_set_lookup_filter(&tree, 1) );
+    int passed = 0;
+    for ( uintmax_t key = 1; key < 2000000; key += 2 ) {
+        passed += RBT_filter_may_contain(tree.extension->filter, key);
+    }
+    TEST_CHECK_( passed < 1000000 / 100, "%d of 1000000 misses passed", passed );
+    for ( int key = 0; key < 8192; ++key ) {
+        TEST_CHECK( RBT_find(&tree, key) == (present[key] ? &values[key] : NULL) );
+    }
+
+    // random updates, growing and shrinking the tree through rebuilds of the filter
+    TEST_CHECK( RBT_set_lazy_delete(&tree, 50) );
+    srand(47);
+    for ( int i = 0; i < 60000; ++i ) {
+        int key = rand() % (i < 30000 ? 8192 : 1024);
+        if ( present[key] && rand() % 2 ) {
+            TEST_CHECK( RBT_delete(&tree, key) );
+            present[key] = 0;
+        } else if ( !present[key] ) {
+            RBT_add(&tree, key, &values[key]);
+            present[key] = 1;
+        }
+    }
+    TEST_CHECK( RBT_OPTION(&tree, filter) != NULL && !RBT_filter_is_due(tree.extension->filter) );
+    TEST_CHECK( RBT_delete_range(&tree, 100, 199, NULL) > 0 );
+    memset(present + 100, 0, 100);
+    for ( int key = 0; key < 8192; ++key ) {
+        TEST_CHECK_( RBT_find(&tree, key) == (present[key] ? &values[key] : NULL), "key %d", key );
+        TEST_CHECK( RBT_finger_find(&tree, &finger, key) == (present[key] ? &values[key] : NULL) );
+    }
+
+    TEST_CHECK( RBT_set_lookup_filter(&tree, 0) && RBT_OPTION(&tree, filter) == NULL );
+    RBT_deinit_tree(&tree, nofree);
+}
+
+void RBT_test_memory_accounting() {
+    static long int values[4096];
+    struct RBT_Tree tree;
+    struct RBT_Memory_Usage usage, global, before;
+
+    RBT_get_global_memory_usage(&before);
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) );
+    TEST_CHECK( usage.nodes == 0 && usage.slack == 0 && usage.auxiliary == 0 );
+    for ( int key = 0; key < 4096; ++key ) {
+        RBT_add(&tree, key, &values[key]);
+    }
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) );
+    TEST_CHECK( usage.nodes == 4096 * sizeof(struct RBT_Node) );
+    RBT_get_global_memory_usage(&global);
+    TEST_CHECK( global.nodes - before.nodes == usage.nodes );
+    TEST_CHECK( global.slack - before.slack == usage.slack );
+
+    // the index and the filter count as auxiliary memory, and leave nothing behind
+    TEST_CHECK( RBT_set_hash_index(&tree, 1) && RBT_set_lookup_filter(&tree, 1) );
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) && usage.auxiliary > 4096 * sizeof(void *) );
+    RBT_get_global_memory_usage(&global);
+    TEST_CHECK( global.auxiliary - before.auxiliary == usage.auxiliary );
+    TEST_CHECK( RBT_set_hash_index(&tree, 0) && RBT_set_lookup_filter(&tree, 0) );
+    RBT_get_global_memory_usage(&global);
+    TEST_CHECK( global.auxiliary == before.auxiliary );
+
+    // deleting, purging and detaching nodes give their memory back
+    TEST_CHECK( RBT_delete(&tree, 0) );
+    TEST_CHECK( RBT_set_lazy_delete(&tree, 101) );
+    TEST_CHECK( RBT_delete(&tree, 1) && RBT_purge(&tree) == 1 );
+    TEST_CHECK( RBT_delete_range(&tree, 2, 1025, NULL) == 1024 );
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) );
+    TEST_CHECK( usage.nodes == 3070 * sizeof(struct RBT_Node) );
+    RBT_get_global_memory_usage(&global);
+    TEST_CHECK( global.nodes - before.nodes == usage.nodes );
+
+    // a budget turns additions away without touching the tree, but still lets dead nodes revive
+    TEST_CHECK( RBT_delete(&tree, 2000) );
+    TEST_CHECK( RBT_set_memory_budget(&tree, usage.nodes + usage.slack) );
+    TEST_CHECK( RBT_add(&tree, 0, &values[0]) == NULL );
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == 3069 && RBT_find(&tree, 0) == NULL );
+    TEST_CHECK( RBT_add(&tree, 2000, &values[2000]) == &values[2000] );
+    TEST_CHECK( RBT_set_memory_budget(&tree, 0) );
+    TEST_CHECK( RBT_add(&tree, 0, &values[0]) == &values[0] );
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == 3071 );
+
+    RBT_deinit_tree(&tree, nofree);
+    RBT_get_global_memory_usage(&global);
+    TEST_CHECK( global.nodes == before.nodes && global.slack == before.slack );
+    TEST_CHECK( global.auxiliary == before.auxiliary );
+}
+
+static int collect_keys(uintmax_t key, void *data, void *context) {
+    ((void) data);
+    uintmax_t *keys = context;
+    keys[++keys[0]] = key;
+    return 1;
+}
+
+void RBT_test_inline_entries() {
+    static long int values[16];
+    struct RBT_Tree tree;
+    struct RBT_Memory_Usage usage;
+    uintmax_t keys[16] = { 0 };
+    uintmax_t key;
+    void *value;
+
+    // the array lives in the extension, leaving the facade a single cache line on 64 bit systems
+    TEST_CHECK( sizeof(struct RBT_Tree) <= 8 * sizeof(uintmax_t) );
+    RBT_init_tree(&tree);
+    TEST_CHECK( tree.extension == NULL );
+    TEST_CHECK( RBT_set_inline_entries(&tree, 1) );
+    TEST_CHECK( RBT_add(&tree, 7, &values[7]) == &values[7] );
+    TEST_CHECK( RBT_add(&tree, 3, &values[3]) == &values[3] );
+    TEST_CHECK( RBT_add(&tree, 5, &values[5]) == &values[5] );
+    TEST_CHECK( RBT_add(&tree, 3, &values[4]) == &values[4] );
+
+    // a small tree allocates no nodes, yet behaves as one
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) && usage.nodes == 0 );
+    TEST_CHECK( tree.root == NULL && RBT_NODE_COUNT(&tree) == 4 );
+    TEST_CHECK( RBT_find(&tree, 5) == &values[5] && RBT_find(&tree, 6) == NULL );
+    TEST_CHECK( RBT_get_minimum(&tree, &key, &value) && key == 3 && value == &values[3] );
+    TEST_CHECK( RBT_get_maximum(&tree, &key, &value) && key == 7 && value == &values[7] );
+    TEST_CHECK( RBT_for_each(&tree, collect_keys, keys) && keys[0] == 4 );
+    TEST_CHECK( keys[1] == 3 && keys[2] == 3 && keys[3] == 5 && keys[4] == 7 );
+    TEST_CHECK( RBT_delete(&tree, 3) && RBT_find(&tree, 3) == &values[4] );
+    TEST_CHECK( !RBT_delete(&tree, 6) && RBT_NODE_COUNT(&tree) == 3 );
+
+    // outgrowing the array moves the elements into nodes, and deleting most of them moves them back
+    TEST_CHECK( RBT_add(&tree, 1, &values[1]) == &values[1] );
+    TEST_CHECK( RBT_add(&tree, 9, &values[9]) == &values[9] );
+    TEST_CHECK( tree.root != NULL && RBT_NODE_COUNT(&tree) == 5 );
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) && usage.nodes == 5 * sizeof(struct RBT_Node) );
+    TEST_CHECK( RBT_find(&tree, 3) == &values[4] && RBT_find(&tree, 9) == &values[9] );
+    TEST_CHECK( RBT_delete(&tree, 1) && RBT_delete(&tree, 9) && tree.root != NULL );
+    TEST_CHECK( RBT_delete(&tree, 7) && tree.root == NULL && RBT_NODE_COUNT(&tree) == 2 );
+    TEST_CHECK( RBT_get_minimum(&tree, &key, NULL) && key == 3 );
+    TEST_CHECK( RBT_get_maximum(&tree, &key, NULL) && key == 5 );
+
+    // options the array cannot serve turn inline entries off
+    TEST_CHECK( RBT_set_hash_index(&tree, 1) && !RBT_OPTION(&tree, inline_entries) && tree.root != NULL );
+    TEST_CHECK( RBT_find(&tree, 5) == &values[5] );
+    TEST_CHECK( !RBT_set_inline_entries(&tree, 1) );
+    TEST_CHECK( RBT_set_hash_index(&tree, 0) && RBT_set_inline_entries(&tree, 1) );
+    TEST_CHECK( tree.root == NULL && RBT_find(&tree, 3) == &values[4] );
+
+    RBT_deinit_tree(&tree, nofree);
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) && usage.nodes == 0 );
+}
+
+void RBT_test_reserve() {
+    static long int values[256];
+    struct RBT_Tree tree;
+    struct RBT_Memory_Usage usage, global, before;
+
+    RBT_get_global_memory_usage(&before);
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_reserve(&tree, 200) && RBT_OPTION(&tree, reserved) == 200 );
+    TEST_CHECK( RBT_reserve(&tree, 100) && RBT_OPTION(&tree, reserved) == 200 );
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) && usage.nodes == 0 );
+    TEST_CHECK( usage.auxiliary >= 200 * sizeof(struct RBT_Node) );
+
+    // additions draw from the reserve, moving its memory from auxiliary to nodes
+    for ( int key = 0; key < 150; ++key ) {
+        TEST_CHECK( RBT_add(&tree, key, &values[key]) == &values[key] );
+    }
+    TEST_CHECK( RBT_OPTION(&tree, reserved) == 50 && RBT_find(&tree, 149) == &values[149] );
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) && usage.nodes == 150 * sizeof(struct RBT_Node) );
+    RBT_get_global_memory_usage(&global);
+    TEST_CHECK( global.nodes - before.nodes == usage.nodes );
+    TEST_CHECK( global.auxiliary - before.auxiliary == usage.auxiliary );
+
+    // a budget with no room left still lets the reserved nodes be used, but refuses a bigger reserve
+    TEST_CHECK( RBT_set_memory_budget(&tree, usage.nodes + usage.slack + usage.auxiliary) );
+    TEST_CHECK( !RBT_reserve(&tree, 51) && RBT_OPTION(&tree, reserved) == 50 );
+    for ( int key = 150; key < 200; ++key ) {
+        TEST_CHECK( RBT_add(&tree, key, &values[key]) == &values[key] );
+    }
+    TEST_CHECK( RBT_OPTION(&tree, reserved) == 0 && RBT_add(&tree, 200, &values[200]) == NULL );
+    TEST_CHECK( RBT_set_memory_budget(&tree, 0) );
+
+    // an accepted reserve never leaves the tree over its budget, slack included
+    TEST_CHECK( RBT_get_memory_usage(&tree, &usage) );
+    uintmax_t budget = usage.nodes + usage.slack + usage.auxiliary + 10 * sizeof(struct RBT_Node);
+    TEST_CHECK( RBT_set_memory_budget(&tree, budget) );
+    TEST_CHECK( !RBT_reserve(&tree, 11) && RBT_OPTION(&tree, reserved) == 0 );
+    if ( RBT_reserve(&tree, 10) ) {
+        TEST_CHECK( RBT_get_memory_usage(&tree, &usage) );
+        TEST_CHECK( usage.nodes + usage.slack + usage.auxiliary <= budget );
+        TEST_CHECK( RBT_shrink_to_fit(&tree) == 10 );
+    }
+    TEST_CHECK( RBT_set_memory_budget(&tree, 0) );
+
+    TEST_CHECK( RBT_reserve(&tree, 10) && RBT_shrink_to_fit(&tree) == 10 );
+    TEST_CHECK( RBT_OPTION(&tree, reserve) == NULL && RBT_shrink_to_fit(&tree) == 0 );
+    TEST_CHECK( RBT_reserve(&tree, 10) );
+    RBT_deinit_tree(&tree, nofree);
+    RBT_get_global_memory_usage(&global);
+    TEST_CHECK( global.nodes == before.nodes && global.auxiliary == before.auxiliary );
+
+    // reserved nodes are sized for the tree, so changing the node size drops them
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_reserve(&tree, 10) );
+    TEST_CHECK( RBT_set_capacity(&tree, 8, RBT_EVICT_LEAST_RECENT, NULL, NULL) && RBT_OPTION(&tree, reserved) == 0 );
+    RBT_deinit_tree(&tree, nofree);
+    RBT_get_global_memory_usage(&global);
+    TEST_CHECK( global.auxiliary == before.auxiliary );
+}
@@ -6,11 +6,28 @@
 
 #include "RBMacros.h"
 
+void RBT_test_is_RB_tree(struct RBT_Tree *tree);
+int RBT_has_even_black_height(struct RBT_Node *node);
+int RBT_red_has_black_children(struct RBT_Node *node);
+
 void RBT_test_insert(void);
 void RBT_test_find(void);
 void RBT_test_min_max(void);
 void RBT_test_min_max_null(void);
 void RBT_test_remove(void);
 void RBT_test_static_allocate_nodes(void);
+void RBT_test_remove_all(void);
+void RBT_test_range_aggregate(void);
+void RBT_test_lazy_delete(void);
+void RBT_test_hash_index(void);
+void RBT_test_finger_find(void);
+void RBT_test_delete_range(void);
+void RBT_test_capacity(void);
+void RBT_test_sequence(void);
+void RBT_test_wavl_balance(void);
+void RBT_test_lookup_filter(void);
+void RBT_test_memory_accounting(void);
+void RBT_test_inline_entries(void);
+void RBT_test_reserve(void);
 
 #endif
\ No newline at end of file
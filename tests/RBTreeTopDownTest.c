@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeTopDownTest.h"
+#include "RBMacros.h"
+
+static int RBT_TD_black_height(struct RBT_TD_Node *node) {
+    if ( node == NULL ) {
+        return 1;
+    }
+    if ( RBT_IS_RED(node) && (RBT_IS_RED(node->link[0]) || RBT_IS_RED(node->link[1])) ) {
+        return 0;
+    }
+    int left = RBT_TD_black_height(node->link[0]);
+    int right = RBT_TD_black_height(node->link[1]);
+    if ( left == 0 || left != right ) {
+        return 0;
+    }
+    return left + RBT_IS_BLACK(node);
+}
+
+static void RBT_test_is_TD_tree(struct RBT_TD_Tree *tree) {
+    TEST_CHECK_( RBT_IS_BLACK(tree->root), "RB properties: root is not black" );
+    TEST_CHECK_( RBT_TD_black_height(tree->root) != 0, "RB properties: red violation or unequal black height" );
+}
+
+void RBT_test_top_down_operations() {
+    static int values[2048];
+    static int present[2048];
+    struct RBT_TD_Tree tree;
+
+    TEST_CHECK( sizeof(struct RBT_TD_Node) < sizeof(struct RBT_Node) );
+    RBT_TD_init_tree(&tree);
+
+    srand(5);
+    for ( int i = 0; i < 20000; ++i ) {
+        int key = rand() % 2048;
+        if ( present[key] ) {
+            TEST_CHECK( RBT_TD_delete(&tree, key) );
+            present[key] = 0;
+        } else {
+            TEST_CHECK( RBT_TD_add(&tree, key, &values[key]) == &values[key] );
+            present[key] = 1;
+        }
+        if ( i % 500 == 0 ) {
+            RBT_test_is_TD_tree(&tree);
+        }
+    }
+    RBT_test_is_TD_tree(&tree);
+
+    uintmax_t count = 0;
+    int minimum = -1, maximum = -1;
+    for ( int key = 0; key < 2048; ++key ) {
+        void *found = RBT_TD_find(&tree, key);
+        TEST_CHECK( found == (present[key] ? &values[key] : NULL) );
+        if ( present[key] ) {
+            count++;
+            minimum = minimum < 0 ? key : minimum;
+            maximum = key;
+        }
+    }
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == count );
+    TEST_CHECK( !RBT_TD_delete(&tree, 4096) );
+
+    uintmax_t key;
+    void *value;
+    TEST_CHECK( RBT_TD_get_minimum(&tree, &key, &value) && key == (uintmax_t) minimum && value == &values[minimum] );
+    TEST_CHECK( RBT_TD_get_maximum(&tree, &key, NULL) && key == (uintmax_t) maximum );
+
+    for ( int key = 0; key < 2048; ++key ) {
+        TEST_CHECK( RBT_TD_delete(&tree, key) == present[key] );
+    }
+    TEST_CHECK( tree.root == NULL && RBT_NODE_COUNT(&tree) == 0 );
+
+    RBT_TD_deinit_tree(&tree, NULL);
+}
+
+void RBT_test_top_down_duplicates() {
+    struct RBT_TD_Tree tree;
+    RBT_TD_init_tree(&tree);
+
+    for ( int i = 0; i < 64; ++i ) {
+        RBT_TD_add(&tree, i % 4, NULL);
+    }
+    RBT_test_is_TD_tree(&tree);
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == 64 );
+
+    int deleted = 0;
+    while ( RBT_TD_delete(&tree, 2) ) {
+        deleted++;
+        RBT_test_is_TD_tree(&tree);
+    }
+    TEST_CHECK( deleted == 16 );
+    TEST_CHECK( RBT_NODE_COUNT(&tree) == 48 );
+
+    RBT_TD_deinit_tree(&tree, NULL);
+}
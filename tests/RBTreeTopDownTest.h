@@ -0,0 +1,9 @@
+#ifndef _HEADER_FILE_RBTreeTopDownTest_20261019161954_
+#define _HEADER_FILE_RBTreeTopDownTest_20261019161954_
+
+#include "RBTree/RBTreeTopDown.h"
+
+void RBT_test_top_down_operations(void);
+void RBT_test_top_down_duplicates(void);
+
+#endif
@@ -0,0 +1,96 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "cutest/pub_cutest.h"
+#include "RBTreeTraceTest.h"
+
+static struct RBT_Trace trace;
+
+static void trace_test_path(char *path, size_t size, const char *name) {
+    const char *directory = getenv("TMPDIR");
+    snprintf(path, size, "%s/rbt_%s_%ld.trace", directory ? directory : "/tmp", name, (long) rand());
+}
+
+// records adds of every key, a find and a delete of every third, and the extremes
+static void record_workload(struct RBT_Tree *tree, int keys) {
+    static long int value;
+    for ( int key = 0; key < keys; ++key ) {
+        RBT_add(tree, (uintmax_t) key << 40, &value);
+        if ( key % 3 == 0 ) {
+            RBT_find(tree, (uintmax_t) key << 40);
+            RBT_delete(tree, (uintmax_t) key << 40);
+        }
+    }
+    RBT_get_minimum(tree, NULL, NULL);
+    RBT_get_maximum(tree, NULL, NULL);
+}
+
+void RBT_test_trace_round_trip() {
+    struct RBT_Tree tree;
+    struct RBT_Trace_Event event;
+    char path[256];
+
+    trace_test_path(path, sizeof(path), "round_trip");
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_trace_open(&trace, path) );
+    TEST_CHECK( RBT_set_trace(&tree, &trace) );
+    record_workload(&tree, 30000);
+    TEST_CHECK( RBT_set_trace(&tree, NULL) );
+    RBT_find(&tree, 1);
+    TEST_CHECK( trace.event_count == 30000 + 2 * 10000 + 2 );
+    TEST_CHECK( RBT_trace_close(&trace) );
+    RBT_deinit_tree(&tree, NULL);
+
+    TEST_CHECK( RBT_trace_open_read(&trace, path) );
+    uint64_t previous = 0;
+    int ordered = 1;
+    for ( int key = 0; key < 30000; ++key ) {
+        TEST_CHECK( RBT_trace_read(&trace, &event) && event.operation == RBT_TRACE_ADD );
+        TEST_CHECK( event.key == (uintmax_t) key << 40 );
+        ordered &= event.timestamp >= previous;
+        previous = event.timestamp;
+        if ( key % 3 == 0 ) {
+            TEST_CHECK( RBT_trace_read(&trace, &event) && event.operation == RBT_TRACE_FIND );
+            TEST_CHECK( RBT_trace_read(&trace, &event) && event.operation == RBT_TRACE_DELETE );
+            TEST_CHECK( event.key == (uintmax_t) key << 40 );
+        }
+    }
+    TEST_CHECK( ordered );
+    TEST_CHECK( RBT_trace_read(&trace, &event) && event.operation == RBT_TRACE_MINIMUM && event.key == 0 );
+    TEST_CHECK( RBT_trace_read(&trace, &event) && event.operation == RBT_TRACE_MAXIMUM );
+    TEST_CHECK( !RBT_trace_read(&trace, &event) );
+    TEST_CHECK( RBT_trace_close(&trace) );
+    remove(path);
+}
+
+void RBT_test_trace_truncated() {
+    struct RBT_Tree tree;
+    struct RBT_Trace_Event event;
+    char path[256];
+
+    trace_test_path(path, sizeof(path), "truncated");
+    RBT_init_tree(&tree);
+    TEST_CHECK( RBT_trace_open(&trace, path) );
+    TEST_CHECK( RBT_set_trace(&tree, &trace) );
+    record_workload(&tree, 100);
+    TEST_CHECK( RBT_trace_close(&trace) );
+    RBT_deinit_tree(&tree, NULL);
+
+    // a record torn by the recording process dying ends the trace, marking it as failed
+    FILE *file = fopen(path, "ab");
+    if ( TEST_CHECK( file != NULL ) ) {
+        fputc(RBT_TRACE_ADD, file);
+        fputc(0x80, file);
+        fclose(file);
+    }
+    TEST_CHECK( RBT_trace_open_read(&trace, path) );
+    int events = 0;
+    while ( RBT_trace_read(&trace, &event) ) {
+        events++;
+    }
+    TEST_CHECK_( events == 100 + 2 * 34 + 2, "%d events", events );
+    TEST_CHECK( !RBT_trace_close(&trace) );
+
+    // files without the trace magic are turned away
+    TEST_CHECK( !RBT_trace_open_read(&trace, "/dev/null") );
+    remove(path);
+}
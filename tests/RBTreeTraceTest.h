@@ -0,0 +1,9 @@
+#ifndef _HEADER_FILE_RBTreeTraceTest_20261019190958_
+#define _HEADER_FILE_RBTreeTraceTest_20261019190958_
+
+#include "RBTree/RBTreeTrace.h"
+
+void RBT_test_trace_round_trip(void);
+void RBT_test_trace_truncated(void);
+
+#endif
@@ -0,0 +1,196 @@
+/**
+ * Trace replayer
+ *
+ * Replays a trace recorded with RBT_set_trace against this build of the library, and reports
+ * the throughput along with percentiles of the latency of every call. Calls are issued back
+ * to back by default, or at the times they were recorded at with --paced.
+ *
+ * usage: redblacktree_replay [--paced] [--wavl] [--index] [--filter] [--lazy-delete PERCENT] TRACE
+ **/
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "RBTree/RBTree.h"
+#include "RBTree/RBTreeTrace.h"
+
+struct RBT_Replay_Options {
+    int paced;
+    int wavl;
+    int index;
+    int filter;
+    unsigned purge_percent;
+    const char *path;
+};
+
+static char RBT_replay_value;
+
+static uint64_t RBT_replay_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * UINT64_C(1000000000) + (uint64_t) now.tv_nsec;
+}
+
+// sleeps most of the way to the deadline, and spins the rest, as sleeps overshoot
+static void RBT_replay_wait_until(uint64_t deadline) {
+    for ( uint64_t now = RBT_replay_clock(); now < deadline; now = RBT_replay_clock() ) {
+        if ( deadline - now > 200000 ) {
+            // nanosleep refuses more than a second in tv_nsec
+            uint64_t gap = deadline - now - 100000;
+            struct timespec pause = { (time_t) (gap / UINT64_C(1000000000)), (long) (gap % UINT64_C(1000000000)) };
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+static int RBT_replay_compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static int RBT_replay_parse(int argc, char **argv, struct RBT_Replay_Options *options) {
+    memset(options, 0, sizeof(*options));
+    for ( int i = 1; i < argc; ++i ) {
+        if ( strcmp(argv[i], "--paced") == 0 ) {
+            options->paced = 1;
+        } else if ( strcmp(argv[i], "--wavl") == 0 ) {
+            options->wavl = 1;
+        } else if ( strcmp(argv[i], "--index") == 0 ) {
+            options->index = 1;
+        } else if ( strcmp(argv[i], "--filter") == 0 ) {
+            options->filter = 1;
+        } else if ( strcmp(argv[i], "--lazy-delete") == 0 && i + 1 < argc ) {
+            options->purge_percent = (unsigned) strtoul(argv[++i], NULL, 10);
+        } else if ( argv[i][0] != '-' && options->path == NULL ) {
+            options->path = argv[i];
+        } else {
+            return 0;
+        }
+    }
+    return options->path != NULL;
+}
+
+// loads the whole trace up front, so reading it does not count towards the replay
+static struct RBT_Trace_Event *RBT_replay_load(const char *path, size_t *count) {
+    static struct RBT_Trace trace;
+    struct RBT_Trace_Event *events = NULL;
+    size_t capacity = 0;
+
+    *count = 0;
+    if ( !RBT_trace_open_read(&trace, path) ) {
+        fprintf(stderr, "%s: not a readable trace\n", path);
+        return NULL;
+    }
+    for ( ;; ) {
+        if ( *count == capacity ) {
+            capacity = capacity ? capacity * 2 : 4096;
+            struct RBT_Trace_Event *grown = realloc(events, capacity * sizeof(struct RBT_Trace_Event));
+            if ( grown == NULL ) {
+                fprintf(stderr, "out of memory after %zu events\n", *count);
+                break;
+            }
+            events = grown;
+        }
+        if ( !RBT_trace_read(&trace, &events[*count]) ) {
+            break;
+        }
+        ++*count;
+    }
+    if ( !RBT_trace_close(&trace) ) {
+        fprintf(stderr, "%s: trace is truncated after %zu events\n", path, *count);
+    }
+    return events;
+}
+
+static void RBT_replay_report(const char *name, uint64_t *latencies, size_t count) {
+    static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+    if ( count == 0 ) {
+        return;
+    }
+    qsort(latencies, count, sizeof(uint64_t), RBT_replay_compare);
+    printf("%-8s %12zu calls", name, count);
+    for ( size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i ) {
+        size_t rank = (size_t) (percentiles[i] / 100.0 * (double) (count - 1));
+        printf("  p%g %8llu ns", percentiles[i], (unsigned long long) latencies[rank]);
+    }
+    printf("  max %8llu ns\n", (unsigned long long) latencies[count - 1]);
+}
+
+
+int main(int argc, char **argv) {
+    static const char *names[] = { "all", "add", "find", "delete", "minimum", "maximum" };
+    struct RBT_Replay_Options options;
+    struct RBT_Tree tree;
+    size_t count;
+
+    if ( !RBT_replay_parse(argc, argv, &options) ) {
+        fprintf(stderr, "usage: %s [--paced] [--wavl] [--index] [--filter] [--lazy-delete PERCENT] TRACE\n", argv[0]);
+        return 2;
+    }
+    struct RBT_Trace_Event *events = RBT_replay_load(options.path, &count);
+    uint64_t *latencies = malloc( (count ? count : 1) * sizeof(uint64_t) * 2 );
+    if ( events == NULL || latencies == NULL ) {
+        free(events);
+        free(latencies);
+        return 1;
+    }
+
+    RBT_init_tree(&tree);
+    if ( (options.wavl && !RBT_set_balance(&tree, RBT_BALANCE_WAVL)) ||
+         (options.index && !RBT_set_hash_index(&tree, 1)) ||
+         (options.filter && !RBT_set_lookup_filter(&tree, 1)) ||
+         (options.purge_percent && !RBT_set_lazy_delete(&tree, options.purge_percent)) ) {
+        fprintf(stderr, "could not configure the tree\n");
+        return 1;
+    }
+
+    uint64_t start = RBT_replay_clock();
+    for ( size_t i = 0; i < count; ++i ) {
+        const struct RBT_Trace_Event *event = &events[i];
+        if ( options.paced ) {
+            RBT_replay_wait_until(start + event->timestamp);
+        }
+        uint64_t issued = RBT_replay_clock();
+        switch ( event->operation ) {
+        case RBT_TRACE_ADD:
+            RBT_add(&tree, event->key, &RBT_replay_value);
+            break;
+        case RBT_TRACE_FIND:
+            RBT_find(&tree, event->key);
+            break;
+        case RBT_TRACE_DELETE:
+            RBT_delete(&tree, event->key);
+            break;
+        case RBT_TRACE_MINIMUM:
+            RBT_get_minimum(&tree, NULL, NULL);
+            break;
+        case RBT_TRACE_MAXIMUM:
+            RBT_get_maximum(&tree, NULL, NULL);
+            break;
+        }
+        latencies[i] = RBT_replay_clock() - issued;
+    }
+    double seconds = (double) (RBT_replay_clock() - start) / 1e9;
+
+    printf("%zu calls in %.3f s, %.0f calls/s, %ju elements left\n",
+        count, seconds, seconds > 0 ? (double) count / seconds : 0.0, RBT_NODE_COUNT(&tree));
+    // the second half of the buffer gathers the latencies of one operation at a time
+    for ( int operation = RBT_TRACE_ADD; operation <= RBT_TRACE_MAXIMUM; ++operation ) {
+        size_t matching = 0;
+        for ( size_t i = 0; i < count; ++i ) {
+            if ( events[i].operation == (enum RBT_Trace_Operation) operation ) {
+                latencies[count + matching++] = latencies[i];
+            }
+        }
+        RBT_replay_report(names[operation], latencies + count, matching);
+    }
+    RBT_replay_report(names[0], latencies, count);
+
+    RBT_deinit_tree(&tree, NULL);
+    free(latencies);
+    free(events);
+    return 0;
+}